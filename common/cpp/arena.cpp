@@ -0,0 +1,187 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include "arena.h"
+#include "parson.h"
+#include "thread_slot.h"
+
+namespace tcf {
+
+    // Alignment of all allocations, enough for any type
+    static const size_t ARENA_ALIGNMENT = 16;
+
+    static size_t AlignUp(size_t size) {
+        return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    }  // AlignUp
+
+    // Header of a chunk, the allocations follow it
+    struct Arena::Chunk {
+        Chunk* next;
+        uint8_t* data;
+    };
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    Arena::Arena(size_t chunk_size) :
+        chunk_size_(AlignUp(chunk_size)), chunks_(nullptr),
+        next_(nullptr), end_(nullptr) {
+    }  // Arena::Arena
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    Arena::~Arena() {
+        while (chunks_ != nullptr) {
+            Chunk* next = chunks_->next;
+            free(chunks_);
+            chunks_ = next;
+        }
+    }  // Arena::~Arena
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void* Arena::Allocate(size_t size) {
+        if (size > chunk_size_ / 4) {
+            return nullptr;
+        }
+        // Distinct pointers for empty allocations too
+        size = size ? AlignUp(size) : ARENA_ALIGNMENT;
+        if ((size_t) (end_ - next_) < size && !AddChunk()) {
+            return nullptr;
+        }
+        void* p = next_;
+        next_ += size;
+        return p;
+    }  // Arena::Allocate
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    bool Arena::Owns(const void* p) const {
+        const uint8_t* byte = (const uint8_t*) p;
+        for (const Chunk* chunk = chunks_; chunk != nullptr;
+                chunk = chunk->next) {
+            if (byte >= chunk->data && byte < chunk->data + chunk_size_) {
+                return true;
+            }
+        }
+        return false;
+    }  // Arena::Owns
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void Arena::Reset() {
+        if (chunks_ == nullptr) {
+            return;
+        }
+        while (chunks_->next != nullptr) {
+            Chunk* next = chunks_->next;
+            free(chunks_);
+            chunks_ = next;
+        }
+        next_ = chunks_->data;
+        end_ = next_ + chunk_size_;
+    }  // Arena::Reset
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Start allocating from a new chunk, the rest of the current one is
+    // left unused
+    bool Arena::AddChunk() {
+        size_t header = AlignUp(sizeof(Chunk));
+        Chunk* chunk = (Chunk*) malloc(header + chunk_size_);
+        if (chunk == nullptr) {
+            return false;
+        }
+        chunk->next = chunks_;
+        chunk->data = (uint8_t*) chunk + header;
+        chunks_ = chunk;
+        next_ = chunk->data;
+        end_ = next_ + chunk_size_;
+        return true;
+    }  // Arena::AddChunk
+
+    // Arena of a thread and the number of scopes open on it
+    struct ThreadArena {
+        Arena arena;
+        unsigned int depth = 0;
+        // Number of JsonArenaScopes open
+        unsigned int json_depth = 0;
+    };
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    static ThreadArena& GetThreadArenaState() {
+#ifdef _UNTRUSTED_
+        static thread_local ThreadArena state;
+        return state;
+#else
+        // Thread local storage does not outlive an ecall, the arena and its
+        // kept chunk are held for each TCS instead (see thread_slot.h)
+        static ThreadSlots<ThreadArena> states;
+        return states.Get();
+#endif
+    }  // GetThreadArenaState
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    ArenaScope::ArenaScope() {
+        GetThreadArenaState().depth++;
+    }  // ArenaScope::ArenaScope
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    ArenaScope::~ArenaScope() {
+        ThreadArena& state = GetThreadArenaState();
+        if (--state.depth == 0) {
+            state.arena.Reset();
+        }
+    }  // ArenaScope::~ArenaScope
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // parson allocation function, the heap unless a JsonArenaScope is
+    // open. ArenaFree() frees values from either.
+    static void* JsonMalloc(size_t size) {
+        return GetThreadArenaState().json_depth > 0 ?
+            ArenaMalloc(size) : malloc(size);
+    }  // JsonMalloc
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    JsonArenaScope::JsonArenaScope() {
+        // Installed once for all threads, it only changes the allocations
+        // of threads with a scope open
+        static const bool json_allocator_set =
+            (json_set_allocation_functions(JsonMalloc, ArenaFree), true);
+        (void) json_allocator_set;
+        GetThreadArenaState().json_depth++;
+    }  // JsonArenaScope::JsonArenaScope
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    JsonArenaScope::~JsonArenaScope() {
+        GetThreadArenaState().json_depth--;
+    }  // JsonArenaScope::~JsonArenaScope
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    Arena* GetThreadArena() {
+        ThreadArena& state = GetThreadArenaState();
+        return state.depth > 0 ? &state.arena : nullptr;
+    }  // GetThreadArena
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void* ArenaMalloc(size_t size) {
+        Arena* arena = GetThreadArena();
+        void* p = arena ? arena->Allocate(size) : nullptr;
+        return p ? p : malloc(size);
+    }  // ArenaMalloc
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void ArenaFree(void* p) {
+        Arena* arena = GetThreadArena();
+        if (arena == nullptr || !arena->Owns(p)) {
+            free(p);
+        }
+    }  // ArenaFree
+}  // namespace tcf
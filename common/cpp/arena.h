@@ -0,0 +1,175 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon arena allocation for the short-lived allocations of a work order.
+ *
+ * While an ArenaScope is open, small allocations of the thread through
+ * ArenaMalloc() or ArenaAllocator are taken one after the other from large
+ * chunks instead of the heap, and freeing them does nothing. Closing the
+ * scope releases all of them at once. The many small allocations of a work
+ * order then no longer fragment the enclave heap between longer-lived
+ * allocations.
+ *
+ * Memory allocated in a scope must be freed before the scope is closed,
+ * or not at all. Outside of a scope, and for large allocations, the heap
+ * is used as usual.
+ *
+ * parson allocates from the arena only on threads with a JsonArenaScope
+ * open, for the JSON documents of a work order which do not outlive it.
+ * Other JSON values, of workloads keeping them or of other threads, are
+ * allocated from the heap.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <string>
+#include <vector>
+
+// Size of the chunks of the arena of a thread, the first of which is kept
+// for the next scope. Larger allocations than a quarter of it are taken
+// from the heap.
+#ifndef ARENA_CHUNK_SIZE
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#endif
+
+namespace tcf {
+    class Arena {
+    public:
+        explicit Arena(size_t chunk_size = ARENA_CHUNK_SIZE);
+        ~Arena();
+
+        /**
+         * Allocate size bytes aligned for any type. Returns nullptr if the
+         * allocation is too large for the arena or memory is exhausted.
+         */
+        void* Allocate(size_t size);
+
+        /** Whether p points into memory of the arena */
+        bool Owns(const void* p) const;
+
+        /**
+         * Release all allocations. The first chunk is kept, the others
+         * are returned to the heap.
+         */
+        void Reset();
+
+    private:
+        Arena(const Arena&);
+        Arena& operator=(const Arena&);
+
+        struct Chunk;
+        bool AddChunk();
+
+        size_t chunk_size_;
+        // Newest chunk first, the kept chunk last
+        Chunk* chunks_;
+        uint8_t* next_;
+        uint8_t* end_;
+    };  // class Arena
+
+    /**
+     * Opens the arena of the calling thread until it is destroyed. Scopes
+     * may be nested, the arena is reset when the outermost one is closed.
+     */
+    class ArenaScope {
+    public:
+        ArenaScope();
+        ~ArenaScope();
+
+    private:
+        ArenaScope(const ArenaScope&);
+        ArenaScope& operator=(const ArenaScope&);
+    };  // class ArenaScope
+
+    /**
+     * Allocates the JSON values parson creates on the calling thread from
+     * its arena until it is destroyed, if an ArenaScope is open. The
+     * values must be freed, or no longer used, before the ArenaScope is
+     * closed. Scopes may be nested.
+     */
+    class JsonArenaScope {
+    public:
+        JsonArenaScope();
+        ~JsonArenaScope();
+
+    private:
+        JsonArenaScope(const JsonArenaScope&);
+        JsonArenaScope& operator=(const JsonArenaScope&);
+    };  // class JsonArenaScope
+
+    /** Returns the arena of the calling thread, nullptr outside a scope */
+    Arena* GetThreadArena();
+
+    /**
+     * malloc() and free() replacements allocating from the arena of the
+     * calling thread in a scope
+     */
+    void* ArenaMalloc(size_t size);
+    void ArenaFree(void* p);
+
+    /**
+     * STL allocator allocating from the arena of the calling thread in a
+     * scope, and with operator new otherwise
+     */
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        typedef T value_type;
+
+        ArenaAllocator() {}
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U>&) {}
+
+        T* allocate(size_t n) {
+            if (n > SIZE_MAX / sizeof(T)) {
+                throw std::bad_alloc();
+            }
+            Arena* arena = GetThreadArena();
+            void* p = arena ? arena->Allocate(n * sizeof(T)) : nullptr;
+            if (p == nullptr) {
+                p = ::operator new(n * sizeof(T));
+            }
+            return static_cast<T*>(p);
+        }
+
+        void deallocate(T* p, size_t) {
+            Arena* arena = GetThreadArena();
+            if (arena == nullptr || !arena->Owns(p)) {
+                ::operator delete(p);
+            }
+        }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U>&) const {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U>&) const {
+            return false;
+        }
+    };  // class ArenaAllocator
+
+    template<typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    typedef std::basic_string<char, std::char_traits<char>,
+        ArenaAllocator<char>> ArenaString;
+}  // namespace tcf
@@ -18,16 +18,19 @@
  * Avalon Crypto Utility header files.
  * Common header files for Avalon crypto functions.
  * These are for hasing, random numbers, signing, verification,
- * secret key encryption, and public key encryption.
+ * secret key encryption, public key encryption, and key agreement.
  */
 
 
 #pragma once
 #include "crypto_utils.h"
+#include "ecdh.h"
 #include "pkenc.h"
 #include "pkenc_private_key.h"
 #include "pkenc_public_key.h"
+#include "random_generator.h"
 #include "sig.h"
 #include "sig_private_key.h"
 #include "sig_public_key.h"
+#include "sig_signer.h"
 #include "skenc.h"
@@ -21,6 +21,7 @@
  */
 
 #include <openssl/err.h>
+#include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
 
@@ -86,3 +87,70 @@ ByteArray pcrypto::ComputeMessageHash(const ByteArray& message) {
     SHA256((const unsigned char*)message.data(), message.size(), hash.data());
     return hash;
 }  // pcrypto::ComputeMessageHash
+
+
+struct pcrypto::MessageHasher::Context {
+    EVP_MD_CTX* md_ctx;
+};
+
+
+/**
+ * Start incremental SHA256 hashing.
+ * Throws RuntimeError.
+ */
+pcrypto::MessageHasher::MessageHasher() : context_(new Context()) {
+    context_->md_ctx = EVP_MD_CTX_new();
+    if (context_->md_ctx == nullptr) {
+        std::string msg("Crypto Error (MessageHasher): OpenSSL could not "
+            "create new EVP_MD_CTX");
+        throw Error::RuntimeError(msg);
+    }
+    if (EVP_DigestInit_ex(context_->md_ctx, EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(context_->md_ctx);
+        std::string msg("Crypto Error (MessageHasher): OpenSSL could not "
+            "initialize SHA256");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::MessageHasher::MessageHasher
+
+
+pcrypto::MessageHasher::~MessageHasher() {
+    EVP_MD_CTX_free(context_->md_ctx);
+}  // pcrypto::MessageHasher::~MessageHasher
+
+
+/**
+ * Add the next piece of the message to the hash.
+ * Throws RuntimeError.
+ *
+ * @param data Next piece of the message
+ * @param size Size of the piece in bytes
+ */
+void pcrypto::MessageHasher::Update(const uint8_t* data, size_t size) {
+    if (EVP_DigestUpdate(context_->md_ctx, data, size) != 1) {
+        std::string msg("Crypto Error (MessageHasher): OpenSSL could not "
+            "update SHA256");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::MessageHasher::Update
+
+
+/**
+ * Return the SHA256 hash of all pieces of the message and reset the
+ * hasher for a new message.
+ * Throws RuntimeError.
+ *
+ * @returns byte array containing binary hash of the message
+ */
+ByteArray pcrypto::MessageHasher::Finalize() {
+    ByteArray hash(constants::DIGEST_LENGTH);
+    unsigned int hash_len = 0;
+
+    if (EVP_DigestFinal_ex(context_->md_ctx, hash.data(), &hash_len) != 1 ||
+            EVP_DigestInit_ex(context_->md_ctx, EVP_sha256(), nullptr) != 1) {
+        std::string msg("Crypto Error (MessageHasher): OpenSSL could not "
+            "finalize SHA256");
+        throw Error::RuntimeError(msg);
+    }
+    return hash;
+}  // pcrypto::MessageHasher::Finalize
@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <memory>
+#include <string>
 #include <vector>
 #include "types.h"
 
@@ -35,6 +38,47 @@ namespace crypto {
 
     ByteArray ComputeMessageHash(const ByteArray& message);
 
+    /**
+     * SHA256 hashing of several independent messages at once, faster
+     * than hashing them one by one where the CPU allows it. Returns the
+     * same digests as ComputeMessageHash() of each message, in order.
+     */
+    std::vector<ByteArray> ComputeMessageHashes(
+        const std::vector<const ByteArray*>& messages);
+    std::vector<ByteArray> ComputeMessageHashes(
+        const std::vector<ByteArray>& messages);
+
+    /**
+     * Incremental SHA256 hashing of data passed in pieces. The digest
+     * is the same as ComputeMessageHash() of all pieces concatenated.
+     * Throws RuntimeError.
+     */
+    class MessageHasher {
+    public:
+        MessageHasher();
+        ~MessageHasher();
+
+        void Update(const uint8_t* data, size_t size);
+
+        void Update(const ByteArray& data) {
+            Update(data.data(), data.size());
+        }
+
+        void Update(const std::string& data) {
+            Update((const uint8_t*) data.data(), data.size());
+        }
+
+        /** Returns the digest and resets the hasher for a new message. */
+        ByteArray Finalize();
+
+    private:
+        MessageHasher(const MessageHasher&);
+        MessageHasher& operator=(const MessageHasher&);
+
+        struct Context;
+        std::unique_ptr<Context> context_;
+    };  // class MessageHasher
+
     /** Generate a cryptographically strong random bitstring. */
     // throws RuntimeError
     ByteArray RandomBitString(size_t length);
@@ -0,0 +1,262 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon ECDH key agreement functions: key generation, shared secret
+ * computation and HKDF key derivation. Used for secp256r1.
+ *
+ * Lower-level functions implemented using OpenSSL.
+ * See also ecdh_common.cpp for OpenSSL-independent code.
+ */
+
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/obj_mac.h>
+#include <memory>    // std::unique_ptr
+
+#include "crypto_shared.h"
+#include "ecdh.h"
+#include "error.h"
+
+#ifndef CRYPTOLIB_OPENSSL
+#error "CRYPTOLIB_OPENSSL must be defined to compile source with OpenSSL."
+#endif
+
+namespace pcrypto = tcf::crypto;
+
+// Typedefs for memory management
+// Specify type and destroy function type for unique_ptrs
+typedef std::unique_ptr<BN_CTX, void (*)(BN_CTX*)> BN_CTX_ptr;
+typedef std::unique_ptr<BIGNUM, void (*)(BIGNUM*)> BIGNUM_ptr;
+typedef std::unique_ptr<EC_KEY, void (*)(EC_KEY*)> EC_KEY_ptr;
+typedef std::unique_ptr<EC_GROUP, void (*)(EC_GROUP*)> EC_GROUP_ptr;
+typedef std::unique_ptr<EC_POINT, void (*)(EC_POINT*)> EC_POINT_ptr;
+typedef std::unique_ptr<EVP_PKEY_CTX, void (*)(EVP_PKEY_CTX*)> PKEY_CTX_ptr;
+
+// Error handling
+namespace Error = tcf::error;
+
+
+/**
+ * Utility function: convert an EC point to an uncompressed public key.
+ * Throws RuntimeError.
+ */
+static ByteArray pointToPublicKey(const EC_GROUP* group,
+        const EC_POINT* point, BN_CTX* context) {
+    ByteArray public_key(pcrypto::ecdh::PUBLIC_KEY_SIZE);
+    if (EC_POINT_point2oct(group, point, POINT_CONVERSION_UNCOMPRESSED,
+            public_key.data(), public_key.size(), context) !=
+            public_key.size()) {
+        std::string msg("Crypto Error (ecdh): Could not serialize EC point");
+        throw Error::RuntimeError(msg);
+    }
+    return public_key;
+}  // pointToPublicKey
+
+
+/**
+ * Zeroize a key.
+ */
+void pcrypto::ecdh::PrivateKey::cleanse(ByteArray& key) {
+    if (!key.empty()) {
+        OPENSSL_cleanse(key.data(), key.size());
+    }
+}  // pcrypto::ecdh::PrivateKey::cleanse
+
+
+/**
+ * Generate a secp256r1 private key.
+ * Throws RuntimeError.
+ */
+void pcrypto::ecdh::PrivateKey::Generate() {
+    EC_KEY_ptr key(EC_KEY_new_by_curve_name(NID_X9_62_prime256v1),
+        EC_KEY_free);
+    if (!key) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::Generate): "
+            "Could not create EC_KEY");
+        throw Error::RuntimeError(msg);
+    }
+    if (!EC_KEY_generate_key(key.get())) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::Generate): "
+            "Could not generate EC key");
+        throw Error::RuntimeError(msg);
+    }
+
+    ByteArray private_key(PRIVATE_KEY_SIZE);
+    if (BN_bn2binpad(EC_KEY_get0_private_key(key.get()),
+            private_key.data(), private_key.size()) !=
+            (int) private_key.size()) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::Generate): "
+            "Could not serialize private key");
+        throw Error::RuntimeError(msg);
+    }
+
+    BN_CTX_ptr context(BN_CTX_new(), BN_CTX_free);
+    if (!context) {
+        cleanse(private_key);
+        std::string msg("Crypto Error (ecdh::PrivateKey::Generate): "
+            "Could not create BN_CTX");
+        throw Error::RuntimeError(msg);
+    }
+    public_key_ = pointToPublicKey(EC_KEY_get0_group(key.get()),
+        EC_KEY_get0_public_key(key.get()), context.get());
+    cleanse(private_key_);
+    private_key_.swap(private_key);
+}  // pcrypto::ecdh::PrivateKey::Generate
+
+
+/**
+ * Compute the public key of private_key_.
+ * Throws RuntimeError, ValueError.
+ */
+void pcrypto::ecdh::PrivateKey::computePublicKey() {
+    EC_GROUP_ptr group(EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1),
+        EC_GROUP_free);
+    BN_CTX_ptr context(BN_CTX_new(), BN_CTX_free);
+    BIGNUM_ptr scalar(BN_secure_new(), BN_clear_free);
+    if (!group || !context || !scalar) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::computePublicKey): "
+            "Could not allocate EC context");
+        throw Error::RuntimeError(msg);
+    }
+
+    BN_bin2bn(private_key_.data(), private_key_.size(), scalar.get());
+    if (BN_is_zero(scalar.get()) ||
+            BN_cmp(scalar.get(), EC_GROUP_get0_order(group.get())) >= 0) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::computePublicKey): "
+            "Private key is out of range");
+        throw Error::ValueError(msg);
+    }
+
+    EC_POINT_ptr point(EC_POINT_new(group.get()), EC_POINT_free);
+    if (!point || !EC_POINT_mul(group.get(), point.get(), scalar.get(),
+            nullptr, nullptr, context.get())) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::computePublicKey): "
+            "Could not compute public key");
+        throw Error::RuntimeError(msg);
+    }
+    public_key_ = pointToPublicKey(group.get(), point.get(), context.get());
+}  // pcrypto::ecdh::PrivateKey::computePublicKey
+
+
+/**
+ * Compute the ECDH shared secret with the public key of the peer.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param peer_key Uncompressed public key of the peer
+ * @returns X coordinate of the shared point, PRIVATE_KEY_SIZE bytes
+ */
+ByteArray pcrypto::ecdh::PrivateKey::ComputeSharedSecret(
+        const ByteArray& peer_key) const {
+    if (private_key_.empty()) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Private key is not initialized");
+        throw Error::RuntimeError(msg);
+    }
+    if (peer_key.size() != PUBLIC_KEY_SIZE ||
+            peer_key[0] != POINT_CONVERSION_UNCOMPRESSED) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Invalid peer public key");
+        throw Error::ValueError(msg);
+    }
+
+    EC_GROUP_ptr group(EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1),
+        EC_GROUP_free);
+    BN_CTX_ptr context(BN_CTX_new(), BN_CTX_free);
+    BIGNUM_ptr scalar(BN_secure_new(), BN_clear_free);
+    BIGNUM_ptr x(BN_secure_new(), BN_clear_free);
+    if (!group || !context || !scalar || !x) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Could not allocate EC context");
+        throw Error::RuntimeError(msg);
+    }
+    EC_POINT_ptr peer_point(EC_POINT_new(group.get()), EC_POINT_free);
+    EC_POINT_ptr shared_point(EC_POINT_new(group.get()), EC_POINT_free);
+    if (!peer_point || !shared_point) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Could not allocate EC point");
+        throw Error::RuntimeError(msg);
+    }
+
+    // Decoding the point checks that it is on the curve
+    if (!EC_POINT_oct2point(group.get(), peer_point.get(), peer_key.data(),
+            peer_key.size(), context.get()) ||
+            EC_POINT_is_at_infinity(group.get(), peer_point.get())) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Peer public key is not a valid point");
+        throw Error::ValueError(msg);
+    }
+
+    BN_bin2bn(private_key_.data(), private_key_.size(), scalar.get());
+    if (!EC_POINT_mul(group.get(), shared_point.get(), nullptr,
+            peer_point.get(), scalar.get(), context.get()) ||
+            EC_POINT_is_at_infinity(group.get(), shared_point.get()) ||
+            !EC_POINT_get_affine_coordinates_GFp(group.get(),
+                shared_point.get(), x.get(), nullptr, context.get())) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Could not compute shared point");
+        throw Error::RuntimeError(msg);
+    }
+
+    ByteArray secret(PRIVATE_KEY_SIZE);
+    if (BN_bn2binpad(x.get(), secret.data(), secret.size()) !=
+            (int) secret.size()) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Could not serialize shared secret");
+        throw Error::RuntimeError(msg);
+    }
+    return secret;
+}  // pcrypto::ecdh::PrivateKey::ComputeSharedSecret
+
+
+/**
+ * Derive a key with HKDF-SHA256 and an empty salt.
+ * Throws RuntimeError.
+ *
+ * @param secret Input keying material
+ * @param info   Context information bound to the key
+ * @param size   Size of the derived key, in bytes
+ * @returns derived key
+ */
+ByteArray pcrypto::ecdh::DeriveKey(const ByteArray& secret,
+        const ByteArray& info, size_t size) {
+    PKEY_CTX_ptr context(EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr),
+        EVP_PKEY_CTX_free);
+    if (!context) {
+        std::string msg("Crypto Error (ecdh::DeriveKey): "
+            "Could not create HKDF context");
+        throw Error::RuntimeError(msg);
+    }
+
+    ByteArray key(size);
+    size_t key_size = key.size();
+    if (EVP_PKEY_derive_init(context.get()) <= 0 ||
+            EVP_PKEY_CTX_set_hkdf_md(context.get(), EVP_sha256()) <= 0 ||
+            EVP_PKEY_CTX_set1_hkdf_key(context.get(), secret.data(),
+                secret.size()) <= 0 ||
+            (!info.empty() && EVP_PKEY_CTX_add1_hkdf_info(context.get(),
+                info.data(), info.size()) <= 0) ||
+            EVP_PKEY_derive(context.get(), key.data(), &key_size) <= 0 ||
+            key_size != size) {
+        std::string msg("Crypto Error (ecdh::DeriveKey): "
+            "HKDF derivation failed");
+        throw Error::RuntimeError(msg);
+    }
+    return key;
+}  // pcrypto::ecdh::DeriveKey
@@ -0,0 +1,97 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon ECDH key agreement and HKDF key derivation functions.
+ * Used to agree on work order session keys with secp256r1 (NIST P-256)
+ * keys, as a faster alternative to RSA-OAEP encrypted session keys.
+ * Public keys are uncompressed points (0x04 || X || Y), private keys are
+ * 32 byte scalars. Both are serialized as hex strings.
+ */
+
+#pragma once
+#include <string>
+#include "types.h"
+
+namespace tcf {
+namespace crypto {
+    // Key agreement functions
+    namespace ecdh {
+        /** Size of an uncompressed secp256r1 public key, in bytes. */
+        const size_t PUBLIC_KEY_SIZE = 65;
+        /** Size of a secp256r1 private key and shared secret, in bytes. */
+        const size_t PRIVATE_KEY_SIZE = 32;
+        /** Size of derived session keys, in bytes (AES-256). */
+        const size_t SESSION_KEY_SIZE = 32;
+        /** HKDF info prefix for work order session keys. */
+        const char SESSION_KEY_INFO[] = "Avalon work order session key";
+
+        class PrivateKey {
+        public:
+            // Default constructor for UNINITIALIZED PrivateKey.
+            PrivateKey() {}
+            // Deserializing constructor.
+            // Throws ValueError.
+            PrivateKey(const std::string& encoded);
+            // Zeroizes the key.
+            ~PrivateKey();
+            // Generate PrivateKey.
+            // throws RuntimeError
+            void Generate();
+            // Reads hex encoded private key.
+            // Throws RuntimeError, ValueError.
+            void Deserialize(const std::string& encoded);
+            // Creates hex encoded private key.
+            // Throws RuntimeError.
+            std::string Serialize() const;
+            // Uncompressed public key.
+            // Throws RuntimeError.
+            const ByteArray& GetPublicKey() const;
+            // Hex encoded uncompressed public key.
+            // Throws RuntimeError.
+            std::string SerializePublicKey() const;
+            // Compute the ECDH shared secret (the X coordinate of the
+            // shared point) with the uncompressed public key of the peer.
+            // Throws RuntimeError, ValueError.
+            ByteArray ComputeSharedSecret(const ByteArray& peer_key) const;
+
+        private:
+            // Sets public_key_ from private_key_.
+            // Throws RuntimeError, ValueError.
+            void computePublicKey();
+            // Zeroizes key.
+            static void cleanse(ByteArray& key);
+
+            ByteArray private_key_;
+            ByteArray public_key_;
+        };
+
+        // HKDF-SHA256 with an empty salt (RFC 5869).
+        // Throws RuntimeError.
+        ByteArray DeriveKey(const ByteArray& secret,
+            const ByteArray& info,
+            size_t size);
+
+        // Derive the session key of a work order from the ECDH shared
+        // secret of the requester's ephemeral key and the worker's key.
+        // Both public keys are bound to the key through the HKDF info.
+        // Throws RuntimeError.
+        ByteArray DeriveSessionKey(const ByteArray& shared_secret,
+            const ByteArray& requester_public_key,
+            const ByteArray& worker_public_key);
+    }  // namespace ecdh
+}  // namespace crypto
+}  // namespace tcf
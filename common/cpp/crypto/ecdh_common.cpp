@@ -0,0 +1,130 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon ECDH key agreement functions: serialization and session key
+ * derivation. Used for secp256r1.
+ *
+ * No OpenSSL/Mbed TLS-dependent code is present.
+ * See ecdh.cpp for OpenSSL/Mbed TLS-dependent code.
+ */
+
+#include "ecdh.h"
+#include "error.h"
+#include "hex_string.h"
+
+namespace pcrypto = tcf::crypto;
+namespace Error = tcf::error; // Error handling
+
+
+/**
+ * Constructor from hex encoded string.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param encoded Hex encoded private key
+ */
+pcrypto::ecdh::PrivateKey::PrivateKey(const std::string& encoded) {
+    Deserialize(encoded);
+}  // pcrypto::ecdh::PrivateKey::PrivateKey
+
+
+/**
+ * PrivateKey destructor. Zeroizes the key.
+ */
+pcrypto::ecdh::PrivateKey::~PrivateKey() {
+    cleanse(private_key_);
+}  // pcrypto::ecdh::PrivateKey::~PrivateKey
+
+
+/**
+ * Deserialize a hex encoded private key and compute its public key.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param encoded Hex encoded private key
+ */
+void pcrypto::ecdh::PrivateKey::Deserialize(const std::string& encoded) {
+    ByteArray key = tcf::HexStringToBinary(encoded);
+    if (key.size() != PRIVATE_KEY_SIZE) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::Deserialize): "
+            "Invalid private key size");
+        throw Error::ValueError(msg);
+    }
+    cleanse(private_key_);
+    private_key_.swap(key);
+    computePublicKey();
+}  // pcrypto::ecdh::PrivateKey::Deserialize
+
+
+/**
+ * Serialize the private key as a hex string.
+ * Throws RuntimeError.
+ *
+ * @returns Hex encoded private key
+ */
+std::string pcrypto::ecdh::PrivateKey::Serialize() const {
+    if (private_key_.empty()) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::Serialize): "
+            "Private key is not initialized");
+        throw Error::RuntimeError(msg);
+    }
+    return ByteArrayToHexEncodedString(private_key_);
+}  // pcrypto::ecdh::PrivateKey::Serialize
+
+
+/**
+ * Get the uncompressed public key of the private key.
+ * Throws RuntimeError.
+ */
+const ByteArray& pcrypto::ecdh::PrivateKey::GetPublicKey() const {
+    if (public_key_.empty()) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::GetPublicKey): "
+            "Private key is not initialized");
+        throw Error::RuntimeError(msg);
+    }
+    return public_key_;
+}  // pcrypto::ecdh::PrivateKey::GetPublicKey
+
+
+/**
+ * Serialize the uncompressed public key as a hex string.
+ * Throws RuntimeError.
+ */
+std::string pcrypto::ecdh::PrivateKey::SerializePublicKey() const {
+    return ByteArrayToHexEncodedString(GetPublicKey());
+}  // pcrypto::ecdh::PrivateKey::SerializePublicKey
+
+
+/**
+ * Derive a work order session key. The HKDF info is SESSION_KEY_INFO
+ * followed by the requester's and the worker's uncompressed public keys.
+ * Throws RuntimeError.
+ *
+ * @param shared_secret        ECDH shared secret of both keys
+ * @param requester_public_key Requester's ephemeral public key
+ * @param worker_public_key    Worker's public key
+ * @returns SESSION_KEY_SIZE bytes session key
+ */
+ByteArray pcrypto::ecdh::DeriveSessionKey(const ByteArray& shared_secret,
+        const ByteArray& requester_public_key,
+        const ByteArray& worker_public_key) {
+    ByteArray info(SESSION_KEY_INFO,
+        SESSION_KEY_INFO + sizeof(SESSION_KEY_INFO) - 1);
+    info.insert(info.end(), requester_public_key.begin(),
+        requester_public_key.end());
+    info.insert(info.end(), worker_public_key.begin(),
+        worker_public_key.end());
+    return DeriveKey(shared_secret, info, SESSION_KEY_SIZE);
+}  // pcrypto::ecdh::DeriveSessionKey
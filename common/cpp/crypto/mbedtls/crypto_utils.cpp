@@ -105,3 +105,64 @@ ByteArray pcrypto::ComputeMessageHash(const ByteArray& message) {
         hash.data(), 0);
     return hash;
 }  // pcrypto::ComputeMessageHash
+
+
+struct pcrypto::MessageHasher::Context {
+    mbedtls_sha256_context sha256;
+};
+
+
+/**
+ * Start incremental SHA256 hashing.
+ * Throws RuntimeError.
+ */
+pcrypto::MessageHasher::MessageHasher() : context_(new Context()) {
+    mbedtls_sha256_init(&context_->sha256);
+    if (mbedtls_sha256_starts_ret(&context_->sha256, 0) != 0) {
+        mbedtls_sha256_free(&context_->sha256);
+        std::string msg("Crypto Error (MessageHasher): Mbed TLS could not "
+            "initialize SHA256");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::MessageHasher::MessageHasher
+
+
+pcrypto::MessageHasher::~MessageHasher() {
+    mbedtls_sha256_free(&context_->sha256);
+}  // pcrypto::MessageHasher::~MessageHasher
+
+
+/**
+ * Add the next piece of the message to the hash.
+ * Throws RuntimeError.
+ *
+ * @param data Next piece of the message
+ * @param size Size of the piece in bytes
+ */
+void pcrypto::MessageHasher::Update(const uint8_t* data, size_t size) {
+    if (mbedtls_sha256_update_ret(&context_->sha256, data, size) != 0) {
+        std::string msg("Crypto Error (MessageHasher): Mbed TLS could not "
+            "update SHA256");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::MessageHasher::Update
+
+
+/**
+ * Return the SHA256 hash of all pieces of the message and reset the
+ * hasher for a new message.
+ * Throws RuntimeError.
+ *
+ * @returns byte array containing binary hash of the message
+ */
+ByteArray pcrypto::MessageHasher::Finalize() {
+    ByteArray hash(constants::DIGEST_LENGTH);
+
+    if (mbedtls_sha256_finish_ret(&context_->sha256, hash.data()) != 0 ||
+            mbedtls_sha256_starts_ret(&context_->sha256, 0) != 0) {
+        std::string msg("Crypto Error (MessageHasher): Mbed TLS could not "
+            "finalize SHA256");
+        throw Error::RuntimeError(msg);
+    }
+    return hash;
+}  // pcrypto::MessageHasher::Finalize
@@ -0,0 +1,270 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon ECDH key agreement functions: key generation, shared secret
+ * computation and HKDF key derivation. Used for secp256r1.
+ *
+ * Lower-level functions implemented using Mbed TLS.
+ * See also ecdh_common.cpp for Mbed TLS-independent code.
+ */
+
+#include <string.h>           // memcpy()
+#include <mbedtls/bignum.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/ecdh.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/hkdf.h>
+#include <mbedtls/md.h>       // MBEDTLS_MD_SHA256
+#include <mbedtls/platform_util.h>
+
+#include "crypto_shared.h"
+#include "crypto_utils.h"     // RandomBitString()
+#include "utils.h"            // ByteArrayToStr()
+#include "ecdh.h"
+#include "error.h"
+
+#ifndef CRYPTOLIB_MBEDTLS
+#error "CRYPTOLIB_MBEDTLS must be defined to compile source with Mbed TLS."
+#endif
+
+namespace pcrypto = tcf::crypto;
+namespace Error = tcf::error; // Error handling
+
+
+/*
+ * Secp256r1 group with a scalar, a point and a shared secret,
+ * freed when it goes out of scope.
+ */
+struct EcContext {
+    mbedtls_ecp_group grp;
+    mbedtls_mpi d;
+    mbedtls_ecp_point Q;
+    mbedtls_mpi z;
+
+    EcContext() {
+        mbedtls_ecp_group_init(&grp);
+        mbedtls_mpi_init(&d);
+        mbedtls_ecp_point_init(&Q);
+        mbedtls_mpi_init(&z);
+    }
+
+    ~EcContext() {
+        mbedtls_mpi_free(&z);
+        mbedtls_ecp_point_free(&Q);
+        mbedtls_mpi_free(&d);
+        mbedtls_ecp_group_free(&grp);
+    }
+};  // struct EcContext
+
+
+/*
+ * Wrapper function to generate a cryptographically strong random bit string.
+ * Uses the interface expected by mbedtls_ecp_gen_keypair()
+ * That is, the same interface as mbedtls_ctr_drbg_random().
+ * Implemented with RandomBitString().
+ *
+ * @param unused     Unused and ignored parameter for context. Set to nullptr
+ * @param output     String containing raw binary plaintext
+ * @param output_len Length of random bit string in bytes
+ * @returns          0 on success
+ *                   MBEDTLS_ERR_CTR_DRBG_REQUEST_TOO_BIG if output_len >1024
+ *                   non-0 on other failures
+ */
+static int mbed_ctr_drbg_random_wrapper(void *unused,
+        unsigned char *output, size_t output_len) {
+    std::string s;
+
+    // Sanity check
+    if (output_len > MBEDTLS_CTR_DRBG_MAX_REQUEST)
+        return MBEDTLS_ERR_CTR_DRBG_REQUEST_TOO_BIG;
+
+    try {
+        s = ByteArrayToStr(tcf::crypto::RandomBitString(output_len));
+    } catch (const tcf::error::RuntimeError&) {
+        return 1; // failure
+    }
+    memcpy(output, s.data(), output_len);
+    return 0; // success
+}   // mbed_ctr_drbg_random_wrapper()
+
+
+/**
+ * Utility function: convert the point Q of ctx to an uncompressed
+ * public key.
+ * Throws RuntimeError.
+ */
+static ByteArray pointToPublicKey(EcContext& ctx) {
+    ByteArray public_key(pcrypto::ecdh::PUBLIC_KEY_SIZE);
+    size_t olen = 0;
+    int rc = mbedtls_ecp_point_write_binary(&ctx.grp, &ctx.Q,
+        MBEDTLS_ECP_PF_UNCOMPRESSED, &olen, public_key.data(),
+        public_key.size());
+    if (rc != 0 || olen != public_key.size()) {
+        std::string msg("Crypto Error (ecdh): Could not serialize EC point");
+        throw Error::RuntimeError(msg);
+    }
+    return public_key;
+}  // pointToPublicKey
+
+
+/**
+ * Zeroize a key.
+ */
+void pcrypto::ecdh::PrivateKey::cleanse(ByteArray& key) {
+    if (!key.empty()) {
+        mbedtls_platform_zeroize(key.data(), key.size());
+    }
+}  // pcrypto::ecdh::PrivateKey::cleanse
+
+
+/**
+ * Generate a secp256r1 private key.
+ * Throws RuntimeError.
+ */
+void pcrypto::ecdh::PrivateKey::Generate() {
+    EcContext ctx;
+    int rc = mbedtls_ecp_group_load(&ctx.grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (rc == 0) {
+        rc = mbedtls_ecp_gen_keypair(&ctx.grp, &ctx.d, &ctx.Q,
+            mbed_ctr_drbg_random_wrapper, nullptr);
+    }
+    ByteArray private_key(PRIVATE_KEY_SIZE);
+    if (rc == 0) {
+        rc = mbedtls_mpi_write_binary(&ctx.d, private_key.data(),
+            private_key.size());
+    }
+    if (rc != 0) {
+        cleanse(private_key);
+        std::string msg("Crypto Error (ecdh::PrivateKey::Generate): "
+            "Could not generate EC key");
+        throw Error::RuntimeError(msg);
+    }
+
+    public_key_ = pointToPublicKey(ctx);
+    cleanse(private_key_);
+    private_key_.swap(private_key);
+}  // pcrypto::ecdh::PrivateKey::Generate
+
+
+/**
+ * Compute the public key of private_key_.
+ * Throws RuntimeError, ValueError.
+ */
+void pcrypto::ecdh::PrivateKey::computePublicKey() {
+    EcContext ctx;
+    int rc = mbedtls_ecp_group_load(&ctx.grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (rc == 0) {
+        rc = mbedtls_mpi_read_binary(&ctx.d, private_key_.data(),
+            private_key_.size());
+    }
+    if (rc != 0) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::computePublicKey): "
+            "Could not load private key");
+        throw Error::RuntimeError(msg);
+    }
+    if (mbedtls_ecp_check_privkey(&ctx.grp, &ctx.d) != 0) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::computePublicKey): "
+            "Private key is out of range");
+        throw Error::ValueError(msg);
+    }
+    rc = mbedtls_ecp_mul(&ctx.grp, &ctx.Q, &ctx.d, &ctx.grp.G,
+        mbed_ctr_drbg_random_wrapper, nullptr);
+    if (rc != 0) {
+        std::string msg("Crypto Error (ecdh::PrivateKey::computePublicKey): "
+            "Could not compute public key");
+        throw Error::RuntimeError(msg);
+    }
+    public_key_ = pointToPublicKey(ctx);
+}  // pcrypto::ecdh::PrivateKey::computePublicKey
+
+
+/**
+ * Compute the ECDH shared secret with the public key of the peer.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param peer_key Uncompressed public key of the peer
+ * @returns X coordinate of the shared point, PRIVATE_KEY_SIZE bytes
+ */
+ByteArray pcrypto::ecdh::PrivateKey::ComputeSharedSecret(
+        const ByteArray& peer_key) const {
+    if (private_key_.empty()) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Private key is not initialized");
+        throw Error::RuntimeError(msg);
+    }
+    if (peer_key.size() != PUBLIC_KEY_SIZE || peer_key[0] != 0x04) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Invalid peer public key");
+        throw Error::ValueError(msg);
+    }
+
+    EcContext ctx;
+    int rc = mbedtls_ecp_group_load(&ctx.grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (rc == 0) {
+        rc = mbedtls_mpi_read_binary(&ctx.d, private_key_.data(),
+            private_key_.size());
+    }
+    if (rc != 0) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Could not load private key");
+        throw Error::RuntimeError(msg);
+    }
+    if (mbedtls_ecp_point_read_binary(&ctx.grp, &ctx.Q, peer_key.data(),
+            peer_key.size()) != 0 ||
+            mbedtls_ecp_check_pubkey(&ctx.grp, &ctx.Q) != 0) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Peer public key is not a valid point");
+        throw Error::ValueError(msg);
+    }
+
+    ByteArray secret(PRIVATE_KEY_SIZE);
+    rc = mbedtls_ecdh_compute_shared(&ctx.grp, &ctx.z, &ctx.Q, &ctx.d,
+        mbed_ctr_drbg_random_wrapper, nullptr);
+    if (rc == 0) {
+        rc = mbedtls_mpi_write_binary(&ctx.z, secret.data(), secret.size());
+    }
+    if (rc != 0) {
+        std::string msg("Crypto Error (ecdh::ComputeSharedSecret): "
+            "Could not compute shared secret");
+        throw Error::RuntimeError(msg);
+    }
+    return secret;
+}  // pcrypto::ecdh::PrivateKey::ComputeSharedSecret
+
+
+/**
+ * Derive a key with HKDF-SHA256 and an empty salt.
+ * Throws RuntimeError.
+ *
+ * @param secret Input keying material
+ * @param info   Context information bound to the key
+ * @param size   Size of the derived key, in bytes
+ * @returns derived key
+ */
+ByteArray pcrypto::ecdh::DeriveKey(const ByteArray& secret,
+        const ByteArray& info, size_t size) {
+    ByteArray key(size);
+    int rc = mbedtls_hkdf(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+        nullptr, 0, secret.data(), secret.size(), info.data(), info.size(),
+        key.data(), key.size());
+    if (rc != 0) {
+        std::string msg("Crypto Error (ecdh::DeriveKey): "
+            "HKDF derivation failed");
+        throw Error::RuntimeError(msg);
+    }
+    return key;
+}  // pcrypto::ecdh::DeriveKey
@@ -0,0 +1,92 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon deterministic random bit generator.
+ *
+ * Lower-level functions implemented using Mbed TLS.
+ * See also random_generator_common.cpp for Mbed TLS-independent code.
+ */
+
+#include <memory>    // std::unique_ptr
+#include <mbedtls/aes.h>
+#include <mbedtls/platform_util.h>  // mbedtls_platform_zeroize()
+
+#include "crypto_shared.h"
+#include "error.h"
+#include "random_generator.h"
+
+#ifndef CRYPTOLIB_MBEDTLS
+#error "CRYPTOLIB_MBEDTLS must be defined to compile source with Mbed TLS."
+#endif
+
+namespace pcrypto = tcf::crypto;
+
+// Error handling
+namespace Error = tcf::error;
+
+
+struct pcrypto::RandomGenerator::Context {
+    // AES-256 encryption with the current key
+    mbedtls_aes_context aes;
+};
+
+
+/**
+ * Create a random generator, which is seeded on first use.
+ */
+pcrypto::RandomGenerator::RandomGenerator() :
+        context_(new Context()), v_(), reseed_counter_(0),
+        fork_generation_(0), seeded_(false) {
+    mbedtls_aes_init(&context_->aes);
+}  // pcrypto::RandomGenerator::RandomGenerator
+
+
+// mbedtls_aes_free() zeroizes the expanded key
+pcrypto::RandomGenerator::~RandomGenerator() {
+    mbedtls_aes_free(&context_->aes);
+    mbedtls_platform_zeroize(v_, sizeof(v_));
+}  // pcrypto::RandomGenerator::~RandomGenerator
+
+
+/*
+ * Set up the AES-256 key.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::SetKey(const uint8_t* key) {
+    if (mbedtls_aes_setkey_enc(&context_->aes, key, 256) != 0) {
+        std::string msg("Crypto Error (RandomGenerator): Mbed TLS could not "
+            "set AES-256 key");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::RandomGenerator::SetKey
+
+
+/*
+ * Encrypt blocks AES blocks from in into out with the current key.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::EncryptBlocks(const uint8_t* in,
+        uint8_t* out, size_t blocks) {
+    for (size_t i = 0; i < blocks; i++) {
+        if (mbedtls_aes_crypt_ecb(&context_->aes, MBEDTLS_AES_ENCRYPT,
+                in + i * 16, out + i * 16) != 0) {
+            std::string msg("Crypto Error (RandomGenerator): Mbed TLS "
+                "could not encrypt AES-256 blocks");
+            throw Error::RuntimeError(msg);
+        }
+    }
+}  // pcrypto::RandomGenerator::EncryptBlocks
@@ -0,0 +1,227 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon ECDSA signer for signing many messages with the same key.
+ * Used for Secp256k1.
+ *
+ * Lower-level functions implemented using Mbed TLS.
+ * The key's private value d is kept with its own copy of the EC group,
+ * grp (see sig_private_key.cpp). Mbed TLS keeps the table of precomputed
+ * multiples of the base point, which it computes on the first
+ * multiplication with it, in the group, so this table is computed once
+ * per signer.
+ */
+
+#include <string.h>           // memcpy()
+#include <mbedtls/asn1write.h>
+#include <mbedtls/bignum.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/ecdsa.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/md.h>       // MBEDTLS_MD_SHA256
+
+#include "crypto_shared.h"
+#include "crypto_utils.h"     // RandomBitString()
+#include "utils.h"            // ByteArrayToStr()
+#include "error.h"
+#include "sig.h"
+#include "sig_private_key.h"
+#include "sig_signer.h"
+
+#ifndef CRYPTOLIB_MBEDTLS
+#error "CRYPTOLIB_MBEDTLS must be defined to compile source with Mbed TLS."
+#endif
+
+namespace pcrypto = tcf::crypto;
+namespace constants = tcf::crypto::constants;
+namespace Error = tcf::error; // Error handling
+
+
+// Key and curve constants, set up once per signer
+struct pcrypto::sig::Signer::Context {
+    Context() {
+        mbedtls_ecp_group_init(&grp);
+        mbedtls_mpi_init(&d);
+        mbedtls_mpi_init(&half_order);
+    }
+    ~Context() {
+        // mbedtls_mpi_free() zeroizes
+        mbedtls_mpi_free(&half_order);
+        mbedtls_mpi_free(&d);
+        mbedtls_ecp_group_free(&grp);
+    }
+
+    mbedtls_ecp_group grp;
+    mbedtls_mpi d;
+    // Floor of order / 2, the largest low S value
+    mbedtls_mpi half_order;
+};
+
+
+/**
+ * Utility function: Mbed TLS wrapper to get random bits.
+ * Uses Avalon RandomBitString(), which is an Avalon common function.
+ * Passed to Mbed TLS functions that use random numbers.
+ * Mbed TLS uses them here for blinding only, the nonces are
+ * deterministic.
+ *
+ * @param unused     Unused and ignored parameter for context. Set to nullptr
+ * @param output     String containing raw binary plaintext
+ * @param output_len Length of random bit string in bytes
+ * @returns          0 on success
+ *                   MBEDTLS_ERR_CTR_DRBG_REQUEST_TOO_BIG if output_len >1024
+ *                   non-0 on other failures
+ */
+static int mbed_ctr_drbg_random_wrapper(void *unused,
+        unsigned char *output, size_t output_len) {
+    std::string s;
+
+    // Sanity check
+    if (output_len > MBEDTLS_CTR_DRBG_MAX_REQUEST)
+        return MBEDTLS_ERR_CTR_DRBG_REQUEST_TOO_BIG;
+
+    try {
+        s = ByteArrayToStr(tcf::crypto::RandomBitString(output_len));
+    } catch (const tcf::error::RuntimeError&) {
+        return 1; // failure
+    }
+    memcpy(output, s.data(), output_len);
+    return 0; // success
+}   // mbed_ctr_drbg_random_wrapper()
+
+
+/**
+ * Constructor, sets up the curve of the private key and its table of
+ * precomputed base point multiples.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param privateKey ECDSA private key to sign with
+ */
+pcrypto::sig::Signer::Signer(const pcrypto::sig::PrivateKey& privateKey) :
+        context_(new Context()) {
+    if (privateKey.private_key_ == nullptr) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "PrivateKey is not initialized");
+        throw Error::ValueError(msg);
+    }
+    const mbedtls_ecdsa_context* key =
+        (const mbedtls_ecdsa_context *)privateKey.private_key_;
+
+    int rc = mbedtls_ecp_group_copy(&context_->grp, &key->grp);
+    if (rc != 0) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Could not copy EC group");
+        throw Error::ValueError(msg);
+    }
+    rc = mbedtls_mpi_copy(&context_->d, &key->d);
+    if (rc == 0) {
+        rc = mbedtls_mpi_copy(&context_->half_order, &context_->grp.N);
+    }
+    if (rc == 0) {
+        rc = mbedtls_mpi_shift_r(&context_->half_order, 1);
+    }
+    if (rc != 0) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Could not set up curve constants");
+        throw Error::RuntimeError(msg);
+    }
+
+    // Multiplying the base point builds the group's table of its
+    // multiples, signatures then only read it
+    mbedtls_ecp_point point;
+    mbedtls_ecp_point_init(&point);
+    rc = mbedtls_ecp_mul(&context_->grp, &point, &context_->d,
+        &context_->grp.G, mbed_ctr_drbg_random_wrapper, nullptr);
+    mbedtls_ecp_point_free(&point);
+    if (rc != 0) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Could not precompute base point multiples");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::sig::Signer::Signer
+
+
+/**
+ * Signer destructor.
+ */
+pcrypto::sig::Signer::~Signer() {
+}  // pcrypto::sig::Signer::~Signer
+
+
+/**
+ * Signs the message hash with a nonce derived as in RFC 6979 and makes
+ * the signature Bitcoin canonical.
+ * Throws RuntimeError.
+ *
+ * @param hashMessage Data in a byte array to sign.
+ *                    This is not the message to sign but a hash of the message
+ * @returns ByteArray containing signature data in DER format
+ *                    as defined in RFC 4492
+ */
+ByteArray pcrypto::sig::Signer::SignMessage(
+        const ByteArray& hashMessage) const {
+    mbedtls_mpi r;
+    mbedtls_mpi s;
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+
+    int rc = mbedtls_ecdsa_sign_det_ext(&context_->grp, &r, &s,
+        &context_->d, hashMessage.data(), hashMessage.size(),
+        MBEDTLS_MD_SHA256, mbed_ctr_drbg_random_wrapper, nullptr);
+
+    // Make signature Bitcoin canonical if needed: if s > order / 2,
+    // then s = order - s
+    if (rc == 0 && mbedtls_mpi_cmp_mpi(&s, &context_->half_order) > 0) {
+        rc = mbedtls_mpi_sub_mpi(&s, &context_->grp.N, &s);
+    }
+
+    // DER encode the signature, the ASN.1 writer works backwards
+    unsigned char der_SIG[constants::MAX_SIG_SIZE];
+    unsigned char* p = der_SIG + sizeof(der_SIG);
+    size_t len = 0;
+    if (rc == 0) {
+        int res = mbedtls_asn1_write_mpi(&p, der_SIG, &s);
+        if (res >= 0) {
+            len += res;
+            res = mbedtls_asn1_write_mpi(&p, der_SIG, &r);
+        }
+        if (res >= 0) {
+            len += res;
+            res = mbedtls_asn1_write_len(&p, der_SIG, len);
+        }
+        if (res >= 0) {
+            len += res;
+            res = mbedtls_asn1_write_tag(&p, der_SIG,
+                MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE);
+        }
+        if (res >= 0) {
+            len += res;
+        } else {
+            rc = res;
+        }
+    }
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&r);
+
+    if (rc != 0) {
+        std::string msg("Crypto Error (sig::Signer::SignMessage): "
+            "Could not compute ECDSA signature");
+        throw Error::RuntimeError(msg);
+    }
+
+    return ByteArray(p, p + len);
+}  // pcrypto::sig::Signer::SignMessage
@@ -23,7 +23,9 @@
  */
 
 #include <string.h>  // memcmp()
+#include <algorithm>
 #include <mbedtls/gcm.h>
+#include <mbedtls/platform_util.h>  // mbedtls_platform_zeroize()
 
 #include "crypto_shared.h"
 #include "error.h"
@@ -38,203 +40,443 @@ namespace Error = tcf::error; // Error handling
 namespace constants = tcf::crypto::constants;
 
 
+struct pcrypto::skenc::CipherContext::Context {
+    mbedtls_gcm_context aes_gcm;
+    // Key set up in aes_gcm, empty if none
+    ByteArray key;
+};
+
+
+/*
+ * Compare keys in constant time, so that the time taken does not tell
+ * how much of a key matches the key of the previous message.
+ */
+static bool SameKey(const ByteArray& a, const ByteArray& b) {
+    unsigned char diff = 0;
+
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}  // SameKey
+
+
+/*
+ * Check the arguments of EncryptInPlace() and DecryptInPlace() and set
+ * up the key of the context. The key is only expanded again if it
+ * differs from the key of the previous message.
+ * Throws RuntimeError, ValueError.
+ */
+static void StartMessage(mbedtls_gcm_context* aes_gcm, ByteArray& context_key,
+        const ByteArray& key, const ByteArray& iv, const std::string& caller) {
+    int rc;
+
+    if (key.size() != constants::SYM_KEY_LEN) {
+        std::string msg(
+            "Crypto Error (" + caller + "): Wrong AES-GCM key length");
+        throw Error::ValueError(msg);
+    }
+
+    if (iv.size() != constants::IV_LEN) {
+        std::string msg(
+            "Crypto Error (" + caller + "): Wrong AES-GCM IV length");
+        throw Error::ValueError(msg);
+    }
+
+    if (!SameKey(context_key, key)) {
+        mbedtls_platform_zeroize(context_key.data(), context_key.size());
+        context_key.clear();
+
+        // MbedTLS expects key length is in bits and IV length in bytes.
+        rc = mbedtls_gcm_setkey(aes_gcm, MBEDTLS_CIPHER_ID_AES,
+            (const unsigned char*)key.data(), key.size() * 8);
+        if (rc != 0) {
+            std::string msg("Crypto Error (" + caller + "): "
+                "Mbed TLS could not set AES key");
+            throw Error::RuntimeError(msg);
+        }
+        context_key = key;
+    }
+}  // StartMessage
+
+
+/**
+ * Create a reusable AES-GCM context.
+ */
+pcrypto::skenc::CipherContext::CipherContext() : context_(new Context()) {
+    mbedtls_gcm_init(&context_->aes_gcm);
+}  // pcrypto::skenc::CipherContext::CipherContext
+
+
+pcrypto::skenc::CipherContext::~CipherContext() {
+    mbedtls_platform_zeroize(context_->key.data(), context_->key.size());
+    mbedtls_gcm_free(&context_->aes_gcm);
+}  // pcrypto::skenc::CipherContext::~CipherContext
+
+
+/**
+ * Wipe the key of the last message from the context.
+ */
+void pcrypto::skenc::CipherContext::Clear() {
+    mbedtls_platform_zeroize(context_->key.data(), context_->key.size());
+    context_->key.clear();
+    mbedtls_gcm_free(&context_->aes_gcm);
+    mbedtls_gcm_init(&context_->aes_gcm);
+}  // pcrypto::skenc::CipherContext::Clear
+
+
 /**
- * Encrypt a message using AES-GCM authenticated encryption.
+ * Encrypt a message in place using AES-GCM authenticated encryption.
  *
- * Appends a 16 byte (128 bit) authentication tag (sometimes called a MAC)
- * to the output cipher text:
- *     message = ciphertext + authentication tag
- * The authentication tag is not encrypted.
+ * The authentication tag (sometimes called a MAC) is stored separately,
+ * the ciphertext followed by the tag is the same as the result of
+ * EncryptMessage().
  *
  * Throws RuntimeError, ValueError.
  *
- * @param message binary data to encrypt
  * @param key Secret AES-256 encryption key.
  *            Generated by GenerateKey()
  * @param iv  96-bit initialization Vector (IV). Generated by GenerateIV()
- * @returns Byte array containing encrypted data and appended auth tag
+ * @param buf binary data to encrypt, replaced by the ciphertext
+ * @param len Length of the data in bytes
+ * @param tag Receives the 16 byte (128 bit) authentication tag
  */
-ByteArray pcrypto::skenc::EncryptMessage(
-        const ByteArray& key, const ByteArray& iv, const ByteArray& message) {
-    mbedtls_gcm_context aes_gcm;
+void pcrypto::skenc::CipherContext::EncryptInPlace(
+        const ByteArray& key, const ByteArray& iv,
+        uint8_t* buf, size_t len, uint8_t tag[constants::TAG_LEN]) {
     int rc;
-    size_t pt_len = message.size();
-    unsigned char* pt = (unsigned char*)message.data();
-    size_t ct_buf_len = pt_len + constants::BLOCK_LENGTH;
-    ByteArray ct(ct_buf_len);
-    const size_t ct_len = pt_len + constants::TAG_LEN;
-    unsigned char tag[constants::TAG_LEN];
 
     // Sanity checks
-    if (key.size() != constants::SYM_KEY_LEN) {
+    if (len == 0) {
         std::string msg(
-            "Crypto Error (EncryptMessage): Wrong AES-GCM key length");
+            "Crypto Error (EncryptInPlace): Cannot encrypt the empty message");
         throw Error::ValueError(msg);
     }
 
-    if (iv.size() != constants::IV_LEN) {
+    StartMessage(&context_->aes_gcm, context_->key, key, iv,
+        "EncryptInPlace");
+
+    rc = mbedtls_gcm_crypt_and_tag(&context_->aes_gcm, MBEDTLS_GCM_ENCRYPT,
+        len, (const unsigned char*)iv.data(), constants::IV_LEN,
+        nullptr, 0, buf, buf, constants::TAG_LEN, tag);
+    if (rc != 0) {
         std::string msg(
-            "Crypto Error (EncryptMessage): Wrong AES-GCM IV length");
+            "Crypto Error (EncryptInPlace): Mbed TLS could not "
+            "encrypt with AES-GCM");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::skenc::CipherContext::EncryptInPlace
+
+
+/**
+ * Decrypt a message in place using AES-GCM authenticated decryption.
+ *
+ * Throws RuntimeError, ValueError,
+ * CryptoError (message authentication failure).
+ *
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV). Generated by GenerateIV()
+ * @param buf Ciphertext to decrypt, without the authentication tag.
+ *            Replaced by the plaintext, or wiped if authentication fails
+ * @param len Length of the ciphertext in bytes
+ * @param tag 16 byte (128 bit) authentication tag of the message
+ */
+void pcrypto::skenc::CipherContext::DecryptInPlace(
+        const ByteArray& key, const ByteArray& iv,
+        uint8_t* buf, size_t len, const uint8_t tag[constants::TAG_LEN]) {
+    int rc;
+
+    StartMessage(&context_->aes_gcm, context_->key, key, iv,
+        "DecryptInPlace");
+
+    // Compares the tag in constant time and wipes buf if it differs
+    rc = mbedtls_gcm_auth_decrypt(&context_->aes_gcm, len,
+        (const unsigned char*)iv.data(), constants::IV_LEN, nullptr, 0,
+        tag, constants::TAG_LEN, buf, buf);
+    if (rc == MBEDTLS_ERR_GCM_AUTH_FAILED) {
+        std::string msg(
+            "Crypto Error (DecryptInPlace): AES_GCM authentication "
+            "failed, plaintext is not trustworthy");
+        throw Error::CryptoError(msg);
+    } else if (rc != 0) {
+        std::string msg(
+            "Crypto Error (DecryptInPlace): Mbed TLS could not "
+            "decrypt with AES-GCM");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::skenc::CipherContext::DecryptInPlace
+
+
+struct pcrypto::skenc::StreamDecryptor::Context {
+    mbedtls_gcm_context aes_gcm;
+    // Mbed TLS decrypts whole blocks except for the last update,
+    // a partial block is kept here until it is completed
+    unsigned char block[16];
+    size_t block_len;
+};
+
+
+/**
+ * Start incremental AES-GCM decryption of a message.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV).
+ *            Generated by GenerateIV()
+ */
+pcrypto::skenc::StreamDecryptor::StreamDecryptor(
+        const ByteArray& key, const ByteArray& iv) : context_(new Context()) {
+    int rc;
+
+    context_->block_len = 0;
+    mbedtls_gcm_init(&context_->aes_gcm);
+
+    // Sanity checks
+    if (key.size() != constants::SYM_KEY_LEN) {
+        std::string msg(
+            "Crypto Error (StreamDecryptor): Wrong AES-GCM key length");
         throw Error::ValueError(msg);
     }
 
-    if (message.size() == 0) {
+    if (iv.size() != constants::IV_LEN) {
         std::string msg(
-            "Crypto Error (EncryptMessage): Cannot encrypt the empty message");
+            "Crypto Error (StreamDecryptor): Wrong AES-GCM IV length");
         throw Error::ValueError(msg);
     }
 
-    // Initialize encryption.
     // MbedTLS expects key length is in bits and IV length in bytes.
-    mbedtls_gcm_init(&aes_gcm);
-    rc = mbedtls_gcm_setkey(&aes_gcm, MBEDTLS_CIPHER_ID_AES,
+    rc = mbedtls_gcm_setkey(&context_->aes_gcm, MBEDTLS_CIPHER_ID_AES,
         (const unsigned char*)key.data(), key.size() * 8);
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
         std::string msg(
-            "Crypto Error (EncryptMessage): Mbed TLS could not set AES key");
+            "Crypto Error (StreamDecryptor): Mbed TLS could not set AES key");
         throw Error::RuntimeError(msg);
     }
 
-    rc= mbedtls_gcm_starts(&aes_gcm, MBEDTLS_GCM_ENCRYPT,
+    rc = mbedtls_gcm_starts(&context_->aes_gcm, MBEDTLS_GCM_DECRYPT,
         (const unsigned char*)iv.data(), constants::IV_LEN, nullptr, 0);
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
         std::string msg(
-            "Crypto Error (EncryptMessage): Mbed TLS could not set AES GCM IV");
+            "Crypto Error (StreamDecryptor): Mbed TLS could not set "
+            "AES GCM IV");
         throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamDecryptor::StreamDecryptor
+
+
+pcrypto::skenc::StreamDecryptor::~StreamDecryptor() {
+    mbedtls_gcm_free(&context_->aes_gcm);
+}  // pcrypto::skenc::StreamDecryptor::~StreamDecryptor
+
+
+/*
+ * Pass size bytes to an incremental AES-GCM operation and append the
+ * output of the whole blocks completed so far to out. Mbed TLS only
+ * accepts partial blocks in the last update, so a partial block is kept
+ * in block until it is completed.
+ * Returns the Mbed TLS error code.
+ */
+static int UpdateWholeBlocks(mbedtls_gcm_context* aes_gcm,
+        unsigned char block[16], size_t& block_len,
+        const uint8_t* data, size_t size, ByteArray& out) {
+    const size_t block_size = 16;
+    int rc = 0;
+
+    // Complete the partial block of the previous update first
+    if (block_len > 0) {
+        size_t n = std::min(size, block_size - block_len);
+        memcpy(block + block_len, data, n);
+        block_len += n;
+        data += n;
+        size -= n;
+        if (block_len < block_size) {
+            return 0;
+        }
+        size_t out_len = out.size();
+        out.resize(out_len + block_size);
+        rc = mbedtls_gcm_update(aes_gcm, block_size, block,
+            out.data() + out_len);
+        block_len = 0;
+    }
+
+    size_t whole = size - size % block_size;
+    if (rc == 0 && whole > 0) {
+        size_t out_len = out.size();
+        out.resize(out_len + whole);
+        rc = mbedtls_gcm_update(aes_gcm, whole,
+            (const unsigned char *)data, out.data() + out_len);
+    }
+    if (rc == 0) {
+        memcpy(block, data + whole, size - whole);
+        block_len = size - whole;
+    }
+    return rc;
+}  // UpdateWholeBlocks
+
 
-    // Encrypt message (with no IV prepended)
-    rc = mbedtls_gcm_update(&aes_gcm, pt_len, pt, ct.data());
+/*
+ * Decrypt size bytes of the message and append the whole blocks
+ * decrypted so far to plaintext.
+ */
+void pcrypto::skenc::StreamDecryptor::DecryptUpdate(
+        const uint8_t* data, size_t size, ByteArray& plaintext) {
+    int rc = UpdateWholeBlocks(&context_->aes_gcm, context_->block,
+        context_->block_len, data, size, plaintext);
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
         std::string msg(
-            "Crypto Error (EncryptMessage): Mbed TLS could not update "
-            "AES-GCM encryption");
+            "Crypto Error (StreamDecryptor): Mbed TLS could not update "
+            "AES-GCM decryption");
         throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamDecryptor::DecryptUpdate
+
+
+/*
+ * Decrypt the last partial block, if any, append it to plaintext and
+ * check the authentication tag of the message.
+ */
+void pcrypto::skenc::StreamDecryptor::DecryptFinal(
+        const uint8_t* tag, ByteArray& plaintext) {
+    unsigned char tag_generated[constants::TAG_LEN];
+    size_t pt_len = plaintext.size();
+    int rc;
 
-    // Generate message's auth tag
-    rc = mbedtls_gcm_finish(&aes_gcm, tag, constants::TAG_LEN);
+    plaintext.resize(pt_len + context_->block_len);
+    rc = mbedtls_gcm_update(&context_->aes_gcm, context_->block_len,
+        context_->block, plaintext.data() + pt_len);
+    context_->block_len = 0;
+    if (rc == 0) {
+        rc = mbedtls_gcm_finish(&context_->aes_gcm, tag_generated,
+            constants::TAG_LEN);
+    }
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
-        std::string msg("Crypto Error (EncryptMessage): "
+        std::string msg("Crypto Error (StreamDecryptor): "
             "Mbed TLS could not get AES-GCM TAG");
         throw Error::RuntimeError(msg);
     }
 
-    // Build and return encrypted output string with auth tag appended
-    ct.resize(ct_len - constants::TAG_LEN);
-    ct.insert(ct.end(), tag, tag + constants::TAG_LEN);
+    // Compare expected tag from the input cipher text with the generated tag
+    if (memcmp(tag, tag_generated, constants::TAG_LEN) != 0) {
+        std::string msg(
+            "Crypto Error (StreamDecryptor): AES_GCM authentication "
+            "failed, plaintext is not trustworthy");
+        throw Error::CryptoError(msg);
+    }
+}  // pcrypto::skenc::StreamDecryptor::DecryptFinal
 
-    // Cleanup and return
-    mbedtls_gcm_free(&aes_gcm);
 
-    return ct;
-}  // pcrypto::skenc::EncryptMessage
+struct pcrypto::skenc::StreamEncryptor::Context {
+    mbedtls_gcm_context aes_gcm;
+    unsigned char block[16];
+    size_t block_len;
+};
 
 
-/*
- * Decrypt message.data() using AES-GCM authenticated decryption.
- *
- * Expects a 12 byte (96 bit) IV (sometimes called a nonce) and
- * an 16 byte (128 bit) authentication tag (sometimes called a MAC),
- * prepended and appended, respectively, the input cipher text:
- *     message = ciphertext + authentication tag
- * The authentication tag is not encrypted.
- *
- * Throws RuntimeError, ValueError,
- * CryptoError (message authentication failure).
+/**
+ * Start incremental AES-GCM encryption of a message.
+ * Throws RuntimeError, ValueError.
  *
- * @param key         Secret AES-256 encryption key.
- *                    Generated by GenerateKey()
- * @param iv          96-bit initialization Vector (IV).
- *                    Generated by GenerateIV()
- * @param message     binary data to decrypt. Generated by EncryptMessage()
- *                    Includes appended authentication tag.
- *                    IV is separate (not prepended to message)
- * @param message_len Length of message in bytes
- * @returns Byte array containing decrypted data
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV).
+ *            Generated by GenerateIV()
  */
-ByteArray pcrypto::skenc::DecryptMessage(
-        const ByteArray& key, const char iv[constants::IV_LEN],
-        const char *message, size_t message_len) {
-    mbedtls_gcm_context aes_gcm;
-    // Both plaintext and cryptotext length (excluding auth tag length)
-    const size_t len = message_len - constants::TAG_LEN;
-    ByteArray pt(message_len);
-    const unsigned char *tag_expected = (unsigned char *)message + len;
-    unsigned char tag_generated[constants::TAG_LEN];
+pcrypto::skenc::StreamEncryptor::StreamEncryptor(
+        const ByteArray& key, const ByteArray& iv) : context_(new Context()) {
     int rc;
 
+    context_->block_len = 0;
+    mbedtls_gcm_init(&context_->aes_gcm);
+
     // Sanity checks
     if (key.size() != constants::SYM_KEY_LEN) {
         std::string msg(
-            "Crypto Error (DecryptMessage): Wrong AES-GCM key length");
+            "Crypto Error (StreamEncryptor): Wrong AES-GCM key length");
         throw Error::ValueError(msg);
     }
 
-    if (message_len < constants::TAG_LEN) {
+    if (iv.size() != constants::IV_LEN) {
         std::string msg(
-            "Crypto Error (DecryptMessage): AES-GCM message smaller "
-            "than minimum length (TAG length)");
+            "Crypto Error (StreamEncryptor): Wrong AES-GCM IV length");
         throw Error::ValueError(msg);
     }
 
-    // Initialize decryption.
     // MbedTLS expects key length is in bits and IV length in bytes.
-    mbedtls_gcm_init(&aes_gcm);
-    rc = mbedtls_gcm_setkey(&aes_gcm, MBEDTLS_CIPHER_ID_AES,
+    rc = mbedtls_gcm_setkey(&context_->aes_gcm, MBEDTLS_CIPHER_ID_AES,
         (const unsigned char*)key.data(), key.size() * 8);
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
         std::string msg(
-            "Crypto Error (DecryptMessage): Mbed TLS could not set AES key");
+            "Crypto Error (StreamEncryptor): Mbed TLS could not set AES key");
         throw Error::RuntimeError(msg);
     }
 
-    rc= mbedtls_gcm_starts(&aes_gcm, MBEDTLS_GCM_DECRYPT,
-        (const unsigned char*)iv, constants::IV_LEN, nullptr, 0);
+    rc = mbedtls_gcm_starts(&context_->aes_gcm, MBEDTLS_GCM_ENCRYPT,
+        (const unsigned char*)iv.data(), constants::IV_LEN, nullptr, 0);
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
         std::string msg(
-            "Crypto Error (DecryptMessage): Mbed TLS could not set AES GCM IV");
+            "Crypto Error (StreamEncryptor): Mbed TLS could not set "
+            "AES GCM IV");
         throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamEncryptor::StreamEncryptor
+
+
+pcrypto::skenc::StreamEncryptor::~StreamEncryptor() {
+    mbedtls_gcm_free(&context_->aes_gcm);
+}  // pcrypto::skenc::StreamEncryptor::~StreamEncryptor
 
-    // Decrypt message (IV is separate; omit appended auth tag)
-    rc = mbedtls_gcm_update(&aes_gcm, len, (const unsigned char *)message,
-        (unsigned char *)pt.data());
+
+/**
+ * Encrypt the next piece of a message with AES-GCM.
+ * Throws RuntimeError.
+ *
+ * @param data Next piece of the message
+ * @param size Size of the piece in bytes
+ * @returns Byte array containing the whole blocks encrypted so far
+ */
+ByteArray pcrypto::skenc::StreamEncryptor::Update(
+        const uint8_t* data, size_t size) {
+    ByteArray ct;
+
+    int rc = UpdateWholeBlocks(&context_->aes_gcm, context_->block,
+        context_->block_len, data, size, ct);
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
         std::string msg(
-            "Crypto Error (DecryptMessage): Mbed TLS could not update "
-            "AES-GCM decryption");
+            "Crypto Error (StreamEncryptor): Mbed TLS could not update "
+            "AES-GCM encryption");
         throw Error::RuntimeError(msg);
     }
+    return ct;
+}  // pcrypto::skenc::StreamEncryptor::Update
+
+
+/**
+ * Finish encryption of a message.
+ * Throws RuntimeError.
+ *
+ * @returns Byte array containing the rest of the encrypted data followed
+ *          by the authentication tag
+ */
+ByteArray pcrypto::skenc::StreamEncryptor::Finalize() {
+    ByteArray ct(context_->block_len + constants::TAG_LEN);
+    int rc;
 
-    // Generate the auth tag from decrypting the message
-    rc = mbedtls_gcm_finish(&aes_gcm, tag_generated, constants::TAG_LEN);
+    rc = mbedtls_gcm_update(&context_->aes_gcm, context_->block_len,
+        context_->block, ct.data());
+    if (rc == 0) {
+        rc = mbedtls_gcm_finish(&context_->aes_gcm,
+            ct.data() + context_->block_len, constants::TAG_LEN);
+    }
+    context_->block_len = 0;
     if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
-        std::string msg("Crypto Error (DecryptMessage): "
+        std::string msg("Crypto Error (StreamEncryptor): "
             "Mbed TLS could not get AES-GCM TAG");
         throw Error::RuntimeError(msg);
     }
-
-    // Compare expected tag from the input cipher text with the generated tag
-    rc = memcmp(tag_expected, tag_generated, constants::TAG_LEN);
-    if (rc != 0) {
-        mbedtls_gcm_free(&aes_gcm);
-        std::string msg(
-            "Crypto Error (DecryptMessage): AES_GCM authentication "
-            "failed, plaintext is not trustworthy");
-        throw Error::CryptoError(msg);
-    }
-
-    // Build and return decrypted output string
-    pt.resize(len);
-
-    return pt;
-}  // pcrypto::skenc::DecryptMessage
+    return ct;
+}  // pcrypto::skenc::StreamEncryptor::Finalize
@@ -0,0 +1,338 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Multi-buffer SHA256 hashing of several independent messages.
+ *
+ * Eight messages are hashed at once, each in one 32-bit lane of
+ * vector registers, so that the serial dependencies of one SHA256 round
+ * are spread over eight independent computations. Lanes which finish a
+ * message continue with the next one.
+ *
+ * No OpenSSL/Mbed TLS-dependent code is present.
+ * ComputeMessageHash() is used where the crypto library is faster.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "crypto_shared.h"
+#include "crypto_utils.h" // ComputeMessageHash()
+
+namespace pcrypto = tcf::crypto;
+namespace constants = tcf::crypto::constants;
+
+// Untrusted x86-64 builds get an AVX2 version of the lane code, selected
+// at load time. Enclaves can not detect CPU features (CPUID is not
+// allowed), they use the baseline SSE2 version.
+#if defined(_UNTRUSTED_) && defined(__x86_64__) && defined(__GNUC__) && \
+    !defined(__clang__)
+#define MESSAGE_HASHES_CPU_DISPATCH 1
+#define MESSAGE_HASHES_TARGETS \
+    __attribute__((target_clones("avx2", "default")))
+#else
+#define MESSAGE_HASHES_TARGETS
+#endif
+
+namespace {
+    const size_t LANES = 8;
+    const size_t BLOCK_SIZE = 64;
+
+    // One 32-bit word of each of the LANES messages
+    typedef uint32_t LaneWords __attribute__((vector_size(4 * LANES)));
+
+    const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    const uint32_t INITIAL_STATE[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    inline uint32_t LoadBigEndian(const uint8_t* p) {
+        return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+            ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+    }
+
+    inline void StoreBigEndian(uint8_t* p, uint32_t value) {
+        p[0] = (uint8_t) (value >> 24);
+        p[1] = (uint8_t) (value >> 16);
+        p[2] = (uint8_t) (value >> 8);
+        p[3] = (uint8_t) value;
+    }
+
+    /*
+     * SHA256 compression of one block into state. Word is uint32_t for
+     * one message or LaneWords for one block of each of LANES messages.
+     * Always inlined, so that it is compiled for the target of the caller.
+     */
+    template <typename Word>
+    inline __attribute__((always_inline))
+    void Compress(Word state[8], Word w[16]) {
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+        Word a = state[0], b = state[1], c = state[2], d = state[3];
+        Word e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; t++) {
+            if (t >= 16) {
+                Word w15 = w[(t - 15) & 15];
+                Word w2 = w[(t - 2) & 15];
+                w[t & 15] += (ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10)) +
+                    w[(t - 7) & 15] +
+                    (ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3));
+            }
+            Word t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) +
+                ((e & f) ^ (~e & g)) + K[t] + w[t & 15];
+            Word t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) +
+                ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+#undef ROTR
+    }  // Compress
+
+    // A message being hashed in a lane
+    struct LaneMessage {
+        size_t index;        // index of the message, or SIZE_MAX if idle
+        const uint8_t* data;
+        size_t full_blocks;  // blocks read directly from data
+        size_t blocks;       // full_blocks plus padded tail blocks
+        size_t next_block;
+        uint8_t tail[2 * BLOCK_SIZE];  // last partial block and padding
+
+        const uint8_t* Block(size_t block) const {
+            if (block < full_blocks) {
+                return data + block * BLOCK_SIZE;
+            }
+            return tail + (block - full_blocks) * BLOCK_SIZE;
+        }
+    };
+
+    void StartMessage(LaneMessage& lane, size_t index,
+            const ByteArray& message) {
+        size_t size = message.size();
+        size_t rest = size % BLOCK_SIZE;
+        lane.index = index;
+        lane.data = message.data();
+        lane.full_blocks = size / BLOCK_SIZE;
+        lane.blocks = lane.full_blocks +
+            (rest + 1 + 8 <= BLOCK_SIZE ? 1 : 2);
+        lane.next_block = 0;
+
+        size_t tail_size = (lane.blocks - lane.full_blocks) * BLOCK_SIZE;
+        memset(lane.tail, 0, tail_size);
+        if (rest > 0) {
+            memcpy(lane.tail, lane.data + lane.full_blocks * BLOCK_SIZE,
+                rest);
+        }
+        lane.tail[rest] = 0x80;
+        uint64_t bits = (uint64_t) size * 8;
+        StoreBigEndian(lane.tail + tail_size - 8, (uint32_t) (bits >> 32));
+        StoreBigEndian(lane.tail + tail_size - 4, (uint32_t) bits);
+    }  // StartMessage
+
+    void StoreDigest(const uint32_t state[8], ByteArray& digest) {
+        digest.resize(constants::DIGEST_LENGTH);
+        for (int i = 0; i < 8; i++) {
+            StoreBigEndian(digest.data() + 4 * i, state[i]);
+        }
+    }  // StoreDigest
+
+    // Hashes the messages with the given indices in LANES lanes
+    MESSAGE_HASHES_TARGETS
+    void HashInLanes(const std::vector<const ByteArray*>& messages,
+            const std::vector<size_t>& indices,
+            std::vector<ByteArray>& digests) {
+        static const uint8_t idle_block[BLOCK_SIZE] = {0};
+        LaneMessage lanes[LANES];
+        LaneWords state[8];
+        LaneWords w[16];
+        size_t next_message = 0;
+        size_t active = 0;
+
+        for (size_t j = 0; j < LANES; j++) {
+            lanes[j].index = SIZE_MAX;
+            if (next_message < indices.size()) {
+                size_t index = indices[next_message];
+                StartMessage(lanes[j], index, *messages[index]);
+                next_message++;
+                active++;
+            }
+        }
+        for (int i = 0; i < 8; i++) {
+            for (size_t j = 0; j < LANES; j++) {
+                state[i][j] = INITIAL_STATE[i];
+            }
+        }
+
+        while (active > 1 || (active == 1 && next_message < indices.size())) {
+            const uint8_t* blocks[LANES];
+            for (size_t j = 0; j < LANES; j++) {
+                blocks[j] = lanes[j].index == SIZE_MAX ?
+                    idle_block : lanes[j].Block(lanes[j].next_block);
+            }
+            for (int t = 0; t < 16; t++) {
+                for (size_t j = 0; j < LANES; j++) {
+                    w[t][j] = LoadBigEndian(blocks[j] + 4 * t);
+                }
+            }
+            Compress(state, w);
+
+            for (size_t j = 0; j < LANES; j++) {
+                LaneMessage& lane = lanes[j];
+                if (lane.index == SIZE_MAX ||
+                        ++lane.next_block < lane.blocks) {
+                    continue;
+                }
+                uint32_t lane_state[8];
+                for (int i = 0; i < 8; i++) {
+                    lane_state[i] = state[i][j];
+                }
+                StoreDigest(lane_state, digests[lane.index]);
+
+                lane.index = SIZE_MAX;
+                active--;
+                if (next_message < indices.size()) {
+                    size_t index = indices[next_message];
+                    StartMessage(lane, index, *messages[index]);
+                    next_message++;
+                    active++;
+                    for (int i = 0; i < 8; i++) {
+                        state[i][j] = INITIAL_STATE[i];
+                    }
+                }
+            }
+        }
+
+        // The rest of the last message is hashed without idle lanes
+        for (size_t j = 0; j < LANES && active > 0; j++) {
+            LaneMessage& lane = lanes[j];
+            if (lane.index == SIZE_MAX) {
+                continue;
+            }
+            uint32_t lane_state[8];
+            uint32_t lane_w[16];
+            for (int i = 0; i < 8; i++) {
+                lane_state[i] = state[i][j];
+            }
+            for (; lane.next_block < lane.blocks; lane.next_block++) {
+                const uint8_t* block = lane.Block(lane.next_block);
+                for (int t = 0; t < 16; t++) {
+                    lane_w[t] = LoadBigEndian(block + 4 * t);
+                }
+                Compress(lane_state, lane_w);
+            }
+            StoreDigest(lane_state, digests[lane.index]);
+            active--;
+        }
+    }  // HashInLanes
+
+    /*
+     * Messages larger than this are hashed with ComputeMessageHash(),
+     * which costs more per call but is faster for long messages where
+     * OpenSSL uses the SHA extensions or vector code of the CPU. Mbed TLS
+     * uses portable C code, the lanes are faster at any size.
+     */
+    size_t MaxLaneMessageSize() {
+#if defined(CRYPTOLIB_MBEDTLS)
+        return SIZE_MAX;
+#elif defined(MESSAGE_HASHES_CPU_DISPATCH)
+        static const size_t max_size = __builtin_cpu_supports("avx2") &&
+            !__builtin_cpu_supports("sha") ? SIZE_MAX : 1024;
+        return max_size;
+#else
+        return 1024;
+#endif
+    }  // MaxLaneMessageSize
+}  // namespace
+
+
+/**
+ * Compute the SHA256 hashes of several independent messages at once.
+ * The digest of each message is the same as ComputeMessageHash() of it.
+ *
+ * @param messages Messages to hash, not null
+ * @returns byte arrays containing the binary hash of each message,
+ *          in the order of messages
+ */
+std::vector<ByteArray> pcrypto::ComputeMessageHashes(
+        const std::vector<const ByteArray*>& messages) {
+    std::vector<ByteArray> digests(messages.size());
+    std::vector<size_t> lane_indices;
+    size_t max_lane_size = MaxLaneMessageSize();
+    for (size_t i = 0; i < messages.size(); i++) {
+        if (messages[i]->size() <= max_lane_size) {
+            lane_indices.push_back(i);
+        } else {
+            digests[i] = ComputeMessageHash(*messages[i]);
+        }
+    }
+    if (lane_indices.size() == 1) {
+        digests[lane_indices[0]] = ComputeMessageHash(
+            *messages[lane_indices[0]]);
+    } else if (lane_indices.size() > 1) {
+        HashInLanes(messages, lane_indices, digests);
+    }
+    return digests;
+}  // pcrypto::ComputeMessageHashes
+
+
+/**
+ * Compute the SHA256 hashes of several independent messages at once.
+ *
+ * @param messages Messages to hash
+ * @returns byte arrays containing the binary hash of each message,
+ *          in the order of messages
+ */
+std::vector<ByteArray> pcrypto::ComputeMessageHashes(
+        const std::vector<ByteArray>& messages) {
+    std::vector<const ByteArray*> pointers;
+    pointers.reserve(messages.size());
+    for (const ByteArray& message : messages) {
+        pointers.push_back(&message);
+    }
+    return ComputeMessageHashes(pointers);
+}  // pcrypto::ComputeMessageHashes
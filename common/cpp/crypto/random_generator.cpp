@@ -0,0 +1,114 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon deterministic random bit generator.
+ *
+ * Lower-level functions implemented using OpenSSL.
+ * See also random_generator_common.cpp for OpenSSL-independent code.
+ */
+
+#include <memory>    // std::unique_ptr
+#include <openssl/crypto.h>  // OPENSSL_cleanse()
+#include <openssl/evp.h>
+
+#include "crypto_shared.h"
+#include "error.h"
+#include "random_generator.h"
+
+#ifndef CRYPTOLIB_OPENSSL
+#error "CRYPTOLIB_OPENSSL must be defined to compile source with OpenSSL."
+#endif
+
+namespace pcrypto = tcf::crypto;
+
+// Typedefs for memory management
+// Specify type and destroy function type for unique_ptrs
+typedef std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX*)> CTX_ptr;
+
+// Error handling
+namespace Error = tcf::error;
+
+
+struct pcrypto::RandomGenerator::Context {
+    // AES-256-ECB encryption with the current key
+    CTX_ptr cipher_ctx;
+
+    Context() : cipher_ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) {}
+};
+
+
+/**
+ * Create a random generator, which is seeded on first use.
+ * Throws RuntimeError.
+ */
+pcrypto::RandomGenerator::RandomGenerator() :
+        context_(new Context()), v_(), reseed_counter_(0),
+        fork_generation_(0), seeded_(false) {
+    if (!context_->cipher_ctx) {
+        std::string msg(
+            "Crypto Error (RandomGenerator): OpenSSL could not create "
+            "new EVP_CIPHER_CTX");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (EVP_EncryptInit_ex(context_->cipher_ctx.get(), EVP_aes_256_ecb(),
+            nullptr, nullptr, nullptr) != 1 ||
+            EVP_CIPHER_CTX_set_padding(context_->cipher_ctx.get(), 0) != 1) {
+        std::string msg(
+            "Crypto Error (RandomGenerator): OpenSSL could not "
+            "initialize EVP_CIPHER_CTX with AES-256-ECB");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::RandomGenerator::RandomGenerator
+
+
+// EVP_CIPHER_CTX_free() cleanses the expanded key
+pcrypto::RandomGenerator::~RandomGenerator() {
+    OPENSSL_cleanse(v_, sizeof(v_));
+}  // pcrypto::RandomGenerator::~RandomGenerator
+
+
+/*
+ * Set up the AES-256 key.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::SetKey(const uint8_t* key) {
+    if (EVP_EncryptInit_ex(context_->cipher_ctx.get(), nullptr, nullptr,
+            key, nullptr) != 1) {
+        std::string msg("Crypto Error (RandomGenerator): OpenSSL could not "
+            "set AES-256 key");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::RandomGenerator::SetKey
+
+
+/*
+ * Encrypt blocks AES blocks from in into out with the current key.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::EncryptBlocks(const uint8_t* in,
+        uint8_t* out, size_t blocks) {
+    int len = (int) blocks * 16;
+    int out_len = 0;
+
+    if (EVP_EncryptUpdate(context_->cipher_ctx.get(), out, &out_len,
+            in, len) != 1 || out_len != len) {
+        std::string msg("Crypto Error (RandomGenerator): OpenSSL could not "
+            "encrypt AES-256 blocks");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::RandomGenerator::EncryptBlocks
@@ -0,0 +1,114 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon deterministic random bit generator.
+ * Uses CTR_DRBG with AES-256 (NIST SP 800-90A).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include "types.h"
+
+// Number of Generate() requests after which a random generator is reseeded
+// from the entropy source. SP 800-90A allows up to 2^48.
+#ifndef RANDOM_GENERATOR_RESEED_INTERVAL
+#define RANDOM_GENERATOR_RESEED_INTERVAL (1 << 16)
+#endif
+
+namespace tcf {
+namespace crypto {
+    namespace constants {
+        /** CTR_DRBG AES-256 seed length (384 bits) */
+        const int DRBG_SEED_LEN = 48;
+        /** Largest CTR_DRBG request, longer requests are split (64 KB) */
+        const int DRBG_MAX_REQUEST_LEN = 1 << 16;
+    }  // namespace constants
+
+    /**
+     * CTR_DRBG with AES-256 and without derivation function, as specified
+     * by NIST SP 800-90A. It is seeded on first use from the entropy
+     * source, sgx_read_rand() in enclaves and RandomBitString() in
+     * untrusted code, and reseeded after RANDOM_GENERATOR_RESEED_INTERVAL
+     * requests and in the child process after fork().
+     *
+     * Much faster than RandomBitString() for the short random values of
+     * work orders. An instance must not be used by more than one thread
+     * at a time, see GetThreadRandomGenerator().
+     */
+    class RandomGenerator {
+    public:
+        /** Throws RuntimeError. */
+        RandomGenerator();
+        ~RandomGenerator();
+
+        /**
+         * Fill buf with length random bytes.
+         * Throws RuntimeError.
+         */
+        void Generate(uint8_t* buf, size_t length);
+
+        /**
+         * Return length random bytes, like RandomBitString().
+         * Throws RuntimeError, ValueError.
+         */
+        ByteArray RandomBitString(size_t length);
+
+        /**
+         * Seed the generator from entropy_input of DRBG_SEED_LEN bytes
+         * instead of the entropy source, for known answer tests.
+         * Throws RuntimeError, ValueError.
+         */
+        void Seed(const ByteArray& entropy_input);
+
+        /** Reseed the generator from the entropy source. */
+        // throws RuntimeError
+        void Reseed();
+
+        /** Wipe the state, the next request seeds the generator again. */
+        void Clear();
+
+    private:
+        RandomGenerator(const RandomGenerator&);
+        RandomGenerator& operator=(const RandomGenerator&);
+
+        // CTR_DRBG_Update() with provided_data of DRBG_SEED_LEN bytes
+        void Update(const uint8_t* provided_data);
+        // Encrypts the next blocks of the counter V into out
+        void EncryptCounter(uint8_t* out, size_t blocks);
+
+        // Crypto library specific
+        void SetKey(const uint8_t* key);
+        void EncryptBlocks(const uint8_t* in, uint8_t* out, size_t blocks);
+
+        struct Context;
+        std::unique_ptr<Context> context_;
+        uint8_t v_[16];
+        uint64_t reseed_counter_;
+        unsigned int fork_generation_;
+        bool seeded_;
+    };  // class RandomGenerator
+
+    /**
+     * Returns the random generator of the calling thread, of the TCS in
+     * enclaves, where it is kept across ecalls.
+     * Throws RuntimeError.
+     */
+    RandomGenerator& GetThreadRandomGenerator();
+}  // namespace crypto
+}  // namespace tcf
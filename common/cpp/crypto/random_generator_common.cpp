@@ -0,0 +1,282 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * CTR_DRBG with AES-256 and without derivation function
+ * (NIST SP 800-90A, section 10.2.1).
+ *
+ * No OpenSSL/Mbed TLS-dependent code is present.
+ * See random_generator.cpp for OpenSSL/Mbed TLS-dependent code.
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef _UNTRUSTED_
+#include <pthread.h>   // pthread_atfork()
+#else
+#include <sgx_trts.h>  // sgx_read_rand()
+#endif
+
+#include "crypto_shared.h"
+#include "crypto_utils.h" // RandomBitString()
+#include "error.h"
+#include "random_generator.h"
+#include "thread_slot.h"
+
+namespace pcrypto = tcf::crypto;
+
+// Error handling
+namespace Error = tcf::error;
+
+namespace constants = tcf::crypto::constants;
+
+static const size_t AES_BLOCK_LEN = 16;
+static const size_t AES_256_KEY_LEN = 32;
+
+
+// Overwrite secret state so that the compiler can not omit it
+static void Wipe(uint8_t* buf, size_t length) {
+    volatile uint8_t* p = buf;
+    while (length-- > 0) {
+        *p++ = 0;
+    }
+}  // Wipe
+
+
+#ifdef _UNTRUSTED_
+// Incremented in the child process after fork(), where the random
+// generators of the parent must not repeat its output
+static unsigned int fork_generation = 0;
+
+static void CountFork() {
+    fork_generation++;
+}  // CountFork
+
+static unsigned int GetForkGeneration() {
+    static int registered = pthread_atfork(nullptr, nullptr, CountFork);
+    (void) registered;
+    return fork_generation;
+}  // GetForkGeneration
+#else
+// Enclaves do not fork
+static unsigned int GetForkGeneration() {
+    return 0;
+}  // GetForkGeneration
+#endif
+
+
+/*
+ * Fill buf with length bytes of entropy.
+ * Throws RuntimeError.
+ */
+static void GetEntropy(uint8_t* buf, size_t length) {
+#ifdef _UNTRUSTED_
+    ByteArray entropy = pcrypto::RandomBitString(length);
+    memcpy(buf, entropy.data(), length);
+    Wipe(entropy.data(), entropy.size());
+#else
+    if (sgx_read_rand(buf, length) != SGX_SUCCESS) {
+        std::string msg("Crypto Error (RandomGenerator): "
+            "sgx_read_rand() failed");
+        throw Error::RuntimeError(msg);
+    }
+#endif
+}  // GetEntropy
+
+
+/**
+ * Fill buf with length random bytes. The generator is seeded or
+ * reseeded first if needed. Requests longer than DRBG_MAX_REQUEST_LEN
+ * are split into several requests.
+ * Throws RuntimeError.
+ *
+ * @param buf    Buffer for the random bytes
+ * @param length Number of random bytes
+ */
+void pcrypto::RandomGenerator::Generate(uint8_t* buf, size_t length) {
+    static const uint8_t no_additional_input[constants::DRBG_SEED_LEN] = {0};
+
+    while (length > 0) {
+        if (!seeded_ || reseed_counter_ > RANDOM_GENERATOR_RESEED_INTERVAL ||
+                fork_generation_ != GetForkGeneration()) {
+            Reseed();
+        }
+
+        size_t request = std::min(length,
+            (size_t) constants::DRBG_MAX_REQUEST_LEN);
+        size_t blocks = request / AES_BLOCK_LEN;
+        size_t rest = request % AES_BLOCK_LEN;
+        EncryptCounter(buf, blocks);
+        if (rest > 0) {
+            uint8_t block[AES_BLOCK_LEN];
+            EncryptCounter(block, 1);
+            memcpy(buf + blocks * AES_BLOCK_LEN, block, rest);
+            Wipe(block, sizeof(block));
+        }
+        // Backtracking resistance: the state which produced this output
+        // is replaced
+        Update(no_additional_input);
+        reseed_counter_++;
+
+        buf += request;
+        length -= request;
+    }
+}  // pcrypto::RandomGenerator::Generate
+
+
+/**
+ * Generate a random bit string.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param length Length of random bit string in bytes
+ * @returns byte array with binary random bits
+ */
+ByteArray pcrypto::RandomGenerator::RandomBitString(size_t length) {
+    if (length < 1) {
+        std::string msg("Crypto Error (RandomGenerator::RandomBitString): "
+            "length argument must be at least 1");
+        throw Error::ValueError(msg);
+    }
+
+    ByteArray buf(length);
+    Generate(buf.data(), length);
+    return buf;
+}  // pcrypto::RandomGenerator::RandomBitString
+
+
+/**
+ * Instantiate the generator from entropy_input, without personalization
+ * string, instead of from the entropy source.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param entropy_input DRBG_SEED_LEN bytes of seed material
+ */
+void pcrypto::RandomGenerator::Seed(const ByteArray& entropy_input) {
+    if (entropy_input.size() != constants::DRBG_SEED_LEN) {
+        std::string msg("Crypto Error (RandomGenerator::Seed): "
+            "entropy input must be 48 bytes long");
+        throw Error::ValueError(msg);
+    }
+
+    Clear();
+    Update(entropy_input.data());
+    reseed_counter_ = 1;
+    fork_generation_ = GetForkGeneration();
+    seeded_ = true;
+}  // pcrypto::RandomGenerator::Seed
+
+
+/**
+ * Reseed the generator from the entropy source, or instantiate it if it
+ * is not seeded yet.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::Reseed() {
+    uint8_t entropy[constants::DRBG_SEED_LEN];
+
+    GetEntropy(entropy, sizeof(entropy));
+    if (!seeded_) {
+        Clear();
+    }
+    Update(entropy);
+    Wipe(entropy, sizeof(entropy));
+    reseed_counter_ = 1;
+    fork_generation_ = GetForkGeneration();
+    seeded_ = true;
+}  // pcrypto::RandomGenerator::Reseed
+
+
+/**
+ * Set the key and V to zero, as for instantiation.
+ * The next request seeds the generator from the entropy source again.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::Clear() {
+    static const uint8_t zero_key[AES_256_KEY_LEN] = {0};
+
+    SetKey(zero_key);
+    Wipe(v_, sizeof(v_));
+    reseed_counter_ = 0;
+    seeded_ = false;
+}  // pcrypto::RandomGenerator::Clear
+
+
+/*
+ * CTR_DRBG_Update(): replace the key and V with the next DRBG_SEED_LEN
+ * bytes of output XOR provided_data.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::Update(const uint8_t* provided_data) {
+    uint8_t temp[constants::DRBG_SEED_LEN];
+
+    EncryptCounter(temp, sizeof(temp) / AES_BLOCK_LEN);
+    for (size_t i = 0; i < sizeof(temp); i++) {
+        temp[i] ^= provided_data[i];
+    }
+    SetKey(temp);
+    memcpy(v_, temp + AES_256_KEY_LEN, sizeof(v_));
+    Wipe(temp, sizeof(temp));
+}  // pcrypto::RandomGenerator::Update
+
+
+/*
+ * Increment V as a 128-bit big-endian number and encrypt it with the key,
+ * blocks times, into out.
+ * Throws RuntimeError.
+ */
+void pcrypto::RandomGenerator::EncryptCounter(uint8_t* out, size_t blocks) {
+    const size_t CHUNK_BLOCKS = 16;
+    uint8_t counters[CHUNK_BLOCKS * AES_BLOCK_LEN];
+    size_t used = std::min(blocks, CHUNK_BLOCKS) * AES_BLOCK_LEN;
+
+    while (blocks > 0) {
+        size_t chunk = std::min(blocks, CHUNK_BLOCKS);
+        for (size_t i = 0; i < chunk; i++) {
+            for (int j = AES_BLOCK_LEN - 1; j >= 0; j--) {
+                if (++v_[j] != 0) {
+                    break;
+                }
+            }
+            memcpy(counters + i * AES_BLOCK_LEN, v_, AES_BLOCK_LEN);
+        }
+        EncryptBlocks(counters, out, chunk);
+        out += chunk * AES_BLOCK_LEN;
+        blocks -= chunk;
+    }
+    Wipe(counters, used);
+}  // pcrypto::RandomGenerator::EncryptCounter
+
+
+/**
+ * Return the random generator of the calling thread. Each thread has
+ * its own state, seeded separately from the entropy source.
+ * In an enclave thread local storage is set up again on every ecall, so
+ * the generator of each TCS is kept in a slot (see thread_slot.h) and
+ * reseeded after RANDOM_GENERATOR_RESEED_INTERVAL requests across ecalls.
+ * The generators are wiped by their destructors when the enclave is
+ * destroyed.
+ * Throws RuntimeError.
+ */
+pcrypto::RandomGenerator& pcrypto::GetThreadRandomGenerator() {
+#ifdef _UNTRUSTED_
+    static thread_local RandomGenerator generator;
+    return generator;
+#else
+    static tcf::ThreadSlots<RandomGenerator> generators;
+    return generators.Get();
+#endif
+}  // pcrypto::GetThreadRandomGenerator
@@ -30,9 +30,11 @@ namespace crypto {
     // ECDSA signature
     namespace sig {
         class PublicKey;
+        class Signer;
 
         class PrivateKey {
             friend PublicKey;
+            friend Signer;
 
         public:
             // Default constructor
@@ -0,0 +1,509 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon ECDSA signer for signing many messages with the same key.
+ * Used for Secp256k1.
+ *
+ * Lower-level functions implemented using OpenSSL.
+ */
+
+#include <openssl/crypto.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <string.h>  // memcpy(), memset()
+#include <memory>    // std::unique_ptr
+
+#include "crypto_shared.h"
+#include "error.h"
+#include "sig.h"
+#include "sig_private_key.h"
+#include "sig_signer.h"
+
+#ifndef CRYPTOLIB_OPENSSL
+#error "CRYPTOLIB_OPENSSL must be defined to compile source with OpenSSL."
+#endif
+
+namespace pcrypto = tcf::crypto;
+
+// Typedefs for memory management.
+// Specify type and destroy function type for unique_ptr
+typedef std::unique_ptr<BIGNUM, void (*)(BIGNUM*)> BIGNUM_ptr;
+typedef std::unique_ptr<BN_CTX, void (*)(BN_CTX*)> BN_CTX_ptr;
+typedef std::unique_ptr<BN_MONT_CTX, void (*)(BN_MONT_CTX*)> BN_MONT_CTX_ptr;
+typedef std::unique_ptr<EC_KEY, void (*)(EC_KEY*)> EC_KEY_ptr;
+typedef std::unique_ptr<EC_POINT, void (*)(EC_POINT*)> EC_POINT_ptr;
+// Error handling
+namespace Error = tcf::error;
+
+// HMAC-SHA256 output length, in bytes
+#define HMAC_LEN SHA256_DIGEST_LENGTH
+
+// Largest nonce candidate, in whole HMAC outputs. Enough for orders of up
+// to 768 bits, the octet strings of the key and of the hash fit as well.
+#define NONCE_BUFFER_LEN (3 * HMAC_LEN)
+
+// Most big numbers holding secrets in a BnFrame
+#define BN_FRAME_SECRETS 4
+
+
+// Key and curve constants, set up once per signer
+struct pcrypto::sig::Signer::Context {
+    Context() : key(nullptr, EC_KEY_free), private_key(nullptr, BN_clear_free),
+        half_order(nullptr, BN_free), order_minus_two(nullptr, BN_free),
+        order_mont(nullptr, BN_MONT_CTX_free) {}
+    ~Context() {
+        if (!private_octets.empty()) {
+            OPENSSL_cleanse(private_octets.data(), private_octets.size());
+        }
+    }
+
+    EC_KEY_ptr key;
+    const EC_GROUP* group;
+    const BIGNUM* order;
+    int order_bits;
+    // Private key for computing s in constant time
+    BIGNUM_ptr private_key;
+    // Floor of order / 2, the largest low S value
+    BIGNUM_ptr half_order;
+    // Exponent for inverting nonces modulo the order in constant time
+    BIGNUM_ptr order_minus_two;
+    // Montgomery context of the order, for inverting nonces and computing s
+    BN_MONT_CTX_ptr order_mont;
+    // Private key as an octet string of the length of the order (RFC 6979)
+    ByteArray private_octets;
+};
+
+
+/**
+ * Create a big number context, for the big numbers of one signature.
+ * Throws RuntimeError.
+ */
+static BN_CTX_ptr NewBnContext() {
+    BN_CTX_ptr context(BN_CTX_new(), BN_CTX_free);
+    if (context == nullptr) {
+        std::string msg("Crypto Error (sig::Signer): "
+            "Could not create BN_CTX");
+        throw Error::RuntimeError(msg);
+    }
+    return context;
+}  // NewBnContext
+
+
+/**
+ * Frame of big numbers taken from a BN_CTX. Big numbers holding secrets
+ * are cleared when the frame ends.
+ */
+class BnFrame {
+public:
+    explicit BnFrame(BN_CTX* context) : context_(context), num_secrets_(0) {
+        BN_CTX_start(context_);
+    }
+    ~BnFrame() {
+        for (int i = 0; i < num_secrets_; i++) {
+            BN_clear(secrets_[i]);
+        }
+        BN_CTX_end(context_);
+    }
+
+    // Throws RuntimeError
+    BIGNUM* Get(bool secret) {
+        BIGNUM* b = BN_CTX_get(context_);
+        if (b == nullptr || (secret && num_secrets_ == BN_FRAME_SECRETS)) {
+            std::string msg("Crypto Error (sig::Signer::SignMessage): "
+                "Could not get BIGNUM");
+            throw Error::RuntimeError(msg);
+        }
+        if (secret) {
+            BN_set_flags(b, BN_FLG_CONSTTIME);
+            secrets_[num_secrets_++] = b;
+        }
+        return b;
+    }
+
+private:
+    BN_CTX* context_;
+    BIGNUM* secrets_[BN_FRAME_SECRETS];
+    int num_secrets_;
+};  // BnFrame
+
+
+/**
+ * HMAC_DRBG of RFC 6979 section 3.2, generating the nonce candidates
+ * for one signature. HMAC-SHA256 is computed from SHA256 states of the
+ * inner and outer padded key, set up once each time the key K changes,
+ * which V and the other data are passed to piece by piece. Nothing is
+ * allocated.
+ */
+class NonceGenerator {
+public:
+    /**
+     * Steps b. to g., with the private key and the hash as octet strings
+     * of the length of the order.
+     */
+    NonceGenerator(const unsigned char* private_octets,
+            const unsigned char* hash_octets, size_t len) {
+        memset(v_, 0x01, sizeof(v_));
+        memset(k_, 0x00, sizeof(k_));
+        SetKey();
+        UpdateKey(0x00, private_octets, hash_octets, len);
+        UpdateV();
+        UpdateKey(0x01, private_octets, hash_octets, len);
+        UpdateV();
+    }
+
+    ~NonceGenerator() {
+        OPENSSL_cleanse(v_, sizeof(v_));
+        OPENSSL_cleanse(k_, sizeof(k_));
+        OPENSSL_cleanse(&inner_, sizeof(inner_));
+        OPENSSL_cleanse(&outer_, sizeof(outer_));
+    }
+
+    /** Step h.2, the next len bytes of output in candidate */
+    void Generate(unsigned char* candidate, size_t len) {
+        for (size_t position = 0; position < len; position += HMAC_LEN) {
+            UpdateV();
+            memcpy(candidate + position, v_, HMAC_LEN);
+        }
+    }
+
+    /** Step h.3, after a rejected candidate */
+    void Reseed() {
+        UpdateKey(0x00, nullptr, nullptr, 0);
+        UpdateV();
+    }
+
+private:
+    // Sets up the SHA256 states of K XOR ipad and K XOR opad
+    void SetKey() {
+        unsigned char pad[SHA256_CBLOCK];
+        memset(pad, 0x36, sizeof(pad));
+        for (int i = 0; i < HMAC_LEN; i++) {
+            pad[i] ^= k_[i];
+        }
+        SHA256_Init(&inner_);
+        SHA256_Update(&inner_, pad, sizeof(pad));
+        memset(pad, 0x5c, sizeof(pad));
+        for (int i = 0; i < HMAC_LEN; i++) {
+            pad[i] ^= k_[i];
+        }
+        SHA256_Init(&outer_);
+        SHA256_Update(&outer_, pad, sizeof(pad));
+        OPENSSL_cleanse(pad, sizeof(pad));
+    }
+
+    // Starts an HMAC with the current key and V as the first data
+    void StartMac(SHA256_CTX& mac) {
+        mac = inner_;
+        SHA256_Update(&mac, v_, HMAC_LEN);
+    }
+
+    void FinishMac(SHA256_CTX& mac, unsigned char* out) {
+        unsigned char inner_hash[HMAC_LEN];
+        SHA256_Final(inner_hash, &mac);
+        mac = outer_;
+        SHA256_Update(&mac, inner_hash, HMAC_LEN);
+        SHA256_Final(out, &mac);
+        OPENSSL_cleanse(inner_hash, sizeof(inner_hash));
+        OPENSSL_cleanse(&mac, sizeof(mac));
+    }
+
+    // V = HMAC_K(V)
+    void UpdateV() {
+        SHA256_CTX mac;
+        StartMac(mac);
+        FinishMac(mac, v_);
+    }
+
+    // K = HMAC_K(V || separator || private key || hash)
+    void UpdateKey(unsigned char separator,
+            const unsigned char* private_octets,
+            const unsigned char* hash_octets, size_t len) {
+        SHA256_CTX mac;
+        StartMac(mac);
+        SHA256_Update(&mac, &separator, 1);
+        if (len > 0) {
+            SHA256_Update(&mac, private_octets, len);
+            SHA256_Update(&mac, hash_octets, len);
+        }
+        FinishMac(mac, k_);
+        SetKey();
+    }
+
+    SHA256_CTX inner_;
+    SHA256_CTX outer_;
+    unsigned char v_[HMAC_LEN];
+    unsigned char k_[HMAC_LEN];
+};  // NonceGenerator
+
+
+/**
+ * Integer of the leftmost order_bits bits of an octet string
+ * (bits2int of RFC 6979).
+ * Throws RuntimeError.
+ */
+static void Bits2Int(const unsigned char* data, size_t len,
+        int order_bits, BIGNUM* out) {
+    size_t used_len = len;
+    if (8 * used_len > (size_t)order_bits) {
+        used_len = (order_bits + 7) / 8;
+    }
+    if (BN_bin2bn(data, used_len, out) == nullptr ||
+            (8 * used_len > (size_t)order_bits &&
+            !BN_rshift(out, out, 8 * used_len - order_bits))) {
+        std::string msg("Crypto Error (sig::Signer::SignMessage): "
+            "Could not convert octets to BIGNUM");
+        throw Error::RuntimeError(msg);
+    }
+}  // Bits2Int
+
+
+/**
+ * Writes a DER length and returns the number of bytes written, at most 2
+ * for the lengths of signatures.
+ */
+static size_t PutDerLength(unsigned char* out, size_t len) {
+    if (len < 0x80) {
+        out[0] = (unsigned char)len;
+        return 1;
+    }
+    out[0] = 0x81;
+    out[1] = (unsigned char)len;
+    return 2;
+}  // PutDerLength
+
+
+/**
+ * Size of the content of the DER INTEGER of a positive big number, with a
+ * leading zero byte if its top bit is set.
+ */
+static size_t DerIntegerSize(const BIGNUM* value) {
+    return BN_num_bytes(value) + (BN_num_bits(value) % 8 == 0 ? 1 : 0);
+}  // DerIntegerSize
+
+
+/**
+ * Writes the DER INTEGER of a positive big number and returns the number
+ * of bytes written.
+ */
+static size_t PutDerInteger(unsigned char* out, const BIGNUM* value) {
+    size_t size = DerIntegerSize(value);
+    out[0] = 0x02;
+    size_t n = 1 + PutDerLength(out + 1, size);
+    if (size > (size_t)BN_num_bytes(value)) {
+        out[n++] = 0x00;
+    }
+    return n + BN_bn2bin(value, out + n);
+}  // PutDerInteger
+
+
+/**
+ * Constructor, sets up the curve constants of the private key.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param privateKey ECDSA private key to sign with
+ */
+pcrypto::sig::Signer::Signer(const pcrypto::sig::PrivateKey& privateKey) :
+        context_(new Context()) {
+    if (privateKey.private_key_ == nullptr) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "PrivateKey is not initialized");
+        throw Error::ValueError(msg);
+    }
+
+    context_->key.reset(EC_KEY_dup((EC_KEY *)privateKey.private_key_));
+    if (context_->key == nullptr) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Could not copy private key");
+        throw Error::RuntimeError(msg);
+    }
+    context_->group = EC_KEY_get0_group(context_->key.get());
+    context_->order = EC_GROUP_get0_order(context_->group);
+    const BIGNUM* private_key = EC_KEY_get0_private_key(context_->key.get());
+    if (context_->order == nullptr || private_key == nullptr) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Could not get private key");
+        throw Error::ValueError(msg);
+    }
+    context_->order_bits = BN_num_bits(context_->order);
+    if (context_->order_bits > 8 * NONCE_BUFFER_LEN) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Curve order is too large");
+        throw Error::ValueError(msg);
+    }
+
+    BN_CTX_ptr bn_context = NewBnContext();
+    context_->private_key.reset(BN_dup(private_key));
+    context_->half_order.reset(BN_new());
+    context_->order_minus_two.reset(BN_new());
+    context_->order_mont.reset(BN_MONT_CTX_new());
+    if (context_->private_key == nullptr ||
+            context_->half_order == nullptr ||
+            context_->order_minus_two == nullptr ||
+            context_->order_mont == nullptr ||
+            !BN_rshift1(context_->half_order.get(), context_->order) ||
+            !BN_copy(context_->order_minus_two.get(), context_->order) ||
+            !BN_sub_word(context_->order_minus_two.get(), 2) ||
+            !BN_MONT_CTX_set(context_->order_mont.get(), context_->order,
+                bn_context.get())) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Could not set up curve constants");
+        throw Error::RuntimeError(msg);
+    }
+    BN_set_flags(context_->private_key.get(), BN_FLG_CONSTTIME);
+
+    context_->private_octets.resize((context_->order_bits + 7) / 8);
+    if (BN_bn2binpad(private_key, context_->private_octets.data(),
+            context_->private_octets.size()) < 0) {
+        std::string msg("Crypto Error (sig::Signer()): "
+            "Could not convert private key");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::sig::Signer::Signer
+
+
+/**
+ * Signer destructor.
+ */
+pcrypto::sig::Signer::~Signer() {
+}  // pcrypto::sig::Signer::~Signer
+
+
+/**
+ * Signs the message hash with a nonce derived as in RFC 6979 section
+ * 3.2 and makes the signature Bitcoin canonical.
+ * Throws RuntimeError.
+ *
+ * @param hashMessage Data in a byte array to sign.
+ *                    This is not the message to sign but a hash of the message
+ * @returns ByteArray containing signature data in DER format
+ *                    as defined in RFC 4492
+ */
+ByteArray pcrypto::sig::Signer::SignMessage(
+        const ByteArray& hashMessage) const {
+    const Context& c = *context_;
+    // Allocated for each signature, thread local storage does not outlive
+    // an ecall in the enclave
+    BN_CTX_ptr bn_context_owner = NewBnContext();
+    BN_CTX* bn_context = bn_context_owner.get();
+    BnFrame frame(bn_context);
+    BIGNUM* k = frame.Get(true);
+    BIGNUM* kinv = frame.Get(true);
+    BIGNUM* x = frame.Get(true);
+    BIGNUM* s = frame.Get(true);
+    BIGNUM* r = frame.Get(false);
+    BIGNUM* h = frame.Get(false);
+
+    EC_POINT_ptr point(EC_POINT_new(c.group), EC_POINT_clear_free);
+    if (point == nullptr) {
+        std::string msg("Crypto Error (sig::Signer::SignMessage): "
+            "Could not create EC_POINT");
+        throw Error::RuntimeError(msg);
+    }
+
+    // bits2octets(h1): the hash as an integer modulo the order
+    size_t octets_len = c.private_octets.size();
+    unsigned char hash_octets[NONCE_BUFFER_LEN];
+    Bits2Int(hashMessage.data(), hashMessage.size(), c.order_bits, h);
+    if (BN_cmp(h, c.order) >= 0 && !BN_sub(h, h, c.order)) {
+        std::string msg("Crypto Error (sig::Signer::SignMessage): "
+            "Could not reduce hash");
+        throw Error::RuntimeError(msg);
+    }
+    if (BN_bn2binpad(h, hash_octets, octets_len) < 0) {
+        std::string msg("Crypto Error (sig::Signer::SignMessage): "
+            "Could not convert hash");
+        throw Error::RuntimeError(msg);
+    }
+
+    NonceGenerator nonces(c.private_octets.data(), hash_octets, octets_len);
+    unsigned char candidate[NONCE_BUFFER_LEN];
+    size_t candidate_len = (c.order_bits + 8 * HMAC_LEN - 1) /
+        (8 * HMAC_LEN) * HMAC_LEN;
+    while (true) {
+        // Step h.: next nonce candidate
+        nonces.Generate(candidate, candidate_len);
+        Bits2Int(candidate, candidate_len, c.order_bits, k);
+        OPENSSL_cleanse(candidate, candidate_len);
+
+        if (!BN_is_zero(k) && BN_cmp(k, c.order) < 0) {
+            // r = x(k * G) mod order and kinv = k^(order - 2) mod order
+            if (!EC_POINT_mul(c.group, point.get(), k, nullptr, nullptr,
+                    bn_context) ||
+                    !EC_POINT_get_affine_coordinates_GFp(c.group,
+                        point.get(), x, nullptr, bn_context) ||
+                    !BN_nnmod(r, x, c.order, bn_context) ||
+                    !BN_mod_exp_mont_consttime(kinv, k,
+                        c.order_minus_two.get(), c.order, bn_context,
+                        c.order_mont.get())) {
+                std::string msg("Crypto Error (sig::Signer::SignMessage): "
+                    "Could not compute nonce point");
+                throw Error::RuntimeError(msg);
+            }
+
+            // s = kinv * (h + r * private key) mod order, multiplying in
+            // the Montgomery domain of the order like ECDSA_do_sign_ex()
+            if (!BN_is_zero(r)) {
+                if (!BN_to_montgomery(s, r, c.order_mont.get(),
+                        bn_context) ||
+                        !BN_mod_mul_montgomery(s, s, c.private_key.get(),
+                            c.order_mont.get(), bn_context) ||
+                        !BN_mod_add_quick(s, s, h, c.order) ||
+                        !BN_to_montgomery(s, s, c.order_mont.get(),
+                            bn_context) ||
+                        !BN_mod_mul_montgomery(s, s, kinv,
+                            c.order_mont.get(), bn_context)) {
+                    std::string msg(
+                        "Crypto Error (sig::Signer::SignMessage): "
+                        "Could not compute ECDSA signature");
+                    throw Error::RuntimeError(msg);
+                }
+                if (!BN_is_zero(s)) {
+                    break;
+                }
+            }
+        }
+        nonces.Reseed();
+    }
+
+    // Make signature Bitcoin canonical if needed: if s > order / 2,
+    // then s = order - s
+    if (BN_cmp(s, c.half_order.get()) > 0 && !BN_sub(s, c.order, s)) {
+        std::string msg("Crypto Error (sig::Signer::SignMessage): "
+            "Could not compute low S");
+        throw Error::RuntimeError(msg);
+    }
+
+    // DER encode the ECDSA signature, SEQUENCE of the INTEGERs r and s
+    size_t r_size = DerIntegerSize(r);
+    size_t s_size = DerIntegerSize(s);
+    size_t content_size = 2 + (r_size >= 0x80) + r_size +
+        2 + (s_size >= 0x80) + s_size;
+    ByteArray der_SIG(2 + (content_size >= 0x80) + content_size);
+    unsigned char* data = der_SIG.data();
+    data[0] = 0x30;
+    size_t n = 1 + PutDerLength(data + 1, content_size);
+    n += PutDerInteger(data + n, r);
+    n += PutDerInteger(data + n, s);
+    if (n != der_SIG.size()) {
+        std::string msg("Crypto Error (sig::Signer::SignMessage): "
+            "Could not convert signature to DER");
+        throw Error::RuntimeError(msg);
+    }
+
+    return der_SIG;
+}  // pcrypto::sig::Signer::SignMessage
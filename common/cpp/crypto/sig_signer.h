@@ -0,0 +1,69 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon ECDSA signer for signing many messages with the same key.
+ * ECDSA used for Secp256k1 elliptical curves.
+ */
+
+#pragma once
+#include <memory>
+#include "types.h"
+
+namespace tcf {
+namespace crypto {
+    namespace sig {
+        class PrivateKey;
+
+        /**
+         * Signs message hashes with one private key, for keys that sign
+         * many messages, like the enclave signing key does for every
+         * work order response.
+         * The curve constants of the key are set up once, when the signer
+         * is created.
+         * The signature nonce is derived deterministically from the key
+         * and the message hash as in RFC 6979, with HMAC-SHA256.
+         * Signatures are DER encoded and Bitcoin canonical (low S), as
+         * signatures of PrivateKey::SignMessage() are with OpenSSL.
+         * A signer can be used by several threads at the same time.
+         */
+        class Signer {
+        public:
+            /**
+             * The private key is copied, it may be destroyed after the
+             * signer is created.
+             * Throws RuntimeError, ValueError.
+             */
+            explicit Signer(const PrivateKey& privateKey);
+            ~Signer();
+
+            /**
+             * Sign hashMessage.data() and return ByteArray containing
+             * raw binary signature.
+             * Throws RuntimeError.
+             */
+            ByteArray SignMessage(const ByteArray& hashMessage) const;
+
+        private:
+            Signer(const Signer&);
+            Signer& operator=(const Signer&);
+
+            struct Context;
+            std::unique_ptr<Context> context_;
+        };  // class Signer
+    }  // namespace sig
+}  // namespace crypto
+}  // namespace tcf
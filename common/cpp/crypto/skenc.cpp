@@ -22,7 +22,9 @@
  * See also skenc_common.cpp for OpenSSL-independent code.
  */
 
+#include <limits.h>  // INT_MAX
 #include <memory>    // std::unique_ptr
+#include <openssl/crypto.h>  // CRYPTO_memcmp(), OPENSSL_cleanse()
 #include <openssl/evp.h>
 
 #include "crypto_shared.h"
@@ -45,213 +47,459 @@ namespace Error = tcf::error;
 namespace constants = tcf::crypto::constants;
 
 
+struct pcrypto::skenc::CipherContext::Context {
+    CTX_ptr cipher_ctx;
+    // Key set up in cipher_ctx, empty if none
+    ByteArray key;
+
+    Context() : cipher_ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) {}
+};
+
+
+/*
+ * Set up the context for a message with key and iv. The key is only
+ * expanded again if it differs from the key of the previous message.
+ * Throws RuntimeError.
+ */
+static void StartMessage(EVP_CIPHER_CTX* context, ByteArray& context_key,
+        const ByteArray& key, const unsigned char* iv, int enc,
+        const std::string& caller) {
+    const unsigned char* new_key = nullptr;
+
+    if (context_key.size() != key.size() ||
+            CRYPTO_memcmp(context_key.data(), key.data(), key.size()) != 0) {
+        OPENSSL_cleanse(context_key.data(), context_key.size());
+        context_key.clear();
+        new_key = (const unsigned char*)key.data();
+    }
+
+    if (EVP_CipherInit_ex(context, nullptr, nullptr, new_key, iv, enc) != 1) {
+        std::string msg("Crypto Error (" + caller + "): OpenSSL could not "
+            "initialize AES-GCM key and IV");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (new_key != nullptr) {
+        context_key = key;
+    }
+}  // StartMessage
+
+
 /**
- * Encrypt a message using AES-GCM authenticated encryption.
+ * Create a reusable AES-GCM context.
+ * Throws RuntimeError.
+ */
+pcrypto::skenc::CipherContext::CipherContext() : context_(new Context()) {
+    if (!context_->cipher_ctx) {
+        std::string msg(
+            "Crypto Error (CipherContext): OpenSSL could not create "
+            "new EVP_CIPHER_CTX");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (EVP_CipherInit_ex(context_->cipher_ctx.get(), EVP_aes_256_gcm(),
+            nullptr, nullptr, nullptr, 1) != 1) {
+        std::string msg(
+            "Crypto Error (CipherContext): OpenSSL could not "
+            "initialize EVP_CIPHER_CTX with AES-GCM");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::skenc::CipherContext::CipherContext
+
+
+// EVP_CIPHER_CTX_free() cleanses the expanded key
+pcrypto::skenc::CipherContext::~CipherContext() {
+    OPENSSL_cleanse(context_->key.data(), context_->key.size());
+}  // pcrypto::skenc::CipherContext::~CipherContext
+
+
+/**
+ * Wipe the key of the last message from the context.
+ * Throws RuntimeError.
+ */
+void pcrypto::skenc::CipherContext::Clear() {
+    OPENSSL_cleanse(context_->key.data(), context_->key.size());
+    context_->key.clear();
+
+    // Resetting the context cleanses the expanded key
+    if (EVP_CIPHER_CTX_reset(context_->cipher_ctx.get()) != 1 ||
+            EVP_CipherInit_ex(context_->cipher_ctx.get(), EVP_aes_256_gcm(),
+                nullptr, nullptr, nullptr, 1) != 1) {
+        std::string msg(
+            "Crypto Error (CipherContext): OpenSSL could not "
+            "reset EVP_CIPHER_CTX");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::skenc::CipherContext::Clear
+
+
+/*
+ * Check the arguments of EncryptInPlace() and DecryptInPlace().
+ * OpenSSL takes the length of the data as int.
+ * Throws ValueError.
+ */
+static void CheckArguments(const ByteArray& key, const ByteArray& iv,
+        size_t len, const std::string& caller) {
+    if (key.size() != constants::SYM_KEY_LEN) {
+        std::string msg(
+            "Crypto Error (" + caller + "): Wrong AES-GCM key length");
+        throw Error::ValueError(msg);
+    }
+
+    if (iv.size() != constants::IV_LEN) {
+        std::string msg(
+            "Crypto Error (" + caller + "): Wrong AES-GCM IV length");
+        throw Error::ValueError(msg);
+    }
+
+    if (len > INT_MAX) {
+        std::string msg(
+            "Crypto Error (" + caller + "): AES-GCM message too long");
+        throw Error::ValueError(msg);
+    }
+}  // CheckArguments
+
+
+/**
+ * Encrypt a message in place using AES-GCM authenticated encryption.
  *
- * Appends a 16 byte (128 bit) authentication tag (sometimes called a MAC)
- * to the output cipher text:
- *     message = ciphertext + authentication tag
- * The authentication tag is not encrypted.
+ * The authentication tag (sometimes called a MAC) is stored separately,
+ * the ciphertext followed by the tag is the same as the result of
+ * EncryptMessage().
  *
  * Throws RuntimeError, ValueError.
  *
- * @param message binary data to encrypt
  * @param key Secret AES-256 encryption key.
  *            Generated by GenerateKey()
  * @param iv  96-bit initialization Vector (IV). Generated by GenerateIV()
- * @returns Byte array containing encrypted data and appended auth tag
+ * @param buf binary data to encrypt, replaced by the ciphertext
+ * @param len Length of the data in bytes
+ * @param tag Receives the 16 byte (128 bit) authentication tag
  */
-ByteArray pcrypto::skenc::EncryptMessage(
-        const ByteArray& key, const ByteArray& iv, const ByteArray& message) {
-    unsigned char tag[constants::TAG_LEN];
-    int len;
-    int ct_len;
-    int pt_len = message.size();
-    unsigned char* pt = (unsigned char*)message.data();
-    int ct_buf_len = pt_len + constants::BLOCK_LENGTH;
-    ByteArray ct(ct_buf_len);
+void pcrypto::skenc::CipherContext::EncryptInPlace(
+        const ByteArray& key, const ByteArray& iv,
+        uint8_t* buf, size_t len, uint8_t tag[constants::TAG_LEN]) {
+    EVP_CIPHER_CTX* context = context_->cipher_ctx.get();
+    int out_len;
 
     // Sanity checks
-    if (key.size() != constants::SYM_KEY_LEN) {
+    CheckArguments(key, iv, len, "EncryptInPlace");
+    if (len == 0) {
         std::string msg(
-            "Crypto Error (EncryptMessage): Wrong AES-GCM key length");
+            "Crypto Error (EncryptInPlace): Cannot encrypt the empty message");
         throw Error::ValueError(msg);
     }
 
-    if (iv.size() != constants::IV_LEN) {
+    // Set Key and IV
+    StartMessage(context, context_->key, key,
+        (const unsigned char*)iv.data(), 1, "EncryptInPlace");
+
+    // AES-GCM is a stream cipher, the ciphertext is as long as the data
+    if (EVP_EncryptUpdate(context, buf, &out_len, buf, (int)len) != 1) {
+        std::string msg(
+            "Crypto Error (EncryptInPlace): OpenSSL could not update "
+            "AES-GCM encryption");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (EVP_EncryptFinal_ex(context, buf + out_len, &out_len) != 1) {
+        std::string msg(
+            "Crypto Error (EncryptInPlace): OpenSSL could not finalize "
+            "AES-GCM encryption");
+        throw Error::RuntimeError(msg);
+    }
+
+    // Generate message's auth tag
+    if (EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_GET_TAG,
+            constants::TAG_LEN, tag) != 1) {
+        std::string msg(
+            "Crypto Error (EncryptInPlace): OpenSSL could not get AES-GCM TAG");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::skenc::CipherContext::EncryptInPlace
+
+
+/**
+ * Decrypt a message in place using AES-GCM authenticated decryption.
+ *
+ * Throws RuntimeError, ValueError,
+ * CryptoError (message authentication failure).
+ *
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV). Generated by GenerateIV()
+ * @param buf Ciphertext to decrypt, without the authentication tag.
+ *            Replaced by the plaintext, or wiped if authentication fails
+ * @param len Length of the ciphertext in bytes
+ * @param tag 16 byte (128 bit) authentication tag of the message
+ */
+void pcrypto::skenc::CipherContext::DecryptInPlace(
+        const ByteArray& key, const ByteArray& iv,
+        uint8_t* buf, size_t len, const uint8_t tag[constants::TAG_LEN]) {
+    EVP_CIPHER_CTX* context = context_->cipher_ctx.get();
+    int out_len;
+
+    // Sanity checks
+    CheckArguments(key, iv, len, "DecryptInPlace");
+
+    // Set Key and IV
+    StartMessage(context, context_->key, key,
+        (const unsigned char*)iv.data(), 0, "DecryptInPlace");
+
+    if (len > 0 && !EVP_DecryptUpdate(context, buf, &out_len, buf,
+            (int)len)) {
         std::string msg(
-            "Crypto Error (EncryptMessage): Wrong AES-GCM IV length");
+            "Crypto Error (DecryptInPlace): OpenSSL could not decrypt "
+            "with AES-GCM");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (!EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG,
+            constants::TAG_LEN, (unsigned char *)tag)) {
+        std::string msg(
+            "Crypto Error (DecryptInPlace): OpenSSL could not set "
+            "AES-GCM TAG");
+        throw Error::RuntimeError(msg);
+    }
+
+    // AES-GCM does not buffer, nothing is written by the final call
+    if (EVP_DecryptFinal_ex(context, buf + len, &out_len) < 1) {
+        OPENSSL_cleanse(buf, len);
+        std::string msg(
+            "Crypto Error (DecryptInPlace): AES_GCM authentication "
+            "failed, plaintext is not trustworthy");
+        throw Error::CryptoError(msg);
+    }
+}  // pcrypto::skenc::CipherContext::DecryptInPlace
+
+
+struct pcrypto::skenc::StreamDecryptor::Context {
+    CTX_ptr cipher_ctx;
+
+    Context() : cipher_ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) {}
+};
+
+
+/**
+ * Start incremental AES-GCM decryption of a message.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV).
+ *            Generated by GenerateIV()
+ */
+pcrypto::skenc::StreamDecryptor::StreamDecryptor(
+        const ByteArray& key, const ByteArray& iv) : context_(new Context()) {
+    // Sanity checks
+    if (key.size() != constants::SYM_KEY_LEN) {
+        std::string msg(
+            "Crypto Error (StreamDecryptor): Wrong AES-GCM key length");
         throw Error::ValueError(msg);
     }
 
-    if (message.size() == 0) {
+    if (iv.size() != constants::IV_LEN) {
         std::string msg(
-            "Crypto Error (EncryptMessage): Cannot encrypt the empty message");
+            "Crypto Error (StreamDecryptor): Wrong AES-GCM IV length");
         throw Error::ValueError(msg);
     }
 
-    // Initialize encryption
-    CTX_ptr context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-    if (!context) {
+    if (!context_->cipher_ctx) {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not create "
+            "Crypto Error (StreamDecryptor): OpenSSL could not create "
             "new EVP_CIPHER_CTX");
         throw Error::RuntimeError(msg);
     }
 
-    if (EVP_EncryptInit_ex(context.get(), EVP_aes_256_gcm(),
-            nullptr, nullptr, nullptr) != 1) {
+    if (!EVP_DecryptInit_ex(context_->cipher_ctx.get(), EVP_aes_256_gcm(),
+            nullptr, nullptr, nullptr)) {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not "
+            "Crypto Error (StreamDecryptor): OpenSSL could not "
             "initialize EVP_CIPHER_CTX with AES-GCM");
         throw Error::RuntimeError(msg);
     }
 
-    // Set Key and IV
-    if (EVP_EncryptInit_ex(context.get(), nullptr, nullptr,
+    if (!EVP_DecryptInit_ex(context_->cipher_ctx.get(), nullptr, nullptr,
             (const unsigned char*)key.data(),
-            (const unsigned char*)iv.data()) != 1) {
+            (const unsigned char*)iv.data())) {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not "
+            "Crypto Error (StreamDecryptor): OpenSSL could not "
             "initialize AES-GCM key and IV");
         throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamDecryptor::StreamDecryptor
+
+
+pcrypto::skenc::StreamDecryptor::~StreamDecryptor() {
+}  // pcrypto::skenc::StreamDecryptor::~StreamDecryptor
+
+
+/*
+ * Decrypt size bytes of the message and append them to plaintext.
+ * AES-GCM does not buffer, the plaintext is as long as the ciphertext.
+ */
+void pcrypto::skenc::StreamDecryptor::DecryptUpdate(
+        const uint8_t* data, size_t size, ByteArray& plaintext) {
+    int len;
+    size_t pt_len = plaintext.size();
+
+    if (size == 0) {
+        return;
+    }
 
-    // Encrypt message (with no IV prepended)
-    if (EVP_EncryptUpdate(context.get(), ct.data(), &len, pt, pt_len) != 1) {
+    plaintext.resize(pt_len + size);
+    if (!EVP_DecryptUpdate(context_->cipher_ctx.get(),
+            plaintext.data() + pt_len, &len,
+            (const unsigned char *)data, size)) {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not update "
-            "AES-GCM encryption");
+            "Crypto Error (StreamDecryptor): OpenSSL could not decrypt "
+            "with AES-GCM");
         throw Error::RuntimeError(msg);
     }
-    ct_len = len;
+    plaintext.resize(pt_len + len);
+}  // pcrypto::skenc::StreamDecryptor::DecryptUpdate
+
 
-    // Get encrypted text, if any, still buffered (when len != 0 mod blocksize)
-    if (EVP_EncryptFinal_ex(context.get(), ct.data() + len, &len) != 1) {
+/*
+ * Check the authentication tag of the message and append decrypted text
+ * still buffered, if any, to plaintext.
+ */
+void pcrypto::skenc::StreamDecryptor::DecryptFinal(
+        const uint8_t* tag, ByteArray& plaintext) {
+    unsigned char final_block[constants::TAG_LEN];
+    int len = 0;
+
+    if (!EVP_CIPHER_CTX_ctrl(context_->cipher_ctx.get(), EVP_CTRL_GCM_SET_TAG,
+            constants::TAG_LEN, (unsigned char *)tag)) {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not finalize "
-            "AES-GCM encryption");
+            "Crypto Error (StreamDecryptor): OpenSSL could not set "
+            "AES-GCM TAG");
         throw Error::RuntimeError(msg);
     }
-    ct_len += len;
 
-    // Generate message's auth tag
-    if (EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_GET_TAG,
-            constants::TAG_LEN, tag) != 1) {
+    if (EVP_DecryptFinal_ex(context_->cipher_ctx.get(), final_block,
+            &len) < 1) {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not get AES-GCM TAG");
-        throw Error::RuntimeError(msg);
+            "Crypto Error (StreamDecryptor): AES_GCM authentication "
+            "failed, plaintext is not trustworthy");
+        throw Error::CryptoError(msg);
     }
+    plaintext.insert(plaintext.end(), final_block, final_block + len);
+}  // pcrypto::skenc::StreamDecryptor::DecryptFinal
 
-    // Build and return encrypted output string with auth tag appended
-    ct.resize(ct_len);
-    ct.insert(ct.end(), tag, tag + constants::TAG_LEN);
 
-    return ct;
-}  // pcrypto::skenc::EncryptMessage
+struct pcrypto::skenc::StreamEncryptor::Context {
+    CTX_ptr cipher_ctx;
 
+    Context() : cipher_ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free) {}
+};
 
-/*
- * Decrypt message.data() using AES-GCM authenticated decryption.
- *
- * Expects a 12 byte (96 bit) IV (sometimes called a nonce) and
- * an 16 byte (128 bit) authentication tag (sometimes called a MAC),
- * prepended and appended, respectively, the input cipher text:
- *     message = ciphertext + authentication tag
- * The authentication tag is not encrypted.
- *
- * Throws RuntimeError, ValueError,
- * CryptoError (message authentication failure).
+
+/**
+ * Start incremental AES-GCM encryption of a message.
+ * Throws RuntimeError, ValueError.
  *
- * @param key         Secret AES-256 encryption key.
- *                    Generated by GenerateKey()
- * @param iv          96-bit initialization Vector (IV).
- *                    Generated by GenerateIV()
- * @param message     binary data to decrypt. Generated by EncryptMessage()
- *                    Includes appended authentication tag.
- *                    IV is separate (not prepended to message)
- * @param message_len Length of message in bytes
- * @returns Byte array containing decrypted data
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV).
+ *            Generated by GenerateIV()
  */
-ByteArray pcrypto::skenc::DecryptMessage(
-        const ByteArray& key, const char iv[constants::IV_LEN],
-        const char *message, size_t message_len) {
-    ByteArray pt(message_len);
-    int len, pt_len;
-    int res;
-
+pcrypto::skenc::StreamEncryptor::StreamEncryptor(
+        const ByteArray& key, const ByteArray& iv) : context_(new Context()) {
     // Sanity checks
     if (key.size() != constants::SYM_KEY_LEN) {
         std::string msg(
-            "Crypto Error (DecryptMessage): Wrong AES-GCM key length");
+            "Crypto Error (StreamEncryptor): Wrong AES-GCM key length");
         throw Error::ValueError(msg);
     }
 
-    if (message_len < constants::TAG_LEN) {
+    if (iv.size() != constants::IV_LEN) {
         std::string msg(
-            "Crypto Error (DecryptMessage): AES-GCM message smaller "
-            "than minimum length (TAG length)");
+            "Crypto Error (StreamEncryptor): Wrong AES-GCM IV length");
         throw Error::ValueError(msg);
     }
 
-    // Initialize decryption
-    CTX_ptr context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-    if (!context) {
+    if (!context_->cipher_ctx) {
         std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not create "
+            "Crypto Error (StreamEncryptor): OpenSSL could not create "
             "new EVP_CIPHER_CTX");
         throw Error::RuntimeError(msg);
     }
 
-    if (!EVP_DecryptInit_ex(context.get(), EVP_aes_256_gcm(),
-            nullptr, nullptr, nullptr)) {
+    if (EVP_EncryptInit_ex(context_->cipher_ctx.get(), EVP_aes_256_gcm(),
+            nullptr, nullptr, nullptr) != 1) {
         std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not "
+            "Crypto Error (StreamEncryptor): OpenSSL could not "
             "initialize EVP_CIPHER_CTX with AES-GCM");
         throw Error::RuntimeError(msg);
     }
 
-    if (!EVP_DecryptInit_ex(context.get(), nullptr, nullptr,
+    if (EVP_EncryptInit_ex(context_->cipher_ctx.get(), nullptr, nullptr,
             (const unsigned char*)key.data(),
-            (const unsigned char*)iv)) {
+            (const unsigned char*)iv.data()) != 1) {
         std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not "
+            "Crypto Error (StreamEncryptor): OpenSSL could not "
             "initialize AES-GCM key and IV");
         throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamEncryptor::StreamEncryptor
+
+
+pcrypto::skenc::StreamEncryptor::~StreamEncryptor() {
+}  // pcrypto::skenc::StreamEncryptor::~StreamEncryptor
 
-    // Decrypt message (IV is separate; omit appended auth tag)
-    if (!EVP_DecryptUpdate(context.get(), pt.data(), &len,
-            (const unsigned char *)message,
-            message_len - constants::TAG_LEN)) {
+
+/**
+ * Encrypt the next piece of a message with AES-GCM.
+ * Throws RuntimeError.
+ *
+ * @param data Next piece of the message
+ * @param size Size of the piece in bytes
+ * @returns Byte array containing the encrypted piece
+ */
+ByteArray pcrypto::skenc::StreamEncryptor::Update(
+        const uint8_t* data, size_t size) {
+    int len = 0;
+    ByteArray ct(size);
+
+    if (size > 0 && EVP_EncryptUpdate(context_->cipher_ctx.get(),
+            ct.data(), &len, (const unsigned char *)data, size) != 1) {
         std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not decrypt "
-            "with AES-GCM");
+            "Crypto Error (StreamEncryptor): OpenSSL could not update "
+            "AES-GCM encryption");
         throw Error::RuntimeError(msg);
     }
-    pt_len = len;
+    ct.resize(len);
+    return ct;
+}  // pcrypto::skenc::StreamEncryptor::Update
 
-    // Extract the auth tag appended to the message
-    if (!EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_SET_TAG,
-            constants::TAG_LEN,
-            (unsigned char *)message + message_len - constants::TAG_LEN)) {
+
+/**
+ * Finish encryption of a message.
+ * Throws RuntimeError.
+ *
+ * @returns Byte array containing the rest of the encrypted data followed
+ *          by the authentication tag
+ */
+ByteArray pcrypto::skenc::StreamEncryptor::Finalize() {
+    int len = 0;
+    ByteArray ct(constants::BLOCK_LENGTH + constants::TAG_LEN);
+
+    if (EVP_EncryptFinal_ex(context_->cipher_ctx.get(), ct.data(),
+            &len) != 1) {
         std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not get AES-GCM TAG");
+            "Crypto Error (StreamEncryptor): OpenSSL could not finalize "
+            "AES-GCM encryption");
         throw Error::RuntimeError(msg);
     }
 
-    // Get decrypted text, if any, still buffered (when len != 0 mod blocksize)
-    res = EVP_DecryptFinal_ex(context.get(), pt.data() + len, &len);
-    if (res < 1) {
+    if (EVP_CIPHER_CTX_ctrl(context_->cipher_ctx.get(), EVP_CTRL_GCM_GET_TAG,
+            constants::TAG_LEN, ct.data() + len) != 1) {
         std::string msg(
-            "Crypto Error (DecryptMessage): AES_GCM authentication "
-            "failed, plaintext is not trustworthy");
-        throw Error::CryptoError(msg);
-    } else {
-        pt_len += len;
+            "Crypto Error (StreamEncryptor): OpenSSL could not get "
+            "AES-GCM TAG");
+        throw Error::RuntimeError(msg);
     }
-
-    // Build and return decrypted output string
-    pt.resize(pt_len);
-    return pt;
-}  // pcrypto::skenc::DecryptMessage
+    ct.resize(len + constants::TAG_LEN);
+    return ct;
+}  // pcrypto::skenc::StreamEncryptor::Finalize
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <memory>
 #include <string>
 #include <vector>
 #include "types.h"
@@ -81,6 +83,173 @@ namespace crypto {
          */
         ByteArray DecryptMessage(const ByteArray& key,
             const ByteArray& message);
+
+        /**
+         * Reusable AES-GCM context for encrypting and decrypting whole
+         * messages. The crypto library context is allocated once and
+         * the expanded key is kept between messages, so the key is only
+         * set up again when a different key is used.
+         * An instance must not be used by more than one thread at a
+         * time, see GetThreadCipherContext().
+         */
+        class CipherContext {
+        public:
+            /** Throws RuntimeError. */
+            CipherContext();
+            ~CipherContext();
+
+            /**
+             * Same as skenc::EncryptMessage(key, iv, message).
+             * Throws RuntimeError, ValueError.
+             */
+            ByteArray EncryptMessage(
+                const ByteArray& key, const ByteArray& iv,
+                const ByteArray& message);
+            /**
+             * Same as skenc::DecryptMessage(key, iv, message, message_len).
+             * Throws RuntimeError, ValueError,
+             * CryptoError (message authentication failure).
+             */
+            ByteArray DecryptMessage(
+                const ByteArray& key, const char iv[constants::IV_LEN],
+                const char *message, size_t message_len);
+
+            /**
+             * Same as skenc::EncryptInPlace(key, iv, buf, len, tag).
+             * Throws RuntimeError, ValueError.
+             */
+            void EncryptInPlace(
+                const ByteArray& key, const ByteArray& iv,
+                uint8_t* buf, size_t len, uint8_t tag[constants::TAG_LEN]);
+            /**
+             * Same as skenc::DecryptInPlace(key, iv, buf, len, tag).
+             * Throws RuntimeError, ValueError,
+             * CryptoError (message authentication failure).
+             */
+            void DecryptInPlace(
+                const ByteArray& key, const ByteArray& iv,
+                uint8_t* buf, size_t len,
+                const uint8_t tag[constants::TAG_LEN]);
+
+            /**
+             * Wipes the key of the last message from the context, the
+             * next message sets up its key again.
+             * Throws RuntimeError.
+             */
+            void Clear();
+
+        private:
+            CipherContext(const CipherContext&);
+            CipherContext& operator=(const CipherContext&);
+
+            struct Context;
+            std::unique_ptr<Context> context_;
+        };  // class CipherContext
+
+        /**
+         * Returns the cipher context of the calling thread, which is
+         * used by EncryptMessage() and DecryptMessage().
+         * Throws RuntimeError.
+         */
+        CipherContext& GetThreadCipherContext();
+
+        /**
+         * Encrypts the len bytes at buf in place and stores the
+         * authentication tag in tag, without allocating memory. The
+         * ciphertext followed by the tag is the same as the result of
+         * EncryptMessage(key, iv, message).
+         * Throws RuntimeError, ValueError.
+         */
+        void EncryptInPlace(
+            const ByteArray& key, const ByteArray& iv,
+            uint8_t* buf, size_t len, uint8_t tag[constants::TAG_LEN]);
+        /**
+         * Decrypts the len bytes of ciphertext at buf in place and checks
+         * the authentication tag, without allocating memory. buf is wiped
+         * if the check fails.
+         * Throws RuntimeError, ValueError,
+         * CryptoError (message authentication failure).
+         */
+        void DecryptInPlace(
+            const ByteArray& key, const ByteArray& iv,
+            uint8_t* buf, size_t len, const uint8_t tag[constants::TAG_LEN]);
+
+        /**
+         * Incremental AES-GCM decryption of a message generated by
+         * EncryptMessage(key, iv, message), passed in pieces of any size.
+         * The last TAG_LEN bytes passed are held back as the
+         * authentication tag, which is checked by Finalize(). Plaintext
+         * returned by Update() is not trustworthy until Finalize()
+         * succeeded.
+         */
+        class StreamDecryptor {
+        public:
+            /** Throws RuntimeError, ValueError. */
+            StreamDecryptor(const ByteArray& key, const ByteArray& iv);
+            ~StreamDecryptor();
+
+            /**
+             * Returns the plaintext of the pieces passed so far, except
+             * of their last TAG_LEN bytes.
+             * Throws RuntimeError.
+             */
+            ByteArray Update(const uint8_t* data, size_t size);
+
+            /**
+             * Returns the rest of the plaintext.
+             * Throws RuntimeError, ValueError,
+             * CryptoError (message authentication failure).
+             */
+            ByteArray Finalize();
+
+        private:
+            StreamDecryptor(const StreamDecryptor&);
+            StreamDecryptor& operator=(const StreamDecryptor&);
+
+            // Implemented by the crypto library specific source
+            void DecryptUpdate(const uint8_t* data, size_t size,
+                ByteArray& plaintext);
+            void DecryptFinal(const uint8_t* tag, ByteArray& plaintext);
+
+            struct Context;
+            std::unique_ptr<Context> context_;
+            // Last bytes passed, which may be the authentication tag
+            ByteArray tail_;
+        };  // class StreamDecryptor
+
+        /**
+         * Incremental AES-GCM encryption of a message passed in pieces of
+         * any size. The pieces returned by Update() and Finalize(), in
+         * that order, are the same as the result of
+         * EncryptMessage(key, iv, message).
+         */
+        class StreamEncryptor {
+        public:
+            /** Throws RuntimeError, ValueError. */
+            StreamEncryptor(const ByteArray& key, const ByteArray& iv);
+            ~StreamEncryptor();
+
+            /**
+             * Returns the ciphertext of the piece, may be shorter than
+             * the piece if the crypto library buffers partial blocks.
+             * Throws RuntimeError.
+             */
+            ByteArray Update(const uint8_t* data, size_t size);
+
+            /**
+             * Returns the rest of the ciphertext followed by the
+             * authentication tag.
+             * Throws RuntimeError.
+             */
+            ByteArray Finalize();
+
+        private:
+            StreamEncryptor(const StreamEncryptor&);
+            StreamEncryptor& operator=(const StreamEncryptor&);
+
+            struct Context;
+            std::unique_ptr<Context> context_;
+        };  // class StreamEncryptor
     }  // namespace skenc
 }  // namespace crypto
 }  // namespace tcf
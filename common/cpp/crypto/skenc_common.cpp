@@ -24,9 +24,13 @@
  * See skenc.cpp for OpenSSL/Mbed TLS-dependent code.
  */
 
+#include <algorithm>
+
 #include "crypto_shared.h"
-#include "crypto_utils.h" // RandomBitString(), ComputeMessageHash()
+#include "crypto_utils.h" // ComputeMessageHash()
 #include "error.h"
+#include "random_generator.h"
+#include "thread_slot.h"
 #include "utils.h"        // StrToByteArray()
 #include "skenc.h"
 
@@ -43,7 +47,8 @@ namespace constants = tcf::crypto::constants;
  * Throws RuntimeError.
  */
 ByteArray pcrypto::skenc::GenerateKey() {
-    return pcrypto::RandomBitString(constants::SYM_KEY_LEN);
+    return pcrypto::GetThreadRandomGenerator().RandomBitString(
+        constants::SYM_KEY_LEN);
 }  // pcrypto::skenc::GenerateKey
 
 
@@ -60,7 +65,8 @@ ByteArray pcrypto::skenc::GenerateKey() {
 ByteArray pcrypto::skenc::GenerateIV(const std::string& IVstring) {
     // generate random IV if no input
     if (IVstring.compare("") == 0)
-        return pcrypto::RandomBitString(constants::IV_LEN);
+        return pcrypto::GetThreadRandomGenerator().RandomBitString(
+            constants::IV_LEN);
     // else use IVstring
     ByteArray hash = ComputeMessageHash(StrToByteArray(IVstring));
     hash.resize(constants::IV_LEN);
@@ -68,6 +74,180 @@ ByteArray pcrypto::skenc::GenerateIV(const std::string& IVstring) {
 }  // pcrypto::skenc::GenerateIV
 
 
+/**
+ * Get the AES-GCM context of the calling thread. In an enclave thread
+ * local storage is set up again on every ecall, so the context of each
+ * TCS is kept in a slot (see thread_slot.h) and set up once for the
+ * lifetime of the enclave.
+ * Throws RuntimeError.
+ */
+pcrypto::skenc::CipherContext& pcrypto::skenc::GetThreadCipherContext() {
+#ifdef _UNTRUSTED_
+    static thread_local CipherContext context;
+    return context;
+#else
+    static tcf::ThreadSlots<CipherContext> contexts;
+    return contexts.Get();
+#endif
+}  // pcrypto::skenc::GetThreadCipherContext
+
+
+/**
+ * Encrypt a message using AES-GCM authenticated encryption.
+ *
+ * Appends a 16 byte (128 bit) authentication tag (sometimes called a MAC)
+ * to the output cipher text:
+ *     message = ciphertext + authentication tag
+ * The authentication tag is not encrypted.
+ *
+ * Throws RuntimeError, ValueError.
+ *
+ * @param key     Secret AES-256 encryption key.
+ *                Generated by GenerateKey()
+ * @param iv      96-bit initialization Vector (IV). Generated by GenerateIV()
+ * @param message binary data to encrypt
+ * @returns Byte array containing encrypted data and appended auth tag
+ */
+ByteArray pcrypto::skenc::CipherContext::EncryptMessage(
+        const ByteArray& key, const ByteArray& iv, const ByteArray& message) {
+    size_t len = message.size();
+    ByteArray ct;
+
+    if (len == 0) {
+        std::string msg(
+            "Crypto Error (EncryptMessage): Cannot encrypt the empty message");
+        throw Error::ValueError(msg);
+    }
+
+    // Allocate room for the tag at once, so that it does not reallocate
+    ct.reserve(len + constants::TAG_LEN);
+    ct.assign(message.begin(), message.end());
+    ct.resize(len + constants::TAG_LEN);
+    EncryptInPlace(key, iv, ct.data(), len, ct.data() + len);
+    return ct;
+}  // pcrypto::skenc::CipherContext::EncryptMessage
+
+
+/**
+ * Decrypt message using AES-GCM authenticated decryption.
+ *
+ * Expects a 12 byte (96 bit) IV (sometimes called a nonce) and
+ * an 16 byte (128 bit) authentication tag (sometimes called a MAC)
+ * appended to the input cipher text:
+ *     message = ciphertext + authentication tag
+ *
+ * Throws RuntimeError, ValueError,
+ * CryptoError (message authentication failure).
+ *
+ * @param key         Secret AES-256 encryption key.
+ *                    Generated by GenerateKey()
+ * @param iv          96-bit initialization Vector (IV).
+ *                    Generated by GenerateIV()
+ * @param message     binary data to decrypt. Generated by EncryptMessage()
+ *                    Includes appended authentication tag.
+ *                    IV is separate (not prepended to message)
+ * @param message_len Length of message in bytes
+ * @returns Byte array containing decrypted data
+ */
+ByteArray pcrypto::skenc::CipherContext::DecryptMessage(
+        const ByteArray& key, const char iv[constants::IV_LEN],
+        const char *message, size_t message_len) {
+    if (message_len < constants::TAG_LEN) {
+        std::string msg(
+            "Crypto Error (DecryptMessage): AES-GCM message smaller "
+            "than minimum length (TAG length)");
+        throw Error::ValueError(msg);
+    }
+
+    size_t len = message_len - constants::TAG_LEN;
+    ByteArray pt(message, message + len);
+    DecryptInPlace(key, ByteArray(iv, iv + constants::IV_LEN),
+        pt.data(), len, (const uint8_t*)message + len);
+    return pt;
+}  // pcrypto::skenc::CipherContext::DecryptMessage
+
+
+/**
+ * Encrypt a message using AES-GCM authenticated encryption with the
+ * cipher context of the calling thread.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param key     Secret AES-256 encryption key.
+ *                Generated by GenerateKey()
+ * @param iv      96-bit initialization Vector (IV). Generated by GenerateIV()
+ * @param message binary data to encrypt
+ * @returns Byte array containing encrypted data and appended auth tag
+ */
+ByteArray pcrypto::skenc::EncryptMessage(
+        const ByteArray& key, const ByteArray& iv, const ByteArray& message) {
+    return GetThreadCipherContext().EncryptMessage(key, iv, message);
+}  // pcrypto::skenc::EncryptMessage
+
+
+/**
+ * Decrypt a message using AES-GCM authenticated decryption with the
+ * cipher context of the calling thread.
+ * Throws RuntimeError, ValueError,
+ * CryptoError (message authentication failure).
+ *
+ * @param key         Secret AES-256 encryption key.
+ *                    Generated by GenerateKey()
+ * @param iv          96-bit initialization Vector (IV).
+ *                    Generated by GenerateIV()
+ * @param message     binary data to decrypt. Generated by EncryptMessage()
+ *                    Includes appended authentication tag.
+ *                    IV is separate (not prepended to message)
+ * @param message_len Length of message in bytes
+ * @returns Byte array containing decrypted data
+ */
+ByteArray pcrypto::skenc::DecryptMessage(
+        const ByteArray& key, const char iv[constants::IV_LEN],
+        const char *message, size_t message_len) {
+    return GetThreadCipherContext().DecryptMessage(
+        key, iv, message, message_len);
+}  // pcrypto::skenc::DecryptMessage
+
+
+/**
+ * Encrypt a message in place using AES-GCM authenticated encryption with
+ * the cipher context of the calling thread.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV). Generated by GenerateIV()
+ * @param buf binary data to encrypt, replaced by the ciphertext
+ * @param len Length of the data in bytes
+ * @param tag Receives the 16 byte (128 bit) authentication tag
+ */
+void pcrypto::skenc::EncryptInPlace(
+        const ByteArray& key, const ByteArray& iv,
+        uint8_t* buf, size_t len, uint8_t tag[constants::TAG_LEN]) {
+    GetThreadCipherContext().EncryptInPlace(key, iv, buf, len, tag);
+}  // pcrypto::skenc::EncryptInPlace
+
+
+/**
+ * Decrypt a message in place using AES-GCM authenticated decryption with
+ * the cipher context of the calling thread.
+ * Throws RuntimeError, ValueError,
+ * CryptoError (message authentication failure).
+ *
+ * @param key Secret AES-256 encryption key.
+ *            Generated by GenerateKey()
+ * @param iv  96-bit initialization Vector (IV). Generated by GenerateIV()
+ * @param buf Ciphertext to decrypt, without the authentication tag.
+ *            Replaced by the plaintext, or wiped if authentication fails
+ * @param len Length of the ciphertext in bytes
+ * @param tag 16 byte (128 bit) authentication tag of the message
+ */
+void pcrypto::skenc::DecryptInPlace(
+        const ByteArray& key, const ByteArray& iv,
+        uint8_t* buf, size_t len, const uint8_t tag[constants::TAG_LEN]) {
+    GetThreadCipherContext().DecryptInPlace(key, iv, buf, len, tag);
+}  // pcrypto::skenc::DecryptInPlace
+
+
 /**
  * Encrypt a message using AES-GCM authenticated encryption.
  * An IV is generated automatically and prepended to the encrypted data.
@@ -171,3 +351,60 @@ ByteArray pcrypto::skenc::DecryptMessage(const ByteArray& key,
 
     return DecryptMessage(key, iv, ct, ct_len);
 }  // pcrypto::skenc::DecryptMessage
+
+
+/**
+ * Decrypt the next piece of a message with AES-GCM. The last TAG_LEN
+ * bytes passed so far are held back, since they may be the
+ * authentication tag.
+ * Throws RuntimeError.
+ *
+ * @param data Next piece of the message
+ * @param size Size of the piece in bytes
+ * @returns Byte array containing the decrypted data released by the piece
+ */
+ByteArray pcrypto::skenc::StreamDecryptor::Update(
+        const uint8_t* data, size_t size) {
+    ByteArray pt;
+    size_t total = tail_.size() + size;
+
+    if (total <= (size_t) constants::TAG_LEN) {
+        tail_.insert(tail_.end(), data, data + size);
+        return pt;
+    }
+
+    // Decrypt everything except of the last TAG_LEN bytes, starting
+    // with the bytes held back from the previous pieces
+    size_t release = total - constants::TAG_LEN;
+    size_t from_tail = std::min(release, tail_.size());
+    size_t from_data = release - from_tail;
+    pt.reserve(release);
+    DecryptUpdate(tail_.data(), from_tail, pt);
+    DecryptUpdate(data, from_data, pt);
+
+    tail_.erase(tail_.begin(), tail_.begin() + from_tail);
+    tail_.insert(tail_.end(), data + from_data, data + size);
+    return pt;
+}  // pcrypto::skenc::StreamDecryptor::Update
+
+
+/**
+ * Finish decryption of a message and check its authentication tag.
+ * Throws RuntimeError, ValueError,
+ * CryptoError (message authentication failure).
+ *
+ * @returns Byte array containing the rest of the decrypted data
+ */
+ByteArray pcrypto::skenc::StreamDecryptor::Finalize() {
+    ByteArray pt;
+
+    if (tail_.size() < (size_t) constants::TAG_LEN) {
+        std::string msg(
+            "Crypto Error (StreamDecryptor): AES-GCM message smaller "
+            "than minimum length (TAG length)");
+        throw Error::ValueError(msg);
+    }
+
+    DecryptFinal(tail_.data(), pt);
+    return pt;
+}  // pcrypto::skenc::StreamDecryptor::Finalize
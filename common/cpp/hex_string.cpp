@@ -15,31 +15,210 @@
 
 #include <algorithm>
 #include <ctype.h>
+#include <string.h>
 #include "hex_string.h"
 #include "error.h"
 
+// The vector code is only built for untrusted code: trusted builds do not
+// search the compiler's include directory and the run time CPU detection
+// uses CPUID, which is not allowed in an enclave. The enclave uses the
+// scalar code.
+#if defined(_UNTRUSTED_) && defined(__x86_64__) && defined(__GNUC__) && \
+    defined(__has_include)
+#if __has_include(<immintrin.h>)
+#include <immintrin.h>
+#define HEX_STRING_SIMD 1
+#endif
+#endif
+
 namespace tcf {
 
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    static const uint8_t HEX_INVALID = 0xff;
+
+    // Value of each hex digit, upper or lower case, HEX_INVALID for
+    // other characters
+    struct HexValueTable {
+        uint8_t value[256];
+
+        HexValueTable() {
+            memset(value, HEX_INVALID, sizeof(value));
+            for (uint8_t i = 0; i < 16; i++) {
+                value[(unsigned char) HEX_DIGITS[i]] = i;
+                value[(unsigned char) tolower(HEX_DIGITS[i])] = i;
+            }
+        }
+    };
+
+    static const HexValueTable hexValues;
+
+#ifdef HEX_STRING_SIMD
+    enum SimdLevel {
+        SIMD_SCALAR,
+        SIMD_SSE41,
+        SIMD_AVX2
+    };
+
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-    static inline uint8_t HexToNibble(char hex) {
-        hex = toupper(hex);
+    static SimdLevel DetectSimdLevel() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return SIMD_AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return SIMD_SSE41;
+        }
+        return SIMD_SCALAR;
+    }  // DetectSimdLevel
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    static SimdLevel GetSimdLevel() {
+        static const SimdLevel level = DetectSimdLevel();
+        return level;
+    }  // GetSimdLevel
 
-        if (hex >= 'A' && hex <= 'F') {  // A-F case
-            return 10 + (hex - 'A');
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Converts 16 hex digits to their values. Sets valid to all ones
+    // for the digits that are valid.
+    __attribute__((target("sse4.1")))
+    static inline __m128i HexDigitsToNibblesSse41(
+        __m128i digits, __m128i& valid) {
+        __m128i decimal = _mm_sub_epi8(digits, _mm_set1_epi8('0'));
+        __m128i alpha = _mm_sub_epi8(
+            _mm_or_si128(digits, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        // Unsigned x <= n if min(x, n) == x
+        __m128i is_decimal = _mm_cmpeq_epi8(
+            _mm_min_epu8(decimal, _mm_set1_epi8(9)), decimal);
+        __m128i is_alpha = _mm_cmpeq_epi8(
+            _mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+        valid = _mm_or_si128(is_decimal, is_alpha);
+        return _mm_blendv_epi8(
+            _mm_add_epi8(alpha, _mm_set1_epi8(10)), decimal, is_decimal);
+    }  // HexDigitsToNibblesSse41
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Converts 32 hex digits to 16 bytes per iteration. Stops before the
+    // first block with an invalid digit, the scalar code reports it.
+    // Returns the number of bytes converted.
+    __attribute__((target("sse4.1")))
+    static size_t HexToBinarySse41(
+        uint8_t* out, size_t length, const char* hex) {
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            __m128i valid_lo, valid_hi;
+            __m128i lo = HexDigitsToNibblesSse41(
+                _mm_loadu_si128((const __m128i*) (hex + 2 * i)), valid_lo);
+            __m128i hi = HexDigitsToNibblesSse41(
+                _mm_loadu_si128((const __m128i*) (hex + 2 * i + 16)),
+                valid_hi);
+            if (_mm_movemask_epi8(_mm_and_si128(valid_lo, valid_hi))
+                    != 0xffff) {
+                break;
+            }
+            // Each pair of nibbles n0, n1 becomes 16 * n0 + n1
+            const __m128i weights = _mm_set1_epi16(0x0110);
+            _mm_storeu_si128((__m128i*) (out + i), _mm_packus_epi16(
+                _mm_maddubs_epi16(lo, weights),
+                _mm_maddubs_epi16(hi, weights)));
         }
-        if (hex >= '0' && hex <= '9') {  // 0-9 case
-            return hex - '0';
+        return i;
+    }  // HexToBinarySse41
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    __attribute__((target("avx2")))
+    static inline __m256i HexDigitsToNibblesAvx2(
+        __m256i digits, __m256i& valid) {
+        __m256i decimal = _mm256_sub_epi8(digits, _mm256_set1_epi8('0'));
+        __m256i alpha = _mm256_sub_epi8(
+            _mm256_or_si256(digits, _mm256_set1_epi8(0x20)),
+            _mm256_set1_epi8('a'));
+        __m256i is_decimal = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(decimal, _mm256_set1_epi8(9)), decimal);
+        __m256i is_alpha = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+        valid = _mm256_or_si256(is_decimal, is_alpha);
+        return _mm256_blendv_epi8(
+            _mm256_add_epi8(alpha, _mm256_set1_epi8(10)), decimal,
+            is_decimal);
+    }  // HexDigitsToNibblesAvx2
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Same as HexToBinarySse41() for 64 hex digits per iteration
+    __attribute__((target("avx2")))
+    static size_t HexToBinaryAvx2(
+        uint8_t* out, size_t length, const char* hex) {
+        size_t i = 0;
+        for (; i + 32 <= length; i += 32) {
+            __m256i valid_lo, valid_hi;
+            __m256i lo = HexDigitsToNibblesAvx2(
+                _mm256_loadu_si256((const __m256i*) (hex + 2 * i)),
+                valid_lo);
+            __m256i hi = HexDigitsToNibblesAvx2(
+                _mm256_loadu_si256((const __m256i*) (hex + 2 * i + 32)),
+                valid_hi);
+            if (_mm256_movemask_epi8(_mm256_and_si256(valid_lo, valid_hi))
+                    != -1) {
+                break;
+            }
+            const __m256i weights = _mm256_set1_epi16(0x0110);
+            // packus works per 128 bit lane, put the lanes back in order
+            __m256i bytes = _mm256_packus_epi16(
+                _mm256_maddubs_epi16(lo, weights),
+                _mm256_maddubs_epi16(hi, weights));
+            _mm256_storeu_si256((__m256i*) (out + i),
+                _mm256_permute4x64_epi64(bytes, 0xd8));
         }
+        return i;
+    }  // HexToBinaryAvx2
 
-        throw error::ValueError("Hex digit is not valid");
-    }  // HexToNibble
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Converts 16 bytes to 32 hex digits per iteration, returns the
+    // number of bytes converted
+    __attribute__((target("sse4.1")))
+    static size_t BinaryToHexSse41(
+        char* out, const uint8_t* in, size_t length) {
+        const __m128i digits = _mm_loadu_si128((const __m128i*) HEX_DIGITS);
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*) (in + i));
+            __m128i hi = _mm_shuffle_epi8(digits,
+                _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+            __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+            _mm_storeu_si128((__m128i*) (out + 2 * i),
+                _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128((__m128i*) (out + 2 * i + 16),
+                _mm_unpackhi_epi8(hi, lo));
+        }
+        return i;
+    }  // BinaryToHexSse41
 
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-    static inline uint8_t HexToByte(const char* inHexDigits) {
-        uint8_t c1 = HexToNibble(inHexDigits[0]);
-        uint8_t c2 = HexToNibble(inHexDigits[1]);
-        return (c1 << 4) | c2;
-    }  // HexToByte
+    // Same as BinaryToHexSse41() for 32 bytes per iteration
+    __attribute__((target("avx2")))
+    static size_t BinaryToHexAvx2(
+        char* out, const uint8_t* in, size_t length) {
+        const __m256i digits = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i*) HEX_DIGITS));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        size_t i = 0;
+        for (; i + 32 <= length; i += 32) {
+            __m256i bytes = _mm256_loadu_si256((const __m256i*) (in + i));
+            __m256i hi = _mm256_shuffle_epi8(digits,
+                _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+            __m256i lo = _mm256_shuffle_epi8(digits,
+                _mm256_and_si256(bytes, mask));
+            // unpack works per 128 bit lane, put the lanes back in order
+            __m256i first = _mm256_unpacklo_epi8(hi, lo);
+            __m256i second = _mm256_unpackhi_epi8(hi, lo);
+            _mm256_storeu_si256((__m256i*) (out + 2 * i),
+                _mm256_permute2x128_si256(first, second, 0x20));
+            _mm256_storeu_si256((__m256i*) (out + 2 * i + 32),
+                _mm256_permute2x128_si256(first, second, 0x31));
+        }
+        return i;
+    }  // BinaryToHexAvx2
+#endif  // HEX_STRING_SIMD
 
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
     std::vector<uint8_t> HexStringToBinary(const std::string& inHexString) {
@@ -63,13 +242,30 @@ namespace tcf {
             "Hex encoded string is not an even length");
 
         const char* pHex = inHexString.c_str();
-        size_t len = inHexString.length();
-        inBinaryDataLength = std::min(inBinaryDataLength, len / 2);
+        size_t len = std::min(inBinaryDataLength, inHexString.length() / 2);
         size_t pos = 0;
-        size_t opos = 0;
-        while (pos < len && opos < inBinaryDataLength) {
-            outBinaryData[opos++] = HexToByte(&pHex[pos]);
-            pos += 2;
+
+#ifdef HEX_STRING_SIMD
+        switch (GetSimdLevel()) {
+        case SIMD_AVX2:
+            pos = HexToBinaryAvx2(outBinaryData, len, pHex);
+            break;
+        case SIMD_SSE41:
+            pos = HexToBinarySse41(outBinaryData, len, pHex);
+            break;
+        default:
+            break;
+        }
+#endif
+
+        const uint8_t* values = hexValues.value;
+        for (; pos < len; pos++) {
+            uint8_t hi = values[(unsigned char) pHex[2 * pos]];
+            uint8_t lo = values[(unsigned char) pHex[2 * pos + 1]];
+            error::ThrowIf<error::ValueError>(
+                hi == HEX_INVALID || lo == HEX_INVALID,
+                "Hex digit is not valid");
+            outBinaryData[pos] = (hi << 4) | lo;
         }
     }  // HexStringToBinary
 
@@ -85,21 +281,32 @@ namespace tcf {
         const uint8_t* inBinaryData,
         size_t inBinaryDataLength
         ) {
-        static const char *hexDigits = "0123456789ABCDEF";
-
-        // Create a string and give a hint to its final size (twice the size
-        // of the input binary data)
-        std::string hexString;
-        hexString.reserve(inBinaryDataLength * 2);
-
-        // Run through the binary data and convert to a hex string
-        std::for_each(
-            inBinaryData,
-            inBinaryData + inBinaryDataLength,
-            [&hexString](uint8_t inputByte) {
-                hexString.push_back(hexDigits[inputByte >> 4]);
-                hexString.push_back(hexDigits[inputByte & 0x0F]);
-            });
+        // Create the string with its final size (twice the size of the
+        // input binary data) and write the digits into it
+        std::string hexString(HEX_STRING_SIZE(inBinaryDataLength), '\0');
+        if (inBinaryDataLength == 0) {
+            return hexString;
+        }
+        char* out = &hexString[0];
+        size_t pos = 0;
+
+#ifdef HEX_STRING_SIMD
+        switch (GetSimdLevel()) {
+        case SIMD_AVX2:
+            pos = BinaryToHexAvx2(out, inBinaryData, inBinaryDataLength);
+            break;
+        case SIMD_SSE41:
+            pos = BinaryToHexSse41(out, inBinaryData, inBinaryDataLength);
+            break;
+        default:
+            break;
+        }
+#endif
+
+        for (; pos < inBinaryDataLength; pos++) {
+            out[2 * pos] = HEX_DIGITS[inBinaryData[pos] >> 4];
+            out[2 * pos + 1] = HEX_DIGITS[inBinaryData[pos] & 0x0F];
+        }
 
         return hexString;
     }  // BinaryToHexString
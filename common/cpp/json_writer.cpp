@@ -0,0 +1,264 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon JSON writer.
+ *
+ * String escaping, UTF-8 validation and number formatting follow
+ * json_serialize_string(), is_valid_utf8() and
+ * json_serialize_to_buffer_r() of parson.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+
+#include "error.h"
+#include "json_writer.h"
+
+namespace tcf {
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Character following the backslash of the escape sequence of c,
+    // 0 if c is written as it is
+    static char EscapeChar(unsigned char c) {
+        switch (c) {
+        case '\"': return '\"';
+        case '\\': return '\\';
+        case '/':  return '/';
+        case '\b': return 'b';
+        case '\f': return 'f';
+        case '\n': return 'n';
+        case '\r': return 'r';
+        case '\t': return 't';
+        default:   return 0;
+        }
+    }  // EscapeChar
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // ASCII character written as it is, checking the digits and letters
+    // of hex and base64 strings first
+    static bool IsPlain(unsigned char c) {
+        if (c >= '0') {
+            return c < 0x80 && c != '\\';
+        }
+        return !EscapeChar(c);
+    }  // IsPlain
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    static bool IsContinuation(unsigned char c) {
+        return (c & 0xC0) == 0x80;
+    }  // IsContinuation
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Length of the valid UTF-8 sequence at s, which starts with a byte
+    // above 0x7F and has available bytes, 0 if it is not valid
+    static size_t Utf8SequenceLength(const unsigned char* s,
+        size_t available) {
+        unsigned char c = s[0];
+        size_t length;
+        unsigned int cp;
+
+        if (c == 0xC0 || c == 0xC1 || c > 0xF4 || IsContinuation(c)) {
+            return 0;
+        } else if ((c & 0xE0) == 0xC0) {
+            length = 2;
+            cp = c & 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            length = 3;
+            cp = c & 0x0F;
+        } else {
+            length = 4;
+            cp = c & 0x07;
+        }
+        if (length > available) {
+            return 0;
+        }
+        for (size_t i = 1; i < length; i++) {
+            if (!IsContinuation(s[i])) {
+                return 0;
+            }
+            cp = (cp << 6) | (s[i] & 0x3F);
+        }
+
+        // Overlong encodings, invalid code points and surrogate halves
+        if ((cp < 0x800 && length > 2) || (cp < 0x10000 && length > 3) ||
+                cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return 0;
+        }
+        return length;
+    }  // Utf8SequenceLength
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    JsonWriter::JsonWriter(size_t expected_size) : need_comma_(false) {
+        buffer_.reserve(expected_size);
+    }  // JsonWriter::JsonWriter
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::BeginObject(const char* name) {
+        BeginValue(name);
+        buffer_.push_back('{');
+        need_comma_ = false;
+    }  // JsonWriter::BeginObject
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::EndObject() {
+        buffer_.push_back('}');
+        need_comma_ = true;
+    }  // JsonWriter::EndObject
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::BeginArray(const char* name) {
+        BeginValue(name);
+        buffer_.push_back('[');
+        need_comma_ = false;
+    }  // JsonWriter::BeginArray
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::EndArray() {
+        buffer_.push_back(']');
+        need_comma_ = true;
+    }  // JsonWriter::EndArray
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::AddStr(
+        const char* name, const char* value, const char* err_msg) {
+        BeginValue(name);
+        AppendString(value, strlen(value), err_msg);
+        need_comma_ = true;
+    }  // JsonWriter::AddStr
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::AddStr(
+        const char* name, const std::string& value, const char* err_msg) {
+        // Like value.c_str(), the string ends at its first NUL
+        const void* nul = memchr(value.data(), '\0', value.size());
+        size_t length = nul ?
+            (const char*) nul - value.data() : value.size();
+
+        BeginValue(name);
+        AppendString(value.data(), length, err_msg);
+        need_comma_ = true;
+    }  // JsonWriter::AddStr
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::BeginStr(const char* name) {
+        BeginValue(name);
+        buffer_.push_back('"');
+    }  // JsonWriter::BeginStr
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::EndStr() {
+        buffer_.push_back('"');
+        need_comma_ = true;
+    }  // JsonWriter::EndStr
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::AddNumber(const char* name, double value) {
+        // Longest "%f" output of a double is 317 characters
+        char number[400];
+        int written;
+
+        BeginValue(name);
+        if (value == (double) (int) value) {
+            written = snprintf(number, sizeof(number), "%d", (int) value);
+        } else {
+            written = snprintf(number, sizeof(number), "%f", value);
+        }
+        tcf::error::ThrowIf<tcf::error::RuntimeError>(
+            written < 0 || (size_t) written >= sizeof(number),
+            "failed to serialize number");
+        buffer_.insert(buffer_.end(), number, number + written);
+        need_comma_ = true;
+    }  // JsonWriter::AddNumber
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    ByteArray JsonWriter::Finish() {
+        buffer_.push_back('\0');
+        ByteArray serialized = std::move(buffer_);
+        buffer_.clear();
+        need_comma_ = false;
+        return serialized;
+    }  // JsonWriter::Finish
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Writes the separator from the preceding member or item and the
+    // member name if there is one
+    void JsonWriter::BeginValue(const char* name) {
+        if (need_comma_) {
+            buffer_.push_back(',');
+        }
+        if (name != nullptr) {
+            AppendString(name, strlen(name), "failed to serialize name");
+            buffer_.push_back(':');
+        }
+    }  // JsonWriter::BeginValue
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    void JsonWriter::AppendString(
+        const char* value, size_t length, const char* err_msg) {
+        buffer_.push_back('"');
+        try {
+            AppendStr(value, length, err_msg);
+        } catch (...) {
+            buffer_.pop_back();
+            throw;
+        }
+        buffer_.push_back('"');
+    }  // JsonWriter::AppendString
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Writes value with escape sequences, without the quotes
+    void JsonWriter::AppendStr(
+        const char* value, size_t length, const char* err_msg) {
+        const unsigned char* s = (const unsigned char*) value;
+        size_t start = buffer_.size();
+
+        // At most two bytes for each character
+        buffer_.resize(start + 2 * length);
+        uint8_t* out = buffer_.data() + start;
+        size_t i = 0;
+        while (i < length) {
+            // Copy runs of characters written as they are at once
+            size_t run = i;
+            while (run < length && IsPlain(s[run])) {
+                run++;
+            }
+            memcpy(out, s + i, run - i);
+            out += run - i;
+            i = run;
+            if (i == length) {
+                break;
+            }
+
+            if (s[i] < 0x80) {
+                *out++ = '\\';
+                *out++ = EscapeChar(s[i]);
+                i++;
+            } else {
+                size_t sequence = Utf8SequenceLength(s + i, length - i);
+                if (sequence == 0) {
+                    buffer_.resize(start);
+                    throw tcf::error::RuntimeError(err_msg);
+                }
+                memcpy(out, s + i, sequence);
+                out += sequence;
+                i += sequence;
+            }
+        }
+        buffer_.resize(out - buffer_.data());
+    }  // JsonWriter::AppendStr
+}  // namespace tcf
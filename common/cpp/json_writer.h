@@ -0,0 +1,97 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon JSON writer, which serializes JSON as it is written instead of
+ * building a parson document first.
+ *
+ * The output is the same as json_serialize_to_buffer() of the parson
+ * document with the same members in the same order: no whitespace, '/'
+ * escaped as "\/", numbers with an integer value printed as an int and
+ * others with "%f", strings ending at their first NUL, and a terminating
+ * NUL at the end of the buffer.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+#include "types.h"
+
+namespace tcf {
+    class JsonWriter {
+    public:
+        /**
+         * Start an empty JSON text, reserving expected_size bytes of the
+         * output buffer.
+         */
+        explicit JsonWriter(size_t expected_size = 0);
+
+        /**
+         * Start an object, the member name of an object member or nullptr
+         * for an array item and the top level object.
+         */
+        void BeginObject(const char* name = nullptr);
+        void EndObject();
+
+        /** Start an array, the member name or nullptr */
+        void BeginArray(const char* name = nullptr);
+        void EndArray();
+
+        /**
+         * Add a string member, or array item if name is nullptr.
+         * Throws RuntimeError with err_msg, like JsonSetStr(), if value is
+         * not valid UTF-8.
+         */
+        void AddStr(const char* name, const char* value, const char* err_msg);
+        void AddStr(const char* name, const std::string& value,
+            const char* err_msg);
+
+        /**
+         * Add a string member, or array item if name is nullptr, whose
+         * value is appended piece by piece with AppendStr() until
+         * EndStr(), for large values which are not held whole.
+         */
+        void BeginStr(const char* name);
+        /**
+         * Append a piece of the value of the string started with
+         * BeginStr(). Throws RuntimeError with err_msg if the piece is
+         * not valid UTF-8 on its own.
+         */
+        void AppendStr(const char* value, size_t length,
+            const char* err_msg);
+        void EndStr();
+
+        /** Add a number member, or array item if name is nullptr */
+        void AddNumber(const char* name, double value);
+
+        /**
+         * Return the serialized JSON text with its terminating NUL.
+         * The writer is empty afterwards.
+         */
+        ByteArray Finish();
+
+    private:
+        void BeginValue(const char* name);
+        void AppendString(const char* value, size_t length,
+            const char* err_msg);
+
+        ByteArray buffer_;
+        // A member or item was written at the current level
+        bool need_comma_;
+    };  // JsonWriter
+}  // namespace tcf
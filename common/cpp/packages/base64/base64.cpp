@@ -38,13 +38,26 @@
 
 /*
  * The original source code has been modified to be used with
- * Hyperledger Avalon. Added function base64_decoded_length().
+ * Hyperledger Avalon. Added function base64_decoded_length() and the
+ * overloads encoding and decoding buffers.
+ * Encoding and decoding use lookup tables and write into pre-sized
+ * buffers. Where the compiler provides the x86 intrinsics (untrusted
+ * builds), blocks of 32 or 16 characters are encoded and decoded with
+ * AVX2 or SSE4.1 instructions, selected at run time.
  */
 
 
-#include <ctype.h>
+#include <string.h>
 #include "base64.h"
 
+#if defined(_UNTRUSTED_) && defined(__x86_64__) && defined(__GNUC__) && \
+    defined(__has_include)
+#if __has_include(<immintrin.h>)
+#include <immintrin.h>
+#define BASE64_SIMD 1
+#endif
+#endif
+
 /*
  * Used to adjust the decoded length of a base64 string.
  * Check if the base64 string is padded at the end with '='
@@ -54,14 +67,295 @@
     ((((in)[(in_len) - 1] == '=') ? -1 : 0) + \
      (((in)[(in_len) - 2] == '=') ? -1 : 0))
 
-static const std::string base64_chars =
+static const char base64_chars[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-// Return true if this is a base64 character (excluding '=' padding)
-static inline bool is_base64(unsigned char c) {
-    return (isalnum(c) || (c == '+') || (c == '/'));
+// Value of each base64 character, 0xff for other characters
+// (including '=' padding)
+static const uint8_t BASE64_INVALID = 0xff;
+
+struct base64_value_table {
+    uint8_t value[256];
+
+    base64_value_table() {
+        memset(value, BASE64_INVALID, sizeof(value));
+        for (uint8_t i = 0; i < 64; i++) {
+            value[(unsigned char) base64_chars[i]] = i;
+        }
+    }
+};
+
+static const base64_value_table base64_values;
+
+
+#ifdef BASE64_SIMD
+enum base64_simd_level {
+    BASE64_SCALAR,
+    BASE64_SSE41,
+    BASE64_AVX2
+};
+
+static base64_simd_level base64_detect_simd_level() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return BASE64_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return BASE64_SSE41;
+    }
+    return BASE64_SCALAR;
+}
+
+static base64_simd_level base64_get_simd_level() {
+    static const base64_simd_level level = base64_detect_simd_level();
+    return level;
+}
+
+/*
+ * The vector code follows W. Mula and D. Lemire, "Faster Base64 Encoding
+ * and Decoding Using AVX2 Instructions", ACM TOW 2018.
+ */
+
+// Spread 12 bytes of each 128 bit lane into 16 6-bit values
+__attribute__((target("avx2")))
+static inline __m256i base64_encode_split_avx2(__m256i in) {
+    in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
+
+// Map 6-bit values to base64 characters, by adding the offset of the
+// range they are in
+__attribute__((target("avx2")))
+static inline __m256i base64_encode_translate_avx2(__m256i in) {
+    const __m256i offsets = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m256i range = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+    range = _mm256_sub_epi8(range,
+        _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25)));
+    return _mm256_add_epi8(in, _mm256_shuffle_epi8(offsets, range));
+}
+
+// Encodes 24 input bytes into 32 characters per iteration,
+// returns the number of input bytes encoded
+__attribute__((target("avx2")))
+static size_t base64_encode_avx2(const uint8_t* in, size_t in_len,
+        char* out) {
+    size_t i = 0;
+    // Each 16 byte load uses 12 bytes
+    for (; i + 28 <= in_len; i += 24) {
+        __m128i lo = _mm_loadu_si128((const __m128i*) (in + i));
+        __m128i hi = _mm_loadu_si128((const __m128i*) (in + i + 12));
+        __m256i values = base64_encode_split_avx2(
+            _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1));
+        _mm256_storeu_si256((__m256i*) out,
+            base64_encode_translate_avx2(values));
+        out += 32;
+    }
+    return i;
+}
+
+__attribute__((target("sse4.1")))
+static size_t base64_encode_sse41(const uint8_t* in, size_t in_len,
+        char* out) {
+    const __m128i offsets = _mm_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    size_t i = 0;
+    for (; i + 16 <= in_len; i += 12) {
+        __m128i in_bytes = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i*) (in + i)),
+            _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+        __m128i t0 = _mm_and_si128(in_bytes, _mm_set1_epi32(0x0fc0fc00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(in_bytes, _mm_set1_epi32(0x003f03f0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        __m128i values = _mm_or_si128(t1, t3);
+        __m128i range = _mm_subs_epu8(values, _mm_set1_epi8(51));
+        range = _mm_sub_epi8(range,
+            _mm_cmpgt_epi8(values, _mm_set1_epi8(25)));
+        _mm_storeu_si128((__m128i*) out,
+            _mm_add_epi8(values, _mm_shuffle_epi8(offsets, range)));
+        out += 16;
+    }
+    return i;
+}
+
+// Decodes 32 characters into 24 bytes per iteration. Stops before the
+// first block containing a character which is not a base64 character,
+// the scalar code handles it. Writes up to 8 bytes past the decoded
+// data. Returns the number of characters decoded.
+__attribute__((target("avx2")))
+static size_t base64_decode_avx2(const char* in, size_t in_len,
+        uint8_t* out) {
+    // Bit masks of the character classes by low and by high nibble,
+    // a character is valid if its two masks have no bit in common
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    // Offset from the character to its value by high nibble, '/' is
+    // the only character needing a different offset than its neighbors
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+
+    size_t i = 0;
+    for (; i + 32 <= in_len; i += 32) {
+        __m256i chars = _mm256_loadu_si256((const __m256i*) (in + i));
+        __m256i hi_nibbles = _mm256_and_si256(
+            _mm256_srli_epi32(chars, 4), mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(chars, mask_2f);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+        __m256i eq_2f = _mm256_cmpeq_epi8(chars, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll,
+            _mm256_add_epi8(eq_2f, hi_nibbles));
+        __m256i values = _mm256_add_epi8(chars, roll);
+
+        // Pack 4 6-bit values into 3 bytes
+        __m256i merged = _mm256_maddubs_epi16(values,
+            _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        merged = _mm256_permutevar8x32_epi32(merged,
+            _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+        _mm256_storeu_si256((__m256i*) out, merged);
+        out += 24;
+    }
+    return i;
+}
+
+// Same as base64_decode_avx2() for 16 characters into 12 bytes, writes
+// up to 4 bytes past the decoded data
+__attribute__((target("sse4.1")))
+static size_t base64_decode_sse41(const char* in, size_t in_len,
+        uint8_t* out) {
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+
+    size_t i = 0;
+    for (; i + 16 <= in_len; i += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i*) (in + i));
+        __m128i hi_nibbles = _mm_and_si128(
+            _mm_srli_epi32(chars, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(chars, mask_2f);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm_testz_si128(lo, hi)) {
+            break;
+        }
+        __m128i eq_2f = _mm_cmpeq_epi8(chars, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll,
+            _mm_add_epi8(eq_2f, hi_nibbles));
+        __m128i values = _mm_add_epi8(chars, roll);
+
+        __m128i merged = _mm_maddubs_epi16(values,
+            _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        merged = _mm_shuffle_epi8(merged, _mm_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128((__m128i*) out, merged);
+        out += 12;
+    }
+    return i;
+}
+#endif  // BASE64_SIMD
+
+
+/**
+ * Encode binary data to printable base64 characters in a buffer.
+ * 0 to 2 '=' padding characters may be appended.
+ * No headers, whitespace or terminating NUL is generated.
+ *
+ * @param buf    Buffer containing binary data to encode
+ * @param length Length of buf in bytes
+ * @param out    Buffer of at least ((length + 2) / 3) * 4 characters
+ * @returns      Number of characters written, ((length + 2) / 3) * 4
+ */
+size_t base64_encode(const uint8_t* buf, size_t length, char* out) {
+    char* start = out;
+    size_t i = 0;
+
+#ifdef BASE64_SIMD
+    switch (base64_get_simd_level()) {
+    case BASE64_AVX2:
+        i = base64_encode_avx2(buf, length, out);
+        break;
+    case BASE64_SSE41:
+        i = base64_encode_sse41(buf, length, out);
+        break;
+    default:
+        break;
+    }
+    out += (i / 3) * 4;
+#endif
+
+    for (; i + 3 <= length; i += 3) {
+        uint32_t triple = (buf[i] << 16) | (buf[i + 1] << 8) | buf[i + 2];
+        *out++ = base64_chars[(triple >> 18) & 0x3f];
+        *out++ = base64_chars[(triple >> 12) & 0x3f];
+        *out++ = base64_chars[(triple >> 6) & 0x3f];
+        *out++ = base64_chars[triple & 0x3f];
+    }
+
+    // Encode the last 1 or 2 bytes and add padding characters
+    if (i < length) {
+        uint32_t triple = buf[i] << 16;
+        if (i + 1 < length) {
+            triple |= buf[i + 1] << 8;
+        }
+        *out++ = base64_chars[(triple >> 18) & 0x3f];
+        *out++ = base64_chars[(triple >> 12) & 0x3f];
+        *out++ = (i + 1 < length) ? base64_chars[(triple >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+
+    return out - start;
+}
+
+
+/**
+ * Encode binary data to a printable base64 string.
+ * 0 to 2 '=' padding characters may be appended.
+ * No headers or whitespace is generated.
+ *
+ * @param buf    Buffer containing binary data to encode
+ * @param length Length of buf in bytes
+ * @returns      String containing base64 encoded data
+ */
+std::string base64_encode(const uint8_t* buf, size_t length) {
+    std::string ret(((length + 2) / 3) * 4, '\0');
+    if (length > 0) {
+        base64_encode(buf, length, &ret[0]);
+    }
+    return ret;
 }
 
 
@@ -74,52 +368,76 @@ static inline bool is_base64(unsigned char c) {
  * @returns   String containing base64 encoded data
  */
 std::string base64_encode(const std::vector<uint8_t>& buf) {
-    std::string ret;
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-    int in_len = buf.size();
-    unsigned char const* bytes_to_encode = buf.data();
-    while (in_len--) {
-        char_array_3[i++] = *(bytes_to_encode++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) +
-                ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) +
-                ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for (i = 0; (i < 4); i++) {
-                ret += base64_chars[char_array_4[i]];
-            }
-            i = 0;
-        }
-    }
+    return base64_encode(buf.data(), buf.size());
+}
 
-    if (i) {
-        for (j = i; j < 3; j++) {
-            char_array_3[j] = '\0';
-        }
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) +
-            ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) +
-            ((char_array_3[2] & 0xc0) >> 6);
+/**
+ * Decode base64 encoded printable characters into a buffer.
+ * 0 to 2 '=' padding characters may be appended.
+ * Decoding stops at first non-base64 character.
+ *
+ * @param encoded_string Printable characters of base64 encoded data.
+ *                       No embedded whitespace characters are present.
+ * @param encoded_len    Length of encoded_string
+ * @param out            Buffer of at least base64_decode_buffer_size()
+ *                       bytes, the vector code writes past the decoded
+ *                       data
+ * @returns Number of bytes decoded
+ */
+size_t base64_decode(const char* encoded_string, size_t encoded_len,
+        uint8_t* out) {
+    const uint8_t* values = base64_values.value;
+    uint8_t* start = out;
+    size_t i = 0;
+
+#ifdef BASE64_SIMD
+    switch (base64_get_simd_level()) {
+    case BASE64_AVX2:
+        i = base64_decode_avx2(encoded_string, encoded_len, out);
+        break;
+    case BASE64_SSE41:
+        i = base64_decode_sse41(encoded_string, encoded_len, out);
+        break;
+    default:
+        break;
+    }
+    out += (i / 4) * 3;
+#endif
 
-        for (j = 0; (j < i + 1); j++) {
-            ret += base64_chars[char_array_4[j]];
+    // Decode until a padding character or non-base64 character is found
+    for (; i + 4 <= encoded_len; i += 4) {
+        uint8_t a = values[(unsigned char) encoded_string[i]];
+        uint8_t b = values[(unsigned char) encoded_string[i + 1]];
+        uint8_t c = values[(unsigned char) encoded_string[i + 2]];
+        uint8_t d = values[(unsigned char) encoded_string[i + 3]];
+        if ((a | b | c | d) == BASE64_INVALID) {
+            break;
         }
+        *out++ = (a << 2) | (b >> 4);
+        *out++ = (b << 4) | (c >> 2);
+        *out++ = (c << 6) | d;
+    }
 
-        // Add padding characters, if needed
-        while ((i++ < 3)) {
-            ret += '=';
+    // Decode the base64 characters of the last, incomplete quantum.
+    // 2 characters give 1 byte, 3 characters give 2 bytes.
+    uint8_t tail[4] = {0, 0, 0, 0};
+    size_t tail_len = 0;
+    while (i < encoded_len && tail_len < 4) {
+        uint8_t value = values[(unsigned char) encoded_string[i++]];
+        if (value == BASE64_INVALID) {
+            break;
         }
+        tail[tail_len++] = value;
+    }
+    if (tail_len > 1) {
+        *out++ = (tail[0] << 2) | (tail[1] >> 4);
+    }
+    if (tail_len > 2) {
+        *out++ = (tail[1] << 4) | (tail[2] >> 2);
     }
 
-    return ret;
+    return out - start;
 }
 
 
@@ -130,57 +448,40 @@ std::string base64_encode(const std::vector<uint8_t>& buf) {
  *
  * @param encoded_string Printable string containing base64 encoded data.
  *                       No embedded whitespace characters are present.
+ * @param encoded_len    Length of encoded_string
  * @returns Vector containing decoded binary data
  */
-std::vector<uint8_t> base64_decode(const std::string& encoded_string) {
-    int in_len = encoded_string.size();
-    int i = 0;
-    int j = 0;
-    int in_ = 0;
-    unsigned char char_array_4[4], char_array_3[3];
-    std::vector<uint8_t> ret;
-
-    // Decode until a padding character or non-base64 character is found
-    while (in_len-- && (encoded_string[in_] != '=') &&
-            is_base64(encoded_string[in_])) {
-        char_array_4[i++] = encoded_string[in_];
-        in_++;
-
-        if (i == 4) {
-            for (i = 0; i < 4; i++) {
-                char_array_4[i] = base64_chars.find(char_array_4[i]);
-            }
-
-            char_array_3[0] = (char_array_4[0] << 2) +
-                ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) +
-                ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) +
-                char_array_4[3];
-
-            for (i = 0; (i < 3); i++) {
-                ret.push_back(char_array_3[i]);
-            }
-            i = 0;
-        }
-    }
+std::vector<uint8_t> base64_decode(const char* encoded_string,
+        size_t encoded_len) {
+    std::vector<uint8_t> ret(base64_decode_buffer_size(encoded_len));
+    ret.resize(base64_decode(encoded_string, encoded_len, ret.data()));
+    return ret;
+}
 
-    if (i) {
-        for (j = 0; j < i; j++) {
-            char_array_4[j] = base64_chars.find(char_array_4[j]);
-        }
 
-        char_array_3[0] = (char_array_4[0] << 2) +
-            ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) +
-            ((char_array_4[2] & 0x3c) >> 2);
+/**
+ * Size of the buffer base64_decode() decodes encoded_len characters
+ * into, with room for the vector code writing past the decoded data.
+ *
+ * @param encoded_len Number of base64 encoded characters
+ * @returns Size of the buffer in bytes
+ */
+size_t base64_decode_buffer_size(size_t encoded_len) {
+    return (encoded_len / 4) * 3 + 8;
+}
 
-        for (j = 0; (j < i - 1); j++) {
-            ret.push_back(char_array_3[j]);
-        }
-    }
 
-    return ret;
+/**
+ * Decode a base64 encoded printable string into a vector of binary data.
+ * 0 to 2 '=' padding characters may be appended.
+ * Decoding stops at first non-base64 character.
+ *
+ * @param encoded_string Printable string containing base64 encoded data.
+ *                       No embedded whitespace characters are present.
+ * @returns Vector containing decoded binary data
+ */
+std::vector<uint8_t> base64_decode(const std::string& encoded_string) {
+    return base64_decode(encoded_string.data(), encoded_string.size());
 }
 
 
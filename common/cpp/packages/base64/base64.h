@@ -13,19 +13,35 @@
 
 /*
  * The original source code has been modified to be used with
- * Hyperledger Avalon. Added function base64_decoded_length().
+ * Hyperledger Avalon. Added function base64_decoded_length() and the
+ * overloads encoding and decoding buffers.
  */
 
 #pragma once
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
 std::string base64_encode(
     const std::vector<uint8_t>& raw_buffer);
 
+std::string base64_encode(
+    const uint8_t* raw_buffer, size_t length);
+
+size_t base64_encode(
+    const uint8_t* raw_buffer, size_t length, char* encoded_buffer);
+
 std::vector<uint8_t> base64_decode(
     const std::string& encoded_string);
 
+std::vector<uint8_t> base64_decode(
+    const char* encoded_string, size_t encoded_len);
+
+size_t base64_decode(
+    const char* encoded_string, size_t encoded_len, uint8_t* raw_buffer);
+
+size_t base64_decode_buffer_size(size_t encoded_len);
+
 unsigned int base64_decoded_length(const char *encoded_string,
     unsigned int encoded_len);
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the arena allocation in arena.cpp.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "arena.h"
+#include "parson.h"
+
+static int count = 0;
+
+static void Check(bool passed, const char* what) {
+    if (passed) {
+        printf("PASSED: %s\n", what);
+    } else {
+        printf("FAILED: %s\n", what);
+        ++count;
+    }
+}
+
+static void TestArena() {
+    printf("Arena test: allocate and reset\n");
+    tcf::Arena arena(1024);
+
+    uint8_t* a = (uint8_t*) arena.Allocate(1);
+    uint8_t* b = (uint8_t*) arena.Allocate(0);
+    uint8_t* c = (uint8_t*) arena.Allocate(100);
+    Check(a != nullptr && b != nullptr && c != nullptr && a != b && b != c,
+        "Allocate() returns distinct pointers");
+    Check((uintptr_t) a % 16 == 0 && (uintptr_t) b % 16 == 0 &&
+        (uintptr_t) c % 16 == 0, "Allocate() aligns allocations");
+    memset(c, 0x5A, 100);
+    Check(arena.Owns(a) && arena.Owns(c + 99), "Owns() its allocations");
+
+    int on_stack;
+    Check(!arena.Owns(&on_stack) && !arena.Owns(nullptr),
+        "Owns() no other memory");
+    Check(arena.Allocate(257) == nullptr,
+        "Allocate() leaves large allocations to the heap");
+
+    // Fill more than one chunk
+    uint8_t* last = nullptr;
+    bool allocated = true;
+    for (int i = 0; i < 64; i++) {
+        last = (uint8_t*) arena.Allocate(200);
+        allocated = allocated && last != nullptr;
+    }
+    Check(allocated, "Allocate() adds chunks");
+    Check(arena.Owns(a) && arena.Owns(last), "Owns() all chunks");
+
+    arena.Reset();
+    Check(!arena.Owns(last), "Reset() frees added chunks");
+    Check(arena.Allocate(16) == a, "Reset() rewinds the kept chunk");
+}
+
+static void TestScope() {
+    printf("Arena test: scopes\n");
+    Check(tcf::GetThreadArena() == nullptr, "no arena outside a scope");
+
+    void* outside = tcf::ArenaMalloc(32);
+    {
+        tcf::ArenaScope scope;
+        tcf::Arena* arena = tcf::GetThreadArena();
+        Check(arena != nullptr, "arena in a scope");
+        Check(!arena->Owns(outside), "heap used outside a scope");
+
+        void* inside = tcf::ArenaMalloc(32);
+        Check(arena->Owns(inside), "arena used in a scope");
+        void* large = tcf::ArenaMalloc(ARENA_CHUNK_SIZE);
+        Check(large != nullptr && !arena->Owns(large),
+            "heap used for large allocations");
+        tcf::ArenaFree(large);
+        tcf::ArenaFree(inside);
+        tcf::ArenaFree(nullptr);
+        {
+            tcf::ArenaScope nested;
+            void* p = tcf::ArenaMalloc(32);
+            Check(tcf::GetThreadArena() == arena && arena->Owns(p),
+                "nested scope uses the same arena");
+        }
+        Check(arena->Owns(inside), "nested scope does not reset the arena");
+        tcf::ArenaFree(outside);
+    }
+    Check(tcf::GetThreadArena() == nullptr, "no arena after the scope");
+}
+
+static void TestAllocator() {
+    printf("Arena test: STL allocator\n");
+    tcf::ArenaVector<int> outside(100, 7);
+    {
+        tcf::ArenaScope scope;
+        tcf::Arena* arena = tcf::GetThreadArena();
+
+        tcf::ArenaVector<int> v;
+        for (int i = 0; i < 1000; i++) {
+            v.push_back(i);
+        }
+        Check(arena->Owns(v.data()) && v[999] == 999,
+            "vector grows in the arena");
+
+        tcf::ArenaString s("a string longer than the small string buffer");
+        s += s;
+        Check(arena->Owns(s.data()), "string in the arena");
+
+        tcf::ArenaVector<int> copy(outside);
+        Check(arena->Owns(copy.data()) && copy == outside,
+            "vector copied into the arena");
+
+        tcf::ArenaVector<int> big(ARENA_CHUNK_SIZE);
+        Check(!arena->Owns(big.data()), "large vector on the heap");
+    }
+    Check(outside.size() == 100 && outside[99] == 7,
+        "vector from outside the scope kept");
+}
+
+static void TestParson() {
+    printf("Arena test: parson allocation\n");
+    const char* text = "{\"a\":[1,2,3],\"b\":{\"c\":\"d\"}}";
+    JSON_Value* outside;
+    {
+        // Outside of an ArenaScope values come from the heap
+        tcf::JsonArenaScope json_scope;
+        outside = json_parse_string(text);
+    }
+    {
+        tcf::ArenaScope scope;
+        JSON_Value* kept = json_parse_string(text);
+        Check(kept != nullptr && !tcf::GetThreadArena()->Owns(kept),
+            "JSON value from the heap outside a JsonArenaScope");
+
+        JSON_Value* value;
+        {
+            tcf::JsonArenaScope json_scope;
+            value = json_parse_string(text);
+        }
+        Check(value != nullptr &&
+            tcf::GetThreadArena()->Owns(value),
+            "JSON value parsed into the arena");
+        char* serialized = json_serialize_to_string(value);
+        Check(serialized != nullptr && strcmp(serialized, text) == 0 &&
+            !tcf::GetThreadArena()->Owns(serialized),
+            "JSON value from the arena serialized");
+        json_free_serialized_string(serialized);
+        json_value_free(value);
+
+        Check(!tcf::GetThreadArena()->Owns(outside),
+            "JSON value from the heap outside an ArenaScope");
+        json_value_free(outside);
+        // Kept beyond the scope, like the values of reusable workloads
+        outside = kept;
+    }
+    Check(json_serialization_size(outside) == strlen(text) + 1,
+        "JSON value from the heap kept after the scope");
+    json_value_free(outside);
+}
+
+int
+main(void)
+{
+    TestArena();
+    TestScope();
+    TestAllocator();
+    TestParson();
+    return count;
+}  // main()
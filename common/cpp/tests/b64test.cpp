@@ -19,6 +19,9 @@
  * - OpenSSL EVP_DecodeBlock() used in signature verification
  * - Avalon base64_encode()
  * - Avalon base64_decode()
+ * The encode and decode functions are also compared with a character by
+ * character reference on random data of lengths covering the vector and
+ * scalar code paths.
  * See https://tools.ietf.org/html/rfc4648
  */
 
@@ -34,6 +37,113 @@
 #include "utils.h"       // ByteArrayToStr()
 #include "base64.h"      // base64_*code()
 
+static const char reference_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Reference encoder, one 6-bit group at a time
+static std::string reference_encode(const ByteArray& data) {
+    std::string encoded;
+    size_t bits = data.size() * 8;
+    for (size_t bit = 0; bit < bits; bit += 6) {
+        unsigned int group = 0;
+        for (size_t b = bit; b < bit + 6; b++) {
+            group <<= 1;
+            if (b < bits) {
+                group |= (data[b / 8] >> (7 - b % 8)) & 1;
+            }
+        }
+        encoded += reference_chars[group];
+    }
+    while (encoded.size() % 4 != 0) {
+        encoded += '=';
+    }
+    return encoded;
+}
+
+// Reference decoder, decodes up to the first character which is not a
+// base64 character, ignoring a trailing incomplete byte
+static ByteArray reference_decode(const std::string& encoded) {
+    ByteArray decoded;
+    unsigned int bits = 0;
+    int num_bits = 0;
+    for (char c : encoded) {
+        const char* p = strchr(reference_chars, c);
+        if (c == '\0' || p == nullptr) {
+            break;
+        }
+        bits = (bits << 6) | (p - reference_chars);
+        num_bits += 6;
+        if (num_bits >= 8) {
+            num_bits -= 8;
+            decoded.push_back((bits >> num_bits) & 0xff);
+        }
+    }
+    return decoded;
+}
+
+// Compares base64_encode() and base64_decode() with the reference
+// functions on random data, returns the number of failures
+static int random_data_tests(void) {
+    static const char invalid_chars[] = {'=', '-', '_', ' ', '\n', '\0',
+        '.', '@', '[', '`', '{', '\x7f', '\x80', '\xff'};
+    int failures = 0;
+
+    srand(1);
+    for (size_t length = 0; length < 300; length++) {
+        for (int repeat = 0; repeat < 4; repeat++) {
+            size_t len = (repeat == 3) ? length * 97 + 1 : length;
+            ByteArray data(len);
+            for (size_t i = 0; i < len; i++) {
+                data[i] = rand() & 0xff;
+            }
+
+            std::string encoded = base64_encode(data);
+            if (encoded != reference_encode(data)) {
+                printf("base64_encode of %lu random bytes FAILED\n", len);
+                failures++;
+                continue;
+            }
+            if (base64_decode(encoded) != data) {
+                printf("base64_decode of %lu random bytes FAILED\n", len);
+                failures++;
+            }
+
+            // Encoding and decoding buffers
+            std::string buffered(encoded.size(), '\0');
+            if (base64_encode(data.data(), len, &buffered[0]) !=
+                    encoded.size() || buffered != encoded) {
+                printf("base64_encode of %lu random bytes into a buffer "
+                    "FAILED\n", len);
+                failures++;
+            }
+            ByteArray decoded(base64_decode_buffer_size(encoded.size()));
+            decoded.resize(base64_decode(encoded.data(), encoded.size(),
+                decoded.data()));
+            if (decoded != data) {
+                printf("base64_decode of %lu random bytes into a buffer "
+                    "FAILED\n", len);
+                failures++;
+            }
+
+            // Decoding stops at the first invalid character
+            if (!encoded.empty()) {
+                std::string truncated = encoded;
+                truncated[rand() % truncated.size()] = invalid_chars[
+                    rand() % sizeof(invalid_chars)];
+                if (base64_decode(truncated) != reference_decode(truncated)) {
+                    printf("base64_decode of %lu characters with invalid "
+                        "character FAILED\n", truncated.size());
+                    failures++;
+                }
+            }
+        }
+    }
+    if (failures == 0) {
+        printf("base64 random data tests PASSED\n");
+    }
+    return failures;
+}
+
 static const char rsa_2048_signature[] =
     "TuHse3QCPZtyZP436ltUAc6cVlIDzwKyjguOBDMmoou/NlGylzY0EtOEbHvVZ28H"
     "T8U1CiCVVmZso2ut2HY3zFDfpUg5/FV7FUSw/UhDOu3xkDwicrOvd/P1C3BKWJ6v"
@@ -194,6 +304,8 @@ main(void)
 
     }
 
+    count += random_data_tests();
+
     // Summarize
     if (count == 0) {
         printf("Base64 Decode tests PASSED.\n");
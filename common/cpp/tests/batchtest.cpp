@@ -0,0 +1,114 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test work order batch encoding in work_order_batch.cpp.
+ */
+
+#include <stdexcept>
+#include <stdio.h>
+
+#include "error.h"       // tcf::error
+#include "utils.h"       // StrToByteArray()
+#include "work_order_batch.h"
+
+namespace batch = tcf::work_order_batch;
+
+int
+main(void)
+{
+    int  count = 0;
+    const char* requests[] = {"{\"id\": 1}", "", "{\"id\": 3}"};
+    const char* ext_data[] = {"", "wpe key", "ext"};
+    const size_t num_requests = 3;
+
+    printf("Request batch test: AppendRequest()/ParseRequests()\n");
+    ByteArray request_batch;
+    for (size_t i = 0; i < num_requests; ++i) {
+        batch::AppendRequest(request_batch, StrToByteArray(requests[i]),
+            StrToByteArray(ext_data[i]));
+    }
+    try {
+        std::vector<batch::RequestItem> items = batch::ParseRequests(
+            request_batch.data(), request_batch.size());
+        bool is_ok = (items.size() == num_requests);
+        for (size_t i = 0; is_ok && i < num_requests; ++i) {
+            is_ok = std::string((const char*) items[i].request,
+                    items[i].request_size) == requests[i] &&
+                std::string((const char*) items[i].ext_data,
+                    items[i].ext_data_size) == ext_data[i];
+        }
+        if (is_ok) {
+            printf("PASSED: ParseRequests()\n");
+        } else {
+            printf("FAILED: ParseRequests() items mismatch\n");
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: ParseRequests():\n%s\n", e.what());
+        ++count;
+    }
+
+    // Truncated batch must be detected
+    try {
+        batch::ParseRequests(request_batch.data(), request_batch.size() - 1);
+        printf("FAILED: ParseRequests() truncated batch undetected\n");
+        ++count;
+    } catch (const tcf::error::ValueError& e) { // expected error here
+        printf("PASSED: ParseRequests() truncated batch detected\n");
+    }
+
+    printf("Response batch test: AppendResponse()/ParseResponses()\n");
+    ByteArray response_batch;
+    batch::AppendResponse(response_batch, TCF_SUCCESS,
+        StrToByteArray("{\"result\": 1}"));
+    batch::AppendResponse(response_batch, TCF_ERR_VALUE, ByteArray());
+    try {
+        std::vector<batch::ResponseItem> items = batch::ParseResponses(
+            response_batch.data(), response_batch.size());
+        if (items.size() == 2 && items[0].status == TCF_SUCCESS &&
+                ByteArrayToStr(items[0].response) == "{\"result\": 1}" &&
+                items[1].status == TCF_ERR_VALUE &&
+                items[1].response.empty()) {
+            printf("PASSED: ParseResponses()\n");
+        } else {
+            printf("FAILED: ParseResponses() items mismatch\n");
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: ParseResponses():\n%s\n", e.what());
+        ++count;
+    }
+
+    // Response size beyond the end of the batch must be detected
+    response_batch[4] = 0xFF;
+    try {
+        batch::ParseResponses(response_batch.data(), response_batch.size());
+        printf("FAILED: ParseResponses() invalid size undetected\n");
+        ++count;
+    } catch (const tcf::error::ValueError& e) { // expected error here
+        printf("PASSED: ParseResponses() invalid size detected\n");
+    }
+
+    // Summarize
+    if (count == 0) {
+        printf("Work order batch tests PASSED.\n");
+    } else {
+        printf("Work order batch tests FAILED %d tests.\n", count);
+    }
+
+    return count;
+}
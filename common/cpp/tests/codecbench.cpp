@@ -0,0 +1,107 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark base64 and hex encoding and decoding of data of the sizes
+ * of hashes, keys and work order data items.
+ *
+ * Usage: codecbench [megabytes per measurement]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "base64.h"      // base64_*code()
+#include "hex_string.h"  // tcf::HexStringToBinary(), BinaryToHexString()
+
+// Runs function until it processed total_bytes of input,
+// returns the input bytes processed per second in MB/s
+template <typename Function>
+static double Measure(size_t input_size, size_t total_bytes,
+        Function function) {
+    size_t iterations = total_bytes / input_size + 1;
+    auto start = std::chrono::steady_clock::now();
+    size_t check = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        check += function();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (check == 0) {
+        printf("Nothing was converted\n");
+    }
+    return (iterations * input_size) / elapsed.count() / 1e6;
+}
+
+int
+main(int argc, char** argv)
+{
+    static const size_t sizes[] = {32, 1024, 64 * 1024, 4 * 1024 * 1024};
+    int megabytes = 256;
+    if (argc > 1) {
+        megabytes = atoi(argv[1]);
+    }
+    if (megabytes <= 0) {
+        printf("Usage: %s [megabytes per measurement]\n", argv[0]);
+        return 1;
+    }
+    size_t total_bytes = (size_t) megabytes * 1000 * 1000;
+    int count = 0;
+
+    printf("Codec benchmark, %d MB per measurement, input MB/s\n",
+        megabytes);
+    printf("%10s %12s %12s %12s %12s\n", "bytes", "b64 encode",
+        "b64 decode", "hex encode", "hex decode");
+    srand(1);
+    for (size_t size : sizes) {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = rand() & 0xff;
+        }
+        std::string encoded = base64_encode(data);
+        std::string hex = tcf::BinaryToHexString(data);
+        if (base64_decode(encoded) != data ||
+                tcf::HexStringToBinary(hex) != data) {
+            count++;
+        }
+
+        double b64_encode = Measure(data.size(), total_bytes, [&data]() {
+            return base64_encode(data).size();
+        });
+        double b64_decode = Measure(encoded.size(), total_bytes,
+            [&encoded]() {
+                return base64_decode(encoded).size();
+            });
+        double hex_encode = Measure(data.size(), total_bytes, [&data]() {
+            return tcf::BinaryToHexString(data).size();
+        });
+        double hex_decode = Measure(hex.size(), total_bytes, [&hex]() {
+            return tcf::HexStringToBinary(hex).size();
+        });
+        printf("%10lu %12.1f %12.1f %12.1f %12.1f\n", size,
+            b64_encode, b64_decode, hex_encode, hex_decode);
+    }
+
+    if (count == 0) {
+        printf("Codec benchmark PASSED.\n");
+    } else {
+        printf("Codec benchmark FAILED, %d sizes not converted back.\n",
+            count);
+    }
+    return count;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test ECDH key agreement and HKDF key derivation in ecdh.cpp.
+ *
+ * HKDF test case 3 is from RFC 5869. The session key test vector was
+ * computed with an independent secp256r1 and HKDF implementation.
+ */
+
+#include <stdio.h>
+#include <stdexcept>
+#include <string>
+
+#include "ecdh.h"
+#include "error.h"       // tcf::error
+#include "hex_string.h"  // tcf::HexStringToBinary()
+#include "types.h"       // ByteArrayToHexEncodedString()
+
+namespace ecdh = tcf::crypto::ecdh;
+
+int
+main(void)
+{
+    int  count = 0;
+
+    printf("HKDF test: DeriveKey()\n");
+    try {
+        ByteArray ikm(22, 0x0b);
+        std::string okm = ByteArrayToHexEncodedString(
+            ecdh::DeriveKey(ikm, ByteArray(), 42));
+        if (okm == "8DA4E775A563C18F715F802A063C5A31B8A11F5C5EE1879EC345"
+                "4E5F3C738D2D9D201395FAA4B61A96C8") {
+            printf("PASSED: DeriveKey() RFC 5869 test case 3\n");
+        } else {
+            printf("FAILED: DeriveKey() RFC 5869 test case 3\n%s\n",
+                okm.c_str());
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: DeriveKey():\n%s\n", e.what());
+        ++count;
+    }
+
+    printf("ECDH test: ComputeSharedSecret()/DeriveSessionKey()\n");
+    try {
+        ecdh::PrivateKey worker_key(
+            "C9AFA9D845BA75166B5C215767B1D6934E50C3DB36E89B127B8A622B120F6721");
+        ecdh::PrivateKey requester_key(
+            "0000000000000000000000000000000000000000000000000000000000000007");
+        if (worker_key.SerializePublicKey() ==
+                "0460FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E"
+                "60F29FB67903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177"
+                "A3C294D4462299") {
+            printf("PASSED: public key of deserialized private key\n");
+        } else {
+            printf("FAILED: public key of deserialized private key\n");
+            ++count;
+        }
+
+        ByteArray secret = requester_key.ComputeSharedSecret(
+            worker_key.GetPublicKey());
+        ByteArray session_key = ecdh::DeriveSessionKey(secret,
+            requester_key.GetPublicKey(), worker_key.GetPublicKey());
+        if (ByteArrayToHexEncodedString(session_key) ==
+                "9A0899270F1159E1D17BD4EF82A1DF4ED211B3FE137AFDFFD31BFC3730"
+                "22AE30") {
+            printf("PASSED: DeriveSessionKey() test vector\n");
+        } else {
+            printf("FAILED: DeriveSessionKey() test vector\n");
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: ECDH test vector:\n%s\n", e.what());
+        ++count;
+    }
+
+    try {
+        ecdh::PrivateKey worker_key;
+        ecdh::PrivateKey requester_key;
+        worker_key.Generate();
+        requester_key.Generate();
+        ecdh::PrivateKey copy(worker_key.Serialize());
+
+        if (requester_key.ComputeSharedSecret(worker_key.GetPublicKey()) ==
+                copy.ComputeSharedSecret(requester_key.GetPublicKey())) {
+            printf("PASSED: generated keys agree on a shared secret\n");
+        } else {
+            printf("FAILED: generated keys do not agree\n");
+            ++count;
+        }
+
+        // A point off the curve must be rejected
+        ByteArray invalid_key = worker_key.GetPublicKey();
+        invalid_key[ecdh::PUBLIC_KEY_SIZE - 1] ^= 1;
+        try {
+            requester_key.ComputeSharedSecret(invalid_key);
+            printf("FAILED: invalid public key undetected\n");
+            ++count;
+        } catch (const tcf::error::ValueError& e) { // expected error here
+            printf("PASSED: invalid public key detected\n");
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: ECDH key agreement:\n%s\n", e.what());
+        ++count;
+    }
+
+    // A private key out of range must be rejected
+    try {
+        ecdh::PrivateKey zero_key(std::string(2 * ecdh::PRIVATE_KEY_SIZE, '0'));
+        printf("FAILED: invalid private key undetected\n");
+        ++count;
+    } catch (const tcf::error::ValueError& e) { // expected error here
+        printf("PASSED: invalid private key detected\n");
+    }
+
+    // Summarize
+    if (count == 0) {
+        printf("ECDH key agreement tests PASSED.\n");
+    } else {
+        printf("ECDH key agreement tests FAILED %d tests.\n", count);
+    }
+
+    return count;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the streamed work order data path of the echo workload,
+ * examples/apps/echo/workload/echo_logic.cpp, with readers and writers
+ * standing in for the ones of the enclave.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "echo_logic.h"
+#include "work_order_data.h"
+
+// Larger than the heap of the enclaves (HeapMaxSize 8 MB), which used to
+// limit the size of work order data
+#define LARGE_DATA_SIZE (16 * 1024 * 1024)
+
+// Most the workload may allocate while echoing streamed data
+#define STREAM_ALLOCATION_LIMIT (256 * 1024)
+
+static const char prefix[] = "RESULT: ";
+
+static int count = 0;
+static size_t allocated_bytes = 0;
+
+void* operator new(size_t size) {
+    allocated_bytes += size;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+static void Check(bool passed, const char* what) {
+    if (passed) {
+        printf("PASSED: %s\n", what);
+    } else {
+        printf("FAILED: %s\n", what);
+        ++count;
+    }
+}
+
+static uint8_t DataByte(size_t i) {
+    return (uint8_t) ((i * 7) ^ (i >> 11));
+}
+
+// Returns size generated bytes in pieces of at most piece_size bytes
+class GeneratedDataReader : public tcf::WorkOrderDataReader {
+public:
+    GeneratedDataReader(size_t size, size_t piece_size) :
+        size_(size), piece_size_(piece_size), position_(0) {}
+
+    size_t Read(uint8_t* buffer, size_t size) override {
+        size_t n = std::min(std::min(size, piece_size_), size_ - position_);
+        for (size_t i = 0; i < n; i++) {
+            buffer[i] = DataByte(position_ + i);
+        }
+        position_ += n;
+        return n;
+    }
+
+private:
+    size_t size_;
+    size_t piece_size_;
+    size_t position_;
+};
+
+// Checks the data written against the echo of the generated data
+class CheckingWriter : public tcf::WorkOrderDataWriter {
+public:
+    CheckingWriter() : size_(0), matches_(true), writes_(0) {}
+
+    void Write(const uint8_t* data, size_t size) override {
+        for (size_t i = 0; i < size; i++, size_++) {
+            uint8_t expected = size_ < sizeof(prefix) - 1 ?
+                (uint8_t) prefix[size_] : DataByte(size_ - sizeof(prefix) + 1);
+            matches_ = matches_ && data[i] == expected;
+        }
+        writes_++;
+    }
+
+    size_t size_;
+    bool matches_;
+    size_t writes_;
+};
+
+static bool IsEcho(const ByteArray& output, size_t size) {
+    if (output.size() != sizeof(prefix) - 1 + size ||
+        memcmp(output.data(), prefix, sizeof(prefix) - 1) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (output[sizeof(prefix) - 1 + i] != DataByte(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void TestEmbedded() {
+    printf("Echo test: embedded data\n");
+    tcf::WorkOrderData in_data(0, ByteArray({'a', 'b', 'c'}));
+    tcf::WorkOrderData out_data;
+    ProcessData(in_data, out_data);
+    Check(ByteArrayToString(out_data.decrypted_data) == "RESULT: abc",
+        "embedded data is echoed in decrypted_data");
+}
+
+static void TestStreamed() {
+    printf("Echo test: %d bytes streamed in and out\n", LARGE_DATA_SIZE);
+    tcf::WorkOrderData in_data;
+    in_data.reader = std::make_shared<GeneratedDataReader>(
+        LARGE_DATA_SIZE, 100 * 1024);
+    tcf::WorkOrderData out_data;
+    std::shared_ptr<CheckingWriter> writer =
+        std::make_shared<CheckingWriter>();
+    out_data.writer = writer;
+
+    allocated_bytes = 0;
+    ProcessData(in_data, out_data);
+    size_t allocated = allocated_bytes;
+
+    Check(writer->size_ == sizeof(prefix) - 1 + LARGE_DATA_SIZE &&
+        writer->matches_, "streamed data is echoed through the writer");
+    Check(writer->writes_ > 1, "output is written piece by piece");
+    Check(out_data.decrypted_data.empty(), "decrypted_data is not set");
+    Check(allocated <= STREAM_ALLOCATION_LIMIT,
+        "streamed data is not held whole");
+}
+
+// Requests not handled through ecall_HandleWorkOrderRequestStream give
+// streaming workloads outData items without writers
+static void TestNonStreamPath() {
+    const size_t size = 1024 * 1024 + 1;
+    printf("Echo test: %zu bytes without writer\n", size);
+    ByteArray data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = DataByte(i);
+    }
+    tcf::WorkOrderData embedded_in(0, data);
+    tcf::WorkOrderData embedded_out(0, ByteArray());
+    ProcessData(embedded_in, embedded_out);
+    Check(IsEcho(embedded_out.decrypted_data, size),
+        "embedded data is echoed in decrypted_data");
+
+    tcf::WorkOrderData streamed_in;
+    streamed_in.reader = std::make_shared<GeneratedDataReader>(
+        size, 100 * 1024);
+    tcf::WorkOrderData streamed_out(0, ByteArray());
+    ProcessData(streamed_in, streamed_out);
+    Check(IsEcho(streamed_out.decrypted_data, size),
+        "streamed data is echoed in decrypted_data");
+}
+
+int
+main(void)
+{
+    TestEmbedded();
+    TestStreamed();
+    TestNonStreamPath();
+    return count;
+}  // main()
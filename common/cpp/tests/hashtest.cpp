@@ -0,0 +1,158 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test work order request and response hashes in work_order_hash.cpp.
+ */
+
+#include <stdexcept>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "crypto.h"      // tcf::crypto
+#include "hex_string.h"  // ByteArrayToHexEncodedString()
+#include "utils.h"       // StrToByteArray(), ByteArrayToString()
+#include "work_order_hash.h"
+
+namespace hash = tcf::work_order_hash;
+
+struct DataItem {
+    std::string data_hash;
+    std::string data;
+    std::string encrypted_data_key;
+    std::string iv;
+};
+
+// Hash of the data items through work_order_hash, empty if they add up
+// to nothing
+static ByteArray
+ItemsHash(const std::vector<DataItem>& items)
+{
+    tcf::crypto::MessageHasher hasher;
+    size_t size = 0;
+    for (const DataItem& item : items) {
+        size += hash::UpdateDataItemHash(hasher, item.data_hash, item.data,
+            item.encrypted_data_key, item.iv);
+    }
+    if (size == 0) {
+        return ByteArray();
+    }
+    return hasher.Finalize();
+}
+
+// Hash of the data items computed by concatenating their fields first
+static std::string
+ConcatItems(const std::vector<DataItem>& items)
+{
+    std::string concat_string;
+    for (const DataItem& item : items) {
+        concat_string += item.data_hash + item.data +
+            item.encrypted_data_key + item.iv;
+    }
+    return concat_string;
+}
+
+// Work order hash computed by concatenating its fields first
+static ByteArray
+ConcatHash(const std::string& id_string,
+    const std::vector<DataItem>& in_data,
+    const std::vector<DataItem>& out_data)
+{
+    std::string final_hash_string = ByteArrayToString(
+        tcf::crypto::ComputeMessageHash(StrToByteArray(id_string)));
+    std::string in_data_string = ConcatItems(in_data);
+    if (!in_data_string.empty()) {
+        final_hash_string += ByteArrayToString(
+            tcf::crypto::ComputeMessageHash(StrToByteArray(in_data_string)));
+    }
+    std::string out_data_string = ConcatItems(out_data);
+    if (!out_data_string.empty()) {
+        final_hash_string += ByteArrayToString(
+            tcf::crypto::ComputeMessageHash(StrToByteArray(out_data_string)));
+    }
+    return tcf::crypto::ComputeMessageHash(StrToByteArray(final_hash_string));
+}
+
+static int
+CheckHash(const char* name,
+    const std::vector<DataItem>& in_data,
+    const std::vector<DataItem>& out_data,
+    const char* expected_hex)
+{
+    ByteArray id_hash = hash::ComputeIdHash(
+        "0x1a2b", "0x3c4d", "0x5e6f", "echo-result", "0x7a8b");
+    ByteArray final_hash = hash::ComputeFinalHash(
+        id_hash, ItemsHash(in_data), ItemsHash(out_data));
+    std::string final_hash_hex = ByteArrayToHexEncodedString(final_hash);
+
+    if (final_hash != ConcatHash("0x1a2b0x3c4d0x5e6fecho-result0x7a8b",
+            in_data, out_data)) {
+        printf("FAILED: %s hash differs from concatenated hash\n", name);
+        return 1;
+    }
+    if (final_hash_hex != expected_hex) {
+        printf("FAILED: %s hash %s, expected %s\n", name,
+            final_hash_hex.c_str(), expected_hex);
+        return 1;
+    }
+    printf("PASSED: %s hash\n", name);
+    return 0;
+}
+
+int
+main(void)
+{
+    int  count = 0;
+    const std::vector<DataItem> in_data = {
+        {"9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08",
+            "dGVzdA==", "-", ""},
+        {"", "aGVsbG8=", "0a1b", "00112233"},
+    };
+    const std::vector<DataItem> out_data = {
+        {"", "", "-", ""},
+    };
+    const std::vector<DataItem> empty_out_data = {
+        {"", "", "", ""},
+        {"", "", "", ""},
+    };
+
+    printf("Work order hash test: ComputeIdHash()/UpdateDataItemHash()/"
+        "ComputeFinalHash()\n");
+    try {
+        count += CheckHash("Request", in_data, out_data,
+            "A7D14FC59FA6939B8890DABC93734CA33AF6D78614DC71C406E7068D91D3881A");
+        // outData adding up to nothing is left out of the hash
+        count += CheckHash("Request with empty outData",
+            in_data, empty_out_data,
+            "B31DDD24C729B854A3EB9C739B869EB484A070457C43E9ED2B793067A2B506D9");
+        count += CheckHash("Response", {}, in_data,
+            ByteArrayToHexEncodedString(ConcatHash(
+                "0x1a2b0x3c4d0x5e6fecho-result0x7a8b", {}, in_data)).c_str());
+    } catch (const std::exception& e) {
+        printf("FAILED: work order hash:\n%s\n", e.what());
+        ++count;
+    }
+
+    // Summarize
+    if (count == 0) {
+        printf("Work order hash tests PASSED.\n");
+    } else {
+        printf("Work order hash tests FAILED %d tests.\n", count);
+    }
+
+    return count;
+}
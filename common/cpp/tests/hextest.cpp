@@ -0,0 +1,124 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test hex string conversion in hex_string.cpp.
+ * Random data of lengths covering the vector and scalar code paths is
+ * compared with a reference conversion.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "error.h"       // tcf::error
+#include "hex_string.h"  // tcf::HexStringToBinary(), BinaryToHexString()
+
+static std::string ReferenceHex(const std::vector<uint8_t>& data) {
+    std::string hex;
+    char digits[3];
+    for (uint8_t byte : data) {
+        snprintf(digits, sizeof(digits), "%02X", byte);
+        hex += digits;
+    }
+    return hex;
+}
+
+static std::string ToLower(std::string hex) {
+    for (char& c : hex) {
+        if (c >= 'A' && c <= 'F') {
+            c = c - 'A' + 'a';
+        }
+    }
+    return hex;
+}
+
+// Returns true if HexStringToBinary() throws ValueError for hex
+static bool ThrowsValueError(const std::string& hex) {
+    try {
+        tcf::HexStringToBinary(hex);
+    } catch (const tcf::error::ValueError&) {
+        return true;
+    }
+    return false;
+}
+
+int
+main(void)
+{
+    static const char invalid_digits[] = {'G', 'g', '/', ':', '@', '`',
+        ' ', 'x', '\0', '\x80', '\xff'};
+    int count = 0;
+
+    printf("Hex conversion test: BinaryToHexString()/HexStringToBinary()\n");
+    srand(1);
+    for (size_t length = 1; length < 200; length++) {
+        std::vector<uint8_t> data(length);
+        for (size_t i = 0; i < length; i++) {
+            data[i] = rand() & 0xff;
+        }
+
+        std::string hex = tcf::BinaryToHexString(data);
+        if (hex != ReferenceHex(data)) {
+            printf("BinaryToHexString of %lu bytes FAILED\n", length);
+            count++;
+            continue;
+        }
+        if (tcf::HexStringToBinary(hex) != data ||
+                tcf::HexStringToBinary(ToLower(hex)) != data) {
+            printf("HexStringToBinary of %lu bytes FAILED\n", length);
+            count++;
+        }
+
+        // An invalid digit at a random position is rejected
+        std::string invalid = hex;
+        invalid[rand() % invalid.size()] =
+            invalid_digits[rand() % sizeof(invalid_digits)];
+        if (!ThrowsValueError(invalid)) {
+            printf("HexStringToBinary of invalid digit in %lu digits "
+                "FAILED\n", invalid.size());
+            count++;
+        }
+
+        // Conversion into a shorter buffer only converts what fits
+        std::vector<uint8_t> prefix(length / 2);
+        if (!prefix.empty()) {
+            tcf::HexStringToBinary(prefix.data(), prefix.size(), hex);
+            if (!std::equal(prefix.begin(), prefix.end(), data.begin())) {
+                printf("HexStringToBinary into %lu bytes FAILED\n",
+                    prefix.size());
+                count++;
+            }
+        }
+    }
+
+    if (!ThrowsValueError("ABC")) {
+        printf("HexStringToBinary of odd length FAILED\n");
+        count++;
+    }
+    if (!tcf::BinaryToHexString(std::vector<uint8_t>()).empty()) {
+        printf("BinaryToHexString of no bytes FAILED\n");
+        count++;
+    }
+
+    if (count == 0) {
+        printf("Hex conversion tests PASSED\n");
+    } else {
+        printf("Hex conversion tests FAILED %d tests\n", count);
+    }
+    return count;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the JSON writer in json_writer.cpp against parson serialization.
+ */
+
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "error.h"       // tcf::error
+#include "json_utils.h"  // JsonSetStr(), JsonSetNumber()
+#include "json_writer.h"
+#include "jsonvalue.h"
+
+static const char* STRINGS[] = {
+    "",
+    "plain text 0123",
+    "/+base64/+==",
+    "quote \" backslash \\ controls \b\f\n\r\t \x01 \x1f",
+    "-----BEGIN PUBLIC KEY-----\nMFkwEwYHKoZIzj0CAQYIKoZI\n"
+        "-----END PUBLIC KEY-----\n",
+    "UTF-8 \xc3\xa9 \xe2\x82\xac \xf0\x9f\x94\x91",
+};
+
+static const double NUMBERS[] = {
+    0, 1, -1, 42, 6000, 2147483647, -2147483647.0 - 1, 2147483648.0,
+    3000000000.0, 0.5, -0.25, 1e300, 1e-7
+};
+
+// parson serialization, terminating NUL included
+static ByteArray SerializeDocument(JsonValue& value) {
+    ByteArray serialized(json_serialization_size(value));
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(
+        json_serialize_to_buffer(value, (char*) serialized.data(),
+            serialized.size()) != JSONSuccess,
+        "serialization failed");
+    return serialized;
+}
+
+int
+main(void)
+{
+    int  count = 0;
+
+    printf("JSON writer test: JsonWriter compared to parson\n");
+    try {
+        JsonValue document(json_value_init_object());
+        JSON_Object* root = json_value_get_object(document);
+        tcf::JsonWriter writer(256);
+
+        writer.BeginObject();
+        JsonSetStr(root, "jsonrpc", "2.0", "jsonrpc");
+        writer.AddStr("jsonrpc", "2.0", "jsonrpc");
+        JsonSetNumber(root, "id", 11, "id");
+        writer.AddNumber("id", 11);
+
+        json_object_set_value(root, "result", json_value_init_object());
+        JSON_Object* result = json_object_get_object(root, "result");
+        writer.BeginObject("result");
+        for (size_t i = 0; i < sizeof(STRINGS) / sizeof(STRINGS[0]); i++) {
+            std::string name = "s" + std::to_string(i);
+            JsonSetStr(result, name.c_str(), STRINGS[i], "string");
+            writer.AddStr(name.c_str(), std::string(STRINGS[i]), "string");
+        }
+
+        // String written piece by piece
+        std::string joined;
+        writer.BeginStr("joined");
+        for (size_t i = 0; i < sizeof(STRINGS) / sizeof(STRINGS[0]); i++) {
+            joined += STRINGS[i];
+            writer.AppendStr(STRINGS[i], strlen(STRINGS[i]), "piece");
+        }
+        writer.EndStr();
+        JsonSetStr(result, "joined", joined.c_str(), "joined");
+
+        json_object_set_value(result, "outData", json_value_init_array());
+        JSON_Array* items = json_object_get_array(result, "outData");
+        writer.BeginArray("outData");
+        for (size_t i = 0; i < sizeof(NUMBERS) / sizeof(NUMBERS[0]); i++) {
+            JSON_Value* item = json_value_init_object();
+            JsonSetNumber(json_value_get_object(item), "index", NUMBERS[i],
+                "number");
+            json_array_append_value(items, item);
+            writer.BeginObject();
+            writer.AddNumber("index", NUMBERS[i]);
+            writer.EndObject();
+        }
+        json_object_set_value(result, "empty", json_value_init_array());
+        writer.EndArray();
+        writer.BeginArray("empty");
+        writer.EndArray();
+        writer.EndObject();
+
+        // String up to its first NUL, like c_str() of it
+        std::string with_nul("ab\0cd", 5);
+        JsonSetStr(root, "nul", with_nul.c_str(), "nul");
+        writer.AddStr("nul", with_nul, "nul");
+        writer.EndObject();
+
+        ByteArray expected = SerializeDocument(document);
+        ByteArray written = writer.Finish();
+        if (written == expected) {
+            printf("PASSED: JsonWriter output is the same as parson\n");
+        } else {
+            printf("FAILED: JsonWriter output differs from parson\n%s\n%s\n",
+                (const char*) expected.data(), (const char*) written.data());
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: JsonWriter exception: %s\n", e.what());
+        ++count;
+    }
+
+    printf("JSON writer test: invalid UTF-8\n");
+    const char* invalid[] = {
+        "\x80", "\xc0\xaf", "\xc3", "\xe2\x82", "\xed\xa0\x80",
+        "\xf4\x90\x80\x80", "\xf8\x88\x80\x80\x80"
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        // parson rejects the string as well
+        JsonValue document(json_value_init_object());
+        bool parson_rejects = json_object_set_string(
+            json_value_get_object(document), "s", invalid[i]) != JSONSuccess;
+        try {
+            tcf::JsonWriter writer;
+            writer.BeginObject();
+            writer.AddStr("s", invalid[i], "invalid string");
+            printf("FAILED: JsonWriter accepted invalid string %zu\n", i);
+            ++count;
+        } catch (const tcf::error::RuntimeError& e) {
+            if (parson_rejects && std::string(e.what()) == "invalid string") {
+                printf("PASSED: JsonWriter rejected invalid string %zu\n", i);
+            } else {
+                printf("FAILED: JsonWriter rejected string %zu, parson %s\n",
+                    i, parson_rejects ? "too" : "accepts it");
+                ++count;
+            }
+        }
+    }
+
+    return count;
+}  // main()
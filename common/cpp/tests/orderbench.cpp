@@ -0,0 +1,263 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark the allocations of the data path of an echo work order, as the
+ * enclave's WorkOrderProcessor takes it: request parsing, decoding,
+ * decryption and hash verification of inData, the move of the data to the
+ * workload, and hashing, encryption and serialization of outData.
+ *
+ * Counts the C++ allocations of an order and the bytes they allocate, for
+ * a regression in the copies of the data to show as a jump in the bytes
+ * allocated per byte of inData. Fails if an order of 64 KB or more
+ * allocates more than ALLOCATION_LIMIT bytes per byte: the decoded inData,
+ * the output of the workload and the response, about 3.5 bytes.
+ *
+ * Usage: orderbench [number of orders per size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "crypto_shared.h"   // Sets default CRYPTOLIB_* value
+#include "arena.h"
+#include "base64.h"          // base64_encode()
+#include "crypto.h"
+#include "error.h"           // tcf::error
+#include "hex_string.h"      // tcf::HexStringToBinary()
+#include "json_writer.h"
+#include "types.h"
+#include "work_order_data.h"
+#include "work_order_request.h"
+
+namespace request = tcf::work_order_request;
+namespace skenc = tcf::crypto::skenc;
+
+// Most bytes an order of 64 KB or more may allocate per byte of inData
+#define ALLOCATION_LIMIT 4.0
+
+static size_t allocations = 0;
+static size_t allocated_bytes = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    allocated_bytes += size;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Request with one inData item holding the encrypted data
+static std::string CreateRequest(const ByteArray& data,
+        const ByteArray& key, const ByteArray& iv) {
+    ByteArray encrypted = skenc::EncryptMessage(key, iv, data);
+    std::string data_hash = ByteArrayToHexEncodedString(
+        tcf::crypto::ComputeMessageHash(data));
+
+    return "{\"jsonrpc\": \"2.0\", \"method\": \"WorkOrderSubmit\", "
+        "\"id\": 11, \"params\": {\"responseTimeoutMSecs\": 6000, "
+        "\"payloadFormat\": \"JSON-RPC\", \"resultUri\": \"\", "
+        "\"workOrderId\": \"0x1234\", \"workerId\": \"w1\", "
+        "\"workloadId\": \"6563686f2d726573756c74\", "
+        "\"requesterId\": \"0x3456\", \"workerEncryptionKey\": \"\", "
+        "\"dataEncryptionAlgorithm\": \"AES-GCM-256\", "
+        "\"encryptedSessionKey\": \"ABCD\", \"sessionKeyIv\": \"0102\", "
+        "\"requesterNonce\": \"nonce\", \"encryptedRequestHash\": \"EF\", "
+        "\"inData\": [{\"index\": 0, \"dataHash\": \"" + data_hash +
+        "\", \"data\": \"" + base64_encode(encrypted) +
+        "\", \"encryptedDataEncryptionKey\": \"null\", \"iv\": \"\"}], "
+        "\"outData\": []}}";
+}
+
+// Passes the base64 encoding of data followed by tag to append in
+// pieces, like WorkOrderDataHandler::EncodeOutput()
+template <typename Append>
+static void EncodeOutput(const ByteArray& data, const uint8_t* tag,
+        Append append) {
+    const size_t chunk_size = 3 * 1024;
+    char encoded[chunk_size / 3 * 4];
+    size_t whole = data.size() - data.size() % 3;
+    for (size_t i = 0; i < whole; i += chunk_size) {
+        append(encoded, base64_encode(data.data() + i,
+            std::min(chunk_size, whole - i), encoded));
+    }
+    uint8_t rest[2 + tcf::crypto::constants::TAG_LEN];
+    size_t rest_size = data.size() - whole;
+    memcpy(rest, data.data() + whole, rest_size);
+    memcpy(rest + rest_size, tag, tcf::crypto::constants::TAG_LEN);
+    rest_size += tcf::crypto::constants::TAG_LEN;
+    append(encoded, base64_encode(rest, rest_size, encoded));
+}
+
+// Processes the request like an echo workload and returns the response
+static ByteArray ProcessOrder(const std::string& json,
+        const ByteArray& key, const ByteArray& iv) {
+    tcf::ArenaScope arena_scope;
+    request::WorkOrderRequest wo_request = request::ParseRequest(
+        json.c_str());
+    const request::DataItem& item = wo_request.in_data.at(0);
+
+    // Unpack, decoding the data from the request and decrypting it in
+    // the buffer of the decoded data
+    ByteArray input_hash = tcf::HexStringToBinary(
+        request::GetString(item.data_hash));
+    ByteArray buffer = request::GetBase64(item.data);
+    size_t len = buffer.size() - tcf::crypto::constants::TAG_LEN;
+    skenc::DecryptInPlace(key, iv, buffer.data(), len, buffer.data() + len);
+    buffer.resize(len);
+    tcf::WorkOrderData in_item(item.index, std::move(buffer));
+
+    std::vector<const ByteArray*> data = {&in_item.decrypted_data};
+    tcf::error::ThrowIf<tcf::error::ValueError>(
+        tcf::crypto::ComputeMessageHashes(data)[0] != input_hash,
+        "input data hash verification failed");
+
+    // The request hash is taken of the data in the request
+    tcf::crypto::MessageHasher request_hasher;
+    request::ForEachStringPiece(item.data,
+        [&request_hasher](const char* piece, size_t size) {
+            request_hasher.Update((const uint8_t*) piece, size);
+        });
+    request_hasher.Finalize();
+
+    // Execute, the echo workload copies its input to its output
+    std::vector<tcf::WorkOrderData> in_wo_data;
+    std::vector<tcf::WorkOrderData> out_wo_data;
+    in_wo_data.push_back(std::move(in_item));
+    out_wo_data.emplace_back(0, in_wo_data[0].decrypted_data);
+
+    // Hash the output, then encrypt it in its own buffer with the tag
+    // kept apart
+    ByteArray& output = out_wo_data[0].decrypted_data;
+    data = {&output};
+    ByteArray hash = std::move(tcf::crypto::ComputeMessageHashes(data)[0]);
+    uint8_t tag[tcf::crypto::constants::TAG_LEN];
+    skenc::EncryptInPlace(key, iv, output.data(), output.size(), tag);
+
+    // The response hash is taken of the encoded output
+    tcf::crypto::MessageHasher response_hasher;
+    EncodeOutput(output, tag,
+        [&response_hasher](const char* piece, size_t size) {
+            response_hasher.Update((const uint8_t*) piece, size);
+        });
+    response_hasher.Finalize();
+
+    // The output is encoded straight into the response
+    tcf::JsonWriter writer(512 +
+        (output.size() + tcf::crypto::constants::TAG_LEN) * 3 / 2);
+    writer.BeginObject();
+    writer.AddStr("jsonrpc", "2.0", "jsonrpc");
+    writer.AddNumber("id", wo_request.id);
+    writer.BeginObject("result");
+    writer.BeginArray("outData");
+    writer.BeginObject();
+    writer.AddNumber("index", 0);
+    writer.AddStr("dataHash", ByteArrayToHexEncodedString(hash), "dataHash");
+    writer.BeginStr("data");
+    EncodeOutput(output, tag, [&writer](const char* piece, size_t size) {
+        writer.AppendStr(piece, size, "data");
+    });
+    writer.EndStr();
+    writer.EndObject();
+    writer.EndArray();
+    writer.EndObject();
+    writer.EndObject();
+    return writer.Finish();
+}
+
+int
+main(int argc, char** argv)
+{
+    static const size_t sizes[] = {1024, 64 * 1024, 4 * 1024 * 1024};
+    int orders = 20;
+    if (argc > 1) {
+        orders = atoi(argv[1]);
+    }
+    if (orders <= 0) {
+        printf("Usage: %s [number of orders per size]\n", argv[0]);
+        return 1;
+    }
+    int count = 0;
+    int short_responses = 0;
+
+    printf("Work order allocation benchmark, %d orders per size\n", orders);
+    printf("%10s %12s %14s %14s %12s\n", "bytes", "allocations",
+        "MB allocated", "bytes/byte", "orders/s");
+    try {
+        ByteArray key = skenc::GenerateKey();
+        ByteArray iv = skenc::GenerateIV();
+        srand(1);
+        for (size_t size : sizes) {
+            ByteArray input(size);
+            for (size_t i = 0; i < size; i++) {
+                input[i] = rand() & 0xff;
+            }
+            std::string json = CreateRequest(input, key, iv);
+
+            // The first order sets up the thread arena and the crypto
+            // contexts, it is not counted
+            ProcessOrder(json, key, iv);
+            allocations = 0;
+            allocated_bytes = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < orders; i++) {
+                ByteArray response = ProcessOrder(json, key, iv);
+                if (response.size() < size) {
+                    short_responses++;
+                }
+            }
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            double bytes_per_byte = allocated_bytes / (double) orders / size;
+            printf("%10zu %12zu %14.2f %14.2f %12.0f\n", size,
+                allocations / orders,
+                allocated_bytes / (double) orders / 1e6,
+                bytes_per_byte,
+                orders / elapsed.count());
+            if (size >= 64 * 1024 && bytes_per_byte > ALLOCATION_LIMIT) {
+                printf("FAILED: %zu byte orders allocate %.2f bytes per "
+                    "byte, more than %.2f\n", size, bytes_per_byte,
+                    ALLOCATION_LIMIT);
+                count++;
+            }
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: work order exception: %s\n", e.what());
+        count++;
+    }
+    if (short_responses > 0) {
+        printf("FAILED: %d responses are too short\n", short_responses);
+        count++;
+    }
+    return count;
+}  // main()
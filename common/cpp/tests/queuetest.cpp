@@ -0,0 +1,219 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the ready enclave queue of the enclave bridge, enclave_queue.cpp,
+ * with several threads acquiring and releasing enclaves concurrently.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "enclave_queue.h"
+
+namespace queue = tcf::enclave_queue;
+
+static int count = 0;
+
+static void Check(bool passed, const char* what) {
+    if (passed) {
+        printf("PASSED: %s\n", what);
+    } else {
+        printf("FAILED: %s\n", what);
+        ++count;
+    }
+}
+
+// Queue with tcs entries for each of enclaves enclaves
+static void FillQueue(queue::EnclaveQueue& q, int enclaves, int tcs) {
+    for (int t = 0; t < tcs; t++) {
+        for (int e = 0; e < enclaves; e++) {
+            q.push(e);
+        }
+    }
+}
+
+static void TestSingleThread() {
+    printf("Enclave queue test: single thread\n");
+    queue::EnclaveQueue q(3, 3);
+    FillQueue(q, 3, 1);
+    Check(q.depth() == 3, "depth() counts the pushed entries");
+
+    std::vector<int> items;
+    int item;
+    while (q.tryPop(item)) {
+        items.push_back(item);
+    }
+    Check(items.size() == 3 && items[0] == 0 && items[1] == 1 &&
+        items[2] == 2, "entries are popped in FIFO order");
+    Check(q.depth() == 0, "queue is empty");
+
+    auto start = std::chrono::steady_clock::now();
+    bool acquired = q.popUntil(item, start + std::chrono::milliseconds(20));
+    Check(!acquired && std::chrono::steady_clock::now() - start >=
+        std::chrono::milliseconds(20), "popUntil() waits until deadline");
+
+    for (int i : items) {
+        q.release(i, 10);
+    }
+    queue::QueueStats stats = q.getStats();
+    Check(stats.acquireCount == 3 && stats.timeoutCount == 2,
+        "acquires and timeouts are counted");
+    Check(stats.enclaves.size() == 3 &&
+        stats.enclaves[1].acquireCount == 1 &&
+        stats.enclaves[1].busyTimeUs == 10 &&
+        stats.enclaves[1].inUse == 0, "enclave utilization is recorded");
+}
+
+static void TestReadyEnclave() {
+    printf("Enclave queue test: ReadyEnclave\n");
+    queue::EnclaveQueue q(1, 1);
+    FillQueue(q, 1, 1);
+    {
+        queue::ReadyEnclave ready(&q, 0);
+        Check(ready.getIndex() == 0 && q.depth() == 0,
+            "ReadyEnclave acquires an entry");
+
+        bool busy = false;
+        try {
+            queue::ReadyEnclave other(&q, 10);
+        } catch (const tcf::error::SystemBusyError&) {
+            busy = true;
+        }
+        Check(busy, "ReadyEnclave throws SystemBusyError on timeout");
+
+        queue::ReadyEnclave moved(std::move(ready));
+        Check(moved.getIndex() == 0 && q.depth() == 0,
+            "moved ReadyEnclave keeps the entry");
+    }
+    Check(q.depth() == 1, "ReadyEnclave returns the entry once");
+}
+
+static void TestWakeUp() {
+    printf("Enclave queue test: waiter is woken up\n");
+    queue::EnclaveQueue q(1, 1);
+    std::atomic<int> acquired(-1);
+    std::thread waiter([&q, &acquired]() {
+        acquired = q.pop();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    Check(acquired == -1, "pop() waits for an entry");
+    q.push(0);
+    waiter.join();
+    Check(acquired == 0, "push() wakes up a waiting pop()");
+}
+
+static void TestThreads() {
+    const int enclaves = 4;
+    const int tcs = 2;
+    const int threads = 16;
+    const int iterations = 20000;
+    printf("Enclave queue test: %d threads, %d enclaves with %d TCS\n",
+        threads, enclaves, tcs);
+
+    queue::EnclaveQueue q(enclaves * tcs, enclaves);
+    FillQueue(q, enclaves, tcs);
+
+    std::atomic<int> in_use[enclaves];
+    for (int e = 0; e < enclaves; e++) {
+        in_use[e] = 0;
+    }
+    std::atomic<int> overcommitted(0);
+    std::atomic<int> invalid(0);
+    std::atomic<int> timeouts(0);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t]() {
+            for (int i = 0; i < iterations; i++) {
+                int item;
+                // Mix blocking, timed and non blocking acquires
+                bool acquired = true;
+                switch ((t + i) % 3) {
+                case 0:
+                    item = q.pop();
+                    break;
+                case 1:
+                    acquired = q.popUntil(item,
+                        std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(100));
+                    break;
+                default:
+                    acquired = q.tryPop(item);
+                    break;
+                }
+                if (!acquired) {
+                    timeouts++;
+                    continue;
+                }
+                if (item < 0 || item >= enclaves) {
+                    invalid++;
+                    continue;
+                }
+                if (++in_use[item] > tcs) {
+                    overcommitted++;
+                }
+                in_use[item]--;
+                q.release(item, 1);
+            }
+        }));
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    Check(invalid == 0, "only pushed entries are acquired");
+    Check(overcommitted == 0,
+        "no enclave is acquired more often than it has TCS");
+    Check(q.depth() == (size_t) (enclaves * tcs),
+        "all entries are back in the queue");
+
+    queue::QueueStats stats = q.getStats();
+    Check(stats.acquireCount + stats.timeoutCount ==
+        (uint64_t) threads * iterations &&
+        stats.timeoutCount == (uint64_t) timeouts,
+        "every acquire is counted once");
+
+    uint64_t acquires = 0;
+    bool released = true;
+    for (const queue::EnclaveUtilization& e : stats.enclaves) {
+        acquires += e.acquireCount;
+        released = released && e.inUse == 0 && e.busyTimeUs == e.acquireCount;
+    }
+    Check(acquires == stats.acquireCount && released,
+        "every acquired enclave is released");
+
+    int item;
+    int entries = 0;
+    while (q.tryPop(item)) {
+        entries++;
+    }
+    Check(entries == enclaves * tcs, "no entry is lost or duplicated");
+}
+
+int
+main(void)
+{
+    TestSingleThread();
+    TestReadyEnclave();
+    TestWakeUp();
+    TestThreads();
+    return count;
+}  // main()
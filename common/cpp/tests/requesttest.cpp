@@ -0,0 +1,249 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test work order request parsing in work_order_request.cpp.
+ */
+
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "base64.h"      // base64_encode(), base64_decode()
+#include "error.h"       // tcf::error
+#include "work_order_request.h"
+
+namespace request = tcf::work_order_request;
+
+static const char* REQUEST =
+    "{\"jsonrpc\": \"2.0\", \"method\": \"WorkOrderSubmit\", \"id\": 11,\n"
+    " \"params\": {\"responseTimeoutMSecs\": 6000,\n"
+    "  \"payloadFormat\": \"JSON-RPC\", \"resultUri\": \"\",\n"
+    "  \"workOrderId\": \"0x1234\", \"workerId\": \"w1\",\n"
+    "  \"workloadId\": \"6563686f2d726573756c74\",\n"
+    "  \"requesterId\": \"0x3456\", \"workerEncryptionKey\": \"\",\n"
+    "  \"dataEncryptionAlgorithm\": \"AES-GCM-256\",\n"
+    "  \"encryptedSessionKey\": \"ABCD\", \"sessionKeyIv\": \"0102\",\n"
+    "  \"requesterNonce\": \"nonce\", \"encryptedRequestHash\": \"EF\",\n"
+    "  \"requesterSignature\": \"c2ln\\/bmF0dXJl\",\n"
+    "  \"verifyingKey\": \"-----BEGIN PUBLIC KEY-----\\nMFkw\\n\",\n"
+    "  \"inData\": [{\"index\": 0, \"dataHash\": \"AA\", \"data\": \"SGk=\",\n"
+    "      \"encryptedDataEncryptionKey\": \"-\", \"iv\": \"\"},\n"
+    "    {\"index\": 1, \"dataStreamSize\": 1.5e3, \"dataHash\": \"\"}],\n"
+    "  \"outData\": []}}\n";
+
+static bool SameRef(const request::StringRef& a, const request::StringRef& b) {
+    if (a.IsMissing() || b.IsMissing()) {
+        return a.IsMissing() && b.IsMissing();
+    }
+    return request::GetString(a) == request::GetString(b);
+}
+
+static bool SameItems(const tcf::ArenaVector<request::DataItem>& a,
+    const tcf::ArenaVector<request::DataItem>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].index != b[i].index ||
+                a[i].data_stream_size != b[i].data_stream_size ||
+                !SameRef(a[i].data_hash, b[i].data_hash) ||
+                !SameRef(a[i].data, b[i].data) ||
+                !SameRef(a[i].encrypted_data_encryption_key,
+                    b[i].encrypted_data_encryption_key) ||
+                !SameRef(a[i].iv, b[i].iv)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool SameRequest(const request::WorkOrderRequest& a,
+    const request::WorkOrderRequest& b) {
+    return a.id == b.id &&
+        a.response_timeout_msecs == b.response_timeout_msecs &&
+        SameRef(a.payload_format, b.payload_format) &&
+        SameRef(a.verifying_key, b.verifying_key) &&
+        SameRef(a.result_uri, b.result_uri) &&
+        SameRef(a.notify_uri, b.notify_uri) &&
+        SameRef(a.work_order_id, b.work_order_id) &&
+        SameRef(a.worker_id, b.worker_id) &&
+        SameRef(a.workload_id, b.workload_id) &&
+        SameRef(a.requester_id, b.requester_id) &&
+        SameRef(a.worker_encryption_key, b.worker_encryption_key) &&
+        SameRef(a.data_encryption_algorithm, b.data_encryption_algorithm) &&
+        SameRef(a.encrypted_session_key, b.encrypted_session_key) &&
+        SameRef(a.session_key_iv, b.session_key_iv) &&
+        SameRef(a.requester_nonce, b.requester_nonce) &&
+        SameRef(a.encrypted_request_hash, b.encrypted_request_hash) &&
+        SameRef(a.requester_signature, b.requester_signature) &&
+        SameItems(a.in_data, b.in_data) &&
+        SameItems(a.out_data, b.out_data);
+}
+
+int
+main(void)
+{
+    int  count = 0;
+
+    printf("Request scan test: ScanRequest()/ParseRequestDocument()\n");
+    try {
+        request::WorkOrderRequest scanned;
+        request::WorkOrderRequest parsed;
+        bool is_scanned = request::ScanRequest(REQUEST, scanned);
+        request::ParseRequestDocument(REQUEST, parsed);
+        if (!is_scanned) {
+            printf("FAILED: ScanRequest() did not scan the request\n");
+            ++count;
+        } else if (!SameRequest(scanned, parsed)) {
+            printf("FAILED: ScanRequest() differs from parson\n");
+            ++count;
+        } else if (scanned.id != 11 || scanned.in_data.size() != 2 ||
+                scanned.in_data[1].data_stream_size != 1500 ||
+                !scanned.notify_uri.IsMissing() ||
+                scanned.result_uri.IsMissing() ||
+                request::GetString(scanned.verifying_key) !=
+                    "-----BEGIN PUBLIC KEY-----\nMFkw\n" ||
+                request::GetString(scanned.requester_signature) !=
+                    "c2ln/bmF0dXJl") {
+            printf("FAILED: ScanRequest() values mismatch\n");
+            ++count;
+        } else {
+            printf("PASSED: ScanRequest()\n");
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: ScanRequest() exception: %s\n", e.what());
+        ++count;
+    }
+
+    // Requests which are left to parson, with its result
+    const char* others[] = {
+        // Unknown member
+        "{\"id\": 1, \"params\": {\"workerId\": \"w\", \"extra\": 1}}",
+        // Escape this parson does not decode, it fails
+        "{\"id\": 2, \"params\": {\"workerId\": \"\\u0041\"}}",
+        // Duplicate member, parson fails
+        "{\"id\": 3, \"params\": {\"workerId\": \"a\", \"workerId\": \"b\"}}",
+        // Number parson fails on
+        "{\"id\": 0e1, \"params\": {}}",
+        // Value of another type
+        "{\"id\": \"4\", \"params\": {\"workerId\": null}}",
+        // Missing params, parson path throws
+        "{\"id\": 5}",
+        // Trailing characters, which parson ignores
+        "{\"id\": 6, \"params\": {\"workerId\": \"w\"}} x",
+        // Not JSON
+        "{\"id\": 7, \"params\": {",
+    };
+    const bool parson_accepts[] = {
+        true, false, false, false, true, false, true, false
+    };
+    printf("Request fallback test: ParseRequest()\n");
+    for (size_t i = 0; i < sizeof(others) / sizeof(others[0]); i++) {
+        request::WorkOrderRequest scanned;
+        if (request::ScanRequest(others[i], scanned)) {
+            printf("FAILED: ScanRequest() scanned request %zu\n", i);
+            ++count;
+            continue;
+        }
+        try {
+            request::WorkOrderRequest parsed = request::ParseRequest(
+                others[i]);
+            if (!parson_accepts[i]) {
+                printf("FAILED: ParseRequest() accepted request %zu\n", i);
+                ++count;
+            } else if (!parsed.document ||
+                    (request::GetString(parsed.worker_id) != "w" &&
+                    !parsed.worker_id.IsMissing())) {
+                printf("FAILED: ParseRequest() request %zu mismatch\n", i);
+                ++count;
+            } else {
+                printf("PASSED: ParseRequest() request %zu\n", i);
+            }
+        } catch (const tcf::error::ValueError& e) {
+            if (parson_accepts[i]) {
+                printf("FAILED: ParseRequest() request %zu exception: %s\n",
+                    i, e.what());
+                ++count;
+            } else {
+                printf("PASSED: ParseRequest() request %zu rejected\n", i);
+            }
+        }
+    }
+
+    printf("Request string test: GetString()\n");
+    try {
+        request::StringRef missing;
+        request::GetString(missing, "missing member");
+        printf("FAILED: GetString() did not throw\n");
+        ++count;
+    } catch (const tcf::error::ValueError& e) {
+        if (request::GetString(request::StringRef()) == "") {
+            printf("PASSED: GetString()\n");
+        } else {
+            printf("FAILED: GetString() of missing member not empty\n");
+            ++count;
+        }
+    }
+
+    // Base64 data with '/' escaped, as parson and JsonWriter write it,
+    // longer than the chunks GetBase64() decodes escaped strings in
+    printf("Request string test: ForEachStringPiece()/GetBase64()\n");
+    srand(1);
+    for (size_t size : {0, 1, 1000, 3071, 3072, 3073, 20000}) {
+        ByteArray data(size);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = rand() & 0xff;
+        }
+        std::string encoded = base64_encode(data);
+        std::string escaped;
+        for (char c : encoded) {
+            if (c == '/') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        // Invalid character, where decoding stops
+        std::string invalid = escaped + "\\n" + escaped;
+
+        for (const std::string* value : {&encoded, &escaped, &invalid}) {
+            request::StringRef ref;
+            ref.data = value->data();
+            ref.size = value->size();
+            ref.escaped = value != &encoded;
+            std::string pieces;
+            size_t pieces_size = request::ForEachStringPiece(ref,
+                [&pieces](const char* piece, size_t length) {
+                    pieces.append(piece, length);
+                });
+            std::string expected = request::GetString(ref);
+            if (pieces != expected || pieces_size != expected.size()) {
+                printf("FAILED: ForEachStringPiece() of %zu bytes\n", size);
+                ++count;
+            } else if (request::GetBase64(ref) != base64_decode(expected)) {
+                printf("FAILED: GetBase64() of %zu bytes\n", size);
+                ++count;
+            } else {
+                printf("PASSED: ForEachStringPiece()/GetBase64() of %zu "
+                    "bytes%s\n", size, value == &invalid ? ", invalid" :
+                    value == &escaped ? ", escaped" : "");
+            }
+        }
+    }
+
+    return count;
+}  // main()
@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <algorithm>
 
 #include "error.h"       // tcf::error
 #include "skenc.h"
@@ -252,6 +253,201 @@ main(void)
         printf("User-seeded IV generation PASSED\n");
     }
 
+    // Test incremental decryption, with pieces which split the
+    // ciphertext and the authentication tag at various places
+    printf("Test AES-GCM stream decryption: StreamDecryptor\n");
+    ByteArray longMsg;
+    for (int i = 0; i < 1000; i++) {
+        longMsg.push_back((uint8_t) (i * 7));
+    }
+    try {
+        ByteArray ctLong = tcf::crypto::skenc::EncryptMessage(
+            key, iv, longMsg);
+        static const size_t piece_sizes[] = {1, 5, 15, 16, 17, 100, 4096};
+        for (size_t piece : piece_sizes) {
+            tcf::crypto::skenc::StreamDecryptor decryptor(key, iv);
+            ByteArray ptLong;
+            for (size_t pos = 0; pos < ctLong.size(); pos += piece) {
+                size_t n = std::min(piece, ctLong.size() - pos);
+                ByteArray pt = decryptor.Update(ctLong.data() + pos, n);
+                ptLong.insert(ptLong.end(), pt.begin(), pt.end());
+            }
+            ByteArray pt = decryptor.Finalize();
+            ptLong.insert(ptLong.end(), pt.begin(), pt.end());
+            if (ptLong != longMsg) {
+                printf("AES-GCM stream decryption test FAILED with "
+                    "%zu byte pieces\n", piece);
+                ++count;
+            }
+        }
+        printf("AES-GCM stream decryption test PASSED\n");
+
+        ctLong[ctLong.size() / 2]++;
+        tcf::crypto::skenc::StreamDecryptor decryptor(key, iv);
+        decryptor.Update(ctLong.data(), ctLong.size());
+        decryptor.Finalize();
+        printf("AES-GCM stream decryption test FAILED; "
+            "ciphertext tampering undetected.\n");
+        ++count;
+    } catch (const tcf::error::CryptoError& e) {
+        printf("AES-GCM stream decryption PASSED; ciphertext tampering "
+            "detected\n");
+    } catch (const std::exception& e) {
+        printf("AES-GCM stream decryption test FAILED\n%s\n", e.what());
+        ++count;
+    }
+
+    try {
+        tcf::crypto::skenc::StreamDecryptor decryptor(key, iv);
+        decryptor.Update(ctAES.data(), tcf::crypto::constants::TAG_LEN - 1);
+        decryptor.Finalize();
+        printf("AES-GCM stream decryption test FAILED; "
+            "invalid ciphertext size undetected.\n");
+        ++count;
+    } catch (const tcf::error::ValueError& e) {
+        printf("AES-GCM stream decryption PASSED; "
+            "invalid ciphertext size detected\n");
+    } catch (const std::exception& e) {
+        printf("AES-GCM stream decryption test FAILED\n%s\n", e.what());
+        ++count;
+    }
+
+    // Test incremental encryption gives the same ciphertext and tag as
+    // EncryptMessage, whatever the piece size
+    printf("Test AES-GCM stream encryption: StreamEncryptor\n");
+    try {
+        ByteArray ctLong = tcf::crypto::skenc::EncryptMessage(
+            key, iv, longMsg);
+        static const size_t piece_sizes[] = {1, 5, 15, 16, 17, 100, 4096};
+        bool passed = true;
+        for (size_t piece : piece_sizes) {
+            tcf::crypto::skenc::StreamEncryptor encryptor(key, iv);
+            ByteArray ctStream;
+            for (size_t pos = 0; pos < longMsg.size(); pos += piece) {
+                size_t n = std::min(piece, longMsg.size() - pos);
+                ByteArray ct = encryptor.Update(longMsg.data() + pos, n);
+                ctStream.insert(ctStream.end(), ct.begin(), ct.end());
+            }
+            ByteArray ct = encryptor.Finalize();
+            ctStream.insert(ctStream.end(), ct.begin(), ct.end());
+            if (ctStream != ctLong) {
+                printf("AES-GCM stream encryption test FAILED with "
+                    "%zu byte pieces\n", piece);
+                passed = false;
+                ++count;
+            }
+        }
+        if (passed) {
+            printf("AES-GCM stream encryption test PASSED\n");
+        }
+    } catch (const std::exception& e) {
+        printf("AES-GCM stream encryption test FAILED\n%s\n", e.what());
+        ++count;
+    }
+
+    // Test in place encryption gives the same ciphertext and tag as
+    // EncryptMessage and in place decryption restores the message
+    printf("Test AES-GCM in place encryption: EncryptInPlace/DecryptInPlace\n");
+    try {
+        ByteArray ct = tcf::crypto::skenc::EncryptMessage(key, iv, longMsg);
+        ByteArray buf(longMsg);
+        uint8_t tag[tcf::crypto::constants::TAG_LEN];
+        bool passed = true;
+
+        tcf::crypto::skenc::EncryptInPlace(key, iv, buf.data(), buf.size(),
+            tag);
+        if (!std::equal(buf.begin(), buf.end(), ct.begin()) ||
+                !std::equal(tag, tag + tcf::crypto::constants::TAG_LEN,
+                    ct.begin() + buf.size())) {
+            passed = false;
+        }
+
+        tcf::crypto::skenc::DecryptInPlace(key, iv, buf.data(), buf.size(),
+            tag);
+        if (buf != longMsg) {
+            passed = false;
+        }
+
+        tcf::crypto::skenc::EncryptInPlace(key, iv, buf.data(), buf.size(),
+            tag);
+        tag[0] ^= 1;
+        try {
+            tcf::crypto::skenc::DecryptInPlace(key, iv, buf.data(),
+                buf.size(), tag);
+            passed = false;
+        } catch (const tcf::error::CryptoError& e) {
+            // Unauthenticated plaintext must not be left in the buffer
+            if (std::count(buf.begin(), buf.end(), 0) != (long)buf.size()) {
+                passed = false;
+            }
+        }
+
+        try {
+            tcf::crypto::skenc::EncryptInPlace(key, iv, buf.data(), 0, tag);
+            passed = false;
+        } catch (const tcf::error::ValueError& e) {
+            // Expected, like EncryptMessage with an empty message
+        }
+
+        if (passed) {
+            printf("AES-GCM in place encryption test PASSED\n");
+        } else {
+            printf("AES-GCM in place encryption test FAILED\n");
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("AES-GCM in place encryption test FAILED\n%s\n", e.what());
+        ++count;
+    }
+
+    // Test a reused context gives the same results as fresh contexts
+    // when switching keys and directions, and after failures
+    printf("Test AES-GCM context reuse: CipherContext\n");
+    try {
+        tcf::crypto::skenc::CipherContext context;
+        ByteArray key2 = tcf::crypto::skenc::GenerateKey();
+        ByteArray iv2 = tcf::crypto::skenc::GenerateIV();
+        const ByteArray* keys[] = {&key, &key, &key2, &key, &key2, &key2};
+        bool passed = true;
+        for (const ByteArray* k : keys) {
+            tcf::crypto::skenc::StreamEncryptor encryptor(*k, iv2);
+            ByteArray expected = encryptor.Update(msg.data(), msg.size());
+            ByteArray tag = encryptor.Finalize();
+            expected.insert(expected.end(), tag.begin(), tag.end());
+
+            ByteArray ct = context.EncryptMessage(*k, iv2, msg);
+            ByteArray pt = context.DecryptMessage(*k,
+                (const char*)iv2.data(), (const char*)ct.data(), ct.size());
+            if (ct != expected || pt != msg) {
+                passed = false;
+            }
+
+            ct[0] ^= 1;
+            try {
+                context.DecryptMessage(*k, (const char*)iv2.data(),
+                    (const char*)ct.data(), ct.size());
+                passed = false;
+            } catch (const tcf::error::CryptoError& e) {
+                // Expected, the next message must not be affected
+            }
+        }
+        context.Clear();
+        ByteArray ct = context.EncryptMessage(key, iv, msg);
+        if (ct != tcf::crypto::skenc::EncryptMessage(key, iv, msg)) {
+            passed = false;
+        }
+
+        if (passed) {
+            printf("AES-GCM context reuse test PASSED\n");
+        } else {
+            printf("AES-GCM context reuse test FAILED\n");
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("AES-GCM context reuse test FAILED\n%s\n", e.what());
+        ++count;
+    }
+
     // Summarize
     if (count == 0) {
         printf("Secret key encryption tests PASSED.\n");
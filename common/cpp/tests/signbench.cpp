@@ -0,0 +1,128 @@
+/*
+ * Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark ECDSA Secp256k1 signing of work order response hashes with
+ * sig::PrivateKey::SignMessage() and with sig::Signer::SignMessage().
+ *
+ * Usage: signbench [number of signatures]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "crypto_shared.h" // Sets default CRYPTOLIB_* value
+#include "error.h"           // tcf::error
+#include "crypto_utils.h"    // ComputeMessageHash()
+#include "sig_private_key.h"
+#include "sig_public_key.h"
+#include "sig_signer.h"
+
+// Number of rounds each way of signing is measured, alternating between
+// them so that both see the same load of the machine
+#define ROUNDS 5
+
+// Signs all hashes with sign and returns the signatures per second
+template <typename SignFunction>
+static double Measure(const std::vector<ByteArray>& hashes,
+        std::vector<ByteArray>& signatures, SignFunction sign) {
+    signatures.clear();
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& hash : hashes) {
+        signatures.push_back(sign(hash));
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return hashes.size() / elapsed.count();
+}
+
+// Returns the number of signatures that do not verify
+static int CountInvalid(const tcf::crypto::sig::PublicKey& public_key,
+        const std::vector<ByteArray>& hashes,
+        const std::vector<ByteArray>& signatures) {
+    int invalid = 0;
+    for (size_t i = 0; i < hashes.size(); i++) {
+        if (public_key.VerifySignature(hashes[i], signatures[i]) != 1) {
+            invalid++;
+        }
+    }
+    return invalid;
+}
+
+int
+main(int argc, char** argv)
+{
+    int count = 0;
+    int num_signatures = 1000;
+    if (argc > 1) {
+        num_signatures = atoi(argv[1]);
+    }
+    if (num_signatures <= 0) {
+        printf("Usage: %s [number of signatures]\n", argv[0]);
+        return 1;
+    }
+
+    try {
+        tcf::crypto::sig::PrivateKey private_key;
+        private_key.Generate();
+        tcf::crypto::sig::PublicKey public_key(private_key);
+
+        std::vector<ByteArray> hashes;
+        for (int i = 0; i < num_signatures; i++) {
+            ByteArray message(sizeof(i));
+            memcpy(message.data(), &i, sizeof(i));
+            hashes.push_back(tcf::crypto::ComputeMessageHash(message));
+        }
+        std::vector<ByteArray> signatures;
+
+        printf("ECDSA Secp256k1 signing benchmark, %d signatures, "
+            "best of %d rounds.\n", num_signatures, ROUNDS);
+
+        tcf::crypto::sig::Signer signer(private_key);
+        std::vector<ByteArray> key_signatures;
+        double key_rate = 0;
+        double signer_rate = 0;
+        for (int i = 0; i < ROUNDS; i++) {
+            key_rate = std::max(key_rate, Measure(hashes, key_signatures,
+                [&private_key](const ByteArray& hash) {
+                    return private_key.SignMessage(hash);
+                }));
+            signer_rate = std::max(signer_rate, Measure(hashes, signatures,
+                [&signer](const ByteArray& hash) {
+                    return signer.SignMessage(hash);
+                }));
+        }
+        count += CountInvalid(public_key, hashes, key_signatures);
+        count += CountInvalid(public_key, hashes, signatures);
+        printf("PrivateKey::SignMessage: %10.1f signatures/s\n", key_rate);
+        printf("Signer::SignMessage:     %10.1f signatures/s (%.2fx)\n",
+            signer_rate, signer_rate / key_rate);
+    } catch (const tcf::error::Error& e) {
+        printf("Signing benchmark FAILED:\n%s\n", e.what());
+        return 1;
+    }
+
+    if (count == 0) {
+        printf("Signing benchmark PASSED.\n");
+    } else {
+        printf("Signing benchmark FAILED, %d invalid signatures.\n", count);
+    }
+    return count;
+}
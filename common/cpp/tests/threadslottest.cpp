@@ -0,0 +1,102 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the per-TCS slots in thread_slot.cpp, with ENCLAVE_TCS_NUM threads
+ * standing in for the TCS of an enclave.
+ */
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "error.h"
+#include "thread_slot.h"
+
+static int count = 0;
+
+static void Check(bool passed, const char* what) {
+    if (passed) {
+        printf("PASSED: %s\n", what);
+    } else {
+        printf("FAILED: %s\n", what);
+        ++count;
+    }
+}
+
+static tcf::ThreadSlots<int> values;
+
+int
+main(void)
+{
+    printf("Thread slot test: %d slots\n", ENCLAVE_TCS_NUM);
+
+    size_t main_slot = tcf::GetThreadSlot();
+    Check(main_slot < ENCLAVE_TCS_NUM, "slot is in range");
+    Check(tcf::GetThreadSlot() == main_slot, "thread keeps its slot");
+    int* main_value = &values.Get();
+    *main_value = 1;
+
+    // Claim the other slots from threads which are kept running, thread
+    // identifiers are reused once threads end
+    std::atomic<int> claimed(0);
+    std::atomic<bool> done(false);
+    std::atomic<bool> distinct(true);
+    std::atomic<bool> separate_values(true);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < ENCLAVE_TCS_NUM; i++) {
+        threads.emplace_back([&]() {
+            size_t slot = tcf::GetThreadSlot();
+            if (slot == main_slot || slot >= ENCLAVE_TCS_NUM ||
+                    tcf::GetThreadSlot() != slot) {
+                distinct = false;
+            }
+            if (&values.Get() == main_value) {
+                separate_values = false;
+            }
+            values.Get() = 2;
+            claimed++;
+            while (!done) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (claimed < ENCLAVE_TCS_NUM - 1) {
+        std::this_thread::yield();
+    }
+    Check(distinct, "threads claim distinct slots");
+    Check(separate_values && *main_value == 1,
+        "threads use the value of their slot");
+
+    bool thrown = false;
+    std::thread extra([&]() {
+        try {
+            tcf::GetThreadSlot();
+        } catch (tcf::error::RuntimeError&) {
+            thrown = true;
+        }
+    });
+    extra.join();
+    Check(thrown, "no slot for more threads than ENCLAVE_TCS_NUM");
+
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Check(tcf::GetThreadSlot() == main_slot, "claimed slot is still found");
+
+    return count;
+}  // main()
@@ -27,6 +27,7 @@
 
 #include <stdexcept>
 #include <stdio.h>
+#include <vector>
 
 #include "crypto_utils.h"
 #include "error.h"       // tcf::error
@@ -75,6 +76,45 @@ main(void)
         ++count;
     }
 
+    // CTR_DRBG AES-256 without derivation function known answer test:
+    // entropy input 000102...2F, no personalization string or additional
+    // input, output of the second request of 70 bytes. Generated with the
+    // CTR-DRBG of OpenSSL 3.0 EVP_RAND, using use_derivation_function=0
+    // and an empty personalization string.
+    printf("Random generator test: RandomGenerator\n");
+    try {
+        static const char* drbg_expected = "3085765770296056678AE5E70137324F"
+            "6CC0DACA6E11275A42584426ED476DAFECB40DC217E9F371279DA5434F223101"
+            "B35A5A11F541125658E4B5DC1E223C7A068A82D0376A";
+        ByteArray entropy;
+        for (int i = 0; i < tcf::crypto::constants::DRBG_SEED_LEN; i++) {
+            entropy.push_back((uint8_t) i);
+        }
+        tcf::crypto::RandomGenerator generator;
+        generator.Seed(entropy);
+        generator.RandomBitString(70);
+        std::string drbg_output =
+            ByteArrayToHexEncodedString(generator.RandomBitString(70));
+
+        ByteArray thread_random =
+            tcf::crypto::GetThreadRandomGenerator().RandomBitString(
+                rand_length);
+        if (drbg_output != drbg_expected) {
+            printf("FAILED: RandomGenerator known answer mismatch:\n%s\n",
+                drbg_output.c_str());
+            ++count;
+        } else if (thread_random.size() != rand_length ||
+                thread_random == ByteArray(rand_length)) {
+            printf("FAILED: GetThreadRandomGenerator()\n");
+            ++count;
+        } else {
+            printf("PASSED: RandomGenerator\n");
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: RandomGenerator:\n%s\n", e.what());
+        ++count;
+    }
+
     for (hash_test_type *tp = hash_test_cases; tp->encoded != nullptr; ++tp) {
         printf("Hash SHA-256 test: ComputeMessageHash()\n");
         std::string msgStr(tp->plain);
@@ -92,6 +132,57 @@ main(void)
         }
     }
 
+    printf("Hash SHA-256 test: MessageHasher\n");
+    try {
+        tcf::crypto::MessageHasher hasher;
+        std::string msgStr(hash_test_cases[0].plain);
+        for (size_t pos = 0; pos < msgStr.size(); pos += 5) {
+            hasher.Update(msgStr.substr(pos, 5));
+        }
+        std::string hashStr_B64 = base64_encode(hasher.Finalize());
+        // The hasher is reset by Finalize()
+        std::string emptyStr_B64 = base64_encode(hasher.Finalize());
+        if (hashStr_B64.compare(hash_test_cases[0].encoded) != 0 ||
+                emptyStr_B64.compare(hash_test_cases[1].encoded) != 0) {
+            printf("FAILED: MessageHasher: SHA256 digest mismatch.\n");
+            ++count;
+        } else {
+            printf("PASSED: MessageHasher\n");
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: MessageHasher:\n%s\n", e.what());
+        ++count;
+    }
+
+    printf("Hash SHA-256 test: ComputeMessageHashes()\n");
+    try {
+        // Lengths around the block boundaries, with a few long messages
+        // hashed one by one in between
+        std::vector<ByteArray> messages;
+        for (size_t length = 0; length < 200; length++) {
+            messages.push_back(ByteArray(length, (uint8_t) length));
+            if (length % 50 == 0) {
+                messages.push_back(ByteArray(5000 + length, 0xa5));
+            }
+        }
+        std::vector<ByteArray> hashes =
+            tcf::crypto::ComputeMessageHashes(messages);
+        is_ok = hashes.size() == messages.size();
+        for (size_t i = 0; is_ok && i < messages.size(); i++) {
+            is_ok = hashes[i] == tcf::crypto::ComputeMessageHash(messages[i]);
+        }
+        if (is_ok) {
+            printf("PASSED: ComputeMessageHashes()\n");
+        } else {
+            printf("FAILED: ComputeMessageHashes(): "
+                "SHA256 digest mismatch.\n");
+            ++count;
+        }
+    } catch (const std::exception& e) {
+        printf("FAILED: ComputeMessageHashes():\n%s\n", e.what());
+        ++count;
+    }
+
 
     // Key generation test: CreateHexEncodedEncryptionKey()
     // examples/apps/simple_wallet/workload/simple_wallet_execute_io.cpp
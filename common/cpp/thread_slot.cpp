@@ -0,0 +1,64 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <atomic>
+
+#ifdef _UNTRUSTED_
+#include <pthread.h>     // pthread_self()
+#else
+#include <sgx_thread.h>  // sgx_thread_self()
+#endif
+
+#include "error.h"
+#include "thread_slot.h"
+
+namespace tcf {
+
+    // Thread owning each slot, 0 while the slot is free
+    static std::atomic<uintptr_t> slot_owners[ENCLAVE_TCS_NUM];
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Identifies the calling thread. The thread data of a TCS, which
+    // sgx_thread_self() returns, is at the same address on every ecall.
+    static uintptr_t GetThreadIdentifier() {
+#ifdef _UNTRUSTED_
+        return (uintptr_t) pthread_self();
+#else
+        return (uintptr_t) sgx_thread_self();
+#endif
+    }  // GetThreadIdentifier
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    size_t GetThreadSlot() {
+        uintptr_t self = GetThreadIdentifier();
+        for (size_t i = 0; i < ENCLAVE_TCS_NUM; i++) {
+            if (slot_owners[i].load(std::memory_order_acquire) == self) {
+                return i;
+            }
+        }
+
+        for (size_t i = 0; i < ENCLAVE_TCS_NUM; i++) {
+            uintptr_t free_slot = 0;
+            if (slot_owners[i].compare_exchange_strong(free_slot, self,
+                    std::memory_order_acq_rel)) {
+                return i;
+            }
+        }
+
+        throw tcf::error::RuntimeError(
+            "More threads than ENCLAVE_TCS_NUM use thread slots");
+    }  // GetThreadSlot
+}  // namespace tcf
@@ -0,0 +1,74 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon state kept by the threads of an enclave from one ecall to the
+ * next.
+ *
+ * The enclaves are signed with TCSPolicy 1, under which the SGX runtime
+ * sets up the thread local storage of a TCS again on every ecall, without
+ * running destructors. A thread_local object is constructed anew for each
+ * ecall and what it allocated is lost. State a TCS keeps across ecalls is
+ * held in ThreadSlots instead, which have one slot for each TCS of the
+ * enclave.
+ *
+ * Threads outside of enclaves keep their thread local storage, and are
+ * not limited in number, they use thread_local objects.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Number of TCS the enclave is signed with, see ENCLAVE_TCS_NUM in
+// CMakeVariables.txt
+#ifndef ENCLAVE_TCS_NUM
+#define ENCLAVE_TCS_NUM 2
+#endif
+
+namespace tcf {
+    /**
+     * Returns the slot of the calling thread, less than ENCLAVE_TCS_NUM.
+     * A thread claims a free slot the first time and keeps it for the
+     * lifetime of the enclave, a TCS always runs as the same thread.
+     * Throws RuntimeError if all slots are claimed by other threads.
+     */
+    size_t GetThreadSlot();
+
+    /**
+     * One T for each slot, constructed with the ThreadSlots and destroyed
+     * with it. Each T is only used by the thread of its slot.
+     */
+    template<typename T>
+    class ThreadSlots {
+    public:
+        ThreadSlots() {}
+
+        /**
+         * Returns the T of the calling thread.
+         * Throws RuntimeError, see GetThreadSlot().
+         */
+        T& Get() {
+            return slots_[GetThreadSlot()];
+        }
+
+    private:
+        ThreadSlots(const ThreadSlots&);
+        ThreadSlots& operator=(const ThreadSlots&);
+
+        T slots_[ENCLAVE_TCS_NUM];
+    };  // class ThreadSlots
+}  // namespace tcf
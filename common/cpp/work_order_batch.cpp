@@ -0,0 +1,139 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon encoding of work order request and response batches.
+ */
+
+#include "error.h"
+#include "work_order_batch.h"
+
+namespace tcf {
+    namespace work_order_batch {
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static void AppendUint32(ByteArray& batch, uint32_t value) {
+            batch.push_back(value & 0xFF);
+            batch.push_back((value >> 8) & 0xFF);
+            batch.push_back((value >> 16) & 0xFF);
+            batch.push_back((value >> 24) & 0xFF);
+        }  // AppendUint32
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static void AppendSize(ByteArray& batch, size_t size) {
+            tcf::error::ThrowIf<tcf::error::ValueError>(
+                size > UINT32_MAX,
+                "Work order batch item is too large");
+            AppendUint32(batch, (uint32_t) size);
+        }  // AppendSize
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static uint32_t ReadUint32(
+            const uint8_t* batch, size_t batch_size, size_t& offset) {
+            tcf::error::ThrowIf<tcf::error::ValueError>(
+                batch_size - offset < sizeof(uint32_t),
+                "Work order batch is truncated");
+            uint32_t value = (uint32_t) batch[offset] |
+                ((uint32_t) batch[offset + 1] << 8) |
+                ((uint32_t) batch[offset + 2] << 16) |
+                ((uint32_t) batch[offset + 3] << 24);
+            offset += sizeof(uint32_t);
+            return value;
+        }  // ReadUint32
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static const uint8_t* ReadBytes(
+            const uint8_t* batch, size_t batch_size, size_t& offset,
+            size_t size) {
+            tcf::error::ThrowIf<tcf::error::ValueError>(
+                batch_size - offset < size,
+                "Work order batch is truncated");
+            const uint8_t* bytes = batch + offset;
+            offset += size;
+            return bytes;
+        }  // ReadBytes
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        void AppendRequest(
+            ByteArray& batch,
+            const ByteArray& request,
+            const ByteArray& ext_data) {
+            AppendSize(batch, request.size());
+            AppendSize(batch, ext_data.size());
+            batch.insert(batch.end(), request.begin(), request.end());
+            batch.insert(batch.end(), ext_data.begin(), ext_data.end());
+        }  // AppendRequest
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        std::vector<RequestItem> ParseRequests(
+            const uint8_t* batch,
+            size_t batch_size) {
+            std::vector<RequestItem> items;
+            size_t offset = 0;
+
+            tcf::error::ThrowIf<tcf::error::ValueError>(
+                batch == nullptr && batch_size > 0,
+                "Work order batch pointer is NULL");
+            while (offset < batch_size) {
+                RequestItem item;
+                item.request_size = ReadUint32(batch, batch_size, offset);
+                item.ext_data_size = ReadUint32(batch, batch_size, offset);
+                item.request = ReadBytes(batch, batch_size, offset,
+                    item.request_size);
+                item.ext_data = ReadBytes(batch, batch_size, offset,
+                    item.ext_data_size);
+                items.push_back(item);
+            }
+
+            return items;
+        }  // ParseRequests
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        void AppendResponse(
+            ByteArray& batch,
+            tcf_err_t status,
+            const ByteArray& response) {
+            AppendUint32(batch, (uint32_t) status);
+            AppendSize(batch, response.size());
+            batch.insert(batch.end(), response.begin(), response.end());
+        }  // AppendResponse
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        std::vector<ResponseItem> ParseResponses(
+            const uint8_t* batch,
+            size_t batch_size) {
+            std::vector<ResponseItem> items;
+            size_t offset = 0;
+
+            tcf::error::ThrowIf<tcf::error::ValueError>(
+                batch == nullptr && batch_size > 0,
+                "Work order batch pointer is NULL");
+            while (offset < batch_size) {
+                ResponseItem item;
+                item.status = (tcf_err_t) (int32_t) ReadUint32(
+                    batch, batch_size, offset);
+                size_t response_size = ReadUint32(batch, batch_size, offset);
+                const uint8_t* response = ReadBytes(batch, batch_size,
+                    offset, response_size);
+                item.response.assign(response, response + response_size);
+                items.push_back(item);
+            }
+
+            return items;
+        }  // ParseResponses
+
+    }  // namespace work_order_batch
+}  // namespace tcf
@@ -0,0 +1,92 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon encoding of work order request and response batches, which are
+ * passed to and from the enclave in one call.
+ *
+ * A request batch is a sequence of items, each of them being
+ *     uint32 request size, uint32 extended data size,
+ *     request bytes, extended data bytes
+ * A response batch is a sequence of items, each of them being
+ *     int32 status (tcf_err_t), uint32 response size, response bytes
+ * Integers are encoded little endian.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "tcf_error.h"
+#include "types.h"
+
+namespace tcf {
+    namespace work_order_batch {
+
+        /** Request of a batch, points into the batch buffer */
+        struct RequestItem {
+            const uint8_t* request;
+            size_t request_size;
+            const uint8_t* ext_data;
+            size_t ext_data_size;
+        };
+
+        /** Response of a batch */
+        struct ResponseItem {
+            tcf_err_t status;
+            ByteArray response;
+        };
+
+        /**
+         * Append a serialized work order request and its extended work
+         * order data to a request batch.
+         * Throws ValueError if either is larger than UINT32_MAX bytes.
+         */
+        void AppendRequest(
+            ByteArray& batch,
+            const ByteArray& request,
+            const ByteArray& ext_data);
+
+        /**
+         * Split a request batch into its items without copying them.
+         * Throws ValueError if the batch is malformed.
+         */
+        std::vector<RequestItem> ParseRequests(
+            const uint8_t* batch,
+            size_t batch_size);
+
+        /**
+         * Append the status and serialized response of a work order to a
+         * response batch.
+         * Throws ValueError if the response is larger than UINT32_MAX
+         * bytes.
+         */
+        void AppendResponse(
+            ByteArray& batch,
+            tcf_err_t status,
+            const ByteArray& response);
+
+        /**
+         * Split a response batch into its items.
+         * Throws ValueError if the batch is malformed.
+         */
+        std::vector<ResponseItem> ParseResponses(
+            const uint8_t* batch,
+            size_t batch_size);
+
+    }  // namespace work_order_batch
+}  // namespace tcf
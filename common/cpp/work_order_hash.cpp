@@ -0,0 +1,70 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon work order request and response hashes.
+ */
+
+#include "work_order_hash.h"
+
+namespace tcf {
+    namespace work_order_hash {
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        ByteArray ComputeIdHash(
+            const std::string& nonce,
+            const std::string& work_order_id,
+            const std::string& worker_id,
+            const std::string& workload_id,
+            const std::string& requester_id) {
+            tcf::crypto::MessageHasher hasher;
+            hasher.Update(nonce);
+            hasher.Update(work_order_id);
+            hasher.Update(worker_id);
+            hasher.Update(workload_id);
+            hasher.Update(requester_id);
+            return hasher.Finalize();
+        }  // ComputeIdHash
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        size_t UpdateDataItemHash(
+            tcf::crypto::MessageHasher& hasher,
+            const std::string& data_hash,
+            const std::string& data,
+            const std::string& encrypted_data_key,
+            const std::string& iv) {
+            hasher.Update(data_hash);
+            hasher.Update(data);
+            hasher.Update(encrypted_data_key);
+            hasher.Update(iv);
+            return data_hash.size() + data.size() +
+                encrypted_data_key.size() + iv.size();
+        }  // UpdateDataItemHash
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        ByteArray ComputeFinalHash(
+            const ByteArray& id_hash,
+            const ByteArray& in_data_hash,
+            const ByteArray& out_data_hash) {
+            tcf::crypto::MessageHasher hasher;
+            hasher.Update(id_hash);
+            hasher.Update(in_data_hash);
+            hasher.Update(out_data_hash);
+            return hasher.Finalize();
+        }  // ComputeFinalHash
+
+    }  // namespace work_order_hash
+}  // namespace tcf
@@ -0,0 +1,75 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon work order request and response hashes, computed by passing
+ * their fields to SHA-256 one after the other instead of concatenating
+ * them first.
+ *
+ * The hash of a request or response is
+ *     SHA256(SHA256(nonce || workOrderId || workerId || workloadId ||
+ *                   requesterId) ||
+ *            SHA256(inData items) || SHA256(outData items))
+ * where nonce is the requester nonce of a request and the worker nonce of
+ * a response, which has no inData part. The data items are concatenated
+ * in index order, each of them as
+ *     dataHash || data || encryptedDataEncryptionKey || iv
+ * The hash of the inData or outData items is left out if the items add up
+ * to nothing.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "crypto_utils.h"
+#include "types.h"
+
+namespace tcf {
+    namespace work_order_hash {
+
+        /**
+         * Hash of the fields identifying the work order.
+         */
+        ByteArray ComputeIdHash(
+            const std::string& nonce,
+            const std::string& work_order_id,
+            const std::string& worker_id,
+            const std::string& workload_id,
+            const std::string& requester_id);
+
+        /**
+         * Pass the fields of a data item to the hash of its data items.
+         * Returns the number of bytes passed.
+         */
+        size_t UpdateDataItemHash(
+            tcf::crypto::MessageHasher& hasher,
+            const std::string& data_hash,
+            const std::string& data,
+            const std::string& encrypted_data_key,
+            const std::string& iv);
+
+        /**
+         * Hash of the work order from the hash of its identifying fields
+         * and the hashes of its data items, which are empty if left out.
+         */
+        ByteArray ComputeFinalHash(
+            const ByteArray& id_hash,
+            const ByteArray& in_data_hash,
+            const ByteArray& out_data_hash);
+
+    }  // namespace work_order_hash
+}  // namespace tcf
@@ -0,0 +1,524 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon work order request parsing.
+ *
+ * The scan only accepts requests which parson parses into the same
+ * values. Whatever else it meets, it leaves to parson: unknown or
+ * duplicate members, which parson rejects, values of another type,
+ * \u escapes, which this parson does not support, numbers outside of the
+ * JSON grammar or starting with 0 and an exponent, which parson rejects,
+ * and anything after the request object, which parson ignores.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "base64.h"
+#include "error.h"
+#include "parson.h"
+#include "work_order_request.h"
+
+namespace tcf {
+    namespace work_order_request {
+
+        // Longest array parson parses, see ARRAY_MAX_CAPACITY in parson
+        static const size_t MAX_ARRAY_SIZE = 122880;
+
+        struct StringMember {
+            const char* name;
+            StringRef WorkOrderRequest::* member;
+        };
+
+        // String members of the params object
+        static const StringMember PARAMS_STRINGS[] = {
+            {"payloadFormat", &WorkOrderRequest::payload_format},
+            {"verifyingKey", &WorkOrderRequest::verifying_key},
+            {"resultUri", &WorkOrderRequest::result_uri},
+            {"notifyUri", &WorkOrderRequest::notify_uri},
+            {"workOrderId", &WorkOrderRequest::work_order_id},
+            {"workerId", &WorkOrderRequest::worker_id},
+            {"workloadId", &WorkOrderRequest::workload_id},
+            {"requesterId", &WorkOrderRequest::requester_id},
+            {"workerEncryptionKey", &WorkOrderRequest::worker_encryption_key},
+            {"dataEncryptionAlgorithm",
+                &WorkOrderRequest::data_encryption_algorithm},
+            {"encryptedSessionKey", &WorkOrderRequest::encrypted_session_key},
+            {"sessionKeyIv", &WorkOrderRequest::session_key_iv},
+            {"requesterNonce", &WorkOrderRequest::requester_nonce},
+            {"encryptedRequestHash",
+                &WorkOrderRequest::encrypted_request_hash},
+            {"requesterSignature", &WorkOrderRequest::requester_signature}
+        };
+        static const size_t NUM_PARAMS_STRINGS =
+            sizeof(PARAMS_STRINGS) / sizeof(PARAMS_STRINGS[0]);
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static bool NameIs(const StringRef& name, const char* expected) {
+            return strncmp(name.data, expected, name.size) == 0 &&
+                expected[name.size] == '\0';
+        }  // NameIs
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        // Marks member bit of seen, returns false if it was marked already
+        static bool FirstSeen(uint32_t& seen, unsigned int bit) {
+            uint32_t mask = (uint32_t) 1 << bit;
+            if (seen & mask) {
+                return false;
+            }
+            seen |= mask;
+            return true;
+        }  // FirstSeen
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static void SkipWhitespace(const char*& p) {
+            while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') {
+                p++;
+            }
+        }  // SkipWhitespace
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static bool ScanString(const char*& p, StringRef& value) {
+            if (*p != '"') {
+                return false;
+            }
+            const char* start = ++p;
+            bool escaped = false;
+            while (*p != '"') {
+                if (*p == '\\') {
+                    if (!strchr("\"\\/bfnrt", p[1]) || p[1] == '\0') {
+                        return false;
+                    }
+                    escaped = true;
+                    p++;
+                } else if ((unsigned char) *p < 0x20) {
+                    // Control characters, the terminating NUL among them
+                    return false;
+                }
+                p++;
+            }
+            value.data = start;
+            value.size = p - start;
+            value.escaped = escaped;
+            p++;
+            return true;
+        }  // ScanString
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static bool IsDigit(char c) {
+            return c >= '0' && c <= '9';
+        }  // IsDigit
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        // Converted with strtod() like parson does, for the same value
+        static bool ScanNumber(const char*& p, double& value) {
+            const char* q = p;
+            if (*q == '-') {
+                q++;
+            }
+            if (*q == '0') {
+                q++;
+                if (*q == 'e' || *q == 'E') {
+                    return false;
+                }
+            } else if (IsDigit(*q)) {
+                while (IsDigit(*q)) {
+                    q++;
+                }
+            } else {
+                return false;
+            }
+            if (*q == '.') {
+                q++;
+                if (!IsDigit(*q)) {
+                    return false;
+                }
+                while (IsDigit(*q)) {
+                    q++;
+                }
+            }
+            if (*q == 'e' || *q == 'E') {
+                q++;
+                if (*q == '+' || *q == '-') {
+                    q++;
+                }
+                if (!IsDigit(*q)) {
+                    return false;
+                }
+                while (IsDigit(*q)) {
+                    q++;
+                }
+            }
+
+            char* end;
+            value = strtod(p, &end);
+            if (end != q) {
+                return false;
+            }
+            p = q;
+            return true;
+        }  // ScanNumber
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        // Scans an object, passing the name of each member and p at its
+        // value to scan_member, which scans the value
+        template<typename ScanMember>
+        static bool ScanObject(const char*& p, ScanMember scan_member) {
+            if (*p != '{') {
+                return false;
+            }
+            p++;
+            SkipWhitespace(p);
+            if (*p == '}') {
+                p++;
+                return true;
+            }
+            while (true) {
+                StringRef name;
+                if (!ScanString(p, name) || name.escaped) {
+                    return false;
+                }
+                SkipWhitespace(p);
+                if (*p != ':') {
+                    return false;
+                }
+                p++;
+                SkipWhitespace(p);
+                if (!scan_member(name, p)) {
+                    return false;
+                }
+                SkipWhitespace(p);
+                if (*p == '}') {
+                    p++;
+                    return true;
+                }
+                if (*p != ',') {
+                    return false;
+                }
+                p++;
+                SkipWhitespace(p);
+            }
+        }  // ScanObject
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static bool ScanDataItem(const char*& p, DataItem& item) {
+            uint32_t seen = 0;
+            return ScanObject(p,
+                [&item, &seen](const StringRef& name, const char*& p) {
+                    if (NameIs(name, "index")) {
+                        return FirstSeen(seen, 0) && ScanNumber(p, item.index);
+                    } else if (NameIs(name, "dataHash")) {
+                        return FirstSeen(seen, 1) &&
+                            ScanString(p, item.data_hash);
+                    } else if (NameIs(name, "data")) {
+                        return FirstSeen(seen, 2) && ScanString(p, item.data);
+                    } else if (NameIs(name, "encryptedDataEncryptionKey")) {
+                        return FirstSeen(seen, 3) &&
+                            ScanString(p, item.encrypted_data_encryption_key);
+                    } else if (NameIs(name, "iv")) {
+                        return FirstSeen(seen, 4) && ScanString(p, item.iv);
+                    } else if (NameIs(name, "dataStreamSize")) {
+                        return FirstSeen(seen, 5) &&
+                            ScanNumber(p, item.data_stream_size);
+                    }
+                    return false;
+                });
+        }  // ScanDataItem
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static bool ScanDataArray(const char*& p, ArenaVector<DataItem>& items) {
+            if (*p != '[') {
+                return false;
+            }
+            p++;
+            SkipWhitespace(p);
+            if (*p == ']') {
+                p++;
+                return true;
+            }
+            while (true) {
+                if (items.size() == MAX_ARRAY_SIZE) {
+                    return false;
+                }
+                items.emplace_back();
+                if (!ScanDataItem(p, items.back())) {
+                    return false;
+                }
+                SkipWhitespace(p);
+                if (*p == ']') {
+                    p++;
+                    return true;
+                }
+                if (*p != ',') {
+                    return false;
+                }
+                p++;
+                SkipWhitespace(p);
+            }
+        }  // ScanDataArray
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static bool ScanParams(const char*& p, WorkOrderRequest& request) {
+            uint32_t seen = 0;
+            return ScanObject(p,
+                [&request, &seen](const StringRef& name, const char*& p) {
+                    for (size_t i = 0; i < NUM_PARAMS_STRINGS; i++) {
+                        if (NameIs(name, PARAMS_STRINGS[i].name)) {
+                            return FirstSeen(seen, i) &&
+                                ScanString(p,
+                                    request.*(PARAMS_STRINGS[i].member));
+                        }
+                    }
+                    if (NameIs(name, "responseTimeoutMSecs")) {
+                        return FirstSeen(seen, NUM_PARAMS_STRINGS) &&
+                            ScanNumber(p, request.response_timeout_msecs);
+                    } else if (NameIs(name, "inData")) {
+                        return FirstSeen(seen, NUM_PARAMS_STRINGS + 1) &&
+                            ScanDataArray(p, request.in_data);
+                    } else if (NameIs(name, "outData")) {
+                        return FirstSeen(seen, NUM_PARAMS_STRINGS + 2) &&
+                            ScanDataArray(p, request.out_data);
+                    }
+                    return false;
+                });
+        }  // ScanParams
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        bool ScanRequest(const char* json_str, WorkOrderRequest& request) {
+            const char* p = json_str;
+            uint32_t seen = 0;
+            StringRef ignored;
+
+            SkipWhitespace(p);
+            bool scanned = ScanObject(p,
+                [&request, &seen, &ignored](
+                    const StringRef& name, const char*& p) {
+                    if (NameIs(name, "jsonrpc")) {
+                        return FirstSeen(seen, 0) && ScanString(p, ignored);
+                    } else if (NameIs(name, "method")) {
+                        return FirstSeen(seen, 1) && ScanString(p, ignored);
+                    } else if (NameIs(name, "id")) {
+                        return FirstSeen(seen, 2) && ScanNumber(p, request.id);
+                    } else if (NameIs(name, "params")) {
+                        return FirstSeen(seen, 3) && ScanParams(p, request);
+                    }
+                    return false;
+                });
+            if (!scanned || !(seen & (1 << 3))) {
+                // parson reports a missing params object
+                return false;
+            }
+            SkipWhitespace(p);
+            return *p == '\0';
+        }  // ScanRequest
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static StringRef GetRef(const JSON_Object* object, const char* name) {
+            StringRef value;
+            value.data = json_object_get_string(object, name);
+            if (value.data != nullptr) {
+                value.size = strlen(value.data);
+            }
+            return value;
+        }  // GetRef
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        static void GetDataItems(const JSON_Object* params_object,
+            const char* name, ArenaVector<DataItem>& items) {
+            JSON_Array* data_array = json_object_get_array(params_object, name);
+            size_t count = json_array_get_count(data_array);
+            items.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                JSON_Object* data_object = json_array_get_object(data_array, i);
+                items[i].index = json_object_get_number(data_object, "index");
+                items[i].data_hash = GetRef(data_object, "dataHash");
+                items[i].data = GetRef(data_object, "data");
+                items[i].encrypted_data_encryption_key = GetRef(
+                    data_object, "encryptedDataEncryptionKey");
+                items[i].iv = GetRef(data_object, "iv");
+                items[i].data_stream_size = json_object_get_number(
+                    data_object, "dataStreamSize");
+            }
+        }  // GetDataItems
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        void ParseRequestDocument(
+            const char* json_str,
+            WorkOrderRequest& request) {
+            // The document is released with the request, in the arena
+            // scope of the work order if there is one
+            JsonArenaScope json_arena_scope;
+            request.document.reset(new JsonValue(json_parse_string(json_str)));
+            tcf::error::ThrowIfNull(request.document->value,
+                "failed to parse the work order request, badly formed JSON");
+
+            JSON_Object* request_object = json_value_get_object(
+                *request.document);
+            tcf::error::ThrowIfNull(request_object,
+                "Missing JSON object in work order request");
+
+            request.id = json_object_get_number(request_object, "id");
+
+            JSON_Object* params_object = json_object_get_object(
+                request_object, "params");
+            tcf::error::ThrowIfNull(params_object,
+                "Missing params object in work order request");
+
+            request.response_timeout_msecs = json_object_get_number(
+                params_object, "responseTimeoutMSecs");
+            for (size_t i = 0; i < NUM_PARAMS_STRINGS; i++) {
+                request.*(PARAMS_STRINGS[i].member) = GetRef(
+                    params_object, PARAMS_STRINGS[i].name);
+            }
+            GetDataItems(params_object, "inData", request.in_data);
+            GetDataItems(params_object, "outData", request.out_data);
+        }  // ParseRequestDocument
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        WorkOrderRequest ParseRequest(const char* json_str) {
+            WorkOrderRequest request;
+            if (!ScanRequest(json_str, request)) {
+                request = WorkOrderRequest();
+                ParseRequestDocument(json_str, request);
+            }
+            return request;
+        }  // ParseRequest
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        std::string GetString(const StringRef& value, const char* err_msg) {
+            if (value.IsMissing()) {
+                tcf::error::ThrowIf<tcf::error::ValueError>(
+                    err_msg != nullptr, err_msg);
+                return "";
+            }
+            if (!value.escaped) {
+                return std::string(value.data, value.size);
+            }
+
+            // Escape sequences were checked by ScanString()
+            std::string decoded;
+            decoded.reserve(value.size);
+            for (size_t i = 0; i < value.size; i++) {
+                char c = value.data[i];
+                if (c == '\\') {
+                    c = value.data[++i];
+                    switch (c) {
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'n': c = '\n'; break;
+                    case 'r': c = '\r'; break;
+                    case 't': c = '\t'; break;
+                    default: break;  // '"', '\\' and '/'
+                    }
+                }
+                decoded.push_back(c);
+            }
+            return decoded;
+        }  // GetString
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        size_t ForEachStringPiece(
+            const StringRef& value,
+            const std::function<void(const char*, size_t)>& append) {
+            if (!value.escaped) {
+                if (value.size > 0) {
+                    append(value.data, value.size);
+                }
+                return value.size;
+            }
+
+            // Runs between escape sequences are passed as they are in
+            // the request, decoded escape sequences one at a time
+            size_t size = 0;
+            size_t run = 0;
+            for (size_t i = 0; i < value.size; i++) {
+                if (value.data[i] != '\\') {
+                    continue;
+                }
+                if (i > run) {
+                    append(value.data + run, i - run);
+                    size += i - run;
+                }
+                char c = value.data[++i];
+                switch (c) {
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                default: break;  // '"', '\\' and '/'
+                }
+                append(&c, 1);
+                size++;
+                run = i + 1;
+            }
+            if (value.size > run) {
+                append(value.data + run, value.size - run);
+                size += value.size - run;
+            }
+            return size;
+        }  // ForEachStringPiece
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        ByteArray GetBase64(const StringRef& value) {
+            if (!value.escaped) {
+                ByteArray decoded(base64_decode_buffer_size(value.size));
+                decoded.resize(
+                    base64_decode(value.data, value.size, decoded.data()));
+                return decoded;
+            }
+
+            // Escaped strings are decoded into a small buffer first, in
+            // chunks of whole base64 quanta. Like base64_decode(),
+            // decoding stops at the first chunk with a non-base64
+            // character.
+            const size_t chunk_size = 4096;
+            char chunk[chunk_size];
+            size_t chunk_length = 0;
+            bool stopped = false;
+            ByteArray decoded(base64_decode_buffer_size(value.size));
+            size_t decoded_size = 0;
+            auto decode_chunk = [&]() {
+                size_t n = base64_decode(chunk, chunk_length,
+                    decoded.data() + decoded_size);
+                stopped = n < chunk_length / 4 * 3;
+                decoded_size += n;
+                chunk_length = 0;
+            };
+            ForEachStringPiece(value, [&](const char* piece, size_t size) {
+                while (size > 0 && !stopped) {
+                    size_t n = std::min(size, chunk_size - chunk_length);
+                    memcpy(chunk + chunk_length, piece, n);
+                    chunk_length += n;
+                    piece += n;
+                    size -= n;
+                    if (chunk_length == chunk_size) {
+                        decode_chunk();
+                    }
+                }
+            });
+            if (chunk_length > 0 && !stopped) {
+                decode_chunk();
+            }
+            decoded.resize(decoded_size);
+            return decoded;
+        }  // GetBase64
+
+    }  // namespace work_order_request
+}  // namespace tcf
@@ -0,0 +1,150 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file
+ * Avalon work order request parsing.
+ *
+ * A work order request is scanned once, without building a JSON document,
+ * into a WorkOrderRequest pointing into the request buffer. Requests of
+ * another shape, with members the scan does not know of, values of other
+ * types or unusual number and string syntax, are parsed with parson
+ * instead, so that they are accepted or rejected as before.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "jsonvalue.h"
+#include "types.h"
+
+namespace tcf {
+    namespace work_order_request {
+
+        /**
+         * String member of a request. Points into the request buffer, or
+         * into the parson document of the request.
+         */
+        struct StringRef {
+            // nullptr if the member is missing
+            const char* data = nullptr;
+            size_t size = 0;
+            // Contains JSON escape sequences, which are not decoded yet
+            bool escaped = false;
+
+            bool IsMissing() const {
+                return data == nullptr;
+            }
+        };
+
+        /** Member of the inData or outData array of a request */
+        struct DataItem {
+            double index = 0;
+            StringRef data_hash;
+            StringRef data;
+            StringRef encrypted_data_encryption_key;
+            StringRef iv;
+            double data_stream_size = 0;
+        };
+
+        /**
+         * Members of a work order request. Numbers missing from the
+         * request are 0, like json_object_dotget_number() returns.
+         */
+        struct WorkOrderRequest {
+            double id = 0;
+            double response_timeout_msecs = 0;
+            StringRef payload_format;
+            StringRef verifying_key;
+            StringRef result_uri;
+            StringRef notify_uri;
+            StringRef work_order_id;
+            StringRef worker_id;
+            StringRef workload_id;
+            StringRef requester_id;
+            StringRef worker_encryption_key;
+            StringRef data_encryption_algorithm;
+            StringRef encrypted_session_key;
+            StringRef session_key_iv;
+            StringRef requester_nonce;
+            StringRef encrypted_request_hash;
+            StringRef requester_signature;
+            ArenaVector<DataItem> in_data;
+            ArenaVector<DataItem> out_data;
+
+            // Parson document the strings point into, if the request was
+            // not scanned
+            std::unique_ptr<JsonValue> document;
+        };
+
+        /**
+         * Parse a work order request, scanning it if it has the usual
+         * shape and with parson otherwise. The strings of the result
+         * point into json_str.
+         * Throws ValueError if the request is not a JSON object with a
+         * params object.
+         */
+        WorkOrderRequest ParseRequest(const char* json_str);
+
+        /**
+         * Scan a work order request in a single pass. Returns false,
+         * leaving request partially filled, if it does not have the
+         * usual shape.
+         */
+        bool ScanRequest(const char* json_str, WorkOrderRequest& request);
+
+        /**
+         * Parse a work order request with parson. In an ArenaScope the
+         * document is allocated from the arena, like the data items of
+         * requests, and the request must not outlive the scope.
+         * Throws ValueError if the request is not a JSON object with a
+         * params object.
+         */
+        void ParseRequestDocument(
+            const char* json_str,
+            WorkOrderRequest& request);
+
+        /**
+         * Return the value of a string member, with escape sequences
+         * decoded, like GetJsonStr(): if it is missing, "" or a
+         * ValueError with err_msg if err_msg is given.
+         */
+        std::string GetString(
+            const StringRef& value,
+            const char* err_msg = nullptr);
+
+        /**
+         * Pass the value of a string member, with escape sequences
+         * decoded, to append piece by piece, without copying it into a
+         * string. Returns the size of the value, 0 if it is missing.
+         */
+        size_t ForEachStringPiece(
+            const StringRef& value,
+            const std::function<void(const char*, size_t)>& append);
+
+        /**
+         * Return the base64 decoded value of a string member, like
+         * base64_decode() of GetString(), without copying the string.
+         */
+        ByteArray GetBase64(const StringRef& value);
+
+    }  // namespace work_order_request
+}  // namespace tcf
@@ -15,9 +15,11 @@
 # limitations under the License.
 import sys
 import logging
-from Cryptodome.PublicKey import RSA
+from Cryptodome.PublicKey import RSA, ECC
 from Cryptodome.Random import get_random_bytes
 from Cryptodome.Cipher import AES, PKCS1_OAEP
+from Cryptodome.Hash import SHA256
+from Cryptodome.Protocol.KDF import HKDF
 from Cryptodome.Random import get_random_bytes
 
 import avalon_crypto_utils.crypto_utility as crypto_utility
@@ -46,6 +48,12 @@ class WorkerEncrypt(object):
     TAG_SIZE = 16
     # AES_GCM authenticated key size
     SYM_KEY_SIZE = 32
+    # Size of an uncompressed SECP256R1 public key
+    EC_PUBLIC_KEY_SIZE = 65
+    # Size of a SECP256R1 coordinate
+    EC_COORDINATE_SIZE = 32
+    # HKDF info label of session keys derived by key agreement
+    SESSION_KEY_INFO = b"Avalon work order session key"
 
 # -------------------------------------------------------------------------
 
@@ -126,6 +134,53 @@ class WorkerEncrypt(object):
             raise
         return enc_session_key
 
+# -------------------------------------------------------------------------
+
+    def derive_session_key(self, key_agreement_key):
+        """
+        Derive a session key shared with a worker by ECDH key agreement
+        with an ephemeral SECP256R1 key and the worker's key agreement key.
+        The worker derives the same session key from the ephemeral public
+        key, sent in place of an RSA encrypted session key.
+
+        Parameters :
+            key_agreement_key: Hex encoded uncompressed SECP256R1 public
+                               key published by the worker
+        Returns :
+            Tuple of the 32 bytes session key and the ephemeral public
+            key in bytes.
+            Raises exception in case of error.
+        """
+        try:
+            worker_public_key = bytes.fromhex(key_agreement_key)
+            size = WorkerEncrypt.EC_COORDINATE_SIZE
+            if len(worker_public_key) != WorkerEncrypt.EC_PUBLIC_KEY_SIZE \
+                    or worker_public_key[0] != 4:
+                raise ValueError("invalid key agreement key")
+            # construct checks that the point is on the curve
+            worker_key = ECC.construct(
+                curve="P-256",
+                point_x=int.from_bytes(worker_public_key[1:1 + size], "big"),
+                point_y=int.from_bytes(worker_public_key[1 + size:], "big"))
+
+            ephemeral_key = ECC.generate(curve="P-256")
+            point = ephemeral_key.pointQ
+            ephemeral_public_key = b"\x04" + \
+                int(point.x).to_bytes(size, "big") + \
+                int(point.y).to_bytes(size, "big")
+
+            shared_point = worker_key.pointQ * ephemeral_key.d
+            shared_secret = int(shared_point.x).to_bytes(size, "big")
+            session_key = HKDF(
+                shared_secret, WorkerEncrypt.SYM_KEY_SIZE, None, SHA256,
+                context=WorkerEncrypt.SESSION_KEY_INFO +
+                ephemeral_public_key + worker_public_key)
+        except Exception as e:
+            err_msg = "Derive session key failed: " + str(e)
+            logger.error(err_msg)
+            raise
+        return session_key, ephemeral_public_key
+
 # -------------------------------------------------------------------------
 
     def decrypt_session_key(self, enc_session_key, rsa_private_key=None):
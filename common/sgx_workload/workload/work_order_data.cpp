@@ -13,6 +13,8 @@
 * limitations under the License.
 */
 
+#include <utility>
+
 #include "work_order_data.h"
 
 namespace tcf {
@@ -23,6 +25,6 @@ namespace tcf {
 
     WorkOrderData::WorkOrderData(int in_index, ByteArray data) {
         index = in_index;
-        decrypted_data = data;
+        decrypted_data = std::move(data);
     }
 }  // namespace tcf
@@ -22,10 +22,54 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <memory>
 #include <string>
 #include "types.h"
 
 namespace tcf {
+    /**
+     * Reads the decrypted data of a work order data item piece by piece.
+     * Used for inData which is streamed into the enclave instead of
+     * being embedded in the work order request.
+     */
+    class WorkOrderDataReader {
+    public:
+        virtual ~WorkOrderDataReader() {}
+
+        /**
+         * Read the next piece of the decrypted data. The data is
+         * verified when its end is reached.
+         * Throws tcf::error::CryptoError or tcf::error::ValueError if
+         * the verification fails.
+         *
+         * @param buffer Buffer for the data
+         * @param size   Size of the buffer in bytes
+         * @returns      Number of bytes read, 0 at the end of the data
+         */
+        virtual size_t Read(uint8_t* buffer, size_t size) = 0;
+    };
+
+    /**
+     * Writes the output of a work order data item piece by piece. Used
+     * for outData which is streamed out of the enclave instead of being
+     * held in memory until the response is built.
+     */
+    class WorkOrderDataWriter {
+    public:
+        virtual ~WorkOrderDataWriter() {}
+
+        /**
+         * Append the next piece of the output data. Throws
+         * tcf::error::ValueError if another item was written since this
+         * one was last written to.
+         *
+         * @param data Next piece of the data
+         * @param size Size of the piece in bytes
+         */
+        virtual void Write(const uint8_t* data, size_t size) = 0;
+    };
+
 	/**
          * Wrapper class for work order data submitted to workload processors.
          */
@@ -37,5 +81,12 @@ namespace tcf {
 		int index;
 		// Initialize here to suppress Klocwork initialization error
 		ByteArray decrypted_data = {};
+		// Set instead of decrypted_data for streamed inData, see
+		// WorkloadProcessor::SupportsStreamedData()
+		std::shared_ptr<WorkOrderDataReader> reader;
+		// Set on outData items whose output can be written through it
+		// instead of decrypted_data, see
+		// WorkloadProcessor::SupportsStreamedData()
+		std::shared_ptr<WorkOrderDataWriter> writer;
 	};
 }  // namespace tcf
@@ -20,11 +20,21 @@
  */
 
 #include <string>
+#include <vector>
 #include "workload_processor.h"
 #include "enclave_utils.h"
 
 std::map<std::string, WorkloadProcessor*> \
     WorkloadProcessor::workload_processor_table;
+sgx_spinlock_t WorkloadProcessor::workload_processor_table_lock = \
+    SGX_SPINLOCK_INITIALIZER;
+std::map<std::string, std::vector<WorkloadProcessor*>> \
+    WorkloadProcessor::workload_processor_pool;
+
+// Outermost WorkloadProcessorBatchScope open on the thread. A plain
+// pointer, since the thread local storage of an enclave does not outlive
+// the ecall, which the scope does not either.
+static thread_local WorkloadProcessorBatchScope* current_batch = nullptr;
 
 WorkloadProcessor::WorkloadProcessor() {}
 
@@ -35,21 +45,39 @@ WorkloadProcessor* WorkloadProcessor::RegisterWorkloadProcessor(
     WorkloadProcessor* processor) {
    Log(TCF_LOG_INFO, "Register Workload Processor - %s",
        workload_id.c_str());
+   tcf::SpinLockGuard guard(&workload_processor_table_lock);
    workload_processor_table[workload_id] = processor;
    return processor;
 }
 
 WorkloadProcessor* WorkloadProcessor::CreateWorkloadProcessor(
     std::string workload_id) {
-   WorkloadProcessor* processor;
+   WorkloadProcessor* processor = nullptr;
+   bool found = false;
 
-   // Search the workload processor type in the table
-   auto itr = workload_processor_table.find(workload_id);
-   if (itr == workload_processor_table.end()) {
+   // Search the workload processor type in the batch, then in the table
+   WorkloadProcessorBatchScope* batch = current_batch;
+   if (batch) {
+       auto cached = batch->prototypes.find(workload_id);
+       if (cached != batch->prototypes.end()) {
+           processor = cached->second;
+           found = true;
+       }
+   }
+   if (!found) {
+       tcf::SpinLockGuard guard(&workload_processor_table_lock);
+       auto itr = workload_processor_table.find(workload_id);
+       if (itr != workload_processor_table.end()) {
+           processor = (*itr).second;
+           found = true;
+       }
+   }
+   if (found && batch) {
+       batch->prototypes[workload_id] = processor;
+   }
+   if (!found) {
        Log(TCF_LOG_ERROR, "Workload Processor not found in table");
        return nullptr;
-   } else {
-       processor = (*itr).second;
    }
 
    // Clone the workload processor and return it.
@@ -60,3 +88,88 @@ WorkloadProcessor* WorkloadProcessor::CreateWorkloadProcessor(
        return processor->Clone();
    }
 }
+
+WorkloadProcessorPtr WorkloadProcessor::AcquireWorkloadProcessor(
+    std::string workload_id) {
+   // Reuse an instance released by an earlier work order of the batch
+   WorkloadProcessorBatchScope* batch = current_batch;
+   if (batch) {
+       auto released = batch->released.find(workload_id);
+       if (released != batch->released.end() && !released->second.empty()) {
+           WorkloadProcessorPtr processor(released->second.back());
+           released->second.pop_back();
+           return processor;
+       }
+   }
+
+   // Reuse an instance released by an earlier work order
+   {
+       tcf::SpinLockGuard guard(&workload_processor_table_lock);
+       auto itr = workload_processor_pool.find(workload_id);
+       if (itr != workload_processor_pool.end() && !itr->second.empty()) {
+           WorkloadProcessorPtr processor(itr->second.back());
+           itr->second.pop_back();
+           return processor;
+       }
+   }
+
+   WorkloadProcessorPtr processor(CreateWorkloadProcessor(workload_id));
+   if (processor) {
+       processor->acquired_workload_id = workload_id;
+   }
+   return processor;
+}
+
+void WorkloadProcessor::ReleaseWorkloadProcessor(
+    WorkloadProcessor* processor) {
+   if (processor == nullptr) {
+       return;
+   }
+   if (processor->IsReusable()) {
+       try {
+           processor->Reset();
+           if (current_batch) {
+               current_batch->released[
+                   processor->acquired_workload_id].push_back(processor);
+               return;
+           }
+           tcf::SpinLockGuard guard(&workload_processor_table_lock);
+           workload_processor_pool[processor->acquired_workload_id].push_back(
+               processor);
+           return;
+       } catch (...) {
+           Log(TCF_LOG_ERROR, "Workload Processor reset failed, discarded");
+       }
+   }
+   delete processor;
+}
+
+WorkloadProcessorBatchScope::WorkloadProcessorBatchScope() {
+   // Nested scopes leave the batch to the outermost one
+   if (current_batch == nullptr) {
+       current_batch = this;
+   }
+}
+
+WorkloadProcessorBatchScope::~WorkloadProcessorBatchScope() {
+   if (current_batch != this) {
+       return;
+   }
+   current_batch = nullptr;
+
+   // Return the instances kept for the batch under a single lock
+   if (!released.empty()) {
+       tcf::SpinLockGuard guard(
+           &WorkloadProcessor::workload_processor_table_lock);
+       for (auto& kept : released) {
+           std::vector<WorkloadProcessor*>& pool =
+               WorkloadProcessor::workload_processor_pool[kept.first];
+           pool.insert(pool.end(), kept.second.begin(), kept.second.end());
+       }
+   }
+}
+
+void WorkloadProcessorRelease::operator()(
+    WorkloadProcessor* processor) const {
+   WorkloadProcessor::ReleaseWorkloadProcessor(processor);
+}
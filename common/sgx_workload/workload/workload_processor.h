@@ -23,9 +23,26 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
+#include <sgx_spinlock.h>
 #include "work_order_data.h"
 
+class WorkloadProcessor;
+
+/**
+ * Deleter of WorkloadProcessorPtr, which releases the WorkloadProcessor
+ * with WorkloadProcessor::ReleaseWorkloadProcessor()
+ */
+struct WorkloadProcessorRelease {
+    void operator()(WorkloadProcessor* processor) const;
+};
+
+/** WorkloadProcessor acquired for a work order */
+typedef std::unique_ptr<WorkloadProcessor, WorkloadProcessorRelease>
+    WorkloadProcessorPtr;
+
 /** Class to register, create, and process a workload. */
 class WorkloadProcessor {
 public:
@@ -36,13 +53,37 @@ public:
     virtual WorkloadProcessor* Clone() const = 0;
 
     /**
-     * Create a WorkloadProcessor
+     * Create a WorkloadProcessor, which the caller deletes
      *
      * @param workload_id Workload identifier
      * @returns           Pointer to WorkloadProcessor
      */
     static WorkloadProcessor* CreateWorkloadProcessor(std::string workload_id);
 
+    /**
+     * Acquire a WorkloadProcessor for a work order. Reusable workloads are
+     * taken from the instances released by earlier work orders, other
+     * workloads and the first instances of reusable ones are cloned.
+     * The WorkloadProcessor is released when the pointer is destroyed.
+     * Within a WorkloadProcessorBatchScope the lookups are done by the
+     * calling thread without taking workload_processor_table_lock.
+     *
+     * @param workload_id Workload identifier
+     * @returns           Pointer to WorkloadProcessor, empty if the
+     *                    workload is not registered
+     */
+    static WorkloadProcessorPtr AcquireWorkloadProcessor(
+        std::string workload_id);
+
+    /**
+     * Release a WorkloadProcessor acquired for a work order. Instances of
+     * reusable workloads are Reset() and kept for later work orders,
+     * others are deleted.
+     *
+     * @param processor Acquired WorkloadProcessor
+     */
+    static void ReleaseWorkloadProcessor(WorkloadProcessor* processor);
+
     /**
      * Register a WorkloadProcessor.
      * Used by the workloads to register themselves
@@ -56,6 +97,62 @@ public:
     /** Mapping between workload id and WorkloadProcessor. */
     static std::map<std::string, WorkloadProcessor*> workload_processor_table;
 
+    /**
+     * Lock for workload_processor_table, since work orders can be
+     * executed on several enclave threads concurrently.
+     */
+    static sgx_spinlock_t workload_processor_table_lock;
+
+    /**
+     * Released instances of reusable workloads by workload id, at most one
+     * for each work order executed concurrently.
+     * Also locked by workload_processor_table_lock.
+     */
+    static std::map<std::string, std::vector<WorkloadProcessor*>>
+        workload_processor_pool;
+
+    /**
+     * Whether instances of the workload are reused by later work orders
+     * after they are released, keeping state which is expensive to set
+     * up, such as parsed models or lookup tables, instead of being cloned
+     * for every work order.
+     * ProcessWorkOrder() runs in the ArenaScope of the work order (see
+     * arena.h), which is released when the work order is done. Reused
+     * instances must not keep arena memory: ArenaVector and ArenaString
+     * containers, or JSON values parsed in a JsonArenaScope. State kept
+     * between work orders has to be allocated from the heap.
+     *
+     * @returns true if instances of the workload are reused
+     */
+    virtual bool IsReusable() const {
+        return false;
+    }
+
+    /**
+     * Clear the state of the work order a reusable instance processed,
+     * before it is reused. Throwing discards the instance.
+     * Called after the arena of the work order is released, arena memory
+     * the instance still points to must not be used or freed here.
+     */
+    virtual void Reset() {}
+
+    /**
+     * Whether the workload reads streamed inData items through
+     * tcf::WorkOrderData::reader. Streamed items are read into
+     * decrypted_data before ProcessWorkOrder() is called for workloads
+     * which do not.
+     * Such workloads also get a tcf::WorkOrderData::writer for each
+     * outData item of a request with streamed data, and may write the
+     * output of the item through it instead of setting decrypted_data.
+     * Items of other requests have no writer, their output has to be
+     * set in decrypted_data.
+     *
+     * @returns true if the workload supports streamed work order data
+     */
+    virtual bool SupportsStreamedData() const {
+        return false;
+    }
+
     /**
      * Process the workload.
      *
@@ -79,6 +176,38 @@ public:
         const ByteArray& work_order_id,
         const std::vector<tcf::WorkOrderData>& in_work_order_data,
         std::vector<tcf::WorkOrderData>& out_work_order_data) = 0;
+
+private:
+    // Workload identifier the instance was acquired for
+    std::string acquired_workload_id;
+};
+
+/**
+ * Scope of a batch of work orders processed one after the other by the
+ * calling thread. While it exists, the registered WorkloadProcessor of a
+ * workload is looked up once for the batch, and reusable instances
+ * released by a work order are kept by the thread for the next work
+ * orders of the batch instead of going through workload_processor_pool.
+ * They are returned to workload_processor_pool when the outermost scope
+ * is destroyed.
+ */
+class WorkloadProcessorBatchScope {
+public:
+    WorkloadProcessorBatchScope();
+    ~WorkloadProcessorBatchScope();
+
+private:
+    friend class WorkloadProcessor;
+
+    WorkloadProcessorBatchScope(const WorkloadProcessorBatchScope&);
+    WorkloadProcessorBatchScope& operator=(
+        const WorkloadProcessorBatchScope&);
+
+    // Registered processors looked up by the batch, which are never
+    // unregistered
+    std::map<std::string, WorkloadProcessor*> prototypes;
+    // Reusable instances released by work orders of the batch
+    std::map<std::string, std::vector<WorkloadProcessor*>> released;
 };
 
 /**
@@ -87,6 +87,10 @@ class DcapAttestation(Attestation):
             'encryption_key': signup_data['encryption_key'],
             'encryption_key_signature':
                 signup_data['encryption_key_signature'],
+            'key_agreement_key':
+                signup_data.get('key_agreement_key', ''),
+            'key_agreement_key_signature':
+                signup_data.get('key_agreement_key_signature', ''),
             'proof_data': 'Not present',
             'enclave_persistent_id': 'Not present'
         }
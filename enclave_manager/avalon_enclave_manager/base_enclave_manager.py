@@ -42,6 +42,10 @@ class EnclaveManager(ABC):
         self._config = config
         worker_id = config.get("WorkerConfig")["worker_id"]
         self._worker_id = hex_utils.get_worker_id_from_name(worker_id)
+        # Milliseconds a work order waits for a free enclave, negative to
+        # wait as long as needed
+        self._acquire_timeout_ms = int(config.get("EnclaveModule", {})
+                                       .get("acquire_timeout_ms", -1))
 
 # -------------------------------------------------------------------------
 
@@ -142,6 +146,9 @@ class EnclaveManager(ABC):
         self.encryption_key = self.enclave_data["encryption_key"]
         self.encryption_key_signature = \
             self.enclave_data["encryption_key_signature"]
+        self.key_agreement_key = self.enclave_data["key_agreement_key"]
+        self.key_agreement_key_signature = \
+            self.enclave_data["key_agreement_key_signature"]
         self.enclave_id = self.enclave_data["enclave_id"]
         self.proof_data = self.enclave_data["proof_data"]
         self.extended_measurements = self.enclave_data["measurements"]
@@ -183,6 +190,11 @@ class EnclaveManager(ABC):
         signup_data_json["encryption_key"] = signup_data.encryption_key
         signup_data_json["encryption_key_signature"] = \
             signup_data.encryption_key_signature
+        # Graphene workers do not publish a key agreement key
+        signup_data_json["key_agreement_key"] = \
+            getattr(signup_data, "key_agreement_key", "")
+        signup_data_json["key_agreement_key_signature"] = \
+            getattr(signup_data, "key_agreement_key_signature", "")
         signup_data_json["enclave_id"] = signup_data.enclave_id
         signup_data_json["proof_data"] = signup_data.proof_data
         signup_data_json["measurements"] = signup_data.extended_measurements
@@ -210,6 +222,11 @@ class EnclaveManager(ABC):
         worker_type_data["encryptionKey"] = enclave_data.encryption_key
         worker_type_data["encryptionKeySignature"] = \
             enclave_data.encryption_key_signature
+        if enclave_data.key_agreement_key:
+            worker_type_data["keyAgreementKey"] = \
+                enclave_data.key_agreement_key
+            worker_type_data["keyAgreementKeySignature"] = \
+                enclave_data.key_agreement_key_signature
 
         worker_info = dict()
         worker_info["workerType"] = WorkerType.TEE_SGX.value
@@ -22,6 +22,7 @@
 
 namespace std {
     %template(StringVector) vector<string>;
+    %template(IntVector) vector<int>;
     %template(StringMap) map<string, string>;
 }
 
@@ -78,6 +79,18 @@ namespace std {
 }
 
 
+// HandleWorkOrderRequestBuffer and HandleWorkOrderRequestStream take the
+// request and streamed data through the Python buffer protocol and return
+// the response as bytes, without base64 encoding
+%include <pybuffer.i>
+%pybuffer_binary(const char* serialized_request, size_t serialized_request_size);
+%pybuffer_binary(const char* ext_wo_data, size_t ext_wo_data_size);
+%pybuffer_binary(const char* stream_data, size_t stream_data_size);
+%typemap(out) ByteArray {
+    $result = PyBytes_FromStringAndSize(
+        (const char*) $1.data(), $1.size());
+}
+
 %thread;
 %{
 #include "swig_utils.h"
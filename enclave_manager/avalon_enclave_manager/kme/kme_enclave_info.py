@@ -49,6 +49,9 @@ class KeyManagementEnclaveInfo(BaseEnclaveInfo):
             self.encryption_key = enclave_info['encryption_key']
             self.encryption_key_signature = \
                 enclave_info['encryption_key_signature']
+            self.key_agreement_key = enclave_info['key_agreement_key']
+            self.key_agreement_key_signature = \
+                enclave_info['key_agreement_key_signature']
             self.proof_data = enclave_info['proof_data']
             self.enclave_id = enclave_info['enclave_id']
             self.extended_measurements = self.get_extended_measurements()
@@ -78,6 +81,9 @@ class KeyManagementEnclaveInfo(BaseEnclaveInfo):
         enclave_info['encryption_key'] = enclave_data.encryption_key
         enclave_info['encryption_key_signature'] = \
             enclave_data.encryption_key_signature
+        enclave_info['key_agreement_key'] = enclave_data.key_agreement_key
+        enclave_info['key_agreement_key_signature'] = \
+            enclave_data.key_agreement_key_signature
         enclave_info['enclave_id'] = enclave_data.verifying_key
         enclave_info['proof_data'] = ''
         if not self.is_sgx_simulator():
@@ -142,6 +148,22 @@ class KeyManagementEnclaveInfo(BaseEnclaveInfo):
 
     # -----------------------------------------------------------------
 
+    def refill_key_pool(self, max_keys):
+        """
+        Generate work order keys into the key pool of an enclave which
+        is not executing a request
+
+        Parameters :
+            @param max_keys - Maximum number of signing key pairs to
+                              generate
+        Returns :
+            @returns Number of signing key pairs in the pool of the enclave
+        """
+        signup_cpp_obj = enclave.SignupInfoKME()
+        return signup_cpp_obj.RefillKeyPool(max_keys)
+
+    # -----------------------------------------------------------------
+
     def _verify_enclave_info(self, enclave_info, mr_enclave, signup_cpp_obj):
         """
         Verifies enclave signup info
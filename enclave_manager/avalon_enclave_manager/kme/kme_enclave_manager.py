@@ -20,6 +20,7 @@ import logging
 import os
 import sys
 import random
+from twisted.internet import task
 
 import avalon_enclave_manager.sgx_work_order_request as work_order_request
 import avalon_enclave_manager.kme.kme_enclave_info as enclave_info
@@ -99,7 +100,8 @@ class KeyManagementEnclaveManager(EnclaveManager):
             wo_request = work_order_request.SgxWorkOrderRequest(
                 EnclaveType.KME,
                 input_json_str,
-                ext_data
+                ext_data,
+                self._acquire_timeout_ms
             )
             wo_response = wo_request.execute()
             try:
@@ -135,9 +137,45 @@ class KeyManagementEnclaveManager(EnclaveManager):
                          "exiting Intel SGX Enclave manager: {}".format(err))
             exit(1)
 
+        self._start_key_pool_refill()
         self._start_kme_listener()
 
 
+# -------------------------------------------------------------------------
+
+    def _start_key_pool_refill(self):
+        """
+        Schedules periodic refills of the enclave's pool of pre-generated
+        work order keys. The KME listener handles requests on the reactor
+        thread, so a refill never runs while a request is being handled
+        and work orders take keys from a full pool.
+        """
+        enclave_config = self._config.get("EnclaveModule", {})
+        interval = float(enclave_config.get("key_pool_refill_interval", 0))
+        if interval <= 0:
+            logger.info("Work order key pool refills are disabled")
+            return
+        self._key_pool_refill_batch = \
+            int(enclave_config.get("key_pool_refill_batch", 4))
+        self._key_pool_refill = task.LoopingCall(self._refill_key_pool)
+        self._key_pool_refill.start(interval, now=True)
+
+# -------------------------------------------------------------------------
+
+    def _refill_key_pool(self):
+        """
+        Generates up to key_pool_refill_batch signing key pairs into the
+        key pool of an idle enclave.
+        """
+        try:
+            pool_size = self.signup_info_handle.refill_key_pool(
+                self._key_pool_refill_batch)
+            logger.debug("Work order key pool holds %d keys", pool_size)
+        except Exception as err:
+            # All enclaves are busy, retry on the next call. Exceptions
+            # must not escape, they would stop the LoopingCall.
+            logger.debug("Skipped work order key pool refill; %s", str(err))
+
 # -------------------------------------------------------------------------
 
     def _start_kme_listener(self):
@@ -16,16 +16,32 @@ import json
 import logging
 import importlib
 
-import avalon_crypto_utils.crypto_utility as crypto
 from avalon_enclave_manager.enclave_type import EnclaveType
 
 logger = logging.getLogger(__name__)
 
+# Size of the buffer passed to the enclave for the work order response.
+# Responses which fit are returned by the same enclave call which
+# executes the work order, larger ones need a second enclave call.
+RESPONSE_SIZE_HINT = 64 * 1024
+
+# inData items with more base64 encoded data than this are streamed into
+# the enclave instead of being embedded in the work order request
+STREAM_DATA_THRESHOLD = 1024 * 1024
+
 
 # -----------------------------------------------------------------
 class SgxWorkOrderRequest(object):
 
-    def __init__(self, enclave_type, work_order, ext_data=""):
+    def __init__(self, enclave_type, work_order, ext_data="",
+                 acquire_timeout_ms=-1):
+        """
+        Parameters :
+            acquire_timeout_ms - Milliseconds to wait for a free enclave
+                                 before execute() fails with SystemError,
+                                 0 not to wait, negative to wait as long
+                                 as needed
+        """
         self.enclave = None
         if enclave_type == EnclaveType.KME:
             self.enclave = importlib.import_module(
@@ -41,29 +57,100 @@ class SgxWorkOrderRequest(object):
             raise Exception('Unsupported enclave type passed in the config')
         self.work_order = work_order
         self.ext_data = ext_data
+        self.acquire_timeout_ms = acquire_timeout_ms
 
     # Execute work order in Intel SGX worker enclave
     def execute(self):
-        serialized_byte_array = crypto.string_to_byte_array(self.work_order)
-        encrypted_request = crypto.byte_array_to_base64(serialized_byte_array)
+        # Pass the request with its terminating NUL, which lets the
+        # enclave parse it in place
+        work_order, stream_data = self._split_stream_data()
+        request = (work_order + "\0").encode("utf-8")
+        ext_data = self.ext_data.encode("utf-8")
 
         try:
-            encoded_encrypted_response = self.enclave.HandleWorkOrderRequest(
-                encrypted_request, self.ext_data)
-            assert encoded_encrypted_response
+            encrypted_response = \
+                self.enclave.HandleWorkOrderRequestStream(
+                    request, ext_data, stream_data, RESPONSE_SIZE_HINT,
+                    self.acquire_timeout_ms)
+            assert encrypted_response
+        except SystemError as err:
+            # No enclave became free within acquire_timeout_ms
+            logger.error('workorder request invocation failed: %s; '
+                         'enclave queue statistics: %s', str(err),
+                         self.get_enclave_queue_stats())
+            raise
         except Exception as err:
             logger.exception('workorder request invocation failed: %s',
                              str(err))
             raise
 
         try:
-            decrypted_response = crypto.base64_to_byte_array(
-                encoded_encrypted_response)
-            response_string = crypto.byte_array_to_string(decrypted_response)
-            response_parsed = json.loads(response_string[0:-1])
+            # Response is NUL terminated, followed by the data of outData
+            # items streamed out of the enclave
+            response_end = encrypted_response.index(b"\0")
+            response_parsed = json.loads(
+                encrypted_response[0:response_end].decode("utf-8"))
+            self._join_stream_data(response_parsed,
+                                   encrypted_response[response_end + 1:])
         except Exception as err:
             logger.exception('workorder response is invalid: %s',
                              str(err))
             raise
 
         return response_parsed
+
+    def get_enclave_queue_stats(self):
+        """
+        Returns the statistics of the queue of free enclaves: acquire and
+        timeout counts, queue depth and wait time histograms, and the
+        acquire count, busy time and TCS in use of each enclave.
+        See GetEnclaveQueueStats of work_order_wrap.h.
+        """
+        try:
+            return json.loads(self.enclave.GetEnclaveQueueStats())
+        except Exception as err:
+            logger.warning('Failed to get enclave queue statistics: %s',
+                           str(err))
+            return None
+
+    def _split_stream_data(self):
+        """
+        Moves the data of large inData items out of the work order request.
+        Such items carry the size of their data in dataStreamSize instead,
+        and the enclave reads their data piece by piece from the stream.
+
+        Returns :
+            Work order request and data of the streamed inData items
+            concatenated in the order of the inData array
+        """
+        if len(self.work_order) <= STREAM_DATA_THRESHOLD:
+            return self.work_order, b""
+
+        request = json.loads(self.work_order)
+        stream_data = []
+        for item in request.get("params", {}).get("inData", []):
+            data = item.get("data", "")
+            if len(data) > STREAM_DATA_THRESHOLD:
+                item["dataStreamSize"] = len(data)
+                del item["data"]
+                stream_data.append(data)
+
+        if not stream_data:
+            return self.work_order, b""
+        return json.dumps(request), "".join(stream_data).encode("utf-8")
+
+    def _join_stream_data(self, response, stream_data):
+        """
+        Puts the data of outData items streamed out of the enclave back
+        in the response, in place of dataStreamOffset and dataStreamSize.
+
+        Parameters :
+            response - Parsed work order response
+            stream_data - Data following the response
+        """
+        for item in response.get("result", {}).get("outData", []):
+            if "dataStreamSize" in item:
+                offset = item.pop("dataStreamOffset")
+                size = item.pop("dataStreamSize")
+                item["data"] = \
+                    stream_data[offset:offset + size].decode("utf-8")
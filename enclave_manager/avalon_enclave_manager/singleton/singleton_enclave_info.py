@@ -50,6 +50,9 @@ class SingletonEnclaveInfo(BaseEnclaveInfo):
             self.encryption_key = enclave_info['encryption_key']
             self.encryption_key_signature = \
                 enclave_info['encryption_key_signature']
+            self.key_agreement_key = enclave_info['key_agreement_key']
+            self.key_agreement_key_signature = \
+                enclave_info['key_agreement_key_signature']
             self.proof_data = enclave_info['proof_data']
             self.enclave_id = enclave_info['enclave_id']
             self.extended_measurements = self.get_extended_measurements()
@@ -79,6 +82,9 @@ class SingletonEnclaveInfo(BaseEnclaveInfo):
         enclave_info['encryption_key'] = enclave_data.encryption_key
         enclave_info['encryption_key_signature'] = \
             enclave_data.encryption_key_signature
+        enclave_info['key_agreement_key'] = enclave_data.key_agreement_key
+        enclave_info['key_agreement_key_signature'] = \
+            enclave_data.key_agreement_key_signature
         enclave_info['enclave_id'] = enclave_data.verifying_key
         enclave_info['proof_data'] = ''
         if not self.is_sgx_simulator():
@@ -94,7 +94,8 @@ class SingletonEnclaveManager(WOProcessorManager):
         try:
             wo_request = work_order_request.SgxWorkOrderRequest(
                 EnclaveType.SINGLETON,
-                input_json_str)
+                input_json_str,
+                acquire_timeout_ms=self._acquire_timeout_ms)
         except Exception as e:
             logger.exception(
                 'Failed to initialize SgxWorkOrderRequest; %s', str(e))
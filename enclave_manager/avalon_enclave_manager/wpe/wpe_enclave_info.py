@@ -66,6 +66,9 @@ class WorkOrderProcessorEnclaveInfo(BaseEnclaveInfo):
             self.encryption_key = enclave_data.encryption_key
             self.encryption_key_signature = \
                 enclave_data.encryption_key_signature
+            self.key_agreement_key = enclave_data.key_agreement_key
+            self.key_agreement_key_signature = \
+                enclave_data.key_agreement_key_signature
             self.enclave_id = enclave_data.verifying_key
             self.proof_data = ''
             if not self.is_sgx_simulator():
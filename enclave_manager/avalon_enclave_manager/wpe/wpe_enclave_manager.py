@@ -107,7 +107,8 @@ class WorkOrderProcessorEnclaveManager(
         wo_request = work_order_request.SgxWorkOrderRequest(
             EnclaveType.WPE,
             input_json_str,
-            pre_proc_output)
+            pre_proc_output,
+            self._acquire_timeout_ms)
         return wo_request.execute()
 
 # -------------------------------------------------------------------------
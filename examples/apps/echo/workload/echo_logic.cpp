@@ -16,6 +16,41 @@
 #include <string>
 #include "echo_logic.h"
 
+// Size of the pieces streamed input is read in
+#define ECHO_CHUNK_SIZE (64 * 1024)
+
+static const char result_prefix[] = "RESULT: ";
+static const size_t result_prefix_size = sizeof(result_prefix) - 1;
+
 std::string Process(std::string str_in) {
-    return "RESULT: " + str_in;
+    return result_prefix + str_in;
+}
+
+void ProcessData(const tcf::WorkOrderData& in_data,
+    tcf::WorkOrderData& out_data) {
+    if (!in_data.reader) {
+        std::string result_str = Process(
+            ByteArrayToString(in_data.decrypted_data));
+        out_data.decrypted_data = ByteArray(result_str.begin(),
+            result_str.end());
+        return;
+    }
+
+    ByteArray chunk(ECHO_CHUNK_SIZE);
+    if (out_data.writer) {
+        out_data.writer->Write(
+            (const uint8_t*) result_prefix, result_prefix_size);
+        size_t n;
+        while ((n = in_data.reader->Read(chunk.data(), chunk.size())) > 0) {
+            out_data.writer->Write(chunk.data(), n);
+        }
+    } else {
+        out_data.decrypted_data.assign(result_prefix,
+            result_prefix + result_prefix_size);
+        size_t n;
+        while ((n = in_data.reader->Read(chunk.data(), chunk.size())) > 0) {
+            out_data.decrypted_data.insert(out_data.decrypted_data.end(),
+                chunk.begin(), chunk.begin() + n);
+        }
+    }
 }
@@ -16,6 +16,13 @@
 #pragma once
 
 #include <string>
+#include "work_order_data.h"
 
 extern std::string Process(std::string str_in);
 
+// Same as Process() for a work order data item. The input is read through
+// in_data.reader and the result is written through out_data.writer if
+// they are set, piece by piece, so that streamed data is never held whole.
+extern void ProcessData(const tcf::WorkOrderData& in_data,
+    tcf::WorkOrderData& out_data);
+
@@ -29,25 +29,18 @@ void EchoResult::ProcessWorkOrder(
         const ByteArray& work_order_id,
         const std::vector<tcf::WorkOrderData>& in_work_order_data,
         std::vector<tcf::WorkOrderData>& out_work_order_data) {
-    std::string result_str;
     int i = 0;
     int out_wo_data_size = out_work_order_data.size();
 
-    for (auto wo_data : in_work_order_data) {
-        // Process the input data
-        result_str = Process(
-            ByteArrayToString(wo_data.decrypted_data));
-
+    for (const auto& wo_data : in_work_order_data) {
         // If the out_work_order_data has entry to hold the data
         if (i < out_wo_data_size) {
-            tcf::WorkOrderData& out_wo_data = out_work_order_data.at(i);
-            out_wo_data.decrypted_data =
-                ByteArray(result_str.begin(), result_str.end());
+            ProcessData(wo_data, out_work_order_data.at(i));
         } else {
             // Create a new entry
-            out_work_order_data.emplace_back(
-                wo_data.index, ByteArray(result_str.begin(), result_str.end()));
-            }
+            out_work_order_data.emplace_back(wo_data.index, ByteArray());
+            ProcessData(wo_data, out_work_order_data.back());
+        }
 
         i++;
     }
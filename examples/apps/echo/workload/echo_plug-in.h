@@ -26,6 +26,16 @@ public:
 
     IMPL_WORKLOAD_PROCESSOR_CLONE(EchoResult)
 
+    // Echo keeps no state between work orders
+    bool IsReusable() const override {
+        return true;
+    }
+
+    // Echo reads and writes large data piece by piece
+    bool SupportsStreamedData() const override {
+        return true;
+    }
+
     void ProcessWorkOrder(
                 std::string workload_id,
                 const ByteArray& requester_id,
@@ -61,6 +61,18 @@ class BaseGenericClient(GenericClientInterface):
                     "Failed to verify worker encryption key signature")
                 return False
 
+        key_agreement_key = getattr(worker_obj, "key_agreement_key", "")
+        if key_agreement_key:
+            # Verify worker key agreement key signature
+            # using worker verification key
+            sig_status = self.signer.verify_encryption_key_signature(
+                worker_obj.key_agreement_key_signature, key_agreement_key,
+                worker_obj.verification_key)
+            if (sig_status != SignatureStatus.PASSED):
+                logger.error(
+                    "Failed to verify worker key agreement key signature")
+                return False
+
         # TODO Need to do verify MRENCLAVE value
         # in the attestation report
         if not worker_obj.proof_data:
@@ -95,7 +107,8 @@ class BaseGenericClient(GenericClientInterface):
     def create_work_order_params(self, worker_id, workload_id,
                                  in_data, worker_encrypt_key,
                                  session_key, session_iv,
-                                 enc_data_enc_key):
+                                 enc_data_enc_key,
+                                 worker_key_agreement_key=None):
         """
         Create work order request params
         """
@@ -113,11 +126,14 @@ class BaseGenericClient(GenericClientInterface):
                 self._work_order_id, worker_id, work_load_id, requester_id,
                 self._session_key, self._session_iv, requester_nonce,
                 worker_encryption_key=worker_encrypt_key,
-                data_encryption_algorithm="AES-GCM-256"
+                data_encryption_algorithm="AES-GCM-256",
+                worker_key_agreement_key=worker_key_agreement_key
             )
 
             if error is not None:
                 return False, error
+            # Session key is derived when key agreement is used
+            self._session_key = wo_params.get_session_key()
         except Exception as err:
             logging.error("Exception occurred while "
                           "creating work order request {}".format(err))
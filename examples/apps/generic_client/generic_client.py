@@ -315,7 +315,8 @@ def Main(args=None):
         parser.in_data(),
         worker_obj.encryption_key,
         session_key, session_iv,
-        encrypted_data_encryption_key)
+        encrypted_data_encryption_key,
+        worker_obj.key_agreement_key)
 
     if not code:
         logging.error("Work order request creation failed \
@@ -46,7 +46,8 @@ class GenericClientInterface(ABC):
     def create_work_order_params(self, worker_id, workload_id,
                                  in_data, worker_encrypt_key,
                                  session_key, session_iv,
-                                 enc_data_enc_key):
+                                 enc_data_enc_key,
+                                 worker_key_agreement_key=None):
         """
         Create work order request using work order
         params class.
@@ -57,6 +58,8 @@ class GenericClientInterface(ABC):
         @param session_key session key
         @param session_iv session iv
         @param enc_data_enc_key data encryption key
+        @param worker_key_agreement_key worker key agreement key, if set
+                                        the session key is derived with it
         Returns work order params object
         """
         pass
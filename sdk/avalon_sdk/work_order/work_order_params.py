@@ -39,8 +39,13 @@ class WorkOrderParams():
             requester_nonce, verifying_key=None, payload_format="JSON-RPC",
             response_timeout_msecs=6000, result_uri=None,
             notify_uri=None, worker_encryption_key=None,
-            data_encryption_algorithm=None, encrypted_session_key=None):
-        """validate and creates workorder request with received values"""
+            data_encryption_algorithm=None, encrypted_session_key=None,
+            worker_key_agreement_key=None):
+        """validate and creates workorder request with received values.
+        If the hex encoded key agreement key of the worker is passed, the
+        session key is derived with it instead of being encrypted with the
+        worker encryption key, and session_key is not used. The derived
+        session key is returned by get_session_key()."""
         if work_order_id:
             self.set_work_order_id(work_order_id)
         self.set_response_timeout_msecs(response_timeout_msecs)
@@ -78,13 +83,30 @@ class WorkOrderParams():
                 0,
                 err_msg)
 
-        self.set_worker_encryption_key(
-            worker_encryption_key.encode("UTF-8").hex())
-
         self.session_iv = session_iv
         self.params_obj["encryptedRequestHash"] = ""
         self.params_obj["requesterSignature"] = ""
         self.params_obj["inData"] = list()
+        if worker_key_agreement_key:
+            # The worker derives the session key from the ephemeral public
+            # key passed in place of the encrypted session key
+            try:
+                self.session_key, ephemeral_public_key = \
+                    self.encrypt.derive_session_key(worker_key_agreement_key)
+            except Exception as err:
+                return util.create_error_response(
+                    WorkOrderStatus.INVALID_PARAMETER_FORMAT_OR_VALUE,
+                    0,
+                    err)
+            self.set_worker_encryption_key(
+                worker_key_agreement_key.encode("UTF-8").hex())
+            self.set_encrypted_session_key(
+                crypto_utility.byte_array_to_hex(ephemeral_public_key))
+            return None
+
+        self.set_worker_encryption_key(
+            worker_encryption_key.encode("UTF-8").hex())
+
         if encrypted_session_key is None:
             try:
                 encrypted_session_key = self.encrypt.encrypt_session_key(
@@ -308,6 +330,10 @@ class WorkOrderParams():
         """Return requesterId work order parameter."""
         return self.params_obj["requesterId"]
 
+    def get_session_key(self):
+        """Return session key of the work order."""
+        return self.session_key
+
     def get_session_key_iv(self):
         """Return sessionKeyIv work order parameter."""
         return self.params_obj["sessionKeyIv"]
@@ -116,6 +116,8 @@ class WorkerDetails():
             "encryptionKey",
             "encryptionKeyNonce",
             "encryptionKeySignature",
+            "keyAgreementKey",
+            "keyAgreementKeySignature",
             "enclaveCertificate"
         ]
 
@@ -197,6 +199,8 @@ class SGXWorkerDetails(WorkerDetails):
         self.encryption_key = ""
         self.encryption_key_nonce = ""
         self.encryption_key_signature = ""
+        self.key_agreement_key = ""
+        self.key_agreement_key_signature = ""
         self.enclave_certificate = ""
 
 # -----------------------------------------------------------------------------
@@ -218,6 +222,11 @@ class SGXWorkerDetails(WorkerDetails):
         self.encryption_key = worker_data['workerTypeData']['encryptionKey']
         self.encryption_key_signature = \
             worker_data['workerTypeData']['encryptionKeySignature']
+        # Only published by workers supporting ECDH session key agreement
+        self.key_agreement_key = \
+            worker_data['workerTypeData'].get('keyAgreementKey', "")
+        self.key_agreement_key_signature = \
+            worker_data['workerTypeData'].get('keyAgreementKeySignature', "")
         if 'proofData' in worker_data['workerTypeData'] and \
                 worker_data['workerTypeData']['proofData']:
             # proofData will be initialized only in HW mode by the
@@ -56,6 +56,28 @@ tcf_err_t ecall_Initialize(uint8_t* persistedSealedEnclaveData,
     return result;
 }  // ecall_Initialize
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf_err_t ecall_GetTcsCount(uint32_t* outTcsCount) {
+    tcf_err_t result = TCF_SUCCESS;
+
+    try {
+        tcf::error::ThrowIfNull(outTcsCount, "TCS count pointer is NULL");
+        *outTcsCount = ENCLAVE_TCS_NUM;
+    } catch (tcf::error::Error& e) {
+        SAFE_LOG(TCF_LOG_ERROR,
+            "Error in Avalon enclave(ecall_GetTcsCount): %04X -- %s",
+            e.error_code(), e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    } catch (...) {
+        SAFE_LOG(TCF_LOG_ERROR,
+            "Unknown error in Avalon enclave(ecall_GetTcsCount)");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // ecall_GetTcsCount
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 tcf_err_t ecall_CreateErsatzEnclaveReport(sgx_target_info_t* targetInfo, sgx_report_t* outReport) {
     tcf_err_t result = TCF_SUCCESS;
@@ -20,6 +20,13 @@
 
 #include "tcf_error.h"
 
+// Number of TCS the enclave is signed with, see ENCLAVE_TCS_NUM in
+// CMakeVariables.txt. It is the number of work orders the enclave can
+// execute concurrently.
+#ifndef ENCLAVE_TCS_NUM
+#define ENCLAVE_TCS_NUM 2
+#endif
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 extern tcf_err_t ecall_Initialize();
 
@@ -27,3 +34,5 @@ extern tcf_err_t ecall_Initialize();
 extern tcf_err_t ecall_CreateErsatzEnclaveReport(
     sgx_target_info_t* targetInfo, sgx_report_t* outReport);
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+extern tcf_err_t ecall_GetTcsCount(uint32_t* outTcsCount);
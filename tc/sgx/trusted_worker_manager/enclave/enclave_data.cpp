@@ -38,10 +38,12 @@
 // of private signature and private encryption keys
 #define MAX_SERIALIZED_SIG_PRIV_KEY_SIZE 256
 #define MAX_SERIALIZED_ENC_PRIV_KEY_SIZE 2048
+#define MAX_SERIALIZED_AGREEMENT_PRIV_KEY_SIZE 128
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-EnclaveData::EnclaveData(void) {
+EnclaveData::EnclaveData(void) :
+    data_lock_(SGX_SPINLOCK_INITIALIZER) {
     // Do not attempt to catch errors here... let the calling procedure
     // handle the constructor errors
 
@@ -50,6 +52,7 @@ EnclaveData::EnclaveData(void) {
 
     // Create the public verifying key
     public_signing_key_ = private_signing_key_.GetPublicKey();
+    signer_.reset(new tcf::crypto::sig::Signer(private_signing_key_));
 
     // Generate private encryption key
     private_encryption_key_.Generate();
@@ -57,7 +60,10 @@ EnclaveData::EnclaveData(void) {
     // Create the public encryption key
     public_encryption_key_ = private_encryption_key_.GetPublicKey();
 
-    // Create encryption key signature
+    // Generate key agreement key
+    key_agreement_key_.Generate();
+
+    // Create encryption and key agreement key signatures
     generate_encryption_key_signature();
 
     SerializePrivateData();
@@ -65,7 +71,8 @@ EnclaveData::EnclaveData(void) {
 }
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-EnclaveData::EnclaveData(const uint8_t* inSealedData) {
+EnclaveData::EnclaveData(const uint8_t* inSealedData) :
+    data_lock_(SGX_SPINLOCK_INITIALIZER) {
     tcf::error::ThrowIfNull(inSealedData, "Sealed sign up data pointer is NULL");
     uint32_t decrypted_size =
         sgx_get_encrypt_txt_len(reinterpret_cast<const sgx_sealed_data_t*>(inSealedData));
@@ -80,11 +87,12 @@ EnclaveData::EnclaveData(const uint8_t* inSealedData) {
     tcf::error::ThrowSgxError(ret, "Failed to unseal  data");
     std::string decrypted_data_string(reinterpret_cast<const char*>(&decrypted_data[0]));
     DeserializeSealedData(decrypted_data_string);
+    signer_.reset(new tcf::crypto::sig::Signer(private_signing_key_));
     // Clear local variable storing secret(s)
     decrypted_data.clear();
     decrypted_data_string.clear();
 
-    // Create encryption key signature
+    // Create encryption and key agreement key signatures
     generate_encryption_key_signature();
 
     SerializePrivateData();
@@ -144,6 +152,19 @@ void EnclaveData::DeserializeSealedData(const std::string& inSerializedEnclaveDa
     // Clear local variables storing secrets before re-assigning new value
     svalue.clear();
     memset_s((char*)pvalue, MAX_SERIALIZED_ENC_PRIV_KEY_SIZE, 0, pvalue_len);
+
+    // Private key agreement key, data sealed before it was introduced
+    // gets a new one
+    pvalue = json_object_dotget_string(keystore_object, "KeyAgreementKey.PrivateKey");
+    if (pvalue) {
+        pvalue_len = strnlen_s(pvalue, MAX_SERIALIZED_AGREEMENT_PRIV_KEY_SIZE);
+        svalue.assign(pvalue);
+        key_agreement_key_.Deserialize(svalue);
+        svalue.clear();
+        memset_s((char*)pvalue, MAX_SERIALIZED_AGREEMENT_PRIV_KEY_SIZE, 0, pvalue_len);
+    } else {
+        key_agreement_key_.Generate();
+    }
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -217,6 +238,22 @@ void EnclaveData::SerializePrivateData(void) {
     // Sanitize local variables storing secrets
     b64_public_encryption_key.clear();
 
+    // Private key agreement key
+    std::string hex_private_agreement_key = key_agreement_key_.Serialize();
+    jret = json_object_dotset_string(
+        dataObject, "KeyAgreementKey.PrivateKey", hex_private_agreement_key.c_str());
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(
+        jret != JSONSuccess, "enclave data serialization failed on private key agreement key");
+
+    // Sanitize local variables storing secrets
+    hex_private_agreement_key.clear();
+
+    // Public key agreement key
+    jret = json_object_dotset_string(dataObject, "KeyAgreementKey.PublicKey",
+        key_agreement_key_.SerializePublicKey().c_str());
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(
+        jret != JSONSuccess, "enclave data serialization failed on public key agreement key");
+
     size_t serializedSize = json_serialization_size(dataValue);
 
     std::vector<char> serialized_buffer;
@@ -269,6 +306,18 @@ void EnclaveData::SerializePublicData(void) {
         jret != JSONSuccess, \
         "enclave data serialization failed on public encryption key signature");
 
+    // Public key agreement key and its signature
+    jret = json_object_dotset_string(dataObject, "KeyAgreementKey",
+        key_agreement_key_.SerializePublicKey().c_str());
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(
+        jret != JSONSuccess, "enclave data serialization failed on public key agreement key");
+
+    jret = json_object_dotset_string(dataObject, "KeyAgreementKeySignature",
+        key_agreement_key_signature_.c_str());
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(
+        jret != JSONSuccess,
+        "enclave data serialization failed on key agreement key signature");
+
     size_t serializedSize = json_serialization_size(dataValue);
 
     std::vector<char> serialized_buffer;
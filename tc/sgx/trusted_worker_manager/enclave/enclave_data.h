@@ -16,14 +16,17 @@
 #pragma once
 
 #include "sgx_tseal.h"
+#include "sgx_spinlock.h"
 
 #include <stdint.h>
 #include <cassert>
+#include <memory>
 #include <string>
 
 #include "crypto.h"
 #include "utils.h"
 #include "hex_string.h"
+#include "enclave_utils.h"
 
 // JSON format for private data:
 // {
@@ -39,6 +42,12 @@
 //         "PrivateKey" : "",
 //     },
 //
+//     "KeyAgreementKey" :
+//     {
+//         "PublicKey" : "",
+//         "PrivateKey" : "",
+//     },
+//
 //     If KME, Extended data consists of MRENCLAVE value of associated WPE
 //     If WPE, Extended data consists of verification key of associated KME
 //     in hex format.
@@ -50,6 +59,8 @@
 //     "SigningKey" : "",
 //     "EncryptionKey" : ""
 //     "EncryptionKeySignature" : ""
+//     "KeyAgreementKey" : ""
+//     "KeyAgreementKeySignature" : ""
 // }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -60,6 +71,9 @@ private:
     ~EnclaveData(void);
 
     static EnclaveData* instance;
+    // Serializes creation of the instance when work orders are executed
+    // on several TCS concurrently
+    static sgx_spinlock_t instance_lock;
  
 protected:
     void SerializePrivateData(void);
@@ -68,18 +82,29 @@ protected:
 
     tcf::crypto::sig::PublicKey public_signing_key_;
     tcf::crypto::sig::PrivateKey private_signing_key_;
+    // Signs with private_signing_key_, which signs every work order
+    // response, set up once the key is known
+    std::unique_ptr<tcf::crypto::sig::Signer> signer_;
     tcf::crypto::pkenc::PublicKey public_encryption_key_;
     tcf::crypto::pkenc::PrivateKey private_encryption_key_;
     std::string encryption_key_signature_;
+    // ECDH key requesters can agree on work order session keys with,
+    // instead of encrypting them with the RSA encryption key
+    tcf::crypto::ecdh::PrivateKey key_agreement_key_;
+    std::string key_agreement_key_signature_;
 
     ByteArray extended_data_;
     std::string nonce_;
+    // Protects extended_data_ and nonce_, which can be updated after
+    // the instance is created
+    mutable sgx_spinlock_t data_lock_;
 
     std::string serialized_private_data_;
     std::string serialized_public_data_;
 
 public:
      static EnclaveData* getInstance(const uint8_t* inSealedData=nullptr) {
+        tcf::SpinLockGuard guard(&instance_lock);
         if(!instance) {
             if(inSealedData != nullptr)
                 instance = new EnclaveData(inSealedData);
@@ -97,8 +122,15 @@ public:
         return private_encryption_key_.DecryptMessage(cipher);
     }
 
+    // Session key agreed on with the requester's ephemeral ECDH key
+    ByteArray derive_session_key(const ByteArray& requester_public_key) const {
+        return tcf::crypto::ecdh::DeriveSessionKey(
+            key_agreement_key_.ComputeSharedSecret(requester_public_key),
+            requester_public_key, key_agreement_key_.GetPublicKey());
+    }
+
     ByteArray sign_message(const ByteArray& message) const {
-        return private_signing_key_.SignMessage(message);
+        return signer_->SignMessage(message);
     }
 
     int verify_signature(const ByteArray& message, const ByteArray& signature) const {
@@ -106,18 +138,22 @@ public:
     }
 
     void set_extended_data(const ByteArray& in_ex_data) {
+        tcf::SpinLockGuard guard(&data_lock_);
         extended_data_ = in_ex_data;
     }
 
     void set_nonce(std::string nonce) {
+        tcf::SpinLockGuard guard(&data_lock_);
         nonce_ = nonce;
     }
 
     std::string get_nonce() {
+        tcf::SpinLockGuard guard(&data_lock_);
         return nonce_;
     }
 
     ByteArray get_extended_data() {
+        tcf::SpinLockGuard guard(&data_lock_);
         return extended_data_;
     }
 
@@ -127,6 +163,10 @@ public:
         return public_encryption_key_.Serialize();
     }
 
+    std::string get_serialized_key_agreement_key(void) const {
+        return key_agreement_key_.SerializePublicKey();
+    }
+
     std::string get_enclave_id(void) const { return public_signing_key_.Serialize(); }
 
     std::string get_public_data(void) const { return serialized_public_data_; }
@@ -144,6 +184,15 @@ public:
                 tcf::crypto::ComputeMessageHash(StrToByteArray(b64_pub_encr_key)));
         encryption_key_signature_ = \
             ByteArrayToHexEncodedString(encr_key_sig_bytes);
+
+        std::string hex_key_agreement_key =
+            key_agreement_key_.SerializePublicKey();
+        ByteArray agreement_key_sig_bytes = \
+            private_signing_key_.SignMessage(
+                tcf::crypto::ComputeMessageHash(
+                    StrToByteArray(hex_key_agreement_key)));
+        key_agreement_key_signature_ = \
+            ByteArrayToHexEncodedString(agreement_key_sig_bytes);
     }
 
     size_t get_sealed_data_size(void) const {
@@ -15,7 +15,10 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <string.h>
+#include <string>
+#include <sgx_spinlock.h>
 
 #include "error.h"
 
@@ -30,3 +33,41 @@ extern void printf(const char* fmt, ...);
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 extern void Log(int level, const char* fmt, ...);
+
+namespace tcf {
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Holds an SGX spinlock for the lifetime of the guard object, so that
+    // the lock is released when an exception is thrown
+    class SpinLockGuard {
+    public:
+        explicit SpinLockGuard(sgx_spinlock_t* lock) : lock_(lock) {
+            sgx_spin_lock(lock_);
+        }
+
+        ~SpinLockGuard() {
+            sgx_spin_unlock(lock_);
+        }
+
+    private:
+        SpinLockGuard(const SpinLockGuard&);
+        SpinLockGuard& operator=(const SpinLockGuard&);
+
+        sgx_spinlock_t* lock_;
+    };  // class SpinLockGuard
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // Returns a buffer marshalled into the enclave as a NUL terminated
+    // string. The buffer is used in place when the caller passed it with
+    // its terminating NUL, otherwise it is copied to storage.
+    inline const char* BufferAsCString(const uint8_t* buffer,
+        size_t size,
+        std::string& storage) {
+        if (size > 0 && buffer[size - 1] == '\0') {
+            return (const char*) buffer;
+        }
+        storage.assign((const char*) buffer, size);
+        return storage.c_str();
+    }  // BufferAsCString
+
+}  // namespace tcf
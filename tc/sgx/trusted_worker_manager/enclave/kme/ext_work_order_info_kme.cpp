@@ -32,6 +32,7 @@
 
 #include "enclave_utils.h"
 #include "ext_work_order_info_kme.h"
+#include "kme_key_pool.h"
 #include "epid_signup_helper.h"
 #include "dcap_signup_helper.h"
 #include "signup_helper.h"
@@ -56,17 +57,14 @@ int ExtWorkOrderInfoKME::GenerateSigningKey(
         return result;
     }
 
-    tcf::crypto::sig::PrivateKey private_sig_key;
-    tcf::crypto::sig::PublicKey public_sig_key;
-
     try {
-        // Generate Signing key pair
-        private_sig_key.Generate();
-        public_sig_key = private_sig_key.GetPublicKey();
+        // Take a pre-generated signing key pair
+        tcf::KMESigningKey sig_key =
+            tcf::KMEKeyPool::getInstance()->TakeSigningKey();
 
-        signing_key = StrToByteArray(private_sig_key.Serialize());
+        signing_key = StrToByteArray(sig_key.private_key_pem);
 
-        ByteArray v_key_bytes = StrToByteArray(public_sig_key.Serialize());
+        ByteArray v_key_bytes = StrToByteArray(sig_key.public_key_pem);
         std::string v_key_hex_str = ByteArrayToHexEncodedString(v_key_bytes);
         verification_key_hex = StrToByteArray(v_key_hex_str);
 
@@ -78,7 +76,7 @@ int ExtWorkOrderInfoKME::GenerateSigningKey(
             ByteArrayToStr(nonce_hex).c_str();
         ByteArray msg_hash = tcf::crypto::ComputeMessageHash(
             StrToByteArray(msg));
-        ByteArray signature = private_sig_key.SignMessage(msg_hash);
+        ByteArray signature = sig_key.private_key.SignMessage(msg_hash);
 
         std::string signature_hex = ByteArrayToHexEncodedString(signature);
         verification_key_signature_hex = StrToByteArray(signature_hex);
@@ -122,33 +120,32 @@ int ExtWorkOrderInfoKME::CreateWorkOrderKeyInfo(
 
     tcf_err_t result = TCF_SUCCESS;
 
-    tcf::crypto::sig::PrivateKey private_sig_key;
-    tcf::crypto::sig::PublicKey public_sig_key;
     try {
+        tcf::KMEKeyPool* key_pool = tcf::KMEKeyPool::getInstance();
         WorkOrderKeyInfo wo_key_info;
         wo_key_info.in_data_keys = this->in_work_order_keys;
         wo_key_info.out_data_keys =  this->out_work_order_keys;
 
-        // generate symmetric key
-        wo_key_info.sym_key = tcf::crypto::skenc::GenerateKey();
+        // Take a pre-generated symmetric key
+        wo_key_info.sym_key = key_pool->TakeSymmetricKey();
 
         // encrypted_wo_key is the encrypted version of session key
         // generated client using symmetric key generated above
         wo_key_info.encrypted_wo_key = tcf::crypto::skenc::EncryptMessage(
             wo_key_info.sym_key, this->work_order_sym_key);
 
-        // Generate work order signing key pair to sign work order response
-        // and encrypt the signing key using symmetric key generated above
-        private_sig_key.Generate();
-        public_sig_key = private_sig_key.GetPublicKey();
+        // Take a pre-generated work order signing key pair to sign work
+        // order response and encrypt the signing key using symmetric key
+        // taken above
+        tcf::KMESigningKey sig_key = key_pool->TakeSigningKey();
 
-        ByteArray signing_key = StrToByteArray(private_sig_key.Serialize());
+        ByteArray signing_key = StrToByteArray(sig_key.private_key_pem);
         // verification_key is PEM encoded public key string
-        wo_key_info.verification_key = public_sig_key.Serialize();
+        wo_key_info.verification_key = sig_key.public_key_pem;
 
         // Generate signature on verification key and nonce
         std::string concat_str = \
-            public_sig_key.Serialize() + this->wo_requester_nonce;
+            sig_key.public_key_pem + this->wo_requester_nonce;
 
         // Sign hash of concatenated verification key signature and
         // requester nonce using worker's private key.
@@ -251,26 +248,25 @@ void ExtWorkOrderInfoKME::CalculateWorkOrderKeyInfoHash(
 
     // sort input-data-keys and output-data-keys based on indices
     std::sort(wo_key_info.in_data_keys.begin(), wo_key_info.in_data_keys.end(),
-        [](tcf::WorkOrderData x, tcf::WorkOrderData y) {
+        [](const tcf::WorkOrderData& x, const tcf::WorkOrderData& y) {
             return x.index < y.index;});
 
     std::sort(wo_key_info.out_data_keys.begin(), wo_key_info.out_data_keys.end(),
-        [](tcf::WorkOrderData x, tcf::WorkOrderData y) {
+        [](const tcf::WorkOrderData& x, const tcf::WorkOrderData& y) {
             return x.index < y.index;});
 
-    std::string in_data_hash_str;
-    for (auto d: wo_key_info.in_data_keys) {
-        in_data_hash_str += ByteArrayToBase64EncodedString(
-            tcf::crypto::ComputeMessageHash(d.decrypted_data));
+    // Keys of inData followed by keys of outData, all hashed at once
+    std::vector<const ByteArray*> data_keys;
+    for (const auto& d: wo_key_info.in_data_keys) {
+        data_keys.push_back(&d.decrypted_data);
     }
-
-    std::string out_data_hash_str;
-    for (auto d: wo_key_info.out_data_keys) {
-        out_data_hash_str += ByteArrayToBase64EncodedString(
-            tcf::crypto::ComputeMessageHash(d.decrypted_data));
+    for (const auto& d: wo_key_info.out_data_keys) {
+        data_keys.push_back(&d.decrypted_data);
+    }
+    std::string final_hash_str = hash1_str;
+    for (const auto& hash: tcf::crypto::ComputeMessageHashes(data_keys)) {
+        final_hash_str += ByteArrayToBase64EncodedString(hash);
     }
-    std::string final_hash_str = \
-        hash1_str + in_data_hash_str + out_data_hash_str;
     wo_key_info_hash = tcf::crypto::ComputeMessageHash(
         StrToByteArray(final_hash_str));
 }  // ExtWorkOrderInfoKME::CalculateWorkOrderKeyInfoHash
@@ -319,7 +315,7 @@ ByteArray ExtWorkOrderInfoKME::CreateJsonWorkOrderKeys(
 
    JSON_Value* key_item_value;
    JSON_Object* key_item_object;
-    for (auto wo_key: wo_key_info.in_data_keys) {
+    for (const auto& wo_key: wo_key_info.in_data_keys) {
         key_item_value = json_value_init_object();
         tcf::error::ThrowIfNull(key_item_value,
             "failed to create a key item value");
@@ -347,7 +343,7 @@ ByteArray ExtWorkOrderInfoKME::CreateJsonWorkOrderKeys(
     tcf::error::ThrowIfNull(out_data_keys_arr,
         "failed to get output-data-keys array");
 
-    for (auto wo_key: wo_key_info.out_data_keys) {
+    for (const auto& wo_key: wo_key_info.out_data_keys) {
         key_item_value = json_value_init_object();
         tcf::error::ThrowIfNull(key_item_value,
             "failed to create a key item value");
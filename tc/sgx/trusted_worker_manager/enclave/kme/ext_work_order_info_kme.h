@@ -16,6 +16,7 @@
 #pragma once
 
 #include <stdlib.h>
+#include <utility>
 #include <vector>
 
 #include "work_order_key_info.h"
@@ -163,11 +164,11 @@ public:
     }
 
     void SetWorkOrderInDataKeys(std::vector<tcf::WorkOrderData> in_wo_keys) {
-        this->in_work_order_keys = in_wo_keys;
+        this->in_work_order_keys = std::move(in_wo_keys);
     }
 
     void SetWorkOrderOutDataKeys(std::vector<tcf::WorkOrderData> out_wo_keys) {
-        this->out_work_order_keys = out_wo_keys;
+        this->out_work_order_keys = std::move(out_wo_keys);
     }
 
     void SetWorkOrderRequesterNonce(std::string wo_nonce) {
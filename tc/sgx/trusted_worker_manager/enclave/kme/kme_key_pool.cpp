@@ -0,0 +1,171 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <utility>
+
+#include "error.h"
+#include "tcf_error.h"
+#include "types.h"
+#include "zero.h"
+
+#include "crypto.h"
+#include "enclave_utils.h"
+#include "kme_key_pool.h"
+
+tcf::KMEKeyPool tcf::KMEKeyPool::instance(KME_KEY_POOL_DEPTH);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::KMEKeyPool::KMEKeyPool(size_t depth) :
+    depth_(depth), hits_(0), misses_(0),
+    lock_(SGX_SPINLOCK_INITIALIZER) {
+}  // KMEKeyPool::KMEKeyPool
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::KMEKeyPool::~KMEKeyPool(void) {
+    Clear();
+}  // KMEKeyPool::~KMEKeyPool
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::KMEKeyPool* tcf::KMEKeyPool::getInstance(void) {
+    return &instance;
+}  // KMEKeyPool::getInstance
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::KMESigningKey tcf::KMEKeyPool::GenerateSigningKey(void) {
+    KMESigningKey key;
+    key.private_key.Generate();
+    key.private_key_pem = key.private_key.Serialize();
+    key.public_key_pem = key.private_key.GetPublicKey().Serialize();
+    return key;
+}  // KMEKeyPool::GenerateSigningKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Fill the pool up to its depth. Keys are generated without holding
+ * the pool lock, so work orders can take keys while it is refilled.
+ *
+ * @param max_keys Maximum number of signing key pairs to generate,
+ *                 this bounds the time the caller spends in the enclave
+ * @returns number of signing key pairs in the pool
+ */
+size_t tcf::KMEKeyPool::Refill(size_t max_keys) {
+    size_t missing_symmetric_keys = 0;
+    {
+        tcf::SpinLockGuard guard(&lock_);
+        if (symmetric_keys_.size() < depth_) {
+            missing_symmetric_keys = depth_ - symmetric_keys_.size();
+        }
+    }
+    for (size_t i = 0; i < missing_symmetric_keys; i++) {
+        ByteArray sym_key = tcf::crypto::skenc::GenerateKey();
+        tcf::SpinLockGuard guard(&lock_);
+        if (symmetric_keys_.size() >= depth_) {
+            ZeroV(sym_key);
+            break;
+        }
+        symmetric_keys_.push_back(std::move(sym_key));
+    }
+
+    for (size_t i = 0; i < max_keys; i++) {
+        {
+            tcf::SpinLockGuard guard(&lock_);
+            if (signing_keys_.size() >= depth_) {
+                break;
+            }
+        }
+        KMESigningKey key = GenerateSigningKey();
+        tcf::SpinLockGuard guard(&lock_);
+        if (signing_keys_.size() >= depth_) {
+            Zero(&key.private_key_pem[0], key.private_key_pem.size());
+            break;
+        }
+        signing_keys_.push_back(std::move(key));
+    }
+
+    tcf::SpinLockGuard guard(&lock_);
+    return signing_keys_.size();
+}  // KMEKeyPool::Refill
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Take a work order signing key pair out of the pool. The key pair is
+ * generated if the pool is empty.
+ *
+ * @returns secp256k1 key pair which is not handed out again
+ */
+tcf::KMESigningKey tcf::KMEKeyPool::TakeSigningKey(void) {
+    {
+        tcf::SpinLockGuard guard(&lock_);
+        if (!signing_keys_.empty()) {
+            hits_++;
+            KMESigningKey key = std::move(signing_keys_.front());
+            signing_keys_.pop_front();
+            return key;
+        }
+        misses_++;
+    }
+    return GenerateSigningKey();
+}  // KMEKeyPool::TakeSigningKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Take a symmetric work order key out of the pool. The key is
+ * generated if the pool is empty.
+ *
+ * @returns AES-GCM-256 key which is not handed out again
+ */
+ByteArray tcf::KMEKeyPool::TakeSymmetricKey(void) {
+    {
+        tcf::SpinLockGuard guard(&lock_);
+        if (!symmetric_keys_.empty()) {
+            hits_++;
+            ByteArray key = std::move(symmetric_keys_.front());
+            symmetric_keys_.pop_front();
+            return key;
+        }
+        misses_++;
+    }
+    return tcf::crypto::skenc::GenerateKey();
+}  // KMEKeyPool::TakeSymmetricKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::KMEKeyPoolStats tcf::KMEKeyPool::GetStats(void) {
+    tcf::SpinLockGuard guard(&lock_);
+    KMEKeyPoolStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.signing_keys = signing_keys_.size();
+    stats.symmetric_keys = symmetric_keys_.size();
+    stats.depth = depth_;
+    return stats;
+}  // KMEKeyPool::GetStats
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Zeroizes and drops all pooled keys
+void tcf::KMEKeyPool::Clear(void) {
+    tcf::SpinLockGuard guard(&lock_);
+    for (KMESigningKey& key : signing_keys_) {
+        if (!key.private_key_pem.empty()) {
+            Zero(&key.private_key_pem[0], key.private_key_pem.size());
+        }
+    }
+    signing_keys_.clear();
+    for (ByteArray& key : symmetric_keys_) {
+        if (!key.empty()) {
+            ZeroV(key);
+        }
+    }
+    symmetric_keys_.clear();
+}  // KMEKeyPool::Clear
@@ -0,0 +1,87 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sgx_spinlock.h>
+#include <deque>
+#include <string>
+
+#include "types.h"
+#include "crypto.h"
+
+// Number of work order signing key pairs and symmetric keys the KME keeps
+// generated ahead of time. The pool is refilled by the KME manager when
+// it is idle (ecall_RefillKeyPoolKME), work orders only generate keys
+// when it is empty. 0 disables the pool.
+#ifndef KME_KEY_POOL_DEPTH
+#define KME_KEY_POOL_DEPTH 16
+#endif
+
+namespace tcf {
+
+    // Secp256k1 key pair with its PEM encodings
+    struct KMESigningKey {
+        tcf::crypto::sig::PrivateKey private_key;
+        std::string private_key_pem;
+        std::string public_key_pem;
+    };
+
+    struct KMEKeyPoolStats {
+        uint64_t hits;
+        uint64_t misses;
+        size_t signing_keys;
+        size_t symmetric_keys;
+        size_t depth;
+    };
+
+    /*
+     * Pool of pre-generated per work order keys of the KME. Each key is
+     * handed out once and dropped from the pool; symmetric keys and PEM
+     * encoded private keys are zeroized when the pool is cleared.
+     */
+    class KMEKeyPool {
+    public:
+        static KMEKeyPool* getInstance(void);
+
+        // Generates keys until both pools are full or max_keys signing
+        // keys were generated, returns the number of pooled signing keys
+        size_t Refill(size_t max_keys);
+
+        // Take a key from the pool, or generate one if it is empty
+        KMESigningKey TakeSigningKey(void);
+        ByteArray TakeSymmetricKey(void);
+
+        KMEKeyPoolStats GetStats(void);
+        void Clear(void);
+
+    private:
+        explicit KMEKeyPool(size_t depth);
+        ~KMEKeyPool(void);
+
+        static KMESigningKey GenerateSigningKey(void);
+
+        size_t depth_;
+        std::deque<KMESigningKey> signing_keys_;
+        std::deque<ByteArray> symmetric_keys_;
+        uint64_t hits_;
+        uint64_t misses_;
+        sgx_spinlock_t lock_;
+
+        static KMEKeyPool instance;
+    };  // class KMEKeyPool
+
+}  // namespace tcf
@@ -27,51 +27,72 @@
 #include "enclave_utils.h"
 #include "base_enclave.h"
 #include "enclave_data.h"
+#include "work_order_enclave_common.h"
+#include "work_order_response_table.h"
 #include "work_order_processor_kme.h"
+#include "kme_key_pool.h"
 
-ByteArray last_serialized_response;
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray tcf::ProcessWorkOrderRequest(EnclaveData* enclave_data,
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    size_t inWorkOrderExtDataSize) {
+    tcf::error::ThrowIfNull(inSerializedRequest,
+        "Serialized request pointer is NULL");
+
+    // Parse the request in place from the marshalled buffer, it is
+    // only copied if the caller did not pass its terminating NUL
+    std::string request_storage;
+    const char* wo_request = tcf::BufferAsCString(inSerializedRequest,
+        inSerializedRequestSize, request_storage);
+
+    // Create KME work order processor
+    tcf::WorkOrderProcessorKME wo_processor;
+
+    // Persist Extended work order data in WorkOrderProcessor instance.
+    // extended work order data contains WPE's public encryption key
+    if (inWorkOrderExtDataSize > 0) {
+        std::string ext_storage;
+        wo_processor.ext_work_order_data = tcf::BufferAsCString(
+            inWorkOrderExtData, inWorkOrderExtDataSize, ext_storage);
+    }
+
+    ByteArray response = wo_processor.Process(enclave_data, wo_request);
+
+    // clear Extended work order data if present after processing work order
+    if (inWorkOrderExtDataSize > 0) {
+        wo_processor.ext_work_order_data.clear();
+    }
+    return response;
+}  // tcf::ProcessWorkOrderRequest
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 tcf_err_t ecall_HandleWorkOrderRequest(const uint8_t* inSerializedRequest,
     size_t inSerializedRequestSize,
     const uint8_t* inWorkOrderExtData,
     size_t inWorkOrderExtDataSize,
+    uint32_t* outResponseIdentifier,
     size_t* outSerializedResponseSize) {
 
     tcf_err_t result = TCF_SUCCESS;
     try {
-        tcf::error::ThrowIfNull(inSerializedRequest,
-            "Serialized request pointer is NULL");
+        tcf::error::ThrowIfNull(outResponseIdentifier,
+            "Response identifier pointer is NULL");
         tcf::error::ThrowIfNull(outSerializedResponseSize,
             "Response size pointer is NULL");
 
         // Unseal the enclave persistent data
         EnclaveData* enclaveData = EnclaveData::getInstance(); 
 
-        ByteArray request(inSerializedRequest,
-            inSerializedRequest + inSerializedRequestSize);
-
-        // Create KME work order processor
-        tcf::WorkOrderProcessorKME wo_processor;
-
-        // Persist Extended work order data in WorkOrderProcessor instance.
-	    // extended work order data contains WPE's public encryption key
-        if (inWorkOrderExtDataSize > 0) {
-            wo_processor.ext_work_order_data = \
-                std::string((const char*) inWorkOrderExtData);
-        }
-
-        std::string wo_string(request.begin(), request.end());
-        last_serialized_response = wo_processor.Process(
-            enclaveData, wo_string);
+        ByteArray response = tcf::ProcessWorkOrderRequest(enclaveData,
+            inSerializedRequest, inSerializedRequestSize,
+            inWorkOrderExtData, inWorkOrderExtDataSize);
 
         // Save the response and return the size of the buffer required for it
-        (*outSerializedResponseSize) = last_serialized_response.size();
-
-        // clear Extended work order data if present after processing work order
-        if (inWorkOrderExtDataSize > 0) {
-            wo_processor.ext_work_order_data.clear();
-        }
+        (*outSerializedResponseSize) = response.size();
+        (*outResponseIdentifier) = \
+            tcf::WorkOrderResponseTable::getInstance()->Store(response);
     } catch (tcf::error::Error& e) {
         SAFE_LOG(TCF_LOG_ERROR,
             "Error in KME(ecall_HandleWorkOrderRequest): %04X -- %s",
@@ -86,3 +107,32 @@ tcf_err_t ecall_HandleWorkOrderRequest(const uint8_t* inSerializedRequest,
 
     return result;
 }  // ecall_HandleWorkOrderRequest
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/*
+ * Generates up to inMaxKeys work order signing key pairs, and the
+ * symmetric keys, into the key pool. Called by the KME manager while
+ * no work orders are waiting.
+ */
+tcf_err_t ecall_RefillKeyPoolKME(size_t inMaxKeys,
+    size_t* outPoolSize) {
+
+    tcf_err_t result = TCF_SUCCESS;
+    try {
+        tcf::error::ThrowIfNull(outPoolSize, "Pool size pointer is NULL");
+
+        (*outPoolSize) = tcf::KMEKeyPool::getInstance()->Refill(inMaxKeys);
+    } catch (tcf::error::Error& e) {
+        SAFE_LOG(TCF_LOG_ERROR,
+            "Error in KME(ecall_RefillKeyPoolKME): %04X -- %s",
+            e.error_code(), e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    } catch (...) {
+        SAFE_LOG(TCF_LOG_ERROR,
+            "Unknown error KME(ecall_RefillKeyPoolKME)");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // ecall_RefillKeyPoolKME
@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <utility>
 
 #include "error.h"
 #include "tcf_error.h"
@@ -50,12 +51,12 @@ namespace tcf {
         // decrypted work order keys
         std::vector<tcf::WorkOrderData> in_wo_keys;
         std::vector<tcf::WorkOrderData> out_wo_keys;
-        for (auto d : this->data_items_in) {
+        for (auto& d : this->data_items_in) {
             in_wo_keys.emplace_back(
                 d.workorder_data.index, d.GetDataEncryptionKey());
         }
 
-        for (auto d : this->data_items_out) {
+        for (auto& d : this->data_items_out) {
             out_wo_keys.emplace_back(
                 d.workorder_data.index, d.GetDataEncryptionKey());
         }
@@ -65,8 +66,8 @@ namespace tcf {
         ext_wo_info_kme->SetExtWorkOrderData(ext_wo_data);
         ext_wo_info_kme->SetWorkOrderRequesterNonce(this->requester_nonce);
         ext_wo_info_kme->SetWorkOrderSymmetricKey(this->session_key);
-        ext_wo_info_kme->SetWorkOrderInDataKeys(in_wo_keys);
-        ext_wo_info_kme->SetWorkOrderOutDataKeys(out_wo_keys);
+        ext_wo_info_kme->SetWorkOrderInDataKeys(std::move(in_wo_keys));
+        ext_wo_info_kme->SetWorkOrderOutDataKeys(std::move(out_wo_keys));
     }  // WorkOrderProcessorKME::PopulateExtWorkOrderInfoData
 
     /*
@@ -80,25 +81,34 @@ namespace tcf {
         std::vector<tcf::WorkOrderData> in_wo_data;
         std::vector<tcf::WorkOrderData> out_wo_data;
         if (data_items_in.size() > 0) {
-            for (auto d : data_items_in) {
+            // The data of the items is moved to the workload
+            in_wo_data.reserve(data_items_in.size());
+            for (auto& d : data_items_in) {
+                // KME workloads get all of the streamed data
+                if (d.IsStreamed()) {
+                    d.ReadStreamedData();
+                }
                 in_wo_data.emplace_back(d.workorder_data.index,
-                                        d.workorder_data.decrypted_data);
+                    std::move(d.workorder_data.decrypted_data));
             }
 
-            for (auto d : data_items_out) {
+            out_wo_data.reserve(data_items_out.size());
+            for (auto& d : data_items_out) {
                 out_wo_data.emplace_back(d.workorder_data.index,
-                                            d.workorder_data.decrypted_data);
+                    std::move(d.workorder_data.decrypted_data));
             }
 
             // Convert workload_id from hex string to string
             ByteArray workload_bytes = HexStringToBinary(workload_id);
             std::string workload_type(workload_bytes.begin(), workload_bytes.end());
-            WorkloadProcessorKME *processor;
-            // Creating workload processor for "kme" workload type. The type of
-            // workload is checked in kme_workload_plugin in case of KME and
-            // processed accordingly.
-            processor = dynamic_cast <WorkloadProcessorKME*>(
-                WorkloadProcessor::CreateWorkloadProcessor("kme"));
+            // Acquiring workload processor for "kme" workload type. The type
+            // of workload is checked in kme_workload_plugin in case of KME and
+            // processed accordingly. It is released when the work order is
+            // done.
+            WorkloadProcessorPtr acquired_processor =
+                WorkloadProcessor::AcquireWorkloadProcessor("kme");
+            WorkloadProcessorKME* processor =
+                dynamic_cast<WorkloadProcessorKME*>(acquired_processor.get());
             tcf::error::ThrowIf<tcf::error::WorkloadError>(
                 (processor==nullptr) ||
                 (processor->ext_work_order_info_kme==nullptr),
@@ -110,14 +120,14 @@ namespace tcf {
                 // to fetch client specific keys which will be wrapped
                 // during preprocess.
                 std::string orig_wo_req = ByteArrayToStr(
-                        data_items_in[0].workorder_data.decrypted_data);
+                        in_wo_data[0].decrypted_data);
                 // ext_data at index 1 contains WPE encryption key
                 std::string ext_data = ByteArrayToStr(
-                    data_items_in[1].workorder_data.decrypted_data);
+                    in_wo_data[1].decrypted_data);
                 WorkOrderProcessorKME kme_wo_proc;
-                JsonValue wo_req_json_val = \
-                    kme_wo_proc.ParseJsonInput(orig_wo_req);
-                kme_wo_proc.DecryptWorkOrderKeys(enclave_data, wo_req_json_val);
+                work_order_request::WorkOrderRequest wo_request = \
+                    kme_wo_proc.ParseJsonInput(orig_wo_req.c_str());
+                kme_wo_proc.DecryptWorkOrderKeys(enclave_data, wo_request);
                 kme_wo_proc.PopulateExtWorkOrderInfoData(ext_data,
                     processor->ext_work_order_info_kme);
             }
@@ -13,6 +13,7 @@
 * limitations under the License.
 */
 
+#include "arena.h"
 #include "utils.h"
 #include "kme_workload_plug-in.h"
 #include "enclave_data.h"
@@ -44,6 +45,7 @@ std::map<ByteArray, ByteArray> KMEWorkloadProcessor::sig_key_map;
  * key of unique ID verification key
  */
 std::map<ByteArray, WPEInfo> KMEWorkloadProcessor::wpe_enc_key_map;
+sgx_spinlock_t KMEWorkloadProcessor::key_map_lock = SGX_SPINLOCK_INITIALIZER;
 
 WPEInfo::WPEInfo() {
     workorder_count = 0;
@@ -75,7 +77,10 @@ void KMEWorkloadProcessor::GetUniqueId(
         verification_key_hex, verification_key_signature_hex);
 
     if (!err) {
-        sig_key_map[verification_key_hex] = signing_key;
+        {
+            tcf::SpinLockGuard guard(&key_map_lock);
+            sig_key_map[verification_key_hex] = signing_key;
+        }
 
         std::string result_str = std::to_string(err);
         // Concatenate status, verification_key and verification_key_signature
@@ -117,6 +122,9 @@ void KMEWorkloadProcessor::Register(
     // Parse the work order request
     ByteArray reg_request = in_work_order_data[0].decrypted_data;
     std::string reg_request_string = ByteArrayToStr(reg_request);
+    // The document is released before the work order is done, it is
+    // allocated from its arena
+    tcf::JsonArenaScope json_arena_scope;
     JsonValue parsed(json_parse_string(reg_request_string.c_str()));
     tcf::error::ThrowIfNull(
         parsed.value,
@@ -189,6 +197,10 @@ void KMEWorkloadProcessor::Register(
             ThrowIf<ValueError>(true, "WPE attestation verification failed");
         }
     }
+
+    // Lookup and removal of the unique id must be atomic to prevent
+    // registering more than one WPE with it
+    tcf::SpinLockGuard guard(&key_map_lock);
     auto search = sig_key_map.find(unique_id_bytes);
 
     if (search != sig_key_map.end()) {
@@ -277,6 +289,9 @@ void KMEWorkloadProcessor::PreprocessWorkorder(
     ByteArray wpe_encrypt_key = StrToByteArray(
         ext_work_order_info_kme->GetExtWorkOrderData().c_str());
 
+    // Work order count of the WPE is updated after key generation,
+    // hold the lock for the whole update
+    tcf::SpinLockGuard guard(&key_map_lock);
     auto search_enc_key = wpe_enc_key_map.find(wpe_encrypt_key);
     if (search_enc_key != wpe_enc_key_map.end()) {
         WPEInfo wpe_info = wpe_enc_key_map[wpe_encrypt_key];
@@ -320,7 +335,7 @@ void KMEWorkloadProcessor::AddOutput(int index, ByteArray& data,
     int out_wo_data_size = out_work_order_data.size();
     // If the out_work_order_data has entry to hold the data
     if (index < out_wo_data_size) {
-        tcf::WorkOrderData out_wo_data = out_work_order_data.at(index);
+        tcf::WorkOrderData& out_wo_data = out_work_order_data.at(index);
         out_wo_data.decrypted_data = data;
     }
     else {
@@ -17,6 +17,7 @@
 
 #include <stdlib.h>
 #include <string>
+#include <sgx_spinlock.h>
 
 #include "types.h"
 #include "workload_processor_kme.h"
@@ -81,6 +82,8 @@ private:
      */
     static std::map<ByteArray, ByteArray> sig_key_map;
     static std::map<ByteArray, WPEInfo> wpe_enc_key_map;
+    /* Protects both maps, work orders can be executed concurrently */
+    static sgx_spinlock_t key_map_lock;
 
     uint64_t max_wo_count_;
 };  // KMEWorkloadProcessor
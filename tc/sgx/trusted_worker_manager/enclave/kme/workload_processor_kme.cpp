@@ -27,7 +27,22 @@ WorkloadProcessorKME::WorkloadProcessorKME() {
     this->ext_work_order_info_kme = nullptr;
 }
 
-WorkloadProcessorKME::~WorkloadProcessorKME() {}
+WorkloadProcessorKME::WorkloadProcessorKME(
+    const WorkloadProcessorKME& other) : WorkloadProcessor(other) {
+    // ExtWorkOrderInfoKME holds the keys of the work order being processed,
+    // so every clone needs its own instance when work orders are executed
+    // concurrently
+    if (other.ext_work_order_info_kme != nullptr) {
+        this->ext_work_order_info_kme = \
+            new ExtWorkOrderInfoKME(*other.ext_work_order_info_kme);
+    } else {
+        this->ext_work_order_info_kme = nullptr;
+    }
+}
+
+WorkloadProcessorKME::~WorkloadProcessorKME() {
+    delete this->ext_work_order_info_kme;
+}
 
 WorkloadProcessor* WorkloadProcessorKME::RegisterWorkloadProcessorKME(
     std::string workload_id, WorkloadProcessor* processor) {
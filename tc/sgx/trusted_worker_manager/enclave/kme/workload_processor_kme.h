@@ -32,7 +32,9 @@
 class WorkloadProcessorKME : public WorkloadProcessor {
 public:
     WorkloadProcessorKME(void);
+    WorkloadProcessorKME(const WorkloadProcessorKME& other);
     virtual ~WorkloadProcessorKME(void);
+    WorkloadProcessorKME& operator=(const WorkloadProcessorKME&) = delete;
 
     /**
      * Register a WorkloadProcessor.
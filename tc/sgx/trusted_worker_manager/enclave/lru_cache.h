@@ -0,0 +1,174 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sgx_spinlock.h>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "enclave_utils.h"
+
+namespace tcf {
+
+    struct LruCacheStats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t size;
+        size_t capacity;
+    };
+
+    /*
+     * Bounded LRU cache of values which are expensive to compute, keyed by
+     * a digest of what they are computed from. Values are computed without
+     * holding the cache lock, so work orders executed on other TCS are not
+     * held up by it. A capacity of 0 disables the cache.
+     * The statistics are logged every stats_interval lookups, in debug
+     * builds only.
+     */
+    template<typename Value>
+    class LruCache {
+    public:
+        // Called on each value as it is evicted, for values holding secrets
+        typedef void (*WipeFunction)(Value& value);
+
+        LruCache(const char* name,
+            size_t capacity,
+            uint64_t stats_interval,
+            WipeFunction wipe = nullptr) :
+            name_(name), capacity_(capacity),
+            stats_interval_(stats_interval), wipe_(wipe),
+            hits_(0), misses_(0), evictions_(0),
+            lock_(SGX_SPINLOCK_INITIALIZER) {
+        }
+
+        ~LruCache(void) {
+            Clear();
+        }
+
+        // Returns the cached value of digest, or the value compute()
+        // returns, which is cached
+        template<typename Compute>
+        Value Get(const std::string& digest, Compute compute) {
+            if (capacity_ == 0) {
+                return compute();
+            }
+
+            Value cached;
+            bool found_entry = false;
+            uint64_t lookups;
+            {
+                tcf::SpinLockGuard guard(&lock_);
+                auto found = index_.find(digest);
+                if (found != index_.end()) {
+                    hits_++;
+                    entries_.splice(entries_.begin(), entries_,
+                        found->second);
+                    cached = found->second->value;
+                    found_entry = true;
+                } else {
+                    misses_++;
+                }
+                lookups = hits_ + misses_;
+            }
+            if (stats_interval_ > 0 && lookups % stats_interval_ == 0) {
+                LogStats();
+            }
+            if (found_entry) {
+                return cached;
+            }
+
+            Value value = compute();
+
+            tcf::SpinLockGuard guard(&lock_);
+            // Another work order may have cached the value in the meantime
+            if (index_.find(digest) == index_.end()) {
+                while (entries_.size() >= capacity_) {
+                    Evict(std::prev(entries_.end()));
+                    evictions_++;
+                }
+                entries_.push_front(CacheEntry{digest, value});
+                index_[digest] = entries_.begin();
+            }
+            return value;
+        }
+
+        LruCacheStats GetStats(void) {
+            tcf::SpinLockGuard guard(&lock_);
+            LruCacheStats stats;
+            stats.hits = hits_;
+            stats.misses = misses_;
+            stats.evictions = evictions_;
+            stats.size = entries_.size();
+            stats.capacity = capacity_;
+            return stats;
+        }
+
+        // Logs the statistics of the cache, in debug builds only
+        void LogStats(void) {
+            LruCacheStats stats = GetStats();
+            Log(TCF_LOG_DEBUG,
+                "%s: %llu hits, %llu misses, %llu evictions, %zu of %zu",
+                name_, (unsigned long long) stats.hits,
+                (unsigned long long) stats.misses,
+                (unsigned long long) stats.evictions,
+                stats.size, stats.capacity);
+        }
+
+        // Wipes and drops all cached values
+        void Clear(void) {
+            tcf::SpinLockGuard guard(&lock_);
+            while (!entries_.empty()) {
+                Evict(entries_.begin());
+            }
+        }
+
+    private:
+        LruCache(const LruCache&);
+        LruCache& operator=(const LruCache&);
+
+        struct CacheEntry {
+            std::string digest;
+            Value value;
+        };
+        typedef std::list<CacheEntry> EntryList;
+
+        // Caller must hold lock_
+        void Evict(typename EntryList::iterator entry) {
+            if (wipe_ != nullptr) {
+                wipe_(entry->value);
+            }
+            index_.erase(entry->digest);
+            entries_.erase(entry);
+        }
+
+        const char* name_;
+        size_t capacity_;
+        uint64_t stats_interval_;
+        WipeFunction wipe_;
+        // Most recently used entry first
+        EntryList entries_;
+        std::unordered_map<std::string, typename EntryList::iterator> index_;
+        uint64_t hits_;
+        uint64_t misses_;
+        uint64_t evictions_;
+        sgx_spinlock_t lock_;
+    };  // class LruCache
+
+}  // namespace tcf
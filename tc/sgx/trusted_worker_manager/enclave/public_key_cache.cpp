@@ -0,0 +1,58 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "error.h"
+#include "tcf_error.h"
+#include "types.h"
+
+#include "crypto.h"
+#include "public_key_cache.h"
+
+tcf::PublicKeyCache tcf::PublicKeyCache::instance;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::PublicKeyCache::PublicKeyCache(void) :
+    LruCache<std::shared_ptr<const tcf::crypto::sig::PublicKey>>(
+        "Public key cache", PUBLIC_KEY_CACHE_SIZE,
+        PUBLIC_KEY_CACHE_STATS_INTERVAL) {
+}  // PublicKeyCache::PublicKeyCache
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::PublicKeyCache* tcf::PublicKeyCache::getInstance(void) {
+    return &instance;
+}  // PublicKeyCache::getInstance
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Get the parsed ECDSA public key of its PEM encoding. The key is parsed
+ * unless it is cached.
+ * Throws RuntimeError, ValueError.
+ *
+ * @param encoded PEM encoded ECDSA public key
+ * @returns parsed public key
+ */
+std::shared_ptr<const tcf::crypto::sig::PublicKey>
+tcf::PublicKeyCache::GetPublicKey(const std::string& encoded) {
+    auto parse = [&]() {
+        return std::make_shared<const tcf::crypto::sig::PublicKey>(encoded);
+    };
+    if (PUBLIC_KEY_CACHE_SIZE == 0) {
+        return parse();
+    }
+
+    ByteArray hash = tcf::crypto::ComputeMessageHash(
+        ByteArray(encoded.begin(), encoded.end()));
+    return Get(std::string(hash.begin(), hash.end()), parse);
+}  // PublicKeyCache::GetPublicKey
@@ -0,0 +1,58 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "sig_public_key.h"
+#include "lru_cache.h"
+
+// Number of parsed requester verifying keys the enclave keeps, so that
+// work orders from the same requester do not parse its PEM encoded key
+// every time. 0 disables the cache.
+#ifndef PUBLIC_KEY_CACHE_SIZE
+#define PUBLIC_KEY_CACHE_SIZE 64
+#endif
+
+// Number of lookups between two logs of the cache statistics in debug
+// builds
+#ifndef PUBLIC_KEY_CACHE_STATS_INTERVAL
+#define PUBLIC_KEY_CACHE_STATS_INTERVAL 1024
+#endif
+
+namespace tcf {
+
+    /*
+     * Cache of parsed ECDSA public keys, keyed by the SHA256 hash of their
+     * PEM encoding. Keys are shared with the callers, an evicted key stays
+     * valid for as long as a caller holds it.
+     */
+    class PublicKeyCache : public LruCache<
+        std::shared_ptr<const tcf::crypto::sig::PublicKey>> {
+    public:
+        static PublicKeyCache* getInstance(void);
+
+        std::shared_ptr<const tcf::crypto::sig::PublicKey> GetPublicKey(
+            const std::string& encoded);
+
+    private:
+        PublicKeyCache(void);
+
+        static PublicKeyCache instance;
+    };  // class PublicKeyCache
+
+}  // namespace tcf
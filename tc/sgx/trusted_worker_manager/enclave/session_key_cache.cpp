@@ -0,0 +1,65 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "error.h"
+#include "tcf_error.h"
+#include "types.h"
+#include "zero.h"
+
+#include "crypto.h"
+#include "session_key_cache.h"
+
+tcf::SessionKeyCache tcf::SessionKeyCache::instance;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void WipeSessionKey(ByteArray& session_key) {
+    if (!session_key.empty()) {
+        ZeroV(session_key);
+    }
+}  // WipeSessionKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::SessionKeyCache::SessionKeyCache(void) :
+    LruCache<ByteArray>("Session key cache", SESSION_KEY_CACHE_SIZE,
+        SESSION_KEY_CACHE_STATS_INTERVAL, WipeSessionKey) {
+}  // SessionKeyCache::SessionKeyCache
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::SessionKeyCache* tcf::SessionKeyCache::getInstance(void) {
+    return &instance;
+}  // SessionKeyCache::getInstance
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Get the session key of a work order request. The key is decrypted
+ * with the enclave's private encryption key unless it is cached.
+ *
+ * @param enclave_data Enclave data holding the private encryption key
+ * @param encrypted_session_key Session key encrypted with the enclave's
+ *                              public encryption key
+ * @returns decrypted session key
+ */
+ByteArray tcf::SessionKeyCache::DecryptSessionKey(
+    const EnclaveData* enclave_data, const ByteArray& encrypted_session_key) {
+    auto decrypt = [&]() {
+        return enclave_data->decrypt_message(encrypted_session_key);
+    };
+    if (SESSION_KEY_CACHE_SIZE == 0) {
+        return decrypt();
+    }
+
+    ByteArray hash = tcf::crypto::ComputeMessageHash(encrypted_session_key);
+    return Get(std::string(hash.begin(), hash.end()), decrypt);
+}  // SessionKeyCache::DecryptSessionKey
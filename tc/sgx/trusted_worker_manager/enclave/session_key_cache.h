@@ -0,0 +1,55 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "types.h"
+#include "enclave_data.h"
+#include "lru_cache.h"
+
+// Number of decrypted session keys the enclave keeps, so that requesters
+// reusing a session key across work orders do not pay for its RSA
+// decryption every time. 0 disables the cache.
+#ifndef SESSION_KEY_CACHE_SIZE
+#define SESSION_KEY_CACHE_SIZE 64
+#endif
+
+// Number of lookups between two logs of the cache statistics in debug
+// builds
+#ifndef SESSION_KEY_CACHE_STATS_INTERVAL
+#define SESSION_KEY_CACHE_STATS_INTERVAL 1024
+#endif
+
+namespace tcf {
+
+    /*
+     * Cache of decrypted work order session keys, keyed by the SHA256
+     * hash of the encrypted session key. Keys are zeroized when they are
+     * evicted.
+     */
+    class SessionKeyCache : public LruCache<ByteArray> {
+    public:
+        static SessionKeyCache* getInstance(void);
+
+        ByteArray DecryptSessionKey(const EnclaveData* enclave_data,
+            const ByteArray& encrypted_session_key);
+
+    private:
+        SessionKeyCache(void);
+
+        static SessionKeyCache instance;
+    };  // class SessionKeyCache
+
+}  // namespace tcf
@@ -28,6 +28,7 @@
 // Initializing singleton class object which gets initialized when
 // getInstance is called
 EnclaveData* EnclaveData::instance = 0;
+sgx_spinlock_t EnclaveData::instance_lock = SGX_SPINLOCK_INITIALIZER;
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 tcf_err_t CreateEnclaveData(uint8_t* persistedSealedEnclaveData) {
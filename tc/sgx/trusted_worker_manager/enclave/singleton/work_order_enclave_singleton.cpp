@@ -26,46 +26,65 @@
 #include "enclave_utils.h"
 #include "base_enclave.h"
 #include "enclave_data.h"
+#include "work_order_enclave_common.h"
+#include "work_order_response_table.h"
 #include "work_order_processor.h"
 
-ByteArray last_serialized_response;
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray tcf::ProcessWorkOrderRequest(EnclaveData* enclave_data,
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    size_t inWorkOrderExtDataSize) {
+    tcf::error::ThrowIfNull(inSerializedRequest,
+        "Serialized request pointer is NULL");
+    tcf::error::ThrowIf<tcf::error::ValueError>(
+        inWorkOrderExtData != nullptr,
+        "Work order extended data should be NULL for singleton worker");
+    tcf::error::ThrowIf<tcf::error::ValueError>(inWorkOrderExtDataSize != 0,
+        "Work order extended data size should be 0 for singleton worker");
+
+    // Parse the request in place from the marshalled buffer, it is
+    // only copied if the caller did not pass its terminating NUL
+    std::string request_storage;
+    const char* wo_request = tcf::BufferAsCString(inSerializedRequest,
+        inSerializedRequestSize, request_storage);
+
+    tcf::WorkOrderProcessor wo_processor;
+
+    // work order extended data will not be used in singleton worker,
+    // hence store empty value
+    wo_processor.ext_work_order_data = "";
+
+    return wo_processor.Process(enclave_data, wo_request);
+}  // tcf::ProcessWorkOrderRequest
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 tcf_err_t ecall_HandleWorkOrderRequest(const uint8_t* inSerializedRequest,
     size_t inSerializedRequestSize,
     const uint8_t* inWorkOrderExtData,
     size_t inWorkOrderExtDataSize,
+    uint32_t* outResponseIdentifier,
     size_t* outSerializedResponseSize) {
     tcf_err_t result = TCF_SUCCESS;
 
     try {
-        tcf::error::ThrowIfNull(inSerializedRequest,
-            "Serialized request pointer is NULL");
+        tcf::error::ThrowIfNull(outResponseIdentifier,
+            "Response identifier pointer is NULL");
         tcf::error::ThrowIfNull(outSerializedResponseSize,
             "Response size pointer is NULL");
-        tcf::error::ThrowIf<tcf::error::ValueError>(
-            inWorkOrderExtData != nullptr,
-            "Work order extended data should be NULL for singleton worker");
-        tcf::error::ThrowIf<tcf::error::ValueError>(inWorkOrderExtDataSize != 0,
-            "Work order extended data size should be 0 for singleton worker");
 
         // Unseal the enclave persistent data
         EnclaveData* enclaveData = EnclaveData::getInstance(); 
 
-        ByteArray request(inSerializedRequest,
-            inSerializedRequest + inSerializedRequestSize);
-
-        tcf::WorkOrderProcessor wo_processor;
-
-        // work order extended data will not be used in singleton worker,
-        // hence store empty value
-        wo_processor.ext_work_order_data = "";
-
-        std::string wo_string(request.begin(), request.end());
-        last_serialized_response = wo_processor.Process(enclaveData, wo_string);
+        ByteArray response = tcf::ProcessWorkOrderRequest(enclaveData,
+            inSerializedRequest, inSerializedRequestSize,
+            inWorkOrderExtData, inWorkOrderExtDataSize);
 
         // Save the response and return the size of the buffer required for it
-        (*outSerializedResponseSize) = last_serialized_response.size();
+        (*outSerializedResponseSize) = response.size();
+        (*outResponseIdentifier) = \
+            tcf::WorkOrderResponseTable::getInstance()->Store(response);
     } catch (tcf::error::Error& e) {
         SAFE_LOG(TCF_LOG_ERROR,
             "Error in worker enclave (ecall_HandleWorkOrderRequest): %04X -- %s",
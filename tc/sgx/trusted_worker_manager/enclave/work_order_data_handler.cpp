@@ -13,8 +13,10 @@
 * limitations under the License.
 */
 
+#include <string.h>
 #include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
  
 #include "error.h"
@@ -23,10 +25,8 @@
 
 #include "crypto.h"
 #include "skenc.h"
-#include "jsonvalue.h"
-#include "parson.h"
 #include "hex_string.h"
-#include "json_utils.h"
+#include "json_writer.h"
 #include "utils.h"
 
 #include "enclave_utils.h"
@@ -73,127 +73,287 @@ namespace tcf {
         }
     }
 
-    void WorkOrderDataHandler::Unpack(const JSON_Object* object) {
+    void WorkOrderDataHandler::Unpack(
+        const work_order_request::DataItem& item) {
+        using work_order_request::GetString;
         ByteArray encrypted_input_data;
-        std::string input_data_hash;
 
-        workorder_data.index = GetJsonNumber(object, "index");
-        iv = GetJsonStr(object, "iv");
-        enc_data_key_str = GetJsonStr(object, "encryptedDataEncryptionKey");
+        workorder_data.index = item.index;
+        iv = GetString(item.iv);
+        enc_data_key_str = GetString(item.encrypted_data_encryption_key);
 
         InitializeDataEncryptionKey();
 
-        std::string data_b64 = GetJsonStr(object, "data");
-        if (!data_b64.empty()) {
-            encrypted_input_data = Base64EncodedStringToByteArray(data_b64);
+        // The data is decoded and hashed where it is in the request,
+        // which outlives the item's part in the work order
+        input_data = item.data;
+        data_hash_hex = GetString(item.data_hash);
+
+        // Large data is streamed into the enclave instead of being embedded
+        // in the request, it is read while computing the request hash
+        stream_size = (size_t) item.data_stream_size;
+        if (stream_size > 0) {
+            tcf::error::ThrowIf<tcf::error::ValueError>(input_data.size > 0,
+                "Invalid case: both data and dataStreamSize are set");
+            return;
+        }
+
+        if (input_data.size > 0) {
+            encrypted_input_data = work_order_request::GetBase64(input_data);
         } else {
             encrypted_input_data.clear();
         }
 
-        input_data_hash = GetJsonStr(object, "dataHash");
         if (!encrypted_input_data.empty()) {
             DecryptData(encrypted_input_data);
-            if (!input_data_hash.empty()) {
-                tcf_err_t status = VerifyInputHash(workorder_data.decrypted_data,
-                    HexStringToBinary(input_data_hash));
-                tcf::error::ThrowIf<tcf::error::ValueError>(
-                    status != TCF_SUCCESS, "input data hash verification failed");
+            if (!data_hash_hex.empty()) {
+                // Verified by VerifyInputHashes() together with the
+                // data of the other items
+                input_hash = HexStringToBinary(data_hash_hex);
             }
         } else {
-            tcf::error::ThrowIf<tcf::error::ValueError>(!input_data_hash.empty(),
+            tcf::error::ThrowIf<tcf::error::ValueError>(!data_hash_hex.empty(),
                "Invalid case: input data is empty but dataHash is non empty");
             workorder_data.decrypted_data = encrypted_input_data;
         }
-        concat_string = input_data_hash + data_b64 + enc_data_key_str + iv;
-        data_b64.clear();
     }  // WorkOrderDataHandler::Unpack
 
-    void WorkOrderDataHandler::Pack(JSON_Array* json_array) {
-        JSON_Status jret;
+    size_t WorkOrderDataHandler::UpdateRequestHash(
+        tcf::crypto::MessageHasher& hasher) {
+        if (!IsStreamed()) {
+            hasher.Update(data_hash_hex);
+            size_t data_size = work_order_request::ForEachStringPiece(
+                input_data, [&hasher](const char* piece, size_t size) {
+                    hasher.Update((const uint8_t*) piece, size);
+                });
+            hasher.Update(enc_data_key_str);
+            hasher.Update(iv);
+            return data_hash_hex.size() + data_size +
+                enc_data_key_str.size() + iv.size();
+        }
+
+        // Same input as embedded data, with the base64 encoded data read
+        // from the stream
+        hasher.Update(data_hash_hex);
+        ByteArray stream_digest = HashStreamedData(
+            stream_offset, stream_size, hasher);
+        hasher.Update(enc_data_key_str);
+        hasher.Update(iv);
 
-        JSON_Value* data_item_value = json_value_init_object();
-        tcf::error::ThrowIfNull(data_item_value, "failed to create a data item");
+        stream_reader = std::make_shared<StreamedDataReader>(
+            stream_offset, stream_size, data_encryption_key, data_iv,
+            stream_digest, HexStringToBinary(data_hash_hex));
+        workorder_data.reader = stream_reader;
+        return data_hash_hex.size() + stream_size +
+            enc_data_key_str.size() + iv.size();
+    }  // WorkOrderDataHandler::UpdateRequestHash
 
-        JSON_Object* data_item_object = json_value_get_object(data_item_value);
-        tcf::error::ThrowIfNull(data_item_object, "failed to create a data item");
+    void WorkOrderDataHandler::ReadStreamedData() {
+        tcf::error::ThrowIf<tcf::error::RuntimeError>(!stream_reader,
+            "Streamed data read before request verification");
+        workorder_data.decrypted_data = stream_reader->ReadAll();
+        workorder_data.reader.reset();
+    }  // WorkOrderDataHandler::ReadStreamedData
 
-        JsonSetNumber(data_item_object,
-                      "index",
-                      workorder_data.index,
-                      "failed to serialize index");
+    void WorkOrderDataHandler::FinishStreamedData() {
+        if (stream_reader) {
+            stream_reader->Finish();
+        }
+    }  // WorkOrderDataHandler::FinishStreamedData
+
+    void WorkOrderDataHandler::CreateStreamWriter(
+        std::shared_ptr<StreamedResult> result) {
+        stream_writer = std::make_shared<StreamedDataWriter>(
+            result, data_encryption_key, data_iv);
+        workorder_data.writer = stream_writer;
+    }  // WorkOrderDataHandler::CreateStreamWriter
+
+    void WorkOrderDataHandler::FinishStreamedOutput() {
+        if (IsOutputStreamed()) {
+            stream_writer->Finish();
+            hash = stream_writer->GetDataHash();
+            encrypted_data.clear();
+            tag.clear();
+            data_hash_hex = ByteArrayToHexEncodedString(hash);
+        }
+    }  // WorkOrderDataHandler::FinishStreamedOutput
+
+    size_t WorkOrderDataHandler::UpdateResponseHash(
+        tcf::crypto::MessageHasher& hasher) {
+        if (!IsOutputStreamed()) {
+            // Unencrypted output is hashed as it is, encrypted output
+            // base64 encoded like it is packed
+            hasher.Update(data_hash_hex);
+            size_t data_size;
+            if (data_encryption_key.empty()) {
+                hasher.Update(encrypted_data);
+                data_size = encrypted_data.size();
+            } else {
+                data_size = EncodeOutput(
+                    [&hasher](const char* piece, size_t size) {
+                        hasher.Update((const uint8_t*) piece, size);
+                    });
+            }
+            hasher.Update(enc_data_key_str);
+            hasher.Update(iv);
+            return data_hash_hex.size() + data_size +
+                enc_data_key_str.size() + iv.size();
+        }
+
+        // Same input as embedded output, with the output read back as it
+        // was written out
+        hasher.Update(data_hash_hex);
+        stream_writer->UpdateResponseHash(hasher);
+        hasher.Update(enc_data_key_str);
+        hasher.Update(iv);
+        return data_hash_hex.size() + stream_writer->GetSize() +
+            enc_data_key_str.size() + iv.size();
+    }  // WorkOrderDataHandler::UpdateResponseHash
+
+    void WorkOrderDataHandler::Pack(JsonWriter& writer) {
+        writer.BeginObject();
+
+        writer.AddNumber("index", workorder_data.index);
 
         Base64EncodedString output_hash_str = ByteArrayToHexEncodedString(hash);
-        JsonSetStr(data_item_object,
-                   "dataHash",
-                   output_hash_str.c_str(),
-                   "failed to serialize dataHash");
-
-        std::string encrypted_output_str = base64_encode(encrypted_data);
-        JsonSetStr(data_item_object,
-                   "data",
-                   encrypted_output_str.c_str(),
-                   "failed to serialize encrypted output data");
-        JsonSetStr(data_item_object,
-                   "encryptedDataEncryptionKey",
-                   enc_data_key_str.c_str(),
-                   "failed to serialize encryptedDataEncryptionKey");
-
-        JsonSetStr(data_item_object,
-                   "iv",
-                   iv.c_str(),
-                   "failed to serialize data iv");
-
-        jret = json_array_append_value(json_array, data_item_value);
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-                jret != JSONSuccess, "failed to add item to the data array");
-    }  // WorkOrderDataHandler::Pack
+        writer.AddStr("dataHash", output_hash_str,
+            "failed to serialize dataHash");
 
-    void WorkOrderDataHandler::ComputeHashString() {
-        std::string b64_encrypted_data = EncryptData();
-        hash = tcf::crypto::ComputeMessageHash(workorder_data.decrypted_data);
-        Base64EncodedString hash_str = ByteArrayToHexEncodedString(hash);
-        concat_string = hash_str + b64_encrypted_data + enc_data_key_str + iv;
-    }  // WorkOrderDataHandler::ComputeHashString
-
-    tcf_err_t WorkOrderDataHandler::VerifyInputHash(
-        ByteArray input_data, ByteArray input_hash) {
-        tcf_err_t verify_status = TCF_SUCCESS;
-        ByteArray hash = tcf::crypto::ComputeMessageHash(input_data);
-        if (std::equal(hash.begin(), hash.end(), input_hash.begin())) {
-            Log(TCF_LOG_INFO, "input data hash verification passed");
+        if (IsOutputStreamed()) {
+            // The untrusted side puts the streamed output back in data
+            writer.AddNumber("dataStreamOffset", stream_writer->GetOffset());
+            writer.AddNumber("dataStreamSize", stream_writer->GetSize());
         } else {
-            Log(TCF_LOG_ERROR, "input data hash verification failed");
-            verify_status = TCF_ERR_CRYPTO;
+            // Encoded straight into the response
+            writer.BeginStr("data");
+            EncodeOutput([&writer](const char* piece, size_t size) {
+                writer.AppendStr(piece, size,
+                    "failed to serialize encrypted output data");
+            });
+            writer.EndStr();
         }
+        writer.AddStr("encryptedDataEncryptionKey", enc_data_key_str,
+            "failed to serialize encryptedDataEncryptionKey");
+
+        writer.AddStr("iv", iv, "failed to serialize data iv");
 
-        return verify_status;
-    }  // WorkOrderDataHandler::VerifyInputHash
+        writer.EndObject();
+    }  // WorkOrderDataHandler::Pack
 
-    void WorkOrderDataHandler::DecryptData(ByteArray encrypted_input_data) {
+    size_t WorkOrderDataHandler::GetPackedSize() {
+        // Base64 encoded data takes 4/3 of the size of the data, escaping
+        // '/' adds 1/64 of that on average
+        return 256 + 2 * hash.size() +
+            (encrypted_data.size() + tag.size()) * 3 / 2 +
+            enc_data_key_str.size() + iv.size();
+    }  // WorkOrderDataHandler::GetPackedSize
 
+    void WorkOrderDataHandler::ComputeHashStrings(
+        const std::vector<WorkOrderDataHandler*>& items) {
+        // The data is hashed first, so that it can be encrypted in its
+        // own buffer afterwards
+        std::vector<const ByteArray*> data;
+        for (auto d : items) {
+            data.push_back(&d->workorder_data.decrypted_data);
+        }
+        std::vector<ByteArray> hashes =
+            tcf::crypto::ComputeMessageHashes(data);
+        for (size_t i = 0; i < items.size(); i++) {
+            items[i]->hash = std::move(hashes[i]);
+            items[i]->data_hash_hex =
+                ByteArrayToHexEncodedString(items[i]->hash);
+            items[i]->EncryptData();
+        }
+    }  // WorkOrderDataHandler::ComputeHashStrings
+
+    void WorkOrderDataHandler::VerifyInputHashes(
+        std::vector<WorkOrderDataHandler>& items) {
+        std::vector<const ByteArray*> data;
+        std::vector<const ByteArray*> expected_hashes;
+        for (auto& d : items) {
+            if (!d.input_hash.empty()) {
+                data.push_back(&d.workorder_data.decrypted_data);
+                expected_hashes.push_back(&d.input_hash);
+            }
+        }
+        if (data.empty()) {
+            return;
+        }
+
+        std::vector<ByteArray> hashes =
+            tcf::crypto::ComputeMessageHashes(data);
+        for (size_t i = 0; i < hashes.size(); i++) {
+            if (hashes[i] != *expected_hashes[i]) {
+                Log(TCF_LOG_ERROR, "input data hash verification failed");
+                throw tcf::error::ValueError(
+                    "input data hash verification failed");
+            }
+        }
+        Log(TCF_LOG_INFO, "input data hash verification passed");
+    }  // WorkOrderDataHandler::VerifyInputHashes
+
+    void WorkOrderDataHandler::DecryptData(ByteArray& encrypted_input_data) {
+        // Decrypt in the buffer of the decoded data, which becomes the
+        // decrypted data without another copy
         if (data_encryption_key.size() > 0) {
-            workorder_data.decrypted_data = tcf::crypto::skenc::DecryptMessage(
-		   data_encryption_key, data_iv, encrypted_input_data);
-        } else {
-            workorder_data.decrypted_data = encrypted_input_data;
+            tcf::error::ThrowIf<tcf::error::ValueError>(
+                encrypted_input_data.size() < tcf::crypto::constants::TAG_LEN,
+                "encrypted input data is shorter than the AES-GCM tag");
+            size_t len = encrypted_input_data.size() -
+                tcf::crypto::constants::TAG_LEN;
+            tcf::crypto::skenc::DecryptInPlace(data_encryption_key, data_iv,
+                encrypted_input_data.data(), len,
+                encrypted_input_data.data() + len);
+            encrypted_input_data.resize(len);
         }
+        workorder_data.decrypted_data.swap(encrypted_input_data);
     }  // WorkOrderDataHandler::DecryptData
 
-    std::string WorkOrderDataHandler::EncryptData() {
-        std::string b64_encrypted_data;
-        if (workorder_data.decrypted_data.empty()) {
-            encrypted_data = workorder_data.decrypted_data;
-            b64_encrypted_data.clear();
-        } else if (data_encryption_key.size() > 0) {
-            encrypted_data = tcf::crypto::skenc::EncryptMessage(
-		   data_encryption_key, data_iv, workorder_data.decrypted_data);
-            b64_encrypted_data = base64_encode(encrypted_data);
-        } else {
-            encrypted_data = workorder_data.decrypted_data;
-            b64_encrypted_data.assign(workorder_data.decrypted_data.begin(),
-			    workorder_data.decrypted_data.end());
+    void WorkOrderDataHandler::EncryptData() {
+        // Encrypt in the buffer of the data, the tag is kept apart so
+        // that the buffer does not need room for it
+        ByteArray& data = workorder_data.decrypted_data;
+        tag.clear();
+        if (!data.empty() && data_encryption_key.size() > 0) {
+            tag.resize(tcf::crypto::constants::TAG_LEN);
+            tcf::crypto::skenc::EncryptInPlace(data_encryption_key, data_iv,
+                data.data(), data.size(), tag.data());
         }
-        return b64_encrypted_data;
+        encrypted_data.swap(data);
+        ByteArray().swap(data);
     }  // WorkOrderDataHandler::EncryptData
 
+    size_t WorkOrderDataHandler::EncodeOutput(
+        const std::function<void(const char*, size_t)>& append) {
+        // Whole base64 quanta of the data are encoded from its buffer in
+        // chunks, the rest of it together with the tag
+        const size_t chunk_size = 3 * 1024;
+        char encoded[chunk_size / 3 * 4];
+        size_t size = encrypted_data.size();
+        size_t whole = size - size % 3;
+        size_t encoded_size = 0;
+        for (size_t i = 0; i < whole; i += chunk_size) {
+            size_t n = base64_encode(encrypted_data.data() + i,
+                std::min(chunk_size, whole - i), encoded);
+            append(encoded, n);
+            encoded_size += n;
+        }
+
+        uint8_t rest[2 + tcf::crypto::constants::TAG_LEN];
+        size_t rest_size = size - whole;
+        if (rest_size > 0) {
+            memcpy(rest, encrypted_data.data() + whole, rest_size);
+        }
+        if (!tag.empty()) {
+            memcpy(rest + rest_size, tag.data(), tag.size());
+            rest_size += tag.size();
+        }
+        if (rest_size > 0) {
+            size_t n = base64_encode(rest, rest_size, encoded);
+            append(encoded, n);
+            encoded_size += n;
+        }
+        return encoded_size;
+    }  // WorkOrderDataHandler::EncodeOutput
+
 }  // namespace tcf
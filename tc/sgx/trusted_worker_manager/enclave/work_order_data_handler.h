@@ -15,16 +15,22 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <functional>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "enclave_data.h"
 
 #include "base64.h"
-#include "parson.h"
+#include "json_writer.h"
 #include "types.h"
 #include "tcf_error.h"
 #include "work_order_data.h"
+#include "work_order_data_stream.h"
+#include "work_order_request.h"
 
 namespace tcf {
         class WorkOrderDataHandler {
@@ -33,56 +39,115 @@ namespace tcf {
 
             explicit WorkOrderDataHandler(ByteArray session_key,
                                           ByteArray session_key_iv) {
-                this->session_key = session_key;
-                this->session_key_iv = session_key_iv;
+                this->session_key = std::move(session_key);
+                this->session_key_iv = std::move(session_key_iv);
                 this->data_encryption_key = {};
                 this->data_iv = {};
             }
 
             // Used when input request doesn't have OutData
-            explicit WorkOrderDataHandler(const WorkOrderData& wo_data,
+            explicit WorkOrderDataHandler(WorkOrderData wo_data,
                                           ByteArray data_encryption_key,
                                           ByteArray data_iv,
                                           std::string enc_data_key_str,
                                           std::string iv) {
-                workorder_data = wo_data;
-                this->data_encryption_key = data_encryption_key;
-                this->data_iv = data_iv;
+                workorder_data = std::move(wo_data);
+                this->data_encryption_key = std::move(data_encryption_key);
+                this->data_iv = std::move(data_iv);
 
-                this->enc_data_key_str = enc_data_key_str;
-                this->iv = iv;
+                this->enc_data_key_str = std::move(enc_data_key_str);
+                this->iv = std::move(iv);
             }
 
-            void Unpack(const JSON_Object* object);
+            // Items own the data of the work order, which is moved between
+            // them and the workload instead of being copied
+            WorkOrderDataHandler(WorkOrderDataHandler&&) = default;
+            WorkOrderDataHandler& operator=(WorkOrderDataHandler&&) = default;
+            WorkOrderDataHandler(const WorkOrderDataHandler&) = delete;
+            WorkOrderDataHandler& operator=(
+                const WorkOrderDataHandler&) = delete;
+
+            void Unpack(const work_order_request::DataItem& item);
 
             void InitializeDataEncryptionKey();
 
             virtual void GetDataEncryptionKey(
                 ByteArray& data_encrypt_key, ByteArray& iv_bytes);
 
-            void Pack(JSON_Array* json_array);
+            // Writes the item into the outData array of a response
+            void Pack(JsonWriter& writer);
+
+            // Size of the item packed into a response, at most
+            size_t GetPackedSize();
 
-            ByteArray GetEncryptionKey() {
+            const ByteArray& GetEncryptionKey() {
                 return this->data_encryption_key;
             }
 
-            std::string GetIv() {
+            const std::string& GetIv() {
                 return this->iv;
             }
 
-            std::string GetEncryptedDataEncryptionKey() {
+            const std::string& GetEncryptedDataEncryptionKey() {
                 return this->enc_data_key_str;
             }
 
-            ByteArray GetDataIv() {
+            const ByteArray& GetDataIv() {
                 return this->data_iv;
             }
 
-            void ComputeHashString();
+            // Computes the hashes of the data of the outData items, hashing
+            // all of the data at once, and encrypts the data in its own
+            // buffer. The data is moved to encrypted_data.
+            static void ComputeHashStrings(
+                const std::vector<WorkOrderDataHandler*>& items);
+
+            // Verifies the data of the unpacked items against their
+            // dataHash, hashing all of the data at once. Throws ValueError.
+            static void VerifyInputHashes(
+                std::vector<WorkOrderDataHandler>& items);
+
+            // inData items carrying dataStreamSize instead of data are
+            // streamed into the enclave, after the preceding streamed items
+            bool IsStreamed() {
+                return this->stream_size > 0;
+            }
+
+            size_t GetStreamSize() {
+                return this->stream_size;
+            }
+
+            void SetStreamOffset(uint64_t offset) {
+                this->stream_offset = offset;
+            }
+
+            // Passes the item's part of the request hash input to hasher,
+            // reading streamed data through it. Returns its size in bytes.
+            size_t UpdateRequestHash(tcf::crypto::MessageHasher& hasher);
+            // Reads all of the streamed data into decrypted_data
+            void ReadStreamedData();
+            // Verifies the rest of partially read streamed data
+            void FinishStreamedData();
+
+            // Lets the workload write the output of the outData item
+            // through workorder_data.writer into result
+            void CreateStreamWriter(std::shared_ptr<StreamedResult> result);
+
+            // Whether the workload wrote the output through the writer
+            bool IsOutputStreamed() {
+                return stream_writer && stream_writer->IsWritten();
+            }
+
+            // Writes out the rest of the streamed output and takes its hash
+            void FinishStreamedOutput();
+
+            // Passes the item's part of the response hash input to hasher,
+            // reading streamed output through it. Returns its size in bytes.
+            size_t UpdateResponseHash(tcf::crypto::MessageHasher& hasher);
+
             tcf::WorkOrderData workorder_data;
-            std::string concat_string;
 
-            ByteArray GetDataEncryptionKey() {
+            const ByteArray& GetDataEncryptionKey() {
                 return this->data_encryption_key;
             }
 
@@ -93,8 +158,19 @@ namespace tcf {
             // enc_data_key_str is encryptedDataEncryptionKey
             // used to decrypt input data
             std::string enc_data_key_str;
+            // Output data, encrypted in place unless it is unencrypted,
+            // and its AES-GCM tag. They are base64 encoded together
+            // piece by piece, as they are hashed and packed.
             ByteArray encrypted_data = {};
+            ByteArray tag = {};
             ByteArray hash = {};
+            // dataHash of unpacked data, until it is verified
+            ByteArray input_hash = {};
+            // dataHash as passed to the request or response hash
+            std::string data_hash_hex;
+            // Base64 encoded data of an unpacked item, pointing into the
+            // request, which is hashed from there
+            work_order_request::StringRef input_data;
 
             // data_encryption_key is a symmetric key used for
             // both encryption and decryption of data
@@ -104,10 +180,21 @@ namespace tcf {
 
             ByteArray session_key = {};
             ByteArray session_key_iv = {};
+
+            // Size of the base64 encoded streamed data, 0 if not streamed
+            size_t stream_size = 0;
+            uint64_t stream_offset = 0;
+            std::shared_ptr<StreamedDataReader> stream_reader;
+            std::shared_ptr<StreamedDataWriter> stream_writer;
+
             void ComputeOutputHash();
-            tcf_err_t VerifyInputHash(ByteArray input_data,
-                                      ByteArray input_hash);
-            void DecryptData(ByteArray encrypted_input_data);
-            std::string EncryptData();
+            // Decrypts the data in place and moves it to decrypted_data
+            void DecryptData(ByteArray& encrypted_input_data);
+            // Moves decrypted_data to encrypted_data, encrypting it
+            void EncryptData();
+            // Passes the base64 encoded encrypted_data and tag to append
+            // piece by piece. Returns the size of the encoded data.
+            size_t EncodeOutput(
+                const std::function<void(const char*, size_t)>& append);
         };
 }  // namespace tcf
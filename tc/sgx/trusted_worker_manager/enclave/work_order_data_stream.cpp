@@ -0,0 +1,335 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "enclave_common_t.h"
+
+#include <algorithm>
+#include <string>
+
+#include "error.h"
+#include "tcf_error.h"
+#include "types.h"
+#include "base64.h"
+
+#include "enclave_utils.h"
+#include "work_order_data_stream.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::ReadStreamedData(uint64_t offset, uint8_t* buffer, size_t size) {
+    tcf_err_t presult = TCF_SUCCESS;
+    sgx_status_t ret = ocall_ReadWorkOrderData(&presult, offset, buffer, size);
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(ret != SGX_SUCCESS,
+        "Failed to read streamed work order data");
+    tcf::error::ThrowIf<tcf::error::ValueError>(presult != TCF_SUCCESS,
+        "Streamed work order data is not available");
+}  // tcf::ReadStreamedData
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::WriteStreamedResult(const uint8_t* data, size_t size) {
+    tcf_err_t presult = TCF_SUCCESS;
+    sgx_status_t ret = ocall_WriteWorkOrderResult(&presult, data, size);
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(ret != SGX_SUCCESS,
+        "Failed to write streamed work order data");
+    tcf::error::ThrowIf<tcf::error::ValueError>(presult != TCF_SUCCESS,
+        "Streamed work order data can not be written");
+}  // tcf::WriteStreamedResult
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::ReadStreamedResult(uint64_t offset, uint8_t* buffer, size_t size) {
+    tcf_err_t presult = TCF_SUCCESS;
+    sgx_status_t ret = ocall_ReadWorkOrderResult(
+        &presult, offset, buffer, size);
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(ret != SGX_SUCCESS,
+        "Failed to read streamed work order data");
+    tcf::error::ThrowIf<tcf::error::ValueError>(presult != TCF_SUCCESS,
+        "Streamed work order data is not available");
+}  // tcf::ReadStreamedResult
+
+// Set while the calling thread handles ecall_HandleWorkOrderRequestStream
+static thread_local bool g_streamedResultCollected = false;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool tcf::IsStreamedResultCollected() {
+    return g_streamedResultCollected;
+}  // tcf::IsStreamedResultCollected
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::StreamedResultScope::StreamedResultScope() {
+    g_streamedResultCollected = true;
+}  // tcf::StreamedResultScope::StreamedResultScope
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::StreamedResultScope::~StreamedResultScope() {
+    g_streamedResultCollected = false;
+}  // tcf::StreamedResultScope::~StreamedResultScope
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray tcf::HashStreamedData(uint64_t offset,
+    size_t size,
+    tcf::crypto::MessageHasher& hasher) {
+    tcf::crypto::MessageHasher stream_hasher;
+    ByteArray chunk(std::min(size, WORK_ORDER_DATA_CHUNK_SIZE));
+
+    for (size_t position = 0; position < size; position += chunk.size()) {
+        chunk.resize(std::min(size - position, WORK_ORDER_DATA_CHUNK_SIZE));
+        ReadStreamedData(offset + position, chunk.data(), chunk.size());
+        hasher.Update(chunk);
+        stream_hasher.Update(chunk);
+    }
+
+    return stream_hasher.Finalize();
+}  // tcf::HashStreamedData
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::StreamedDataReader::StreamedDataReader(uint64_t offset,
+    size_t size,
+    const ByteArray& key,
+    const ByteArray& iv,
+    const ByteArray& stream_digest,
+    const ByteArray& data_hash) :
+    offset_(offset),
+    size_(size),
+    position_(0),
+    at_end_(false),
+    stream_digest_(stream_digest),
+    data_hash_(data_hash),
+    pending_position_(0) {
+    tcf::error::ThrowIf<tcf::error::ValueError>(size % 4 != 0,
+        "Streamed work order data is not base64 encoded");
+    if (!key.empty()) {
+        decryptor_.reset(new tcf::crypto::skenc::StreamDecryptor(key, iv));
+    }
+}  // tcf::StreamedDataReader::StreamedDataReader
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t tcf::StreamedDataReader::Read(uint8_t* buffer, size_t size) {
+    while (pending_position_ == pending_.size() && !at_end_) {
+        ReadChunk();
+    }
+
+    size_t n = std::min(size, pending_.size() - pending_position_);
+    std::copy(pending_.begin() + pending_position_,
+        pending_.begin() + pending_position_ + n, buffer);
+    pending_position_ += n;
+    return n;
+}  // tcf::StreamedDataReader::Read
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray tcf::StreamedDataReader::ReadAll() {
+    ByteArray data(pending_.begin() + pending_position_, pending_.end());
+    pending_.clear();
+    pending_position_ = 0;
+
+    while (!at_end_) {
+        ReadChunk();
+        data.insert(data.end(), pending_.begin(), pending_.end());
+        pending_.clear();
+    }
+    return data;
+}  // tcf::StreamedDataReader::ReadAll
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataReader::Finish() {
+    // Data which was not read at all was not used
+    if (position_ == 0) {
+        return;
+    }
+
+    pending_.clear();
+    pending_position_ = 0;
+    while (!at_end_) {
+        ReadChunk();
+        pending_.clear();
+    }
+}  // tcf::StreamedDataReader::Finish
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataReader::ReadChunk() {
+    size_t chunk_size = std::min(size_ - position_,
+        WORK_ORDER_DATA_CHUNK_SIZE);
+    if (chunk_size == 0) {
+        VerifyEnd();
+        return;
+    }
+
+    std::string chunk(chunk_size, '\0');
+    ReadStreamedData(offset_ + position_, (uint8_t*) &chunk[0], chunk_size);
+    position_ += chunk_size;
+    stream_hasher_.Update(chunk);
+
+    ByteArray decoded = base64_decode(chunk);
+    if (decryptor_) {
+        pending_ = decryptor_->Update(decoded.data(), decoded.size());
+    } else {
+        pending_.swap(decoded);
+    }
+    pending_position_ = 0;
+    data_hasher_.Update(pending_);
+}  // tcf::StreamedDataReader::ReadChunk
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataReader::VerifyEnd() {
+    pending_.clear();
+    pending_position_ = 0;
+
+    tcf::error::ThrowIf<tcf::error::ValueError>(
+        stream_hasher_.Finalize() != stream_digest_,
+        "Streamed input data changed after request verification");
+
+    if (decryptor_) {
+        pending_ = decryptor_->Finalize();
+        data_hasher_.Update(pending_);
+    }
+
+    ByteArray hash = data_hasher_.Finalize();
+    tcf::error::ThrowIf<tcf::error::ValueError>(
+        !data_hash_.empty() && hash != data_hash_,
+        "input data hash verification failed");
+
+    // Only set once verified, so that a failed verification is reported
+    // again by later reads, even if the workload ignored it
+    at_end_ = true;
+}  // tcf::StreamedDataReader::VerifyEnd
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+uint64_t tcf::StreamedResult::Start(StreamedDataWriter* writer) {
+    if (writer_ != nullptr) {
+        writer_->Finish();
+    }
+    writer_ = writer;
+    return size_;
+}  // tcf::StreamedResult::Start
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedResult::Append(const uint8_t* data, size_t size) {
+    WriteStreamedResult(data, size);
+    size_ += size;
+}  // tcf::StreamedResult::Append
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::StreamedDataWriter::StreamedDataWriter(
+    std::shared_ptr<StreamedResult> result,
+    const ByteArray& key,
+    const ByteArray& iv) :
+    result_(result),
+    written_(false),
+    finished_(false),
+    offset_(0),
+    size_(0) {
+    if (!key.empty()) {
+        encryptor_.reset(new tcf::crypto::skenc::StreamEncryptor(key, iv));
+    }
+}  // tcf::StreamedDataWriter::StreamedDataWriter
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataWriter::Write(const uint8_t* data, size_t size) {
+    // Items are contiguous in the output, an item can't be continued
+    // once another one was written
+    tcf::error::ThrowIf<tcf::error::ValueError>(
+        written_ && result_->GetWriter() != this,
+        "outData items must be written one after the other");
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(finished_,
+        "Streamed work order data written after the work order");
+    if (size == 0) {
+        return;
+    }
+
+    if (!written_) {
+        written_ = true;
+        offset_ = result_->Start(this);
+    }
+
+    data_hasher_.Update(data, size);
+    if (encryptor_) {
+        Encode(encryptor_->Update(data, size));
+    } else {
+        Encode(ByteArray(data, data + size));
+    }
+}  // tcf::StreamedDataWriter::Write
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataWriter::Finish() {
+    if (!written_ || finished_) {
+        return;
+    }
+
+    if (encryptor_) {
+        Encode(encryptor_->Finalize());
+    }
+    pending_ += base64_encode(unencoded_);
+    unencoded_.clear();
+    Flush();
+
+    data_hash_ = data_hasher_.Finalize();
+    stream_digest_ = stream_hasher_.Finalize();
+    finished_ = true;
+}  // tcf::StreamedDataWriter::Finish
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataWriter::UpdateResponseHash(
+    tcf::crypto::MessageHasher& hasher) {
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(!finished_,
+        "Streamed work order data is not finished");
+
+    // Same as the response hash of embedded output, which hashes the
+    // base64 encoded data if it is encrypted and the data itself if not
+    tcf::crypto::MessageHasher stream_hasher;
+    std::string chunk;
+    for (size_t position = 0; position < size_; position += chunk.size()) {
+        chunk.resize(std::min(size_ - position, WORK_ORDER_DATA_CHUNK_SIZE));
+        ReadStreamedResult(offset_ + position, (uint8_t*) &chunk[0],
+            chunk.size());
+        stream_hasher.Update(chunk);
+        if (encryptor_) {
+            hasher.Update(chunk);
+        } else {
+            hasher.Update(base64_decode(chunk));
+        }
+    }
+
+    // The hash is signed, so the data hashed must be the data written
+    tcf::error::ThrowIf<tcf::error::ValueError>(
+        stream_hasher.Finalize() != stream_digest_,
+        "Streamed output data changed after it was written");
+}  // tcf::StreamedDataWriter::UpdateResponseHash
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataWriter::Encode(const ByteArray& data) {
+    // Encode whole base64 quanta only, so that the pieces written out
+    // concatenate to the encoding of the whole data
+    unencoded_.insert(unencoded_.end(), data.begin(), data.end());
+    size_t whole = unencoded_.size() - unencoded_.size() % 3;
+    if (whole == 0) {
+        return;
+    }
+
+    pending_ += base64_encode(unencoded_.data(), whole);
+    unencoded_.erase(unencoded_.begin(), unencoded_.begin() + whole);
+    if (pending_.size() >= WORK_ORDER_DATA_CHUNK_SIZE) {
+        Flush();
+    }
+}  // tcf::StreamedDataWriter::Encode
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::StreamedDataWriter::Flush() {
+    if (pending_.empty()) {
+        return;
+    }
+
+    result_->Append((const uint8_t*) pending_.data(), pending_.size());
+    stream_hasher_.Update(pending_);
+    size_ += pending_.size();
+    pending_.clear();
+}  // tcf::StreamedDataWriter::Flush
@@ -0,0 +1,200 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include "crypto.h"
+#include "types.h"
+#include "work_order_data.h"
+
+namespace tcf {
+
+    // Size of the pieces of streamed inData copied into the enclave at a
+    // time. A multiple of 4, so that every piece but the last one is
+    // whole base64 quanta.
+    const size_t WORK_ORDER_DATA_CHUNK_SIZE = 64 * 1024;
+
+    // Copies size bytes at offset of the inData streamed alongside the
+    // work order request being handled
+    void ReadStreamedData(uint64_t offset, uint8_t* buffer, size_t size);
+
+    // Passes size bytes of streamed data at offset to hasher in pieces
+    // of WORK_ORDER_DATA_CHUNK_SIZE and returns the SHA256 hash of them
+    ByteArray HashStreamedData(uint64_t offset,
+        size_t size,
+        tcf::crypto::MessageHasher& hasher);
+
+    // Appends size bytes to the output of the streamed outData items of
+    // the work order request being handled
+    void WriteStreamedResult(const uint8_t* data, size_t size);
+
+    // Copies size bytes at offset of the output written with
+    // WriteStreamedResult
+    void ReadStreamedResult(uint64_t offset, uint8_t* buffer, size_t size);
+
+    // Whether the work order request being handled came through
+    // ecall_HandleWorkOrderRequestStream, so that the output of its
+    // outData items can be written out of the enclave
+    bool IsStreamedResultCollected();
+
+    // Marks the work order requests handled by the calling thread while
+    // it exists as coming through ecall_HandleWorkOrderRequestStream
+    class StreamedResultScope {
+    public:
+        StreamedResultScope();
+        ~StreamedResultScope();
+
+    private:
+        StreamedResultScope(const StreamedResultScope&);
+        StreamedResultScope& operator=(const StreamedResultScope&);
+    };  // class StreamedResultScope
+
+    /*
+      Reads the base64 encoded, optionally encrypted data of a streamed
+      inData item piece by piece, decrypting and hashing it incrementally.
+      At the end of the data it checks that the data did not change since
+      its hash stream_digest was taken with HashStreamedData, that the
+      AES-GCM tag is valid and that the decrypted data matches data_hash.
+    */
+    class StreamedDataReader : public WorkOrderDataReader {
+    public:
+        // key is empty if the data is not encrypted, data_hash is empty
+        // if the request does not carry a hash of the data
+        StreamedDataReader(uint64_t offset,
+            size_t size,
+            const ByteArray& key,
+            const ByteArray& iv,
+            const ByteArray& stream_digest,
+            const ByteArray& data_hash);
+
+        size_t Read(uint8_t* buffer, size_t size) override;
+
+        // Reads the rest of the data into a single buffer
+        ByteArray ReadAll();
+
+        // Reads and verifies the rest of the data if it was partially
+        // read, so that nothing read is left unverified
+        void Finish();
+
+    private:
+        void ReadChunk();
+        void VerifyEnd();
+
+        uint64_t offset_;
+        size_t size_;
+        size_t position_;
+        bool at_end_;
+
+        std::unique_ptr<tcf::crypto::skenc::StreamDecryptor> decryptor_;
+        tcf::crypto::MessageHasher stream_hasher_;
+        tcf::crypto::MessageHasher data_hasher_;
+        ByteArray stream_digest_;
+        ByteArray data_hash_;
+
+        // Decrypted data of the last chunk not read yet
+        ByteArray pending_;
+        size_t pending_position_;
+    };  // class StreamedDataReader
+
+    class StreamedDataWriter;
+
+    // Output of the streamed outData items of a work order. Items are
+    // written one after the other, each one is a contiguous range.
+    class StreamedResult {
+    public:
+        StreamedResult() : size_(0), writer_(nullptr) {}
+
+        // Finishes the item written so far and returns the offset of the
+        // item of writer, which is written next
+        uint64_t Start(StreamedDataWriter* writer);
+
+        void Append(const uint8_t* data, size_t size);
+
+        const StreamedDataWriter* GetWriter() const {
+            return writer_;
+        }
+
+    private:
+        uint64_t size_;
+        StreamedDataWriter* writer_;
+    };  // class StreamedResult
+
+    /*
+      Encrypts, hashes and base64 encodes the output of an outData item
+      written by the workload piece by piece, and writes the base64
+      encoded data out of the enclave in pieces of
+      WORK_ORDER_DATA_CHUNK_SIZE.
+    */
+    class StreamedDataWriter : public WorkOrderDataWriter {
+    public:
+        // key is empty if the data is not to be encrypted
+        StreamedDataWriter(std::shared_ptr<StreamedResult> result,
+            const ByteArray& key,
+            const ByteArray& iv);
+
+        void Write(const uint8_t* data, size_t size) override;
+
+        bool IsWritten() const {
+            return written_;
+        }
+
+        // Writes out the rest of the data, at the end of the work order
+        void Finish();
+
+        uint64_t GetOffset() const {
+            return offset_;
+        }
+
+        // Size of the base64 encoded data
+        size_t GetSize() const {
+            return size_;
+        }
+
+        // SHA256 hash of the data written by the workload
+        const ByteArray& GetDataHash() const {
+            return data_hash_;
+        }
+
+        // Passes the data written out to hasher as it is hashed for the
+        // response hash, checking that it did not change since written
+        void UpdateResponseHash(tcf::crypto::MessageHasher& hasher);
+
+    private:
+        void Encode(const ByteArray& data);
+        void Flush();
+
+        std::shared_ptr<StreamedResult> result_;
+        std::unique_ptr<tcf::crypto::skenc::StreamEncryptor> encryptor_;
+        tcf::crypto::MessageHasher data_hasher_;
+        tcf::crypto::MessageHasher stream_hasher_;
+        ByteArray data_hash_;
+        ByteArray stream_digest_;
+
+        bool written_;
+        bool finished_;
+        uint64_t offset_;
+        size_t size_;
+
+        // Last bytes of the data not making a whole base64 quantum
+        ByteArray unencoded_;
+        // Base64 encoded data not written out yet
+        std::string pending_;
+    };  // class StreamedDataWriter
+
+}  // namespace tcf
@@ -18,30 +18,32 @@
 #include <sgx_trts.h>
 #include<mbusafecrt.h>
 
+#include <string>
+#include <vector>
+
 #include "error.h"
 #include "tcf_error.h"
 #include "types.h"
 #include "enclave_utils.h"
-
-// global variable to store last serialized response. Initialized when
-// work order is successfully processed in ecall_HandleWorkOrderRequest
-extern ByteArray last_serialized_response;
+#include "workload_processor.h"
+#include "work_order_batch.h"
+#include "work_order_data_stream.h"
+#include "work_order_enclave_common.h"
+#include "work_order_response_table.h"
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-tcf_err_t ecall_GetSerializedResponse(uint8_t* outSerializedResponse,
+tcf_err_t ecall_GetSerializedResponse(uint32_t inResponseIdentifier,
+    uint8_t* outSerializedResponse,
     size_t inSerializedResponseSize) {
 
     tcf_err_t result = TCF_SUCCESS;
     try {
         tcf::error::ThrowIfNull(outSerializedResponse,
             "Serialized response pointer is NULL");
-        tcf::error::ThrowIf<tcf::error::ValueError>(
-            inSerializedResponseSize < last_serialized_response.size(),
-            "Not enough space for the response");
 
-        memcpy_s(outSerializedResponse, inSerializedResponseSize,
-            last_serialized_response.data(),
-            last_serialized_response.size());
+        // Response is released from the table once it is copied out
+        tcf::WorkOrderResponseTable::getInstance()->Take(inResponseIdentifier,
+            outSerializedResponse, inSerializedResponseSize);
     } catch (tcf::error::Error& e) {
         SAFE_LOG(TCF_LOG_ERROR,
             "Error in enclave(ecall_GetSerializedResponse): %04X -- %s",
@@ -56,3 +58,154 @@ tcf_err_t ecall_GetSerializedResponse(uint8_t* outSerializedResponse,
 
     return result;
 }  // ecall_GetSerializedResponse
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf_err_t ecall_HandleWorkOrderRequestWithResponse(
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    size_t inWorkOrderExtDataSize,
+    uint8_t* outSerializedResponse,
+    size_t inResponseBufferSize,
+    uint32_t* outResponseIdentifier,
+    size_t* outSerializedResponseSize) {
+
+    tcf_err_t result = TCF_SUCCESS;
+    try {
+        tcf::error::ThrowIfNull(outSerializedResponse,
+            "Serialized response pointer is NULL");
+
+        // Worker specific processing is done by ecall_HandleWorkOrderRequest,
+        // which stores the response in the response table
+        result = ecall_HandleWorkOrderRequest(inSerializedRequest,
+            inSerializedRequestSize, inWorkOrderExtData,
+            inWorkOrderExtDataSize, outResponseIdentifier,
+            outSerializedResponseSize);
+        if (result != TCF_SUCCESS) {
+            return result;
+        }
+
+        // Copy the response out in the same enclave transition when the
+        // caller's buffer is large enough. Otherwise the caller has to use
+        // ecall_GetSerializedResponse with the returned identifier and size.
+        if (*outSerializedResponseSize <= inResponseBufferSize) {
+            tcf::WorkOrderResponseTable::getInstance()->Take(
+                *outResponseIdentifier, outSerializedResponse,
+                inResponseBufferSize);
+        }
+    } catch (tcf::error::Error& e) {
+        SAFE_LOG(TCF_LOG_ERROR,
+            "Error in enclave(ecall_HandleWorkOrderRequestWithResponse): "
+            "%04X -- %s", e.error_code(), e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    } catch (...) {
+        SAFE_LOG(TCF_LOG_ERROR, "Unknown error in "
+            "enclave(ecall_HandleWorkOrderRequestWithResponse)");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // ecall_HandleWorkOrderRequestWithResponse
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf_err_t ecall_HandleWorkOrderRequestStream(
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    size_t inWorkOrderExtDataSize,
+    uint8_t* outSerializedResponse,
+    size_t inResponseBufferSize,
+    uint32_t* outResponseIdentifier,
+    size_t* outSerializedResponseSize) {
+
+    // The untrusted side collects the output of streamed outData items
+    // for requests of this ecall only, workloads get writers for them
+    // while the scope is open
+    tcf::StreamedResultScope streamed_result_scope;
+    return ecall_HandleWorkOrderRequestWithResponse(inSerializedRequest,
+        inSerializedRequestSize, inWorkOrderExtData, inWorkOrderExtDataSize,
+        outSerializedResponse, inResponseBufferSize, outResponseIdentifier,
+        outSerializedResponseSize);
+}  // ecall_HandleWorkOrderRequestStream
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf_err_t ecall_HandleWorkOrderBatch(
+    const uint8_t* inSerializedBatch,
+    size_t inSerializedBatchSize,
+    uint8_t* outSerializedResponse,
+    size_t inResponseBufferSize,
+    uint32_t* outResponseIdentifier,
+    size_t* outSerializedResponseSize) {
+
+    tcf_err_t result = TCF_SUCCESS;
+    try {
+        tcf::error::ThrowIfNull(inSerializedBatch,
+            "Serialized batch pointer is NULL");
+        tcf::error::ThrowIfNull(outSerializedResponse,
+            "Serialized response pointer is NULL");
+        tcf::error::ThrowIfNull(outResponseIdentifier,
+            "Response identifier pointer is NULL");
+        tcf::error::ThrowIfNull(outSerializedResponseSize,
+            "Response size pointer is NULL");
+
+        std::vector<tcf::work_order_batch::RequestItem> requests =
+            tcf::work_order_batch::ParseRequests(inSerializedBatch,
+                inSerializedBatchSize);
+
+        // Unseal the enclave persistent data once for the batch, and
+        // look the workloads of the batch up once
+        EnclaveData* enclaveData = EnclaveData::getInstance();
+        WorkloadProcessorBatchScope workload_batch;
+
+        tcf::WorkOrderResponseTable* response_table =
+            tcf::WorkOrderResponseTable::getInstance();
+        ByteArray batch_response;
+        for (const auto& request : requests) {
+            // A work order which fails is reported in its own status,
+            // the other work orders of the batch are still processed
+            tcf_err_t status = TCF_SUCCESS;
+            ByteArray response;
+            try {
+                response = tcf::ProcessWorkOrderRequest(enclaveData,
+                    request.request, request.request_size,
+                    request.ext_data_size > 0 ? request.ext_data : nullptr,
+                    request.ext_data_size);
+            } catch (tcf::error::Error& e) {
+                SAFE_LOG(TCF_LOG_ERROR,
+                    "Error in enclave(ecall_HandleWorkOrderBatch) work "
+                    "order: %04X -- %s", e.error_code(), e.what());
+                status = e.error_code();
+            } catch (...) {
+                SAFE_LOG(TCF_LOG_ERROR,
+                    "Unknown error in enclave(ecall_HandleWorkOrderBatch) "
+                    "work order");
+                status = TCF_ERR_UNKNOWN;
+            }
+            tcf::work_order_batch::AppendResponse(batch_response,
+                status, response);
+        }
+
+        *outSerializedResponseSize = batch_response.size();
+        *outResponseIdentifier = response_table->Store(batch_response);
+
+        // Same as for a single work order, the response batch is copied
+        // out right away if it fits into the caller's buffer
+        if (*outSerializedResponseSize <= inResponseBufferSize) {
+            response_table->Take(*outResponseIdentifier,
+                outSerializedResponse, inResponseBufferSize);
+        }
+    } catch (tcf::error::Error& e) {
+        SAFE_LOG(TCF_LOG_ERROR,
+            "Error in enclave(ecall_HandleWorkOrderBatch): %04X -- %s",
+            e.error_code(), e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    } catch (...) {
+        SAFE_LOG(TCF_LOG_ERROR,
+            "Unknown error in enclave(ecall_HandleWorkOrderBatch)");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // ecall_HandleWorkOrderBatch
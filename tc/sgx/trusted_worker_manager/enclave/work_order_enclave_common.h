@@ -0,0 +1,41 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+#include "enclave_data.h"
+
+namespace tcf {
+
+    /*
+      Processes a serialized work order request with the work order
+      processor of the worker, and returns the serialized response.
+      Defined by each worker enclave, for its ecall_HandleWorkOrderRequest
+      and for ecall_HandleWorkOrderBatch, which looks enclave_data up once
+      for all of the work orders of a batch.
+      Throws tcf::error::Error if the request can not be processed into
+      a response.
+    */
+    ByteArray ProcessWorkOrderRequest(EnclaveData* enclave_data,
+        const uint8_t* inSerializedRequest,
+        size_t inSerializedRequestSize,
+        const uint8_t* inWorkOrderExtData,
+        size_t inWorkOrderExtDataSize);
+
+}  // namespace tcf
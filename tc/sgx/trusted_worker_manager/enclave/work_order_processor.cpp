@@ -13,23 +13,29 @@
 * limitations under the License.
 */
 
+#include <ctype.h>
+#include <string.h>
 #include <algorithm>
+#include <memory>
 #include <vector>
 #include <string>
+#include <utility>
 
 #include "error.h"
 #include "tcf_error.h"
 #include "types.h"
 
+#include "arena.h"
 #include "crypto.h"
-#include "jsonvalue.h"
-#include "parson.h"
 #include "hex_string.h"
-#include "json_utils.h"
+#include "json_writer.h"
 #include "utils.h"
+#include "work_order_hash.h"
 
 #include "enclave_utils.h"
 #include "enclave_data.h"
+#include "public_key_cache.h"
+#include "session_key_cache.h"
 
 #include "work_order_data.h"
 #include "work_order_processor.h"
@@ -42,27 +48,21 @@ namespace tcf {
         session_key.clear();
     }
 
-    JsonValue WorkOrderProcessor::ParseJsonInput(std::string json_str) {
-        // Parse the work order request
-        JsonValue parsed(json_parse_string(json_str.c_str()));
-        tcf::error::ThrowIfNull(
-            parsed.value, "failed to parse the work order request, badly formed JSON");
+    work_order_request::WorkOrderRequest WorkOrderProcessor::ParseJsonInput(
+        const char* json_str) {
+        using work_order_request::GetString;
 
-        JSON_Object* request_object = json_value_get_object(parsed);
-        tcf::error::ThrowIfNull(request_object, "Missing JSON object in work order request");
+        // Parse the work order request, in a single scan unless it has an
+        // unusual shape
+        work_order_request::WorkOrderRequest request =
+            work_order_request::ParseRequest(json_str);
 
-        json_request_id = GetJsonNumber(request_object, "id");
+        json_request_id = request.id;
 
-        JSON_Object* params_object = json_object_dotget_object(request_object, "params");
-        tcf::error::ThrowIfNull(params_object, "Missing params object in work order request");
+        response_timeout_msecs = request.response_timeout_msecs;
 
-        response_timeout_msecs = GetJsonNumber(
-            params_object,
-            "responseTimeoutMSecs");
-
-        payload_format = GetJsonStr(
-            params_object,
-            "payloadFormat",
+        payload_format = GetString(
+            request.payload_format,
             "invalid request; failed to retrieve payload format");
 
         /* verifyingKey is optional field. This parameter is not described
@@ -70,85 +70,60 @@ namespace tcf {
            requester signature. Hence don't throw exception
            if param is not there or empty value.
         */
-        verifying_key = GetJsonStr(
-            params_object,
-            "verifyingKey",
-            nullptr);
+        verifying_key = GetString(request.verifying_key);
 
         // resultUri is optional field. Hence don't throw exception
         // if param is not there or empty in the request.
-        result_uri = GetJsonStr(
-            params_object,
-            "resultUri",
-            nullptr);
+        result_uri = GetString(request.result_uri);
 
         // notifyUri is optional field. Hence don't throw exception
         // if param is not there or empty in the request.
-        notify_uri = GetJsonStr(
-            params_object,
-            "notifyUri",
-            nullptr);
-
-        work_order_id = GetJsonStr(
-            params_object,
-            "workOrderId",
+        notify_uri = GetString(request.notify_uri);
+
+        work_order_id = GetString(
+            request.work_order_id,
             "invalid request; failed to retrieve work order id");
 
-        worker_id = GetJsonStr(
-            params_object,
-            "workerId",
+        worker_id = GetString(
+            request.worker_id,
             "invalid request; failed to retrieve worker id");
 
-        workload_id = GetJsonStr(
-            params_object,
-            "workloadId",
+        workload_id = GetString(
+            request.workload_id,
             "invalid request; failed to retrieve work load id");
 
-        requester_id = GetJsonStr(
-            params_object,
-            "requesterId",
+        requester_id = GetString(
+            request.requester_id,
             "invalid request; failed to retrieve requester id");
 
         // workerEncryptionKey is optional field. Hence don't throw exception
         // if param is not there or empty in the request.
-        worker_encryption_key = GetJsonStr(
-            params_object,
-            "workerEncryptionKey",
-            nullptr);
+        worker_encryption_key = GetString(request.worker_encryption_key);
 
         // dataEncryptionAlgorithm is optional field. Hence don't throw exception
         // if param is not there or empty in the request.
-        data_encryption_algorithm = GetJsonStr(
-            params_object,
-            "dataEncryptionAlgorithm",
-            nullptr);
-
-        encrypted_session_key = GetJsonStr(
-            params_object,
-            "encryptedSessionKey",
+        data_encryption_algorithm = GetString(
+            request.data_encryption_algorithm);
+
+        encrypted_session_key = GetString(
+            request.encrypted_session_key,
             "invalid request; failed to retrieve encrypted session key");
 
-        session_key_iv = GetJsonStr(
-            params_object,
-            "sessionKeyIv",
+        session_key_iv = GetString(
+            request.session_key_iv,
             "invalid request; failed to retrieve session key iv");
 
-        requester_nonce = GetJsonStr(
-            params_object,
-            "requesterNonce",
+        requester_nonce = GetString(
+            request.requester_nonce,
             "invalid request; failed to retrieve requester nonce");
 
-        encrypted_request_hash = GetJsonStr(
-            params_object,
-            "encryptedRequestHash",
+        encrypted_request_hash = GetString(
+            request.encrypted_request_hash,
             "invalid request; failed to retrieve encrypted request hash");
 
         // requesterSignature is optional field. Hence don't throw exception
         // if param is not there or empty in the request.
-        requester_signature = GetJsonStr(
-            params_object,
-            "requesterSignature",
-            nullptr);
+        requester_signature = GetString(request.requester_signature);
 
         if (data_encryption_algorithm.length() > 0) {
             tcf::error::ThrowIf<tcf::error::ValueError>(data_encryption_algorithm != "AES-GCM-256",
@@ -161,111 +136,136 @@ namespace tcf {
         tcf::error::ThrowIf<tcf::error::ValueError>(payload_format != "json-rpc",
             "Unsupported payload format found in the input");
 
-        // return JSON deserialized value
-        return parsed;
+        // return the parsed request, with the data items
+        return request;
     }  // WorkOrderProcessor::ParseJsonInput
 
     void WorkOrderProcessor::DecryptWorkOrderKeys(
-        EnclaveData* enclave_data, const JsonValue& wo_req_json_val) {
+        EnclaveData* enclave_data,
+        const work_order_request::WorkOrderRequest& wo_request) {
 
-        // Decrypt Encryption key
         ByteArray encrypted_session_key_bytes = \
             HexStringToBinary(encrypted_session_key);
-        session_key = enclave_data->decrypt_message(
-            encrypted_session_key_bytes);
+        if (IsKeyAgreementRequested(enclave_data)) {
+            // encryptedSessionKey is the requester's ephemeral ECDH
+            // public key, the session key is derived from the shared secret
+            session_key = enclave_data->derive_session_key(
+                encrypted_session_key_bytes);
+        } else {
+            // Decrypt Encryption key
+            session_key = SessionKeyCache::getInstance()->DecryptSessionKey(
+                enclave_data, encrypted_session_key_bytes);
+        }
         ByteArray session_key_iv_bytes = HexStringToBinary(session_key_iv);
 
-        JSON_Object* request_object = json_value_get_object(wo_req_json_val);
-        tcf::error::ThrowIfNull(request_object,
-            "Missing JSON object in work order request");
-
-        JSON_Object* params_object = json_object_dotget_object(request_object, "params");
-        tcf::error::ThrowIfNull(params_object,
-            "Missing params object in work order request");
-
-        JSON_Array* data_array = json_object_get_array(
-            params_object, "inData");
-        size_t count = json_array_get_count(data_array);
-        tcf::error::ThrowIf<tcf::error::ValueError>(count == 0,
-            "Indata is empty");
+        tcf::error::ThrowIf<tcf::error::ValueError>(
+            wo_request.in_data.empty(), "Indata is empty");
 
-        size_t i;
-        for (i = 0; i < count; i++) {
-            JSON_Object* data_object = json_array_get_object(data_array, i);
+        for (const auto& item : wo_request.in_data) {
             WorkOrderDataHandler wo_data(session_key, session_key_iv_bytes);
-            wo_data.Unpack(data_object);
-            data_items_in.emplace_back(wo_data);
+            wo_data.Unpack(item);
+            data_items_in.emplace_back(std::move(wo_data));
         }
-        data_array = json_object_get_array(params_object, "outData");
+        WorkOrderDataHandler::VerifyInputHashes(data_items_in);
 
-        count = json_array_get_count(data_array);
-        for (i = 0; i < count; i++) {
-            JSON_Object* data_object = json_array_get_object(data_array, i);
+        for (const auto& item : wo_request.out_data) {
             WorkOrderDataHandler wo_data(session_key, session_key_iv_bytes);
-            wo_data.Unpack(data_object);
-            data_items_out.emplace_back(wo_data);
+            wo_data.Unpack(item);
+            data_items_out.emplace_back(std::move(wo_data));
         }
+        WorkOrderDataHandler::VerifyInputHashes(data_items_out);
     }  // WorkOrderProcessor::DecryptWorkOrderKeys
 
-    JsonValue WorkOrderProcessor::CreateJsonOutput() {
-        JSON_Status jret;
-
-        // Create the response structure
-        JsonValue resp_value(json_value_init_object());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            !resp_value.value, "Failed to create the response object");
-
-        JSON_Object* resp = json_value_get_object(resp_value);
-        tcf::error::ThrowIfNull(resp, "Failed on retrieval of response object value");
-
-        JsonSetStr(resp, "jsonrpc", "2.0", "failed to serialize jsonrpc");
-        JsonSetNumber(resp, "id", json_request_id, "failed to serialize json request id");
-
-        jret = json_object_set_value(resp, "result", json_value_init_object());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            jret != JSONSuccess, "failed to serialize result");
-
-        JSON_Object* result = json_object_get_object(resp, "result");
-        tcf::error::ThrowIfNull(result, "failed to serialize the result");
-
-        JsonSetStr(result, "workOrderId", work_order_id.c_str(),
-                  "failed to serialize work order id");
-        JsonSetStr(result, "workloadId", workload_id.c_str(),
-                "failed to serialize workload id");
-        JsonSetStr(result, "workerId", worker_id.c_str(),
-                "failed to serialize worker id");
-        JsonSetStr(result, "requesterId", requester_id.c_str(),
-                "failed to serialize requester id");
-        JsonSetStr(result, "workerNonce", worker_nonce.c_str(),
-                "failed to serialize worker nonce");
-        JsonSetStr(result, "workerSignature", worker_signature.c_str(),
-                "failed to serialize worker signature");
-
-        jret = json_object_set_value(result, "outData", json_value_init_array());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            jret != JSONSuccess, "failed to serialize the result data");
-
-        JSON_Array* data_array = json_object_get_array(result, "outData");
-        tcf::error::ThrowIfNull(data_array, "failed to serialize the dependency array");
-
-        for (auto out_data : data_items_out)
-            out_data.Pack(data_array);
-
-        // return constructed json
-        return resp_value;
+    /*
+     * Requesters agree on the session key with the worker's ECDH key
+     * instead of encrypting it with the worker's RSA key by naming the
+     * ECDH key in workerEncryptionKey, either as it is published or
+     * hex encoded again like other workerEncryptionKey values.
+     *
+     * @param enclave_data - Instance of EnclaveData class
+     */
+    bool WorkOrderProcessor::IsKeyAgreementRequested(
+        EnclaveData* enclave_data) {
+        if (worker_encryption_key.empty()) {
+            return false;
+        }
+        std::string agreement_key =
+            enclave_data->get_serialized_key_agreement_key();
+        std::string requested_key = worker_encryption_key;
+        if (requested_key.size() == 2 * agreement_key.size()) {
+            try {
+                requested_key = ByteArrayToString(
+                    HexStringToBinary(requested_key));
+            } catch (tcf::error::ValueError& e) {
+                return false;
+            }
+        }
+        if (requested_key.size() != agreement_key.size()) {
+            return false;
+        }
+        // Hex digits of either case
+        return std::equal(requested_key.begin(), requested_key.end(),
+            agreement_key.begin(), [](char x, char y)
+            {return ::toupper(x) == ::toupper(y);});
+    }  // WorkOrderProcessor::IsKeyAgreementRequested
+
+    void WorkOrderProcessor::PrepareStreamedData() {
+        // Streamed inData items follow each other in the stream in the
+        // order of the inData array
+        uint64_t stream_offset = 0;
+        for (auto& d : data_items_in) {
+            if (d.IsStreamed()) {
+                d.SetStreamOffset(stream_offset);
+                stream_offset += d.GetStreamSize();
+            }
+        }
+        for (auto& d : data_items_out) {
+            tcf::error::ThrowIf<tcf::error::ValueError>(d.IsStreamed(),
+                "outData can not be streamed");
+        }
+    }  // WorkOrderProcessor::PrepareStreamedData
+
+    ByteArray WorkOrderProcessor::CreateJsonOutput() {
+        // Reserve room for the whole response, most of which is outData
+        size_t expected_size = 512 + work_order_id.size() +
+            workload_id.size() + worker_id.size() + requester_id.size() +
+            worker_nonce.size() + worker_signature.size();
+        for (auto& out_data : data_items_out) {
+            expected_size += out_data.GetPackedSize();
+        }
+        JsonWriter writer(expected_size);
+
+        writer.BeginObject();
+        writer.AddStr("jsonrpc", "2.0", "failed to serialize jsonrpc");
+        writer.AddNumber("id", json_request_id);
+        writer.BeginObject("result");
+        WriteResult(writer);
+        writer.EndObject();
+        writer.EndObject();
+
+        // return serialized json
+        return writer.Finish();
     }  // WorkOrderProcessor::CreateJsonOutput
 
-    ByteArray WorkOrderProcessor::SerializeJson(JsonValue& json_value) {
-        size_t serializedSize = json_serialization_size(json_value);
-        ByteArray serialized_response;
-        serialized_response.resize(serializedSize);
-
-        JSON_Status jret = json_serialize_to_buffer(json_value,
-            reinterpret_cast<char*>(&serialized_response[0]), serialized_response.size());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            jret != JSONSuccess, "workorder response serialization failed");
-        return serialized_response;
-    }  // WorkOrderProcessor::SerializeJson
+    void WorkOrderProcessor::WriteResult(JsonWriter& writer) {
+        writer.AddStr("workOrderId", work_order_id,
+            "failed to serialize work order id");
+        writer.AddStr("workloadId", workload_id,
+            "failed to serialize workload id");
+        writer.AddStr("workerId", worker_id,
+            "failed to serialize worker id");
+        writer.AddStr("requesterId", requester_id,
+            "failed to serialize requester id");
+        writer.AddStr("workerNonce", worker_nonce,
+            "failed to serialize worker nonce");
+        writer.AddStr("workerSignature", worker_signature,
+            "failed to serialize worker signature");
+
+        writer.BeginArray("outData");
+        for (auto& out_data : data_items_out)
+            out_data.Pack(writer);
+        writer.EndArray();
+    }  // WorkOrderProcessor::WriteResult
 
     std::vector<tcf::WorkOrderData> WorkOrderProcessor::ExecuteWorkOrder(
         EnclaveData* enclave_data) {
@@ -273,25 +273,45 @@ namespace tcf {
         std::vector<tcf::WorkOrderData> in_wo_data;
         std::vector<tcf::WorkOrderData> out_wo_data;
         if (data_items_in.size() > 0) {
-            for (auto d : data_items_in) {
-                in_wo_data.emplace_back(d.workorder_data.index,
-                                        d.workorder_data.decrypted_data);
-            }
-
-            for (auto d : data_items_out) {
-                out_wo_data.emplace_back(d.workorder_data.index,
-                                         d.workorder_data.decrypted_data);
-            }
-
             // Convert workload_id from hex string to string
             ByteArray workload_bytes = HexStringToBinary(workload_id);
             std::string workload_type(workload_bytes.begin(), workload_bytes.end());
 
-            WorkloadProcessor *processor = \
-                WorkloadProcessor::CreateWorkloadProcessor(workload_type);
+            // Released when the work order is done
+            WorkloadProcessorPtr processor =
+                WorkloadProcessor::AcquireWorkloadProcessor(workload_type);
             tcf::error::ThrowIf<tcf::error::WorkloadError>(
-                processor == nullptr,
+                !processor,
                 "Workload cannot be processed by this worker");
+
+            // The data of the items is moved to the workload, the items
+            // keep what they need to finish streamed data
+            in_wo_data.reserve(data_items_in.size());
+            for (auto& d : data_items_in) {
+                // Workloads which can't read streamed data get all of it
+                // in decrypted_data
+                if (d.IsStreamed() && !processor->SupportsStreamedData()) {
+                    d.ReadStreamedData();
+                }
+                in_wo_data.push_back(std::move(d.workorder_data));
+            }
+
+            // Output of workloads writing outData through writers is
+            // written out of the enclave as it is produced. Requests not
+            // handled through ecall_HandleWorkOrderRequestStream have no
+            // place for it outside, their output is in decrypted_data.
+            bool write_streamed = processor->SupportsStreamedData() &&
+                tcf::IsStreamedResultCollected();
+            std::shared_ptr<StreamedResult> streamed_result =
+                std::make_shared<StreamedResult>();
+            out_wo_data.reserve(data_items_out.size());
+            for (auto& d : data_items_out) {
+                if (write_streamed) {
+                    d.CreateStreamWriter(streamed_result);
+                }
+                out_wo_data.push_back(std::move(d.workorder_data));
+            }
+
             processor->ProcessWorkOrder(
                     workload_type,
                     StrToByteArray(requester_id),
@@ -306,58 +326,53 @@ namespace tcf {
     }
 
     ByteArray WorkOrderProcessor::ComputeRequestHash() {
-        std::string concat_string = requester_nonce + work_order_id +
-                worker_id + workload_id + requester_id;
-        ByteArray hash_1 =  tcf::crypto::ComputeMessageHash(
-                                    StrToByteArray(concat_string));
-        // Calculate inData hash
+        if (!request_hash.empty()) {
+            return request_hash;
+        }
+
+        // The request fields are passed to the hashers one after the
+        // other, without being concatenated first
+        ByteArray hash_1 = tcf::work_order_hash::ComputeIdHash(
+            requester_nonce, work_order_id, worker_id, workload_id,
+            requester_id);
+        // Calculate inData hash, streamed inData is passed to the
+        // hasher piece by piece
         ByteArray hash_in_data;
-        std::string hash_in_data_str;
+        tcf::crypto::MessageHasher in_data_hasher;
+        size_t in_data_size = 0;
         size_t i;
         // First sort the inData elements based on index
         // Sorting is required to calculate hash deterministically
         std::sort(data_items_in.begin(), data_items_in.end(),
-            [](WorkOrderDataHandler x, WorkOrderDataHandler  y)
+            [](const WorkOrderDataHandler& x, const WorkOrderDataHandler& y)
             {return x.workorder_data.index < y.workorder_data.index;});
         for (i = 0; i < data_items_in.size(); i++) {
             tcf::WorkOrderDataHandler& d = data_items_in.at(i);
-            if (!d.concat_string.empty()) {
-                hash_in_data_str = hash_in_data_str + d.concat_string;
-            }
+            in_data_size += d.UpdateRequestHash(in_data_hasher);
         }
-        if(!hash_in_data_str.empty()) {
-            hash_in_data = tcf::crypto::ComputeMessageHash(
-                                StrToByteArray(hash_in_data_str));
+        if (in_data_size > 0) {
+            hash_in_data = in_data_hasher.Finalize();
         }
         // Compute outData hash
         ByteArray hash_out_data;
-        std::string hash_out_data_str;
+        tcf::crypto::MessageHasher out_data_hasher;
+        size_t out_data_size = 0;
         // First sort the outData elements based on index
         // Sorting is required to calculate hash deterministically
         std::sort(data_items_out.begin(),  data_items_out.end(),
-            [](WorkOrderDataHandler x, WorkOrderDataHandler  y)
+            [](const WorkOrderDataHandler& x, const WorkOrderDataHandler& y)
             {return x.workorder_data.index < y.workorder_data.index;});
         for (i = 0; i < data_items_out.size(); i++) {
             tcf::WorkOrderDataHandler& d = data_items_out.at(i);
-            if (!d.concat_string.empty()) {
-                hash_out_data_str = hash_out_data_str + d.concat_string;
-            }
+            out_data_size += d.UpdateRequestHash(out_data_hasher);
         }
-        if(!hash_out_data_str.empty()) {
-            hash_out_data = tcf::crypto::ComputeMessageHash(
-                                    StrToByteArray(hash_out_data_str));
+        if (out_data_size > 0) {
+            hash_out_data = out_data_hasher.Finalize();
         }
         // Calculate final hash
-        std::string final_hash_string = ByteArrayToString(hash_1);
-        if(!hash_in_data_str.empty()) {
-            final_hash_string += ByteArrayToString(hash_in_data);
-        }
-        if(!hash_out_data_str.empty()) {
-            final_hash_string += ByteArrayToString(hash_out_data);
-        }
-        ByteArray final_hash = tcf::crypto::ComputeMessageHash(
-                                    StrToByteArray(final_hash_string));
-        return final_hash;
+        request_hash = tcf::work_order_hash::ComputeFinalHash(
+            hash_1, hash_in_data, hash_out_data);
+        return request_hash;
     }
 
     tcf_err_t WorkOrderProcessor::VerifyEncryptedRequestHash() {
@@ -394,9 +409,12 @@ namespace tcf {
         ByteArray final_hash = ComputeRequestHash();
         ByteArray Signature_byte = base64_decode(requester_signature);
 
-        tcf::crypto::sig::PublicKey public_signing_key_(verifying_key);
+        // Requesters sign their work orders with the same key, it is
+        // parsed once and then taken from the cache
+        std::shared_ptr<const tcf::crypto::sig::PublicKey> public_signing_key_ =
+            PublicKeyCache::getInstance()->GetPublicKey(verifying_key);
 
-        size_t SIG_result = public_signing_key_.VerifySignature(final_hash, Signature_byte);
+        size_t SIG_result = public_signing_key_->VerifySignature(final_hash, Signature_byte);
         if (SIG_result == 1) {
             Log(TCF_LOG_INFO, "Client Signature Verification Passed");
         } else if (SIG_result == 0) {
@@ -409,23 +427,32 @@ namespace tcf {
 
     ByteArray WorkOrderProcessor::ResponseHashCalculate(
                         std::vector<tcf::WorkOrderData>& wo_data) {
-        ByteArray nonce = tcf::crypto::RandomBitString(16);
-        // Create a worker nonce string
-        worker_nonce = base64_encode(tcf::crypto::ComputeMessageHash(nonce));
-        std::string concat_string = worker_nonce + work_order_id +
-                worker_id + workload_id + requester_id;
-
-        ByteArray hash_1 = tcf::crypto::ComputeMessageHash(
-                                    StrToByteArray(concat_string));
+        // Create a worker nonce string, as long as the SHA-256 digest of
+        // random bytes it used to be
+        worker_nonce = base64_encode(
+            tcf::crypto::GetThreadRandomGenerator().RandomBitString(
+                tcf::crypto::constants::DIGEST_LENGTH));
+        ByteArray hash_1 = tcf::work_order_hash::ComputeIdHash(
+            worker_nonce, work_order_id, worker_id, workload_id,
+            requester_id);
         size_t i = 0;
         size_t out_data_size = data_items_out.size();
-        for (auto data : wo_data) {
+        for (auto& d : data_items_out) {
+            d.FinishStreamedOutput();
+        }
+        std::vector<size_t> hashed_items;
+        for (auto& data : wo_data) {
+            if (i < out_data_size && data_items_out.at(i).IsOutputStreamed()) {
+                // Output was written out through the item's writer
+                i++;
+                continue;
+            }
             if (i < out_data_size) {
                 // If client request contains outData then update only
                 // the data field
                 tcf::WorkOrderDataHandler& out_data = data_items_out.at(i);
-                out_data.workorder_data.decrypted_data = data.decrypted_data;
-                out_data.ComputeHashString();
+                out_data.workorder_data.decrypted_data =
+                    std::move(data.decrypted_data);
             } else {
                 // If client has not provided outData element then use
                 // session keys to encrypt the output data.
@@ -433,42 +460,39 @@ namespace tcf {
                 std::string encrypted_data_encryption_key = "";
                 ByteArray data_encryption_key = session_key;
                 ByteArray data_iv = HexStringToBinary(session_key_iv);
-                tcf::WorkOrderDataHandler out_data(data, data_encryption_key,
-                        data_iv, encrypted_data_encryption_key, iv);
-                out_data.ComputeHashString();
-                data_items_out.emplace_back(out_data);
+                data_items_out.emplace_back(std::move(data),
+                    std::move(data_encryption_key), std::move(data_iv),
+                    encrypted_data_encryption_key, iv);
             }
-            tcf::WorkOrderDataHandler& out_data = data_items_out.at(i);
-            out_data.workorder_data.decrypted_data = data.decrypted_data;
-            out_data.ComputeHashString();
+            hashed_items.push_back(i);
             i++;
         }
+        // Items are encrypted and their data hashed all at once
+        std::vector<tcf::WorkOrderDataHandler*> hashed_data_items;
+        for (size_t index : hashed_items) {
+            hashed_data_items.push_back(&data_items_out.at(index));
+        }
+        WorkOrderDataHandler::ComputeHashStrings(hashed_data_items);
         // Calculate outData hash
         // First sort the outData elements based on index
         // Sorting is required to calculate hash deterministically
         std::sort(data_items_out.begin(),  data_items_out.end(),
-            [](WorkOrderDataHandler x, WorkOrderDataHandler  y)
+            [](const WorkOrderDataHandler& x, const WorkOrderDataHandler& y)
             {return x.workorder_data.index < y.workorder_data.index;});
+        // Streamed output is passed to the hasher piece by piece
         ByteArray hash_out_data;
-        std::string hash_out_data_str;
+        tcf::crypto::MessageHasher out_data_hasher;
+        size_t out_data_hash_size = 0;
         for (size_t i = 0; i < data_items_out.size(); i++) {
             tcf::WorkOrderDataHandler& d = data_items_out.at(i);
-            if (!d.concat_string.empty()) {
-               hash_out_data_str = hash_out_data_str + d.concat_string;
-            }
+            out_data_hash_size += d.UpdateResponseHash(out_data_hasher);
         }
-        if(!hash_out_data_str.empty()) {
-            hash_out_data = tcf::crypto::ComputeMessageHash(
-                                        StrToByteArray(hash_out_data_str));
+        if (out_data_hash_size > 0) {
+            hash_out_data = out_data_hasher.Finalize();
         }
-        // Calculate final hash
-        std::string final_hash_string = ByteArrayToString(hash_1);
-        if(!hash_out_data_str.empty()) {
-            final_hash_string += ByteArrayToString(hash_out_data);
-        }
-        ByteArray final_hash = tcf::crypto::ComputeMessageHash(
-                                    StrToByteArray(final_hash_string));
-        return final_hash;
+        // Calculate final hash, a response has no inData hash
+        return tcf::work_order_hash::ComputeFinalHash(
+            hash_1, ByteArray(), hash_out_data);
     }
 
     void WorkOrderProcessor::ComputeSignature(ByteArray& message_hash) {
@@ -482,55 +506,40 @@ namespace tcf {
     }
 
     ByteArray WorkOrderProcessor::CreateErrorResponse(int err_code, const char* err_message) {
-        JSON_Status jret;
         // Create the response structure
-        JsonValue resp_value(json_value_init_object());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            !resp_value.value, "Failed to create the response object");
-
-        JSON_Object* resp = json_value_get_object(resp_value);
-        tcf::error::ThrowIfNull(resp, "Failed on retrieval of response object value");
+        JsonWriter writer(256 + strlen(err_message) + work_order_id.size());
 
-        JsonSetStr(resp, "jsonrpc", "2.0", "failed to serialize jsonrpc");
-        JsonSetNumber(resp, "id", json_request_id, "failed to serialize json request id");
+        writer.BeginObject();
+        writer.AddStr("jsonrpc", "2.0", "failed to serialize jsonrpc");
+        writer.AddNumber("id", json_request_id);
 
-        jret = json_object_set_value(resp, "error", json_value_init_object());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            jret != JSONSuccess, "failed to serialize error");
+        writer.BeginObject("error");
+        writer.AddNumber("code", err_code);
+        writer.AddStr("message", err_message,
+            "failed to serialize error message");
 
-        JSON_Object* error = json_object_get_object(resp, "error");
-        tcf::error::ThrowIfNull(error, "failed to serialize the result");
-
-        JsonSetNumber(error, "code", err_code, "failed to serialize error code");
-        JsonSetStr(error, "message", err_message, "failed to serialize error message");
-
-        jret = json_object_set_value(error, "data", json_value_init_object());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            jret != JSONSuccess, "failed to serialize data");
-        JSON_Object* data = json_object_get_object(error, "data");
-        tcf::error::ThrowIfNull(data, "failed to serialize the data object");
-
-        JsonSetStr(data, "workOrderId", work_order_id.c_str(),
+        writer.BeginObject("data");
+        writer.AddStr("workOrderId", work_order_id,
             "failed to serialize work order id");
+        writer.EndObject();
+        writer.EndObject();
+        writer.EndObject();
 
         // Serialize the resulting json
-        size_t serializedSize = json_serialization_size(resp_value);
-        ByteArray serialized_response;
-        serialized_response.resize(serializedSize);
-
-        jret = json_serialize_to_buffer(resp_value,
-            reinterpret_cast<char*>(&serialized_response[0]), serialized_response.size());
-        tcf::error::ThrowIf<tcf::error::RuntimeError>(
-            jret != JSONSuccess, "workorder response serialization failed");
-
-        return serialized_response;
+        return writer.Finish();
     }
 
-    ByteArray WorkOrderProcessor::Process(EnclaveData* enclaveData, std::string json_str) {
+    ByteArray WorkOrderProcessor::Process(EnclaveData* enclaveData, const char* json_str) {
+        // The parsed request, and the JSON documents of the work order
+        // parsed in a JsonArenaScope, are allocated from the arena of the
+        // thread, all at once released when the work order is done
+        ArenaScope arena_scope;
         try {
             // Parse serialized json request and return serialized json object
-            JsonValue wo_req_json_val = ParseJsonInput(json_str);
-            DecryptWorkOrderKeys(enclaveData, wo_req_json_val);
+            work_order_request::WorkOrderRequest wo_request =
+                ParseJsonInput(json_str);
+            DecryptWorkOrderKeys(enclaveData, wo_request);
+            PrepareStreamedData();
             tcf::error::ThrowIf<tcf::error::ValueError>(VerifyEncryptedRequestHash()!= TCF_SUCCESS,
                 "Decryption of client request hash failed. Request is tampered.");
             if (!requester_signature.empty()) {
@@ -538,12 +547,16 @@ namespace tcf {
                     "Signature verification of client request failed. Request is tampered.");
             }
             std::vector<tcf::WorkOrderData> wo_data = ExecuteWorkOrder(enclaveData);
+            // The workload may have stopped reading streamed data before
+            // its end, where it is verified
+            for (auto& d : data_items_in) {
+                d.FinishStreamedData();
+            }
             size_t i = 0;
             size_t out_data_size = data_items_out.size();
             ByteArray hash = ResponseHashCalculate(wo_data);
             ComputeSignature(hash);
-            JsonValue response_json = CreateJsonOutput();
-            return SerializeJson(response_json);
+            return CreateJsonOutput();
         } catch (tcf::error::ValueError& e) {
             return CreateErrorResponse(e.error_code(), e.what());
         } catch (tcf::error::Error& e) {
@@ -19,10 +19,10 @@
 #include <vector>
 #include "enclave_data.h"
 
-#include "parson.h"
-#include "jsonvalue.h"
+#include "json_writer.h"
 #include "types.h"
 #include "work_order_data_handler.h"
+#include "work_order_request.h"
 
 namespace tcf {
     class WorkOrderProcessor {
@@ -32,17 +32,23 @@ namespace tcf {
         }
         ~WorkOrderProcessor();
         ByteArray CreateErrorResponse(int err_code, const char* err_message);
-        ByteArray Process(EnclaveData* enclaveData, std::string json_str);
+        ByteArray Process(EnclaveData* enclaveData, const char* json_str);
         std::string ext_work_order_data;
 
     protected:
-        JsonValue ParseJsonInput(std::string json_str);
+        // The strings of the result point into json_str
+        work_order_request::WorkOrderRequest ParseJsonInput(
+            const char* json_str);
         virtual void DecryptWorkOrderKeys(EnclaveData* enclave_data,
-            const JsonValue& wo_req_json_obj);
-        virtual JsonValue CreateJsonOutput();
-        ByteArray SerializeJson(JsonValue& json_value);
+            const work_order_request::WorkOrderRequest& wo_request);
+        // Serialized response, written without building a JSON document
+        ByteArray CreateJsonOutput();
+        // Writes the members of the result object of the response
+        virtual void WriteResult(JsonWriter& writer);
         virtual std::vector<tcf::WorkOrderData> ExecuteWorkOrder(
             EnclaveData* enclave_data);
+        void PrepareStreamedData();
+        bool IsKeyAgreementRequested(EnclaveData* enclave_data);
         ByteArray ComputeRequestHash();
         ByteArray ResponseHashCalculate(
             std::vector<tcf::WorkOrderData>& wo_data);
@@ -73,6 +79,8 @@ namespace tcf {
         std::string worker_nonce;
         std::string worker_signature;
         ByteArray session_key = {};
+        // Computed once, streamed inData is read to compute it
+        ByteArray request_hash = {};
 
         /** verifying_key is client's public key used for signature verification.
             Sharing keys between client and worker is not defined in spec yet.
@@ -0,0 +1,150 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mbusafecrt.h>
+
+#include "error.h"
+#include "tcf_error.h"
+#include "types.h"
+
+#include "enclave_utils.h"
+#include "work_order_response_table.h"
+
+tcf::WorkOrderResponseTable tcf::WorkOrderResponseTable::instance;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::WorkOrderResponseTable::WorkOrderResponseTable(void) :
+    next_identifier_(1), next_age_(0), lock_(SGX_SPINLOCK_INITIALIZER) {
+    for (int i = 0; i < WORK_ORDER_RESPONSE_SLOTS; i++) {
+        slots_[i].identifier = 0;
+        slots_[i].age = 0;
+    }
+}  // WorkOrderResponseTable::WorkOrderResponseTable
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::WorkOrderResponseTable* tcf::WorkOrderResponseTable::getInstance(void) {
+    return &instance;
+}  // WorkOrderResponseTable::getInstance
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Caller must hold lock_
+int tcf::WorkOrderResponseTable::FindSlot(uint32_t identifier) const {
+    if (identifier == 0) {
+        return -1;
+    }
+    for (int i = 0; i < WORK_ORDER_RESPONSE_SLOTS; i++) {
+        if (slots_[i].identifier == identifier) {
+            return i;
+        }
+    }
+    return -1;
+}  // WorkOrderResponseTable::FindSlot
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Store a serialized response in a free slot. The contents of response
+ * are moved into the table. If every slot is in use, the oldest response
+ * is dropped since its caller never fetched it.
+ *
+ * @param response Serialized work order response
+ * @returns identifier to fetch the response with
+ */
+uint32_t tcf::WorkOrderResponseTable::Store(ByteArray& response) {
+    sgx_spin_lock(&lock_);
+
+    int slot = -1;
+    for (int i = 0; i < WORK_ORDER_RESPONSE_SLOTS; i++) {
+        if (slots_[i].identifier == 0) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || slots_[i].age < slots_[slot].age) {
+            slot = i;
+        }
+    }
+    if (slots_[slot].identifier != 0) {
+        SAFE_LOG(TCF_LOG_WARNING,
+            "Response table full, dropping response %u",
+            slots_[slot].identifier);
+    }
+
+    uint32_t identifier = next_identifier_++;
+    if (next_identifier_ == 0) {
+        next_identifier_ = 1;
+    }
+    slots_[slot].identifier = identifier;
+    slots_[slot].age = next_age_++;
+    slots_[slot].response.swap(response);
+    ByteArray().swap(response);
+
+    sgx_spin_unlock(&lock_);
+    return identifier;
+}  // WorkOrderResponseTable::Store
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Get the size of a stored response.
+ * Throws ValueError if there is no response for identifier.
+ */
+size_t tcf::WorkOrderResponseTable::GetSize(uint32_t identifier) {
+    sgx_spin_lock(&lock_);
+    int slot = FindSlot(identifier);
+    size_t size = (slot < 0) ? 0 : slots_[slot].response.size();
+    sgx_spin_unlock(&lock_);
+
+    tcf::error::ThrowIf<tcf::error::ValueError>(slot < 0,
+        "Unknown work order response identifier");
+    return size;
+}  // WorkOrderResponseTable::GetSize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/**
+ * Copy a stored response into outBuffer and free its slot.
+ * Throws ValueError if there is no response for identifier or if the
+ * buffer is too small; the response is kept in the latter case.
+ */
+void tcf::WorkOrderResponseTable::Take(uint32_t identifier,
+    uint8_t* outBuffer, size_t bufferSize) {
+    ByteArray response;
+
+    sgx_spin_lock(&lock_);
+    int slot = FindSlot(identifier);
+    bool fits = (slot >= 0 && slots_[slot].response.size() <= bufferSize);
+    if (fits) {
+        response.swap(slots_[slot].response);
+        slots_[slot].identifier = 0;
+    }
+    sgx_spin_unlock(&lock_);
+
+    tcf::error::ThrowIf<tcf::error::ValueError>(slot < 0,
+        "Unknown work order response identifier");
+    tcf::error::ThrowIf<tcf::error::ValueError>(!fits,
+        "Not enough space for the response");
+
+    memcpy_s(outBuffer, bufferSize, response.data(), response.size());
+}  // WorkOrderResponseTable::Take
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void tcf::WorkOrderResponseTable::Release(uint32_t identifier) {
+    ByteArray response;
+
+    sgx_spin_lock(&lock_);
+    int slot = FindSlot(identifier);
+    if (slot >= 0) {
+        response.swap(slots_[slot].response);
+        slots_[slot].identifier = 0;
+    }
+    sgx_spin_unlock(&lock_);
+}  // WorkOrderResponseTable::Release
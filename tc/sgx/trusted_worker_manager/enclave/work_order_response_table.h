@@ -0,0 +1,70 @@
+/* Copyright 2020 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sgx_spinlock.h>
+
+#include "types.h"
+#include "base_enclave.h"
+
+// Number of serialized responses the enclave keeps until they are
+// fetched with ecall_GetSerializedResponse. Should not be lower than
+// the TCSNum of the enclave.
+#ifndef WORK_ORDER_RESPONSE_SLOTS
+#define WORK_ORDER_RESPONSE_SLOTS (4 * ENCLAVE_TCS_NUM)
+#endif
+
+namespace tcf {
+
+    /*
+     * Bounded table of serialized work order responses, keyed by the
+     * response identifier returned to the untrusted caller. Replaces a
+     * single global response buffer, so that work orders executed on
+     * different TCS do not overwrite each other's response.
+     */
+    class WorkOrderResponseTable {
+    public:
+        static WorkOrderResponseTable* getInstance(void);
+
+        uint32_t Store(ByteArray& response);
+        size_t GetSize(uint32_t identifier);
+        void Take(uint32_t identifier, uint8_t* outBuffer, size_t bufferSize);
+        void Release(uint32_t identifier);
+
+    private:
+        struct ResponseSlot {
+            // 0 when the slot is free
+            uint32_t identifier;
+            // Order in which the responses were stored, unlike the
+            // identifier it does not wrap around
+            uint64_t age;
+            ByteArray response;
+        };
+
+        WorkOrderResponseTable(void);
+
+        int FindSlot(uint32_t identifier) const;
+
+        ResponseSlot slots_[WORK_ORDER_RESPONSE_SLOTS];
+        uint32_t next_identifier_;
+        uint64_t next_age_;
+        sgx_spinlock_t lock_;
+
+        static WorkOrderResponseTable instance;
+    };  // class WorkOrderResponseTable
+
+}  // namespace tcf
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "types.h"
@@ -28,12 +29,12 @@ namespace tcf {
             ByteArray session_key, ByteArray session_key_iv,
             ByteArray data_enc_key_from_preprocess) {
 
-            this->session_key = session_key;
-            this->session_key_iv = session_key_iv;
+            this->session_key = std::move(session_key);
+            this->session_key_iv = std::move(session_key_iv);
             this->data_encryption_key = {};
             this->data_iv = {};
             this->data_encryption_key_from_preprocess = \
-                data_enc_key_from_preprocess;
+                std::move(data_enc_key_from_preprocess);
         }
 
         void GetDataEncryptionKey(
@@ -24,47 +24,67 @@
 #include "enclave_utils.h"
 #include "base_enclave.h"
 #include "enclave_data.h"
+#include "work_order_enclave_common.h"
+#include "work_order_response_table.h"
 #include "work_order_processor_wpe.h"
 
-ByteArray last_serialized_response;
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray tcf::ProcessWorkOrderRequest(EnclaveData* enclave_data,
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    size_t inWorkOrderExtDataSize) {
+    tcf::error::ThrowIfNull(inSerializedRequest,
+        "Serialized request pointer is NULL");
+    tcf::error::ThrowIfNull(inWorkOrderExtData,
+        "Extende work order data pointer is NULL");
+
+    // Parse the request in place from the marshalled buffer, it is
+    // only copied if the caller did not pass its terminating NUL
+    std::string request_storage;
+    const char* wo_request = tcf::BufferAsCString(inSerializedRequest,
+        inSerializedRequestSize, request_storage);
+
+    tcf::WorkOrderProcessorWPE wo_processor;
+
+    // Persist Extended work order data in WorkOrderProcessor instance
+    std::string ext_storage;
+    wo_processor.ext_work_order_data = tcf::BufferAsCString(
+        inWorkOrderExtData, inWorkOrderExtDataSize, ext_storage);
+
+    ByteArray response = wo_processor.Process(enclave_data, wo_request);
+
+    // clear Extended work order data after processing work order
+    wo_processor.ext_work_order_data.clear();
+    return response;
+}  // tcf::ProcessWorkOrderRequest
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 tcf_err_t ecall_HandleWorkOrderRequest(const uint8_t* inSerializedRequest,
     size_t inSerializedRequestSize,
     const uint8_t* inWorkOrderExtData,
     size_t inWorkOrderExtDataSize,
+    uint32_t* outResponseIdentifier,
     size_t* outSerializedResponseSize) {
 
     tcf_err_t result = TCF_SUCCESS;
     try {
-        tcf::error::ThrowIfNull(inSerializedRequest,
-            "Serialized request pointer is NULL");
-        tcf::error::ThrowIfNull(inWorkOrderExtData,
-            "Extende work order data pointer is NULL");
+        tcf::error::ThrowIfNull(outResponseIdentifier,
+            "Response identifier pointer is NULL");
         tcf::error::ThrowIfNull(outSerializedResponseSize,
             "Response size pointer is NULL");
 
         // Unseal the enclave persistent data
         EnclaveData* enclaveData = EnclaveData::getInstance(); 
 
-        ByteArray request(inSerializedRequest,
-            inSerializedRequest + inSerializedRequestSize);
-
-        tcf::WorkOrderProcessorWPE wo_processor;
-
-        // Persist Extended work order data in WorkOrderProcessor instance
-        wo_processor.ext_work_order_data = \
-            std::string((const char*) inWorkOrderExtData);
-
-        std::string wo_string(request.begin(), request.end());
-        last_serialized_response = wo_processor.Process(
-            enclaveData, wo_string);
+        ByteArray response = tcf::ProcessWorkOrderRequest(enclaveData,
+            inSerializedRequest, inSerializedRequestSize,
+            inWorkOrderExtData, inWorkOrderExtDataSize);
 
         // Save the response and return the size of the buffer required for it
-        (*outSerializedResponseSize) = last_serialized_response.size();
-
-        // clear Extended work order data after processing work order
-        wo_processor.ext_work_order_data.clear();
+        (*outSerializedResponseSize) = response.size();
+        (*outResponseIdentifier) = \
+            tcf::WorkOrderResponseTable::getInstance()->Store(response);
     } catch (tcf::error::Error& e) {
         SAFE_LOG(TCF_LOG_ERROR,
             "Error in KME(ecall_HandleWorkOrderRequest): %04X -- %s",
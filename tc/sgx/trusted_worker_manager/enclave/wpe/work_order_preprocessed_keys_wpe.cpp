@@ -13,6 +13,7 @@
 * limitations under the License.
 */
 
+#include "arena.h"
 #include "crypto.h"
 #include "tcf_error.h"
 #include "error.h"
@@ -74,7 +75,9 @@ tcf_err_t WorkOrderPreProcessedKeys::ParsePreProcessingJson(
     std::string work_order_keys_data_json, EnclaveData* enclave_data) {
 
     JSON_Status jret;
-    // Parse the preprocessed work order keys json
+    // Parse the preprocessed work order keys json, in the arena of the
+    // work order as the document is released before it is done
+    tcf::JsonArenaScope json_arena_scope;
     JsonValue parsed(json_parse_string(work_order_keys_data_json.c_str()));
     tcf::error::ThrowIfNull(parsed.value,
         "Failed to parse the preprocessed work order keys data");
@@ -162,24 +165,20 @@ ByteArray WorkOrderPreProcessedKeys::CalculateWorkOrderKeyInfoHash() {
     std::string hash1_str = ByteArrayToBase64EncodedString(
         tcf::crypto::ComputeMessageHash(StrToByteArray(concat_str)));
 
-    // Compute hash on encrypted_in_data_keys
-    std::string enc_in_data_hash_str;
-    for (auto d: encrypted_in_data_keys) {
-        enc_in_data_hash_str += ByteArrayToBase64EncodedString(
-            tcf::crypto::ComputeMessageHash(
-                Base64EncodedStringToByteArray(d)));
+    // Compute hash on encrypted_in_data_keys followed by
+    // encrypted_out_data_keys, all hashed at once
+    std::vector<ByteArray> enc_data_keys;
+    for (const auto& d: encrypted_in_data_keys) {
+        enc_data_keys.push_back(Base64EncodedStringToByteArray(d));
     }
-
-    // Compute hash on encrypted_out_data_keys
-    std::string enc_out_data_hash_str;
-    for (auto d: encrypted_out_data_keys) {
-        enc_out_data_hash_str += ByteArrayToBase64EncodedString(
-            tcf::crypto::ComputeMessageHash(
-                Base64EncodedStringToByteArray(d)));
+    for (const auto& d: encrypted_out_data_keys) {
+        enc_data_keys.push_back(Base64EncodedStringToByteArray(d));
     }
 
-    std::string final_hash_str = \
-        hash1_str + enc_in_data_hash_str + enc_out_data_hash_str;
+    std::string final_hash_str = hash1_str;
+    for (const auto& hash: tcf::crypto::ComputeMessageHashes(enc_data_keys)) {
+        final_hash_str += ByteArrayToBase64EncodedString(hash);
+    }
     return tcf::crypto::ComputeMessageHash(StrToByteArray(final_hash_str));
 }
 
@@ -18,9 +18,7 @@
 #include <string>
 
 #include "crypto.h"
-#include "jsonvalue.h"
-#include "parson.h"
-#include "json_utils.h"
+#include "json_writer.h"
 #include "error.h"
 #include "tcf_error.h"
 #include "types.h"
@@ -44,10 +42,11 @@ namespace tcf {
      * work order key info json
      *
      * @param enclave_data - Instance of EnclaveData class
-     * @param wo_req_json_val - Work order request json value
+     * @param wo_request - Parsed work order request
      */
     void WorkOrderProcessorWPE::DecryptWorkOrderKeys(
-        EnclaveData* enclave_data, const JsonValue& wo_req_json_val) {
+        EnclaveData* enclave_data,
+        const work_order_request::WorkOrderRequest& wo_request) {
         
         // Decrypt Encryption key
         ByteArray encrypted_session_key_bytes = \
@@ -66,55 +65,34 @@ namespace tcf {
         session_key = wo_pre_proc_keys.work_order_session_key;
         ByteArray session_key_iv_bytes = HexStringToBinary(session_key_iv);
 
-        JSON_Object* request_object = json_value_get_object(wo_req_json_val);
-        tcf::error::ThrowIfNull(request_object,
-            "Missing JSON object in work order request");
+        tcf::error::ThrowIf<tcf::error::ValueError>(
+            wo_request.in_data.empty(), "Indata is empty");
 
-        JSON_Object* params_object = json_object_dotget_object(request_object, "params");
-        tcf::error::ThrowIfNull(params_object,
-            "Missing params object in work order request");
-
-	JSON_Array* data_array = json_object_get_array(
-            params_object, "inData");
-        size_t count = json_array_get_count(data_array);
-        tcf::error::ThrowIf<tcf::error::ValueError>(count == 0,
-            "Indata is empty");
-
-        size_t i;
-        for (i = 0; i < count; i++) {
-            JSON_Object* data_object = json_array_get_object(data_array, i);
+        for (size_t i = 0; i < wo_request.in_data.size(); i++) {
             WorkOrderDataHandlerWPE wo_data(session_key, session_key_iv_bytes,
                 wo_pre_proc_keys.in_data_keys[i].decrypted_data);
             // Use in-data key from preprocessed json
-            wo_data.Unpack(data_object);
-            data_items_in.emplace_back(wo_data);
+            wo_data.Unpack(wo_request.in_data[i]);
+            data_items_in.emplace_back(std::move(wo_data));
         }
-        data_array = json_object_get_array(params_object, "outData");
+        WorkOrderDataHandler::VerifyInputHashes(data_items_in);
 
-        count = json_array_get_count(data_array);
-        for (i = 0; i < count; i++) {
-            JSON_Object* data_object = json_array_get_object(data_array, i);
+        for (size_t i = 0; i < wo_request.out_data.size(); i++) {
             WorkOrderDataHandlerWPE wo_data(session_key, session_key_iv_bytes,
                 wo_pre_proc_keys.out_data_keys[i].decrypted_data);
             // Use out-data key from preprocessed json
-            wo_data.Unpack(data_object);
-            data_items_out.emplace_back(wo_data);
+            wo_data.Unpack(wo_request.out_data[i]);
+            data_items_out.emplace_back(std::move(wo_data));
         }
+        WorkOrderDataHandler::VerifyInputHashes(data_items_out);
     }
 
     /*
-     * Creates Work order response in json format
+     * Writes the members of the result object of the work order response
      */
-    JsonValue WorkOrderProcessorWPE::CreateJsonOutput() {
-        // Calling base class method to create json response
-        JsonValue response = WorkOrderProcessor::CreateJsonOutput();
-
-        JSON_Object* resp_obj = json_value_get_object(response);
-        tcf::error::ThrowIfNull(resp_obj,
-            "failed to get json object for result");
-
-        JSON_Object* result = json_object_get_object(resp_obj, "result");
-        tcf::error::ThrowIfNull(result, "failed to serialize the result");
+    void WorkOrderProcessorWPE::WriteResult(JsonWriter& writer) {
+        // Calling base class method to write json response members
+        WorkOrderProcessor::WriteResult(writer);
 
         // Pack additional parameters extVerificationKey and
         // extVerificationKeySignature from preprocessed json used at client
@@ -124,15 +102,14 @@ namespace tcf {
         //            used by client to verify signature of the output
         // extVerificationKeySignature - client needs to verify using
         //            Worker's(KME) public verification key
-        JsonSetStr(result, "extVerificationKey",
-            (wo_pre_proc_keys.verification_key).c_str(),
+        writer.AddStr("extVerificationKey",
+            wo_pre_proc_keys.verification_key,
             "failed to serialize verification key");
-        JsonSetStr(result, "extVerificationKeySignature",
+        writer.AddStr("extVerificationKeySignature",
             ByteArrayToBase64EncodedString(
-                wo_pre_proc_keys.verification_key_signature).c_str(),
+                wo_pre_proc_keys.verification_key_signature),
             "failed to serialize verification key signature");
-        return response;
-    }  // WorkOrderProcessorWPE::CreateJsonOutput
+    }  // WorkOrderProcessorWPE::WriteResult
 
     /*
      * Computes signature on the hash by using signing key
@@ -37,8 +37,8 @@ namespace tcf {
         WorkOrderPreProcessedKeys wo_pre_proc_keys;
 
         void DecryptWorkOrderKeys(EnclaveData* enclave_data,
-            const JsonValue& wo_req_json_val) override;
-        JsonValue CreateJsonOutput() override;
+            const work_order_request::WorkOrderRequest& wo_request) override;
+        void WriteResult(JsonWriter& writer) override;
         void ComputeSignature(ByteArray& message_hash) override;
     };  // WorkOrderProcessorWPE
 }  // namespace tcf
@@ -28,7 +28,8 @@
 #include "base.h"
 
 static bool g_IsInitialized = false;
-static std::string g_LastError;
+// Enclaves are called from several threads, keep the error per thread
+static thread_local std::string g_LastError;
 static tcf::enclave_queue::EnclaveQueue *g_EnclaveReadyQueue;
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -54,6 +55,19 @@ tcf::enclave_queue::ReadyEnclave tcf::enclave_api::base::GetReadyEnclave() {
     return tcf::enclave_queue::ReadyEnclave(g_EnclaveReadyQueue);
 }  // tcf::enclave_api::base::GetReadyEnclaveIndex
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::enclave_queue::ReadyEnclave tcf::enclave_api::base::GetReadyEnclave(
+    int timeoutMs) {
+    return tcf::enclave_queue::ReadyEnclave(g_EnclaveReadyQueue, timeoutMs);
+}  // tcf::enclave_api::base::GetReadyEnclave
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf::enclave_queue::QueueStats tcf::enclave_api::base::GetEnclaveQueueStats() {
+    tcf::error::ThrowIf<tcf::error::RuntimeError>(
+        g_EnclaveReadyQueue == NULL, "Enclaves are not initialized");
+    return g_EnclaveReadyQueue->getStats();
+}  // tcf::enclave_api::base::GetEnclaveQueueStats
+
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 void tcf::enclave_api::base::SetLastError(
@@ -77,16 +91,33 @@ tcf_err_t tcf::enclave_api::base::Initialize(
     try {
         if (!g_IsInitialized) {
 
-            if (g_EnclaveReadyQueue == NULL) g_EnclaveReadyQueue = new tcf::enclave_queue::EnclaveQueue();
-
             g_Enclave.reserve(numOfEnclaves);
             for (int i = 0; i < numOfEnclaves; ++i) {
                 g_Enclave.push_back(tcf::enclave_api::Enclave(attestation));
-                g_EnclaveReadyQueue->push(i);
             }
 
+            uint32_t maxTcsCount = 0;
+            size_t totalTcsCount = 0;
             for (tcf::enclave_api::Enclave& enc : g_Enclave) {
                 enc.Load(inPathToEnclave, persisted_sealed_data);
+                maxTcsCount = std::max(maxTcsCount, enc.GetTcsCount());
+                totalTcsCount += enc.GetTcsCount();
+            }
+
+            if (g_EnclaveReadyQueue == NULL) {
+                g_EnclaveReadyQueue = new tcf::enclave_queue::EnclaveQueue(
+                    totalTcsCount, numOfEnclaves);
+            }
+
+            // Each enclave can execute as many work orders concurrently as
+            // it has TCS, so queue one entry per TCS. Entries are queued
+            // round robin to spread the work orders across the enclaves.
+            for (uint32_t tcs = 0; tcs < maxTcsCount; ++tcs) {
+                for (int i = 0; i < numOfEnclaves; ++i) {
+                    if (tcs < g_Enclave[i].GetTcsCount()) {
+                        g_EnclaveReadyQueue->push(i);
+                    }
+                }
             }
 
             g_IsInitialized = true;
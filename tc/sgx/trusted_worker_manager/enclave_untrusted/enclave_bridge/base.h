@@ -37,9 +37,25 @@ namespace tcf {
             /*
               Returns an object with index of next available enclave as a field
               Ensures enclave index is returned to queue in case of a crash
+              An enclave is available as long as one of its TCS is free, so
+              the same index can be handed to several threads at a time
             */
             tcf::enclave_queue::ReadyEnclave GetReadyEnclave();
 
+            /*
+              Same as GetReadyEnclave, but waits at most timeoutMs
+              milliseconds for an enclave. Does not wait if timeoutMs is 0,
+              waits as long as needed if it is negative.
+              Throws SystemBusyError if no enclave became available.
+            */
+            tcf::enclave_queue::ReadyEnclave GetReadyEnclave(int timeoutMs);
+
+            /*
+              Returns the depth and wait time histograms of the ready
+              enclave queue and the utilization of each enclave
+            */
+            tcf::enclave_queue::QueueStats GetEnclaveQueueStats();
+
             /*
               Saves an error message for later retrieval.
              */
@@ -58,7 +74,8 @@ namespace tcf {
               to the enclave DLL.
               inSpid - A pointer to a string that contains the hex encoded SPID.
               persisted_sealed_data - Sealed data persisted from last bootup
-              numOfEnclaves -- Number of worker enclaves to create
+              numOfEnclaves -- Number of worker enclaves to create. Each of
+              them executes up to ENCLAVE_TCS_NUM work orders concurrently
             */
             tcf_err_t Initialize(const std::string& inPathToEnclave,
                 const Attestation *attestation,
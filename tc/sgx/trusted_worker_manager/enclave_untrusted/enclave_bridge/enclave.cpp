@@ -14,6 +14,7 @@
  */
 
 #include <linux/limits.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <iostream>
@@ -22,6 +23,9 @@
 #include <pthread.h>
 
 #include "sgx_support.h"
+#if SGX_SWITCHLESS
+#include "sgx_uswitchless.h"
+#endif
 #include "enclave_common_u.h"
 
 #include "log.h"
@@ -35,6 +39,10 @@
 
 #include "enclave.h"
 
+// Error message of the last failed ecall of the thread, set by the
+// enclave through ocall_SetErrorMessage
+extern thread_local std::string g_enclaveError;
+
 std::vector<tcf::enclave_api::Enclave> g_Enclave;
 
 namespace tcf {
@@ -47,6 +55,7 @@ namespace tcf {
 
         // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
         Enclave::Enclave(const Attestation *attestation_obj) :
+            tcsCount(1),
             attestation(const_cast<Attestation *>(attestation_obj)) {
         }  // Enclave::Enclave
 
@@ -125,12 +134,27 @@ namespace tcf {
         void Enclave::ThrowTCFError(
             tcf_err_t err) {
             if (err != TCF_SUCCESS) {
-                std::string tmp(this->enclaveError);
-                this->enclaveError.clear();
+                std::string tmp(g_enclaveError);
+                g_enclaveError.clear();
                 throw error::Error(err, tmp.c_str());
             }
         }  // Enclave::ThrowTCFError
 
+#if SGX_SWITCHLESS
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        // Number of untrusted threads serving switchless ocalls. The
+        // build time default can be overridden with the environment
+        // variable SGX_SWITCHLESS_UWORKERS.
+        static uint32_t GetSwitchlessUworkers() {
+            uint32_t uworkers = SGX_SWITCHLESS_UWORKERS;
+            const char* value = getenv("SGX_SWITCHLESS_UWORKERS");
+            if (value != nullptr && atoi(value) > 0) {
+                uworkers = atoi(value);
+            }
+            return uworkers;
+        }  // GetSwitchlessUworkers
+
+#endif
         // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
         void Enclave::LoadEnclave(
                 const Base64EncodedString& persistedSealedEnclaveData) {
@@ -149,6 +173,26 @@ namespace tcf {
                 sgx_status_t ret = SGX_SUCCESS;
                 ret = tcf::sgx_util::CallSgx([this, flags, &token] () {
                         int updated = 0;
+#if SGX_SWITCHLESS
+                        // Ocalls are served by uworkers only, ecalls
+                        // are not switchless
+                        sgx_uswitchless_config_t us_config =
+                            SGX_USWITCHLESS_CONFIG_INITIALIZER;
+                        us_config.num_uworkers = GetSwitchlessUworkers();
+                        us_config.num_tworkers = 0;
+                        const void* ex_features_p[32] = { 0 };
+                        ex_features_p[SGX_CREATE_ENCLAVE_EX_SWITCHLESS_BIT_IDX] =
+                            &us_config;
+                        return sgx_create_enclave_ex(
+                            this->enclaveFilePath.c_str(),
+                            flags,
+                            &token,
+                            &updated,
+                            &this->enclaveId,
+                            NULL,
+                            SGX_CREATE_ENCLAVE_EX_SWITCHLESS,
+                            ex_features_p);
+#else
                         return sgx_create_enclave(
                             this->enclaveFilePath.c_str(),
                             flags,
@@ -156,6 +200,7 @@ namespace tcf {
                             &updated,
                             &this->enclaveId,
                             NULL);
+#endif
                     },
                     10,  // retries
                     250  // retryWaitMs
@@ -198,6 +243,22 @@ namespace tcf {
                     ret,
                     "Failed to calculate length of sealed signup data");
                 this->ThrowTCFError(tcfError);
+
+                // Number of TCS the enclave was built with decides how many
+                // work orders can be dispatched to it concurrently
+                ret = tcf::sgx_util::CallSgx([this, &tcfError] () {
+                            sgx_status_t ret =
+                            ecall_GetTcsCount(
+                                this->enclaveId,
+                                &tcfError,
+                                &this->tcsCount);
+                            return
+                            error::ConvertErrorStatus(ret, tcfError);
+                        });
+                tcf::error::ThrowSgxError(
+                    ret,
+                    "Failed to get the TCS count of the enclave");
+                this->ThrowTCFError(tcfError);
             }
         }  // Enclave::LoadEnclave
 
@@ -52,6 +52,10 @@ namespace tcf {
                 return this->sealedSignupDataSize;
             }  // GetSealedSignupDataSize
 
+            uint32_t GetTcsCount() const {
+                return this->tcsCount;
+            }  // GetTcsCount
+
             void GetEnclaveCharacteristics(
                 sgx_measurement_t* outEnclaveMeasurement,
                 sgx_basename_t* outEnclaveBasename);
@@ -101,8 +105,9 @@ namespace tcf {
             long threadId;
 
             size_t sealedSignupDataSize;
+            // Number of work orders the enclave can execute concurrently
+            uint32_t tcsCount;
 
-            std::string enclaveError;
 	    Attestation *attestation;
 
         };  // class Enclave
@@ -15,8 +15,7 @@
 
 #include <stdlib.h>
 #include <string>
-#include <pthread.h>
-#include <queue>
+#include <thread>
 
 #include "error.h"
 #include "tcf_error.h"
@@ -24,41 +23,302 @@
 
 #include "enclave_queue.h"
 
+// Number of attempts to dequeue before a thread blocks for an entry
+#define ENCLAVE_QUEUE_SPIN_COUNT 64
 
 namespace tcf {
 
     namespace enclave_queue {
 
         // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-        int EnclaveQueue::pop() {
-            pthread_mutex_lock(&mutex);
-            while (queue_.empty()) {
-                pthread_cond_wait(&cond, &mutex);
+        static uint64_t MicrosecondsSince(
+            const std::chrono::steady_clock::time_point& start) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }  // MicrosecondsSince
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        EnclaveQueue::EnclaveQueue(size_t capacity, size_t numOfEnclaves) :
+            enqueuePos_(0), dequeuePos_(0), waiters_(0),
+            numOfEnclaves_(numOfEnclaves), acquireCount_(0),
+            timeoutCount_(0) {
+            tcf::error::ThrowIf<tcf::error::ValueError>(capacity == 0,
+                "Enclave queue capacity must not be 0");
+
+            // Ring size has to be a power of two
+            size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            mask_ = size - 1;
+            cells_.reset(new Cell[size]);
+            for (size_t i = 0; i < size; i++) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+
+            enclaveCounters_.reset(new EnclaveCounters[numOfEnclaves_]);
+            for (size_t i = 0; i < numOfEnclaves_; i++) {
+                enclaveCounters_[i].acquireCount.store(0);
+                enclaveCounters_[i].busyTimeUs.store(0);
+                enclaveCounters_[i].inUse.store(0);
+            }
+            for (size_t i = 0; i < DEPTH_HISTOGRAM_BUCKETS; i++) {
+                depthHistogram_[i].store(0);
             }
-            int item = queue_.front();
-            queue_.pop();
-            pthread_mutex_unlock(&mutex);
+            for (size_t i = 0; i < WAIT_TIME_HISTOGRAM_BUCKETS; i++) {
+                waitTimeHistogram_[i].store(0);
+            }
+        }  // EnclaveQueue::EnclaveQueue
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        int EnclaveQueue::pop() {
+            int item = -1;
+            acquire(item, nullptr);
             return item;
         }  // EnclaveQueue::pop
 
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        bool EnclaveQueue::tryPop(int& item) {
+            size_t current_depth = depth();
+            if (!tryDequeue(item)) {
+                timeoutCount_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            recordAcquire(item, current_depth, 0);
+            return true;
+        }  // EnclaveQueue::tryPop
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        bool EnclaveQueue::popUntil(
+            int& item,
+            const std::chrono::steady_clock::time_point& deadline) {
+            return acquire(item, &deadline);
+        }  // EnclaveQueue::popUntil
+
         // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
         void EnclaveQueue::push(const int& item) {
-            pthread_mutex_lock(&mutex);
-            queue_.push(item);
-            pthread_mutex_unlock(&mutex);
-            pthread_cond_signal(&cond);
+            // There are never more entries than the capacity of the ring,
+            // but the cell to write can still be held by a thread which is
+            // in the middle of dequeuing from it. Retry until it is done.
+            while (!tryEnqueue(item)) {
+                std::this_thread::yield();
+            }
+
+            // Pairs with the increment of waiters_ in acquire, either the
+            // waiter finds the new entry or it is seen here and woken up
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters_.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cond_.notify_one();
+            }
         }  // EnclaveQueue::push
 
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        void EnclaveQueue::release(const int& item, uint64_t busyTimeUs) {
+            if (item >= 0 && (size_t) item < numOfEnclaves_) {
+                EnclaveCounters& counters = enclaveCounters_[item];
+                counters.busyTimeUs.fetch_add(busyTimeUs,
+                    std::memory_order_relaxed);
+                counters.inUse.fetch_sub(1, std::memory_order_relaxed);
+            }
+            push(item);
+        }  // EnclaveQueue::release
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        size_t EnclaveQueue::depth() const {
+            size_t enqueued = enqueuePos_.load(std::memory_order_relaxed);
+            size_t dequeued = dequeuePos_.load(std::memory_order_relaxed);
+            return (enqueued > dequeued) ? enqueued - dequeued : 0;
+        }  // EnclaveQueue::depth
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        QueueStats EnclaveQueue::getStats() const {
+            QueueStats stats;
+            stats.acquireCount = acquireCount_.load();
+            stats.timeoutCount = timeoutCount_.load();
+            for (size_t i = 0; i < DEPTH_HISTOGRAM_BUCKETS; i++) {
+                stats.depthHistogram.push_back(depthHistogram_[i].load());
+            }
+            for (size_t i = 0; i < WAIT_TIME_HISTOGRAM_BUCKETS; i++) {
+                stats.waitTimeHistogram.push_back(
+                    waitTimeHistogram_[i].load());
+            }
+            for (size_t i = 0; i < numOfEnclaves_; i++) {
+                EnclaveUtilization utilization;
+                utilization.acquireCount =
+                    enclaveCounters_[i].acquireCount.load();
+                utilization.busyTimeUs = enclaveCounters_[i].busyTimeUs.load();
+                utilization.inUse = enclaveCounters_[i].inUse.load();
+                stats.enclaves.push_back(utilization);
+            }
+            return stats;
+        }  // EnclaveQueue::getStats
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        // Bounded MPMC ring: each cell carries a sequence number telling
+        // whether it is ready to be written (sequence == position) or
+        // read (sequence == position + 1) at a given ring position.
+        bool EnclaveQueue::tryEnqueue(const int& item) {
+            Cell* cell;
+            size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+                if (diff == 0) {
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    // Full
+                    return false;
+                } else {
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+            cell->item = item;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }  // EnclaveQueue::tryEnqueue
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        bool EnclaveQueue::tryDequeue(int& item) {
+            Cell* cell;
+            size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos_.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    // Empty
+                    return false;
+                } else {
+                    pos = dequeuePos_.load(std::memory_order_relaxed);
+                }
+            }
+            item = cell->item;
+            cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }  // EnclaveQueue::tryDequeue
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        // Waits for an entry until deadline, or forever if deadline is
+        // nullptr
+        bool EnclaveQueue::acquire(
+            int& item,
+            const std::chrono::steady_clock::time_point* deadline) {
+            std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            size_t current_depth = depth();
+
+            bool acquired = tryDequeue(item);
+            for (int i = 0; !acquired && i < ENCLAVE_QUEUE_SPIN_COUNT; i++) {
+                acquired = tryDequeue(item);
+            }
+
+            if (!acquired) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                waiters_.fetch_add(1, std::memory_order_seq_cst);
+                while (!(acquired = tryDequeue(item))) {
+                    if (deadline == nullptr) {
+                        cond_.wait(lock);
+                    } else if (cond_.wait_until(lock, *deadline) ==
+                               std::cv_status::timeout) {
+                        acquired = tryDequeue(item);
+                        break;
+                    }
+                }
+                waiters_.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            if (!acquired) {
+                timeoutCount_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            recordAcquire(item, current_depth, MicrosecondsSince(start));
+            return true;
+        }  // EnclaveQueue::acquire
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        void EnclaveQueue::recordAcquire(
+            int item,
+            size_t depth,
+            uint64_t waitTimeUs) {
+            acquireCount_.fetch_add(1, std::memory_order_relaxed);
+
+            size_t depth_bucket = depth;
+            if (depth_bucket >= DEPTH_HISTOGRAM_BUCKETS) {
+                depth_bucket = DEPTH_HISTOGRAM_BUCKETS - 1;
+            }
+            depthHistogram_[depth_bucket].fetch_add(1,
+                std::memory_order_relaxed);
+
+            size_t wait_bucket = 0;
+            while (wait_bucket < WAIT_TIME_HISTOGRAM_BUCKETS - 1 &&
+                   (waitTimeUs >> wait_bucket) != 0) {
+                wait_bucket++;
+            }
+            waitTimeHistogram_[wait_bucket].fetch_add(1,
+                std::memory_order_relaxed);
+
+            if (item >= 0 && (size_t) item < numOfEnclaves_) {
+                EnclaveCounters& counters = enclaveCounters_[item];
+                counters.acquireCount.fetch_add(1, std::memory_order_relaxed);
+                counters.inUse.fetch_add(1, std::memory_order_relaxed);
+            }
+        }  // EnclaveQueue::recordAcquire
+
 
         // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
         ReadyEnclave::ReadyEnclave(EnclaveQueue *queue) {
                 queue_ = queue;
                 enclaveIndex_ = queue_->pop();
+                acquired_ = std::chrono::steady_clock::now();
+        }  // ReadyEnclave::ReadyEnclave
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        ReadyEnclave::ReadyEnclave(EnclaveQueue *queue, int timeoutMs) {
+                queue_ = nullptr;
+                enclaveIndex_ = -1;
+
+                bool acquired;
+                if (timeoutMs < 0) {
+                    enclaveIndex_ = queue->pop();
+                    acquired = true;
+                } else if (timeoutMs == 0) {
+                    acquired = queue->tryPop(enclaveIndex_);
+                } else {
+                    acquired = queue->popUntil(enclaveIndex_,
+                        std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeoutMs));
+                }
+                tcf::error::ThrowIf<tcf::error::SystemBusyError>(
+                    !acquired, "No enclave available");
+
+                queue_ = queue;
+                acquired_ = std::chrono::steady_clock::now();
+        }  // ReadyEnclave::ReadyEnclave
+
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        ReadyEnclave::ReadyEnclave(ReadyEnclave&& other) :
+            enclaveIndex_(other.enclaveIndex_), queue_(other.queue_),
+            acquired_(other.acquired_) {
+                // Only one of the objects returns the entry
+                other.queue_ = nullptr;
         }  // ReadyEnclave::ReadyEnclave
 
         // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
         ReadyEnclave::~ReadyEnclave() {
-                if (this->queue_) queue_->push(this->enclaveIndex_);
+                if (this->queue_) {
+                    queue_->release(this->enclaveIndex_,
+                        MicrosecondsSince(acquired_));
+                }
         }  // ReadyEnclave::~ReadyEnclave
 
     }  // namespace enclave_queue
@@ -13,25 +13,116 @@
  * limitations under the License.
  */
 
+#pragma once
 
-#include <pthread.h>
-#include <queue>
-
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace tcf {
     namespace enclave_queue {
+
+        // Bucket i of the wait time histogram counts acquires which waited
+        // less than 2^i microseconds, the last bucket counts longer waits
+        const size_t WAIT_TIME_HISTOGRAM_BUCKETS = 24;
+
+        // Bucket i of the depth histogram counts acquires which found i
+        // ready entries in the queue, the last bucket counts deeper queues
+        const size_t DEPTH_HISTOGRAM_BUCKETS = 33;
+
+        struct EnclaveUtilization {
+            // Number of times the enclave was acquired
+            uint64_t acquireCount;
+            // Total time the enclave was held, in microseconds
+            uint64_t busyTimeUs;
+            // Number of TCS of the enclave currently acquired
+            uint64_t inUse;
+        };
+
+        struct QueueStats {
+            uint64_t acquireCount;
+            uint64_t timeoutCount;
+            std::vector<uint64_t> depthHistogram;
+            std::vector<uint64_t> waitTimeHistogram;
+            std::vector<EnclaveUtilization> enclaves;
+        };
+
+        /*
+          Bounded lock free multi producer multi consumer ring of indexes of
+          ready enclaves, with one entry per free TCS. Acquiring an entry
+          takes no lock while the queue is not empty; threads which have
+          to wait for an entry block on a condition variable.
+        */
         class EnclaveQueue {
         public:
+            EnclaveQueue(size_t capacity, size_t numOfEnclaves);
 
+            // Waits until an entry is available
             int pop();
 
+            // Returns false right away if no entry is available
+            bool tryPop(int& item);
+
+            // Returns false if no entry became available before deadline
+            bool popUntil(
+                int& item,
+                const std::chrono::steady_clock::time_point& deadline);
+
             void push(const int& item);
 
-        private:
-            std::queue<int> queue_;
-            pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-            pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+            // Returns an entry acquired with one of the pop methods, after
+            // its enclave was held for busyTimeUs microseconds
+            void release(const int& item, uint64_t busyTimeUs);
+
+            // Approximate number of ready entries
+            size_t depth() const;
 
+            QueueStats getStats() const;
+
+        private:
+            struct Cell {
+                std::atomic<size_t> sequence;
+                int item;
+            };
+
+            struct EnclaveCounters {
+                std::atomic<uint64_t> acquireCount;
+                std::atomic<uint64_t> busyTimeUs;
+                std::atomic<uint64_t> inUse;
+            };
+
+            bool tryDequeue(int& item);
+            bool tryEnqueue(const int& item);
+            bool acquire(
+                int& item,
+                const std::chrono::steady_clock::time_point* deadline);
+            void recordAcquire(int item, size_t depth, uint64_t waitTimeUs);
+
+            std::unique_ptr<Cell[]> cells_;
+            size_t mask_;
+            // Keep producer and consumer positions on separate cache lines
+            char padding0_[64];
+            std::atomic<size_t> enqueuePos_;
+            char padding1_[64];
+            std::atomic<size_t> dequeuePos_;
+            char padding2_[64];
+
+            // Slow path for threads waiting for an entry
+            std::atomic<int> waiters_;
+            std::mutex mutex_;
+            std::condition_variable cond_;
+
+            size_t numOfEnclaves_;
+            std::unique_ptr<EnclaveCounters[]> enclaveCounters_;
+            std::atomic<uint64_t> acquireCount_;
+            std::atomic<uint64_t> timeoutCount_;
+            std::atomic<uint64_t> depthHistogram_[DEPTH_HISTOGRAM_BUCKETS];
+            std::atomic<uint64_t>
+                waitTimeHistogram_[WAIT_TIME_HISTOGRAM_BUCKETS];
         };  // class EnclaveQueue
 
 
@@ -45,19 +136,29 @@ namespace tcf {
             int enclaveIndex_;
             EnclaveQueue *queue_;
 
+            // Waits until an enclave is available
             ReadyEnclave(EnclaveQueue *queue);
 
+            // Waits at most timeoutMs milliseconds for an enclave, does
+            // not wait if timeoutMs is 0. Throws SystemBusyError if no
+            // enclave became available.
+            ReadyEnclave(EnclaveQueue *queue, int timeoutMs);
+
+            ReadyEnclave(ReadyEnclave&& other);
+            ReadyEnclave(const ReadyEnclave&) = delete;
+            ReadyEnclave& operator=(const ReadyEnclave&) = delete;
+
             ~ReadyEnclave();
 
             int getIndex() {
                 return enclaveIndex_;
             }
 
+        private:
+            std::chrono::steady_clock::time_point acquired_;
+
         };  // class ReadyEnclave
 
     }  /* namespace enclave_queue */
 
 }  /* namespace tcf */
-
-
-
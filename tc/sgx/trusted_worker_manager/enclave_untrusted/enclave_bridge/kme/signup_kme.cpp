@@ -152,7 +152,52 @@ tcf_err_t SignupDataKME::UnsealEnclaveData(
     return result;
 }  // SignupDataKME::UnsealSignupData
 
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+tcf_err_t SignupDataKME::RefillKeyPool(
+    size_t maxKeys,
+    int enclaveIndex,
+    size_t& outPoolSize) {
+    tcf_err_t result = TCF_SUCCESS;
+
+    try {
+        sgx_enclave_id_t enclaveid = g_Enclave[enclaveIndex].GetEnclaveId();
+        size_t pool_size = 0;
+
+        tcf_err_t presult = TCF_SUCCESS;
+        sgx_status_t sresult = tcf::sgx_util::CallSgx(
+            [ enclaveid,
+              &presult,
+              maxKeys,
+              &pool_size] () {
+                sgx_status_t sresult =
+                ecall_RefillKeyPoolKME(
+                    enclaveid,
+                    &presult,
+                    maxKeys,
+                    &pool_size);
+                return tcf::error::ConvertErrorStatus(sresult, presult);
+            });
+
+        tcf::error::ThrowSgxError(sresult,
+            "Intel SGX enclave call failed (ecall_RefillKeyPoolKME)");
+        g_Enclave[enclaveIndex].ThrowTCFError(presult);
+
+        outPoolSize = pool_size;
+    } catch (tcf::error::Error& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    } catch (std::exception& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = TCF_ERR_UNKNOWN;
+    } catch (...) {
+        tcf::enclave_api::base::SetLastError("Unexpected exception");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // SignupDataKME::RefillKeyPool
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 tcf_err_t SignupDataKME::VerifyEnclaveInfo(
     const std::string& enclaveInfo,
     const std::string& mr_enclave,
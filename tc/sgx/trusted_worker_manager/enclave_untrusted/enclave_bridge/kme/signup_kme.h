@@ -36,4 +36,14 @@ public:
         const std::string& ext_data);
 
     tcf_err_t UnsealEnclaveData(StringArray& outPublicEnclaveData);
+
+    /*
+      Generates up to maxKeys work order signing key pairs into the key
+      pool of the enclave enclaveIndex. outPoolSize is set to the number
+      of key pairs in its pool.
+    */
+    tcf_err_t RefillKeyPool(
+        size_t maxKeys,
+        int enclaveIndex,
+        size_t& outPoolSize);
 };  // SignupDataKME
@@ -21,7 +21,11 @@
 #include "log.h"
 #include "timer.h"
 
-std::string g_enclaveError;
+// ocalls run on the thread which made the ecall, or on an untrusted
+// worker thread when the enclave is built with SGX_SWITCHLESS.
+// ocall_SetErrorMessage is never switchless, the error message is set on
+// the thread which made the ecall and read by Enclave::ThrowTCFError.
+thread_local std::string g_enclaveError;
 
 extern "C" {
 
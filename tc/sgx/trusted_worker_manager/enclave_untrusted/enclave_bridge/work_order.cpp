@@ -15,17 +15,91 @@
 
 #include "enclave_common_u.h"
 
+#include <string.h>
+
 #include "tcf_error.h"
 #include "error.h"
 #include "avalon_sgx_error.h"
 #include "log.h"
 #include "types.h"
+#include "work_order_batch.h"
 
 #include "enclave.h"
 #include "base.h"
 #include "work_order.h"
 #include "sgx_utility.h"
 
+// inData streamed alongside the work order request handled by this thread
+// and output of its streamed outData. The ocalls for them are not
+// switchless, so they run on the same thread.
+namespace {
+    thread_local const uint8_t* g_workOrderData = nullptr;
+    thread_local size_t g_workOrderDataSize = 0;
+    thread_local ByteArray* g_workOrderResult = nullptr;
+
+    class WorkOrderDataScope {
+    public:
+        WorkOrderDataScope(const uint8_t* data, size_t size,
+            ByteArray* result) {
+            g_workOrderData = data;
+            g_workOrderDataSize = size;
+            g_workOrderResult = result;
+        }
+
+        ~WorkOrderDataScope() {
+            g_workOrderData = nullptr;
+            g_workOrderDataSize = 0;
+            g_workOrderResult = nullptr;
+        }
+    };
+
+    tcf_err_t CopyRange(const uint8_t* data, size_t size,
+        uint64_t offset, uint8_t* buffer, size_t bufferSize) {
+        if (data == nullptr || offset > size ||
+            bufferSize > size - offset) {
+            return TCF_ERR_VALUE;
+        }
+        memcpy(buffer, data + offset, bufferSize);
+        return TCF_SUCCESS;
+    }
+}
+
+extern "C" {
+    tcf_err_t ocall_ReadWorkOrderData(
+        uint64_t inOffset,
+        uint8_t* outBuffer,
+        size_t inBufferSize) {
+        return CopyRange(g_workOrderData, g_workOrderDataSize,
+            inOffset, outBuffer, inBufferSize);
+    }  // ocall_ReadWorkOrderData
+
+    tcf_err_t ocall_WriteWorkOrderResult(
+        const uint8_t* inData,
+        size_t inDataSize) {
+        if (g_workOrderResult == nullptr) {
+            return TCF_ERR_VALUE;
+        }
+        try {
+            g_workOrderResult->insert(g_workOrderResult->end(),
+                inData, inData + inDataSize);
+        } catch (std::exception&) {
+            return TCF_ERR_MEMORY;
+        }
+        return TCF_SUCCESS;
+    }  // ocall_WriteWorkOrderResult
+
+    tcf_err_t ocall_ReadWorkOrderResult(
+        uint64_t inOffset,
+        uint8_t* outBuffer,
+        size_t inBufferSize) {
+        if (g_workOrderResult == nullptr) {
+            return TCF_ERR_VALUE;
+        }
+        return CopyRange(g_workOrderResult->data(), g_workOrderResult->size(),
+            inOffset, outBuffer, inBufferSize);
+    }  // ocall_ReadWorkOrderResult
+}  // extern "C"
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 /*
  * Handles json serialized work order requests and updates serialized
@@ -41,13 +115,14 @@
 */
 tcf_err_t WorkOrderHandler::HandleWorkOrderRequest(
     const Base64EncodedString& inSerializedRequest,
-    const std::string inWorkOrderExtData,
+    const std::string& inWorkOrderExtData,
     uint32_t& outResponseIdentifier,
     size_t& outSerializedResponseSize,
     int enclaveIndex) {
     tcf_err_t result = TCF_SUCCESS;
 
     try {
+        uint32_t response_identifier = 0;
         size_t response_size = 0;
         ByteArray serialized_request = \
             Base64EncodedStringToByteArray(inSerializedRequest);
@@ -63,8 +138,9 @@ tcf_err_t WorkOrderHandler::HandleWorkOrderRequest(
                     this,
                     enclaveid,
                     &presult,
-                    serialized_request,
-                    inWorkOrderExtData,
+                    &serialized_request,
+                    &inWorkOrderExtData,
+                    &response_identifier,
                     &response_size
                 ]
                 () {
@@ -75,6 +151,7 @@ tcf_err_t WorkOrderHandler::HandleWorkOrderRequest(
                         serialized_request.size(),
                         (const uint8_t*) inWorkOrderExtData.c_str(),
                         inWorkOrderExtData.length(),
+                        &response_identifier,
                         &response_size);
                     return tcf::error::ConvertErrorStatus(sresult_inner, presult);
                 });
@@ -82,6 +159,7 @@ tcf_err_t WorkOrderHandler::HandleWorkOrderRequest(
             "Intel SGX enclave call failed (ecall_HandleWorkOrderRequest)");
         g_Enclave[enclaveIndex].ThrowTCFError(presult);
 
+        outResponseIdentifier = response_identifier;
         outSerializedResponseSize = response_size;
     } catch (tcf::error::Error& e) {
         tcf::enclave_api::base::SetLastError(e.what());
@@ -98,8 +176,386 @@ tcf_err_t WorkOrderHandler::HandleWorkOrderRequest(
 }  // WorkOrderHandler::HandleWorkOrderRequest
 
 /*
- * Get serialized work order response for the last executed work order
- * request.
+ * Handles json serialized work order requests and copies the serialized
+ * work order response out in the same enclave call, provided it fits in
+ * a buffer of inResponseSizeHint bytes. If the response is larger,
+ * outSerializedResponse is left empty and the caller has to fetch it
+ * with GetSerializedResponse using outSerializedResponseSize.
+ *
+ * @param inSerializedRequest - Base64 encoded work order request
+ * @param inWorkOrderExtData - Extended work order data
+ * @param inResponseSizeHint - Size of the response buffer to pass in
+ * @param outResponseIdentifier - Work order response identifier
+ * @param outSerializedResponseSize - Size of the serialized response
+ * @param outSerializedResponse - Base64 encoded response, empty if it
+ *                                did not fit in the buffer
+ * @param enclaveIndex - Enclave index
+ *
+ * @returns status of work order request execution
+*/
+tcf_err_t WorkOrderHandler::HandleWorkOrderRequestWithResponse(
+    const Base64EncodedString& inSerializedRequest,
+    const std::string& inWorkOrderExtData,
+    const size_t inResponseSizeHint,
+    uint32_t& outResponseIdentifier,
+    size_t& outSerializedResponseSize,
+    Base64EncodedString& outSerializedResponse,
+    int enclaveIndex) {
+    tcf_err_t result = TCF_SUCCESS;
+
+    try {
+        ByteArray serialized_request = \
+            Base64EncodedStringToByteArray(inSerializedRequest);
+        ByteArray serialized_response(inResponseSizeHint);
+
+        result = HandleWorkOrderRequestWithResponse(
+            serialized_request.data(),
+            serialized_request.size(),
+            (const uint8_t*) inWorkOrderExtData.c_str(),
+            inWorkOrderExtData.length(),
+            serialized_response.data(),
+            serialized_response.size(),
+            outResponseIdentifier,
+            outSerializedResponseSize,
+            enclaveIndex);
+
+        if (result == TCF_SUCCESS &&
+            outSerializedResponseSize <= serialized_response.size()) {
+            serialized_response.resize(outSerializedResponseSize);
+            outSerializedResponse = \
+                ByteArrayToBase64EncodedString(serialized_response);
+        } else {
+            outSerializedResponse.clear();
+        }
+    } catch (tcf::error::Error& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    } catch (std::exception& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = TCF_ERR_UNKNOWN;
+    } catch (...) {
+        tcf::enclave_api::base::SetLastError("Unexpected exception");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // WorkOrderHandler::HandleWorkOrderRequestWithResponse
+
+/*
+ * Same as above for a work order request passed as raw JSON bytes. The
+ * request is marshalled into the enclave straight from the caller's
+ * buffer and the response is copied out straight into the caller's
+ * buffer, without base64 encoding or intermediate copies. Passing the
+ * request with its terminating NUL in inSerializedRequestSize lets the
+ * enclave parse it in place.
+ *
+ * @param inSerializedRequest - JSON serialized work order request
+ * @param inSerializedRequestSize - Size of the request
+ * @param inWorkOrderExtData - Extended work order data, may be NULL
+ * @param inWorkOrderExtDataSize - Size of the extended work order data
+ * @param outSerializedResponse - Buffer for the serialized response
+ * @param inResponseBufferSize - Size of the response buffer
+ * @param outResponseIdentifier - Work order response identifier
+ * @param outSerializedResponseSize - Size of the serialized response, the
+ *                                    buffer was not written if it is larger
+ *                                    than inResponseBufferSize
+ * @param enclaveIndex - Enclave index
+ *
+ * @returns status of work order request execution
+*/
+tcf_err_t WorkOrderHandler::HandleWorkOrderRequestWithResponse(
+    const uint8_t* inSerializedRequest,
+    const size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    const size_t inWorkOrderExtDataSize,
+    uint8_t* outSerializedResponse,
+    const size_t inResponseBufferSize,
+    uint32_t& outResponseIdentifier,
+    size_t& outSerializedResponseSize,
+    int enclaveIndex) {
+    return CallHandleWorkOrderRequest(
+        inSerializedRequest,
+        inSerializedRequestSize,
+        inWorkOrderExtData,
+        inWorkOrderExtDataSize,
+        outSerializedResponse,
+        inResponseBufferSize,
+        outResponseIdentifier,
+        outSerializedResponseSize,
+        false,
+        enclaveIndex);
+}  // WorkOrderHandler::HandleWorkOrderRequestWithResponse
+
+/*
+ * Same as above for a work order request whose large inData items are
+ * streamed into the enclave instead of being embedded in the request.
+ * Such items carry dataStreamSize, the size of their base64 encoded data,
+ * in place of data, and their data is concatenated in inStreamData in the
+ * order of the inData array. The enclave reads the data in pieces while
+ * handling the request, so it never holds all of it at once.
+ * Likewise outData items of the response which carry dataStreamOffset and
+ * dataStreamSize in place of data were written to outStreamData by the
+ * workload piece by piece. Workloads only write outData piece by piece
+ * for requests handled here, through ecall_HandleWorkOrderRequestStream.
+ *
+ * @param inStreamData - Base64 encoded data of the streamed inData items
+ * @param inStreamDataSize - Size of the streamed data
+ * @param outStreamData - Base64 encoded data of the streamed outData items
+ *
+ * @returns status of work order request execution
+*/
+tcf_err_t WorkOrderHandler::HandleWorkOrderRequestStream(
+    const uint8_t* inSerializedRequest,
+    const size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    const size_t inWorkOrderExtDataSize,
+    const uint8_t* inStreamData,
+    const size_t inStreamDataSize,
+    uint8_t* outSerializedResponse,
+    const size_t inResponseBufferSize,
+    uint32_t& outResponseIdentifier,
+    size_t& outSerializedResponseSize,
+    ByteArray& outStreamData,
+    int enclaveIndex) {
+    outStreamData.clear();
+    WorkOrderDataScope stream(inStreamData, inStreamDataSize, &outStreamData);
+    return CallHandleWorkOrderRequest(
+        inSerializedRequest,
+        inSerializedRequestSize,
+        inWorkOrderExtData,
+        inWorkOrderExtDataSize,
+        outSerializedResponse,
+        inResponseBufferSize,
+        outResponseIdentifier,
+        outSerializedResponseSize,
+        true,
+        enclaveIndex);
+}  // WorkOrderHandler::HandleWorkOrderRequestStream
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/*
+ * Calls the enclave for HandleWorkOrderRequestWithResponse, or for
+ * HandleWorkOrderRequestStream if inStreamed is set.
+*/
+tcf_err_t WorkOrderHandler::CallHandleWorkOrderRequest(
+    const uint8_t* inSerializedRequest,
+    const size_t inSerializedRequestSize,
+    const uint8_t* inWorkOrderExtData,
+    const size_t inWorkOrderExtDataSize,
+    uint8_t* outSerializedResponse,
+    const size_t inResponseBufferSize,
+    uint32_t& outResponseIdentifier,
+    size_t& outSerializedResponseSize,
+    bool inStreamed,
+    int enclaveIndex) {
+    tcf_err_t result = TCF_SUCCESS;
+
+    try {
+        uint32_t response_identifier = 0;
+        size_t response_size = 0;
+
+        // xxxxx Call the enclave
+
+        // Get the enclave id for passing into the ecall
+        sgx_enclave_id_t enclaveid = g_Enclave[enclaveIndex].GetEnclaveId();
+
+        // Requests with streamed data have an ecall of their own, the
+        // enclave writes the output of outData items out only for them
+        auto ecall = inStreamed ? ecall_HandleWorkOrderRequestStream :
+            ecall_HandleWorkOrderRequestWithResponse;
+
+        tcf_err_t presult = TCF_SUCCESS;
+        sgx_status_t sresult = tcf::sgx_util::CallSgx(
+                [
+                    this,
+                    ecall,
+                    enclaveid,
+                    &presult,
+                    inSerializedRequest,
+                    inSerializedRequestSize,
+                    inWorkOrderExtData,
+                    inWorkOrderExtDataSize,
+                    outSerializedResponse,
+                    inResponseBufferSize,
+                    &response_identifier,
+                    &response_size
+                ]
+                () {
+                    sgx_status_t sresult_inner = ecall(
+                            enclaveid,
+                            &presult,
+                            inSerializedRequest,
+                            inSerializedRequestSize,
+                            inWorkOrderExtData,
+                            inWorkOrderExtDataSize,
+                            outSerializedResponse,
+                            inResponseBufferSize,
+                            &response_identifier,
+                            &response_size);
+                    return tcf::error::ConvertErrorStatus(sresult_inner, presult);
+                });
+        tcf::error::ThrowSgxError(sresult, inStreamed ?
+            "Intel SGX enclave call failed "
+            "(ecall_HandleWorkOrderRequestStream)" :
+            "Intel SGX enclave call failed "
+            "(ecall_HandleWorkOrderRequestWithResponse)");
+        g_Enclave[enclaveIndex].ThrowTCFError(presult);
+
+        outResponseIdentifier = response_identifier;
+        outSerializedResponseSize = response_size;
+    } catch (tcf::error::Error& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    } catch (std::exception& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = TCF_ERR_UNKNOWN;
+    } catch (...) {
+        tcf::enclave_api::base::SetLastError("Unexpected exception");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // WorkOrderHandler::CallHandleWorkOrderRequest
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+/*
+ * Handles a batch of json serialized work order requests in a single
+ * enclave transition. A failure of a single work order does not fail
+ * the batch, it is reported in the status of its response.
+ *
+ * @param inSerializedRequests - Base64 encoded work order requests
+ * @param inWorkOrderExtData - Extended work order data of each request,
+ *                             may be empty if no request has any
+ * @param inResponseSizeHint - Expected size of the serialized response
+ *                             batch, a second call into the enclave is
+ *                             needed to fetch a larger one
+ * @param outStatus - Status of each work order
+ * @param outSerializedResponses - Base64 encoded work order responses,
+ *                                 empty for failed work orders
+ * @param enclaveIndex - Enclave index
+ *
+ * @returns status of the batch execution
+*/
+tcf_err_t WorkOrderHandler::HandleWorkOrderBatch(
+    const std::vector<Base64EncodedString>& inSerializedRequests,
+    const std::vector<std::string>& inWorkOrderExtData,
+    const size_t inResponseSizeHint,
+    std::vector<tcf_err_t>& outStatus,
+    std::vector<Base64EncodedString>& outSerializedResponses,
+    int enclaveIndex) {
+    tcf_err_t result = TCF_SUCCESS;
+
+    try {
+        tcf::error::ThrowIf<tcf::error::ValueError>(
+            !inWorkOrderExtData.empty() &&
+            inWorkOrderExtData.size() != inSerializedRequests.size(),
+            "Extended work order data does not match the requests");
+
+        ByteArray serialized_batch;
+        for (size_t i = 0; i < inSerializedRequests.size(); i++) {
+            ByteArray ext_data;
+            if (!inWorkOrderExtData.empty()) {
+                ext_data.assign(inWorkOrderExtData[i].begin(),
+                    inWorkOrderExtData[i].end());
+            }
+            tcf::work_order_batch::AppendRequest(serialized_batch,
+                Base64EncodedStringToByteArray(inSerializedRequests[i]),
+                ext_data);
+        }
+
+        uint32_t response_identifier = 0;
+        size_t response_size = 0;
+        ByteArray serialized_response(inResponseSizeHint);
+
+        // xxxxx Call the enclave
+
+        // Get the enclave id for passing into the ecall
+        sgx_enclave_id_t enclaveid = g_Enclave[enclaveIndex].GetEnclaveId();
+
+        tcf_err_t presult = TCF_SUCCESS;
+        sgx_status_t sresult = tcf::sgx_util::CallSgx(
+                [
+                    this,
+                    enclaveid,
+                    &presult,
+                    &serialized_batch,
+                    &serialized_response,
+                    &response_identifier,
+                    &response_size
+                ]
+                () {
+                    sgx_status_t sresult_inner = ecall_HandleWorkOrderBatch(
+                        enclaveid,
+                        &presult,
+                        serialized_batch.data(),
+                        serialized_batch.size(),
+                        serialized_response.data(),
+                        serialized_response.size(),
+                        &response_identifier,
+                        &response_size);
+                    return tcf::error::ConvertErrorStatus(sresult_inner, presult);
+                });
+        tcf::error::ThrowSgxError(sresult,
+            "Intel SGX enclave call failed (ecall_HandleWorkOrderBatch)");
+        g_Enclave[enclaveIndex].ThrowTCFError(presult);
+
+        if (response_size > serialized_response.size()) {
+            // Response batch did not fit, fetch it from the enclave
+            serialized_response.resize(response_size);
+            sresult = tcf::sgx_util::CallSgx(
+                    [
+                        this,
+                        enclaveid,
+                        &presult,
+                        response_identifier,
+                        &serialized_response
+                    ]
+                    () {
+                        sgx_status_t sresult_inner = ecall_GetSerializedResponse(
+                            enclaveid,
+                            &presult,
+                            response_identifier,
+                            serialized_response.data(),
+                            serialized_response.size());
+                        return tcf::error::ConvertErrorStatus(sresult_inner, presult);
+                    });
+            tcf::error::ThrowSgxError(sresult,
+                "Intel SGX enclave call failed (GetSerializedResponse)");
+            g_Enclave[enclaveIndex].ThrowTCFError(presult);
+        }
+
+        std::vector<tcf::work_order_batch::ResponseItem> responses =
+            tcf::work_order_batch::ParseResponses(
+                serialized_response.data(), response_size);
+        tcf::error::ThrowIf<tcf::error::ValueError>(
+            responses.size() != inSerializedRequests.size(),
+            "Number of responses does not match the requests");
+
+        outStatus.clear();
+        outSerializedResponses.clear();
+        for (const auto& response : responses) {
+            outStatus.push_back(response.status);
+            outSerializedResponses.push_back(
+                ByteArrayToBase64EncodedString(response.response));
+        }
+    } catch (tcf::error::Error& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    } catch (std::exception& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = TCF_ERR_UNKNOWN;
+    } catch (...) {
+        tcf::enclave_api::base::SetLastError("Unexpected exception");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // WorkOrderHandler::HandleWorkOrderBatch
+
+/*
+ * Get serialized work order response of a work order request executed
+ * with HandleWorkOrderRequest. The enclave releases the response once
+ * it is returned.
  *
  * @param inResponseIdentifier - Work order response identifier
  * @param inSerializedResponseSize - Size of the serialized response
@@ -118,6 +574,45 @@ tcf_err_t WorkOrderHandler::GetSerializedResponse(
     try {
         ByteArray serialized_response(inSerializedResponseSize);
 
+        result = GetSerializedResponse(inResponseIdentifier,
+            serialized_response.data(), serialized_response.size(),
+            enclaveIndex);
+        if (result == TCF_SUCCESS) {
+            outSerializedResponse = \
+                ByteArrayToBase64EncodedString(serialized_response);
+        }
+    } catch (tcf::error::Error& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    } catch (std::exception& e) {
+        tcf::enclave_api::base::SetLastError(e.what());
+        result = TCF_ERR_UNKNOWN;
+    } catch (...) {
+        tcf::enclave_api::base::SetLastError("Unexpected exception");
+        result = TCF_ERR_UNKNOWN;
+    }
+
+    return result;
+}  // WorkOrderHandler::GetSerializedResponse
+
+/*
+ * Same as above, copying the response straight into the caller's buffer.
+ *
+ * @param inResponseIdentifier - Work order response identifier
+ * @param outSerializedResponse - Buffer for the serialized response
+ * @param inSerializedResponseSize - Size of the serialized response
+ * @param enclaveIndex - Enclave index
+ *
+ * @returns status of the get serialized response
+*/
+tcf_err_t WorkOrderHandler::GetSerializedResponse(
+    const uint32_t inResponseIdentifier,
+    uint8_t* outSerializedResponse,
+    const size_t inSerializedResponseSize,
+    int enclaveIndex) {
+    tcf_err_t result = TCF_SUCCESS;
+
+    try {
         // xxxxx Call the enclave
 
         // Get the enclave id for passing into the ecall
@@ -129,21 +624,22 @@ tcf_err_t WorkOrderHandler::GetSerializedResponse(
                     this,
                     enclaveid,
                     &presult,
-                    &serialized_response
+                    inResponseIdentifier,
+                    outSerializedResponse,
+                    inSerializedResponseSize
                 ]
                 () {
                     sgx_status_t sresult_inner = ecall_GetSerializedResponse(
                         enclaveid,
                         &presult,
-                        serialized_response.data(),
-                        serialized_response.size());
+                        inResponseIdentifier,
+                        outSerializedResponse,
+                        inSerializedResponseSize);
                     return tcf::error::ConvertErrorStatus(sresult_inner, presult);
                 });
         tcf::error::ThrowSgxError(sresult,
             "Intel SGX enclave call failed (GetSerializedResponse)");
         g_Enclave[enclaveIndex].ThrowTCFError(presult);
-
-        outSerializedResponse = ByteArrayToBase64EncodedString(serialized_response);
     } catch (tcf::error::Error& e) {
         tcf::enclave_api::base::SetLastError(e.what());
         result = e.error_code();
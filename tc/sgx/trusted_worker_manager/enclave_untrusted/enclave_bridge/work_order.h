@@ -16,6 +16,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <stdlib.h>
 
 #include "tcf_error.h"
@@ -27,14 +28,75 @@ public:
 
     tcf_err_t HandleWorkOrderRequest(
         const Base64EncodedString& inSerializedRequest,
-        const std::string inWorkOrderExtData,
+        const std::string& inWorkOrderExtData,
         uint32_t& outResponseIdentifier,
         size_t& outSerializedResponseSize,
         int enclaveIndex);
 
+    tcf_err_t HandleWorkOrderRequestWithResponse(
+        const Base64EncodedString& inSerializedRequest,
+        const std::string& inWorkOrderExtData,
+        const size_t inResponseSizeHint,
+        uint32_t& outResponseIdentifier,
+        size_t& outSerializedResponseSize,
+        Base64EncodedString& outSerializedResponse,
+        int enclaveIndex);
+
+    tcf_err_t HandleWorkOrderRequestWithResponse(
+        const uint8_t* inSerializedRequest,
+        const size_t inSerializedRequestSize,
+        const uint8_t* inWorkOrderExtData,
+        const size_t inWorkOrderExtDataSize,
+        uint8_t* outSerializedResponse,
+        const size_t inResponseBufferSize,
+        uint32_t& outResponseIdentifier,
+        size_t& outSerializedResponseSize,
+        int enclaveIndex);
+
+    tcf_err_t HandleWorkOrderRequestStream(
+        const uint8_t* inSerializedRequest,
+        const size_t inSerializedRequestSize,
+        const uint8_t* inWorkOrderExtData,
+        const size_t inWorkOrderExtDataSize,
+        const uint8_t* inStreamData,
+        const size_t inStreamDataSize,
+        uint8_t* outSerializedResponse,
+        const size_t inResponseBufferSize,
+        uint32_t& outResponseIdentifier,
+        size_t& outSerializedResponseSize,
+        ByteArray& outStreamData,
+        int enclaveIndex);
+
+    tcf_err_t HandleWorkOrderBatch(
+        const std::vector<Base64EncodedString>& inSerializedRequests,
+        const std::vector<std::string>& inWorkOrderExtData,
+        const size_t inResponseSizeHint,
+        std::vector<tcf_err_t>& outStatus,
+        std::vector<Base64EncodedString>& outSerializedResponses,
+        int enclaveIndex);
+
     tcf_err_t GetSerializedResponse(
         const uint32_t inResponseIdentifier,
         const size_t inSerializedResponseSize,
         Base64EncodedString& outSerializedResponse,
         int enclaveIndex);
+
+    tcf_err_t GetSerializedResponse(
+        const uint32_t inResponseIdentifier,
+        uint8_t* outSerializedResponse,
+        const size_t inSerializedResponseSize,
+        int enclaveIndex);
+
+private:
+    tcf_err_t CallHandleWorkOrderRequest(
+        const uint8_t* inSerializedRequest,
+        const size_t inSerializedRequestSize,
+        const uint8_t* inWorkOrderExtData,
+        const size_t inWorkOrderExtDataSize,
+        uint8_t* outSerializedResponse,
+        const size_t inResponseBufferSize,
+        uint32_t& outResponseIdentifier,
+        size_t& outSerializedResponseSize,
+        bool inStreamed,
+        int enclaveIndex);
 };
@@ -15,6 +15,7 @@
 
 #include "tcf_error.h"
 #include "swig_utils.h"
+#include "base.h"
 
 #include "signup_kme.h"
 #include "signup_info_kme.h"
@@ -52,12 +53,16 @@ std::map<std::string, std::string> SignupInfoKME::CreateEnclaveData(
     std::string verifying_key;
     std::string encryption_key;
     std::string encryption_key_signature;
+    std::string key_agreement_key;
+    std::string key_agreement_key_signature;
 
     presult = SignupInfo::DeserializePublicEnclaveData(
         public_enclave_data.str(),
         verifying_key,
         encryption_key,
-        encryption_key_signature);
+        encryption_key_signature,
+        key_agreement_key,
+        key_agreement_key_signature);
     ThrowTCFError(presult);
 
     // Save the information
@@ -65,6 +70,8 @@ std::map<std::string, std::string> SignupInfoKME::CreateEnclaveData(
     result["verifying_key"] = verifying_key;
     result["encryption_key"] = encryption_key;
     result["encryption_key_signature"] = encryption_key_signature;
+    result["key_agreement_key"] = key_agreement_key;
+    result["key_agreement_key_signature"] = key_agreement_key_signature;
     result["sealed_enclave_data"] = sealed_enclave_data;
     result["enclave_quote"] = enclave_quote;
 
@@ -87,22 +94,43 @@ std::map<std::string, std::string> SignupInfoKME::UnsealEnclaveData() {
     std::string verifying_key;
     std::string encryption_key;
     std::string encryption_key_signature;
+    std::string key_agreement_key;
+    std::string key_agreement_key_signature;
 
     presult = SignupInfo::DeserializePublicEnclaveData(
         public_enclave_data.str(),
         verifying_key,
         encryption_key,
-        encryption_key_signature);
+        encryption_key_signature,
+        key_agreement_key,
+        key_agreement_key_signature);
     ThrowTCFError(presult);
 
     std::map<std::string, std::string> result;
     result["verifying_key"] = verifying_key;
     result["encryption_key"] = encryption_key;
     result["encryption_key_signature"] = encryption_key_signature;
+    result["key_agreement_key"] = key_agreement_key;
+    result["key_agreement_key_signature"] = key_agreement_key_signature;
 
     return result;
 }  // SignupInfoKME::UnsealEnclaveData
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t SignupInfoKME::RefillKeyPool(size_t max_keys) {
+    // Only use an enclave which is not executing a request
+    tcf::enclave_queue::ReadyEnclave ready_enclave =
+        tcf::enclave_api::base::GetReadyEnclave(0);
+
+    size_t pool_size = 0;
+    SignupDataKME signup_data;
+    tcf_err_t presult = signup_data.RefillKeyPool(
+        max_keys, ready_enclave.getIndex(), pool_size);
+    ThrowTCFError(presult);
+
+    return pool_size;
+}  // SignupInfoKME::RefillKeyPool
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 size_t SignupInfoKME::VerifyEnclaveInfo(
     const std::string& enclave_info,
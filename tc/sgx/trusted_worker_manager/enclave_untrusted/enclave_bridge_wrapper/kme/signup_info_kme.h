@@ -33,6 +33,14 @@ public:
         const std::string& mr_enclave,
         const std::string& ext_data);
 
+    /*
+      Refills the work order key pool of the next ready enclave with up
+      to max_keys signing key pairs and returns the number of key pairs
+      in its pool. Does not wait for an enclave, throws SystemBusyError
+      if all of them are executing requests.
+    */
+    size_t RefillKeyPool(size_t max_keys);
+
     static SignupInfo* DeserializeSignupInfo(
         const std::string& serialized_signup_info);
 
@@ -63,6 +63,14 @@ tcf_err_t SignupInfo::DeserializeSignupInfo(
 
         this->encryption_key_signature.assign(pvalue);
 
+        // --------------- key agreement key ---------------
+        pvalue = json_object_dotget_string(data_object, "key_agreement_key");
+        this->key_agreement_key.assign(pvalue ? pvalue : "");
+
+        pvalue = json_object_dotget_string(data_object,
+            "key_agreement_key_signature");
+        this->key_agreement_key_signature.assign(pvalue ? pvalue : "");
+
         // --------------- proof data ---------------
         pvalue = json_object_dotget_string(data_object, "proof_data");
         tcf::error::ThrowIfNull(pvalue,
@@ -96,7 +104,9 @@ tcf_err_t SignupInfo::DeserializePublicEnclaveData(
     const std::string& public_enclave_data,
     std::string& verifying_key,
     std::string& encryption_key,
-    std::string& encryption_key_signature) {
+    std::string& encryption_key_signature,
+    std::string& key_agreement_key,
+    std::string& key_agreement_key_signature) {
 
     tcf_err_t result = TCF_SUCCESS;
 
@@ -132,6 +142,15 @@ tcf_err_t SignupInfo::DeserializePublicEnclaveData(
             "invalid public enclave data; missing EncryptionKeySignature");
 
         encryption_key_signature.assign(pvalue);
+
+        // --------------- key agreement key ---------------
+        // Not published by enclaves sealed before key agreement was added
+        pvalue = json_object_dotget_string(data_object, "KeyAgreementKey");
+        key_agreement_key.assign(pvalue ? pvalue : "");
+
+        pvalue = json_object_dotget_string(data_object,
+            "KeyAgreementKeySignature");
+        key_agreement_key_signature.assign(pvalue ? pvalue : "");
     } catch (tcf::error::Error& e) {
         tcf::enclave_api::base::SetLastError(e.what());
         result = e.error_code();
@@ -34,7 +34,9 @@ public:
         const std::string& public_enclave_data,
         std::string& verifying_key,
         std::string& encryption_key,
-        std::string& encryption_key_signature);
+        std::string& encryption_key_signature,
+        std::string& key_agreement_key,
+        std::string& key_agreement_key_signature);
 
     tcf_err_t DeserializeSignupInfo(const std::string& serialized_signup_info);
 
@@ -42,6 +44,8 @@ public:
     std::string verifying_key;
     std::string encryption_key;
     std::string encryption_key_signature;
+    std::string key_agreement_key;
+    std::string key_agreement_key_signature;
     std::string proof_data;
     std::string enclave_persistent_id;
 
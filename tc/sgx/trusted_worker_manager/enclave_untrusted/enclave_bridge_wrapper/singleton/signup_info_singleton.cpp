@@ -50,10 +50,13 @@ std::map<std::string, std::string> SignupInfoSingleton::CreateEnclaveData() {
     std::string verifying_key;
     std::string encryption_key;
     std::string encryption_key_signature;
+    std::string key_agreement_key;
+    std::string key_agreement_key_signature;
 
     presult = SignupInfo::DeserializePublicEnclaveData(
         public_enclave_data.str(), verifying_key, encryption_key,
-	encryption_key_signature);
+	encryption_key_signature,
+        key_agreement_key, key_agreement_key_signature);
     ThrowTCFError(presult);
 
     // Save the information
@@ -61,6 +64,8 @@ std::map<std::string, std::string> SignupInfoSingleton::CreateEnclaveData() {
     result["verifying_key"] = verifying_key;
     result["encryption_key"] = encryption_key;
     result["encryption_key_signature"] = encryption_key_signature;
+    result["key_agreement_key"] = key_agreement_key;
+    result["key_agreement_key_signature"] = key_agreement_key_signature;
     result["sealed_enclave_data"] = sealed_enclave_data;
     result["enclave_quote"] = enclave_quote;
 
@@ -82,16 +87,21 @@ std::map<std::string, std::string> SignupInfoSingleton::UnsealEnclaveData() {
     std::string verifying_key;
     std::string encryption_key;
     std::string encryption_key_signature;
+    std::string key_agreement_key;
+    std::string key_agreement_key_signature;
 
     presult = SignupInfo::DeserializePublicEnclaveData(
         public_enclave_data.str(), verifying_key, encryption_key,
-        encryption_key_signature);
+        encryption_key_signature,
+        key_agreement_key, key_agreement_key_signature);
     ThrowTCFError(presult);
 
     std::map<std::string, std::string> result;
     result["verifying_key"] = verifying_key;
     result["encryption_key"] = encryption_key;
     result["encryption_key_signature"] = encryption_key_signature;
+    result["key_agreement_key"] = key_agreement_key;
+    result["key_agreement_key_signature"] = key_agreement_key_signature;
 
     return result;
 }  // SignupInfoSingleton::UnsealEnclaveData
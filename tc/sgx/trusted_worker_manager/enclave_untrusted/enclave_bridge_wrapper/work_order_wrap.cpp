@@ -14,7 +14,9 @@
  */
 
 #include <stdlib.h>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "error.h"
 #include "tcf_error.h"
@@ -63,3 +65,240 @@ std::string HandleWorkOrderRequest(
     ThrowTCFError(presult);
     return response;
 }
+
+/*
+ * Handles json serialized work order requests and returns serialized
+ * work order response. The response is returned by the same enclave call
+ * that executes the work order, if it fits in response_size_hint bytes.
+ * Otherwise it is fetched with a second call to GetSerializedResponse.
+ *
+ * @param serialized_request - JSON serialized work order request
+ * @param ext_wo_data - Extended work order data
+ * @param response_size_hint - Expected upper bound of the response size
+ * @param acquire_timeout_ms - Milliseconds to wait for a free enclave,
+ *                             negative to wait as long as needed
+ * @ returns JSON serialized response
+*/
+std::string HandleWorkOrderRequestWithResponse(
+    const std::string& serialized_request,
+    const std::string& ext_wo_data,
+    size_t response_size_hint,
+    int acquire_timeout_ms) {
+    tcf_err_t presult;
+
+    uint32_t response_identifier;
+    size_t response_size;
+    Base64EncodedString response;
+
+    tcf::enclave_queue::ReadyEnclave readyEnclave = \
+        tcf::enclave_api::base::GetReadyEnclave(acquire_timeout_ms);
+
+    WorkOrderHandler wo_handle;
+    presult = wo_handle.HandleWorkOrderRequestWithResponse(
+        serialized_request,
+        ext_wo_data,
+        response_size_hint,
+        response_identifier,
+        response_size,
+        response,
+        readyEnclave.getIndex());
+    ThrowTCFError(presult);
+
+    // Response did not fit in the buffer, fall back to the two step path
+    if (response_size > response_size_hint) {
+        presult = wo_handle.GetSerializedResponse(
+            response_identifier,
+            response_size,
+            response,
+            readyEnclave.getIndex());
+        ThrowTCFError(presult);
+    }
+    return response;
+}
+
+/*
+ * Handles a json serialized work order request passed as raw bytes and
+ * returns the serialized work order response as raw bytes. The request
+ * is marshalled into the enclave straight from the caller's buffer and
+ * the response is copied out straight into the returned buffer, without
+ * base64 encoding either of them. A request passed with its terminating
+ * NUL is parsed in place by the enclave.
+ *
+ * @param serialized_request - JSON serialized work order request
+ * @param serialized_request_size - Size of the request
+ * @param ext_wo_data - Extended work order data
+ * @param ext_wo_data_size - Size of the extended work order data
+ * @param response_size_hint - Expected upper bound of the response size
+ * @param acquire_timeout_ms - Milliseconds to wait for a free enclave,
+ *                             negative to wait as long as needed
+ * @ returns JSON serialized response, see HandleWorkOrderRequestStream
+ *           for the data of outData items streamed by the workload
+*/
+ByteArray HandleWorkOrderRequestBuffer(
+    const char* serialized_request,
+    size_t serialized_request_size,
+    const char* ext_wo_data,
+    size_t ext_wo_data_size,
+    size_t response_size_hint,
+    int acquire_timeout_ms) {
+    return HandleWorkOrderRequestStream(
+        serialized_request,
+        serialized_request_size,
+        ext_wo_data,
+        ext_wo_data_size,
+        nullptr,
+        0,
+        response_size_hint,
+        acquire_timeout_ms);
+}
+
+/*
+ * Same as HandleWorkOrderRequestBuffer for a request whose large inData
+ * items carry dataStreamSize instead of data. The base64 encoded data of
+ * these items is concatenated in stream_data in the order of the inData
+ * array, the enclave reads it piece by piece while handling the request.
+ * outData items of the response which carry dataStreamOffset and
+ * dataStreamSize instead of data were streamed out of the enclave by the
+ * workload, their data follows the terminating NUL of the response.
+ *
+ * @param stream_data - Data of the streamed inData items
+ * @param stream_data_size - Size of the streamed data
+ * @ returns JSON serialized response, followed by the data of the
+ *           streamed outData items
+*/
+ByteArray HandleWorkOrderRequestStream(
+    const char* serialized_request,
+    size_t serialized_request_size,
+    const char* ext_wo_data,
+    size_t ext_wo_data_size,
+    const char* stream_data,
+    size_t stream_data_size,
+    size_t response_size_hint,
+    int acquire_timeout_ms) {
+    tcf_err_t presult;
+
+    uint32_t response_identifier;
+    size_t response_size;
+    ByteArray response(response_size_hint);
+    ByteArray streamed_output;
+
+    tcf::enclave_queue::ReadyEnclave readyEnclave = \
+        tcf::enclave_api::base::GetReadyEnclave(acquire_timeout_ms);
+
+    WorkOrderHandler wo_handle;
+    presult = wo_handle.HandleWorkOrderRequestStream(
+        (const uint8_t*) serialized_request,
+        serialized_request_size,
+        ext_wo_data_size ? (const uint8_t*) ext_wo_data : nullptr,
+        ext_wo_data_size,
+        (const uint8_t*) stream_data,
+        stream_data_size,
+        response.data(),
+        response.size(),
+        response_identifier,
+        response_size,
+        streamed_output,
+        readyEnclave.getIndex());
+    ThrowTCFError(presult);
+
+    // Response did not fit in the buffer, fall back to the two step path
+    if (response_size > response.size()) {
+        response.resize(response_size);
+        presult = wo_handle.GetSerializedResponse(
+            response_identifier,
+            response.data(),
+            response.size(),
+            readyEnclave.getIndex());
+        ThrowTCFError(presult);
+    } else {
+        response.resize(response_size);
+    }
+    response.insert(response.end(),
+        streamed_output.begin(), streamed_output.end());
+    return response;
+}
+
+/*
+ * Handles a batch of json serialized work order requests with a single
+ * enclave call and returns the status and serialized response of each
+ * of them. Responses of failed work orders are empty.
+ *
+ * @param serialized_requests - JSON serialized work order requests
+ * @param ext_wo_data - Extended work order data of each request, empty
+ *                      if none of the requests has any
+ * @param response_size_hint - Expected upper bound of the size of all
+ *                             responses together
+ * @param acquire_timeout_ms - Milliseconds to wait for a free enclave,
+ *                             negative to wait as long as needed
+ * @ returns status and JSON serialized response of each work order
+*/
+WorkOrderBatchResponse HandleWorkOrderBatch(
+    const std::vector<std::string>& serialized_requests,
+    const std::vector<std::string>& ext_wo_data,
+    size_t response_size_hint,
+    int acquire_timeout_ms) {
+    tcf_err_t presult;
+
+    std::vector<tcf_err_t> status;
+    std::vector<Base64EncodedString> responses;
+
+    tcf::enclave_queue::ReadyEnclave readyEnclave = \
+        tcf::enclave_api::base::GetReadyEnclave(acquire_timeout_ms);
+
+    WorkOrderHandler wo_handle;
+    presult = wo_handle.HandleWorkOrderBatch(
+        serialized_requests,
+        ext_wo_data,
+        response_size_hint,
+        status,
+        responses,
+        readyEnclave.getIndex());
+    ThrowTCFError(presult);
+
+    WorkOrderBatchResponse batch_response;
+    batch_response.status.assign(status.begin(), status.end());
+    batch_response.responses.swap(responses);
+    return batch_response;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void AppendJsonArray(
+    std::ostringstream& out,
+    const std::vector<uint64_t>& values) {
+    out << "[";
+    for (size_t i = 0; i < values.size(); i++) {
+        out << (i ? "," : "") << values[i];
+    }
+    out << "]";
+}  // AppendJsonArray
+
+/*
+ * Returns the statistics of the queue of ready enclaves as a JSON object.
+ * Bucket i of depth_histogram counts enclave acquisitions which found i
+ * free TCS, bucket i of wait_time_histogram those which waited less than
+ * 2^i microseconds for one. The last bucket of each histogram counts all
+ * larger values.
+ *
+ * @ returns JSON serialized queue statistics
+*/
+std::string GetEnclaveQueueStats() {
+    tcf::enclave_queue::QueueStats stats =
+        tcf::enclave_api::base::GetEnclaveQueueStats();
+
+    std::ostringstream out;
+    out << "{\"acquire_count\":" << stats.acquireCount
+        << ",\"timeout_count\":" << stats.timeoutCount
+        << ",\"depth_histogram\":";
+    AppendJsonArray(out, stats.depthHistogram);
+    out << ",\"wait_time_histogram\":";
+    AppendJsonArray(out, stats.waitTimeHistogram);
+    out << ",\"enclaves\":[";
+    for (size_t i = 0; i < stats.enclaves.size(); i++) {
+        out << (i ? "," : "")
+            << "{\"acquire_count\":" << stats.enclaves[i].acquireCount
+            << ",\"busy_time_us\":" << stats.enclaves[i].busyTimeUs
+            << ",\"in_use\":" << stats.enclaves[i].inUse << "}";
+    }
+    out << "]}";
+    return out.str();
+}  // GetEnclaveQueueStats
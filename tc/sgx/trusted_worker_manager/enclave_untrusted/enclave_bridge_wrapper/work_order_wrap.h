@@ -14,6 +14,7 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "types.h"
 
@@ -22,3 +23,55 @@ std::string HandleWorkOrderRequest(
     const std::string& serializedRequest,
     const std::string& ext_wo_data);
 
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// acquire_timeout_ms limits the time to wait for a free enclave, see
+// tcf::enclave_api::base::GetReadyEnclave. A negative value waits as long
+// as needed.
+std::string HandleWorkOrderRequestWithResponse(
+    const std::string& serializedRequest,
+    const std::string& ext_wo_data,
+    size_t response_size_hint,
+    int acquire_timeout_ms = -1);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Same as HandleWorkOrderRequestWithResponse for a request passed as raw
+// JSON bytes, the response is returned as raw JSON bytes too. From
+// Python both are passed through the buffer protocol.
+ByteArray HandleWorkOrderRequestBuffer(
+    const char* serialized_request,
+    size_t serialized_request_size,
+    const char* ext_wo_data,
+    size_t ext_wo_data_size,
+    size_t response_size_hint,
+    int acquire_timeout_ms = -1);
+
+// Same as HandleWorkOrderRequestBuffer for a request whose large inData
+// items are streamed into the enclave from stream_data. Data of outData
+// items streamed out of the enclave follows the NUL ending the response.
+ByteArray HandleWorkOrderRequestStream(
+    const char* serialized_request,
+    size_t serialized_request_size,
+    const char* ext_wo_data,
+    size_t ext_wo_data_size,
+    const char* stream_data,
+    size_t stream_data_size,
+    size_t response_size_hint,
+    int acquire_timeout_ms = -1);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Result of HandleWorkOrderBatch, status[i] and responses[i] belong to
+// the i-th request of the batch
+struct WorkOrderBatchResponse {
+    std::vector<int> status;
+    std::vector<std::string> responses;
+};
+
+WorkOrderBatchResponse HandleWorkOrderBatch(
+    const std::vector<std::string>& serialized_requests,
+    const std::vector<std::string>& ext_wo_data,
+    size_t response_size_hint,
+    int acquire_timeout_ms = -1);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+std::string GetEnclaveQueueStats();
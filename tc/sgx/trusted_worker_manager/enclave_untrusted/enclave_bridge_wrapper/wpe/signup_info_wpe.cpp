@@ -84,12 +84,16 @@ std::map<std::string, std::string> SignupInfoWPE::CreateEnclaveData(
     std::string verifying_key;
     std::string encryption_key;
     std::string encryption_key_signature;
+    std::string key_agreement_key;
+    std::string key_agreement_key_signature;
 
     presult = SignupInfo::DeserializePublicEnclaveData(
         public_enclave_data.str(),
         verifying_key,
         encryption_key,
-        encryption_key_signature);
+        encryption_key_signature,
+        key_agreement_key,
+        key_agreement_key_signature);
     ThrowTCFError(presult);
 
     // Save the information
@@ -97,6 +101,8 @@ std::map<std::string, std::string> SignupInfoWPE::CreateEnclaveData(
     result["verifying_key"] = verifying_key;
     result["encryption_key"] = encryption_key;
     result["encryption_key_signature"] = encryption_key_signature;
+    result["key_agreement_key"] = key_agreement_key;
+    result["key_agreement_key_signature"] = key_agreement_key_signature;
     // sealing of enclave data is not done in WPE, hence keeping it empty
     result["sealed_enclave_data"] = "";
     result["enclave_quote"] = enclave_quote;
@@ -19,11 +19,13 @@
 //#include "tSgxSSL_api.h"
 #include <pwd.h>
 #include <unistd.h>
+#include <chrono>
 #define MAX_PATH FILENAME_MAX
 
 #include "TestApp.h"
 #include "TestEnclave_u.h"
 #include "sgx_urts.h"
+#include "sgx_uswitchless.h"
 #include "c11_support.h"
 
 /* Global EID shared by multiple threads */
@@ -85,10 +87,11 @@ void print_error_message(sgx_status_t ret)
 
 /* Initialize the enclave:
  *   Step 1: try to retrieve the launch token saved by last transaction
- *   Step 2: call sgx_create_enclave to initialize an enclave instance
+ *   Step 2: call sgx_create_enclave to initialize an enclave instance,
+ *           with uworkers threads for switchless ocalls if not 0
  *   Step 3: save the launch token if it is updated
  */
-int initialize_enclave(void)
+int initialize_enclave(uint32_t uworkers)
 {
     char token_path[MAX_PATH] = {'\0'};
     sgx_launch_token_t token = {0};
@@ -143,7 +146,20 @@ int initialize_enclave(void)
 
     /* Step 2: call sgx_create_enclave to initialize an enclave instance */
     /* Debug Support: set 2nd parameter to 1 */
-    ret = sgx_create_enclave(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, &token, &updated, &global_eid, NULL);
+    if (uworkers > 0)
+    {
+        sgx_uswitchless_config_t us_config = SGX_USWITCHLESS_CONFIG_INITIALIZER;
+        us_config.num_uworkers = uworkers;
+        us_config.num_tworkers = 0;
+        const void* ex_features_p[32] = { 0 };
+        ex_features_p[SGX_CREATE_ENCLAVE_EX_SWITCHLESS_BIT_IDX] = &us_config;
+        ret = sgx_create_enclave_ex(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, &token, &updated,
+            &global_eid, NULL, SGX_CREATE_ENCLAVE_EX_SWITCHLESS, ex_features_p);
+    }
+    else
+    {
+        ret = sgx_create_enclave(ENCLAVE_FILENAME, SGX_DEBUG_FLAG, &token, &updated, &global_eid, NULL);
+    }
     if (ret != SGX_SUCCESS)
     {
         print_error_message(ret);
@@ -181,18 +197,74 @@ void ocall_print_string(const char* str)
     printf("%s", str);
 }
 
+void ocall_bench(const char* str)
+{
+    (void)(str);
+}
+
+void ocall_bench_switchless(const char* str)
+{
+    (void)(str);
+}
+
+/* Time repeats ocalls from the enclave, returns nanoseconds per ocall */
+static double time_ocalls(uint64_t repeats, int switchless)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ecall_repeat_ocalls(global_eid, repeats, switchless);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / repeats;
+}
+
+/* Compare regular and switchless ocalls, as used by the worker enclaves
+ * built with SGX_SWITCHLESS
+ */
+static int bench_ocalls(uint64_t repeats, uint32_t uworkers)
+{
+    printf("Benchmark ocalls: %llu ocalls, %u uworkers\n",
+        (unsigned long long)repeats, uworkers);
+
+    if (initialize_enclave(uworkers) < 0)
+    {
+        fprintf(stderr, "Error: could not initialize Intel SGX Enclave\n");
+        return -1;
+    }
+
+    /* Warm up */
+    ecall_repeat_ocalls(global_eid, repeats / 10 + 1, 1);
+
+    double regular = time_ocalls(repeats, 0);
+    double switchless = time_ocalls(repeats, 1);
+    sgx_destroy_enclave(global_eid);
+
+    printf("regular ocall:    %10.1f ns\n", regular);
+    printf("switchless ocall: %10.1f ns\n", switchless);
+    printf("speedup:          %10.2fx\n", regular / switchless);
+    return 0;
+}
+
 /* Application entry */
 int SGX_CDECL main(int argc, char* argv[])
 {
-    (void)(argc);
-    (void)(argv);
-
     int result;
 
+    /* ttest --bench-ocalls [repeats] [uworkers] */
+    if (argc > 1 && strcmp(argv[1], "--bench-ocalls") == 0)
+    {
+        uint64_t repeats = (argc > 2) ? strtoull(argv[2], NULL, 10) : 100000;
+        uint32_t uworkers = (argc > 3) ? strtoul(argv[3], NULL, 10) : 2;
+        if (repeats == 0 || uworkers == 0)
+        {
+            fprintf(stderr, "Usage: %s --bench-ocalls [repeats] [uworkers]\n", argv[0]);
+            return -1;
+        }
+        return bench_ocalls(repeats, uworkers);
+    }
+
     printf("Test TRUSTED Common API.\n");
 
     /* Initialize the enclave */
-    if (initialize_enclave() < 0)
+    if (initialize_enclave(0) < 0)
     {
         fprintf(stderr, "Error: could not initialize Intel SGX Enclave\n");
         return -1;
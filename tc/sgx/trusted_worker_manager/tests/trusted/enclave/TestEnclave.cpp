@@ -49,3 +49,16 @@ int test()
 {
     return tcf::crypto::testCrypto();
 }
+
+// Benchmark ECALL
+void ecall_repeat_ocalls(uint64_t repeats, int switchless)
+{
+    const char* message = "Work order processed, response is ready to be fetched";
+    for (uint64_t i = 0; i < repeats; i++)
+    {
+        if (switchless)
+            ocall_bench_switchless(message);
+        else
+            ocall_bench(message);
+    }
+}